@@ -0,0 +1,113 @@
+#include "accel_curve.h"
+
+#include <math.h>
+#include <placement.h>
+
+#include <algorithm>
+
+AccelCurve::AccelCurve(const float* velocities, const float* accelerations,
+                       int points, float stepsPerUnit, float initialPulseDelay,
+                       float minPulseDelay)
+    : m_points(std::min(std::max(points, 1), ACCEL_CURVE_MAX_POINTS)),
+      m_stepsPerUnit(stepsPerUnit),
+      m_initialPulseDelay(initialPulseDelay),
+      m_minPulseDelay(minPulseDelay) {
+  for (int i = 0; i < m_points; i++) {
+    m_velocities[i] = velocities[i];
+    m_baseIncrements[i] = accelerations[i] / stepsPerUnit;
+    m_increments[i] = m_baseIncrements[i];
+  }
+
+  buildStoppingTable();
+}
+
+ELS_FASTRUN float AccelCurve::getIncrement(float pulseDelay) {
+  if (pulseDelay <= 0) {
+    return m_increments[m_points - 1];
+  }
+
+  float velocity = 1000000 / (pulseDelay * m_stepsPerUnit);
+  if (velocity <= m_velocities[0]) {
+    return m_increments[0];
+  }
+
+  for (int i = 1; i < m_points; i++) {
+    if (velocity < m_velocities[i]) {
+      float t = (velocity - m_velocities[i - 1]) /
+                (m_velocities[i] - m_velocities[i - 1]);
+      return m_increments[i - 1] + t * (m_increments[i] - m_increments[i - 1]);
+    }
+  }
+
+  return m_increments[m_points - 1];
+}
+
+void AccelCurve::buildStoppingTable() {
+  // decelerate from the fastest speed the same way the leadscrew does
+  m_stopDelayCount = 0;
+  m_stopTailPulses = 0;
+  float delay = m_minPulseDelay;
+  while (delay < m_initialPulseDelay &&
+         m_stopDelayCount < ACCEL_CURVE_MAX_STOP_PULSES) {
+    m_stopDelays[m_stopDelayCount++] = delay;
+    float increment = getIncrement(delay);
+    if (increment <= 0) {
+      break;
+    }
+    delay += increment * delay;
+  }
+
+  if (delay >= m_initialPulseDelay || m_stopDelayCount == 0) {
+    return;
+  }
+
+  // the table ran out, finish off with the gentlest increment left
+  float increment = getIncrement(delay);
+  for (float d = delay; d < m_initialPulseDelay; d *= 1.01) {
+    increment = std::min(increment, getIncrement(d));
+  }
+  if (increment > 0) {
+    m_stopTailPulses =
+        ceil(log(m_initialPulseDelay / delay) / log(1 + increment));
+  }
+}
+
+ELS_FASTRUN int AccelCurve::getPulsesToStop(float pulseDelay) {
+  if (pulseDelay >= m_initialPulseDelay || m_stopDelayCount == 0) {
+    return 0;
+  }
+
+  // a deceleration from a slower delay never catches up with one from a
+  // faster delay, so the last table delay at or below ours is an upper bound
+  float* next = std::upper_bound(m_stopDelays, m_stopDelays + m_stopDelayCount,
+                                 pulseDelay);
+  int index = std::max(0, (int)(next - m_stopDelays) - 1);
+
+  return m_stopDelayCount - index + m_stopTailPulses;
+}
+
+float AccelCurve::getInitialPulseDelay() { return m_initialPulseDelay; }
+
+void AccelCurve::setLimits(float maxAcceleration, float minPulseDelay) {
+  float basePeak = 0;
+  for (int i = 0; i < m_points; i++) {
+    basePeak = std::max(basePeak, m_baseIncrements[i]);
+  }
+  float scale = basePeak > 0 ? maxAcceleration / m_stepsPerUnit / basePeak : 0;
+  for (int i = 0; i < m_points; i++) {
+    m_increments[i] = m_baseIncrements[i] * scale;
+  }
+  m_minPulseDelay = minPulseDelay;
+
+  buildStoppingTable();
+}
+
+float AccelCurve::getMaxAcceleration() {
+  float peak = 0;
+  for (int i = 0; i < m_points; i++) {
+    peak = std::max(peak, m_increments[i]);
+  }
+  return peak * m_stepsPerUnit;
+}
+
+float AccelCurve::getMinPulseDelay() { return m_minPulseDelay; }
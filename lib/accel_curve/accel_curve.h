@@ -0,0 +1,70 @@
+#include <cstdint>
+
+#pragma once
+
+// the stopping table is statically allocated, anything slower than this many
+// pulses from the fastest speed is estimated with the gentlest acceleration
+#define ACCEL_CURVE_MAX_STOP_PULSES 1024
+// the most points a curve can have
+#define ACCEL_CURVE_MAX_POINTS 16
+
+/**
+ * An acceleration limit that changes with speed, stepper torque drops off as
+ * the motor speeds up so it can't accelerate as hard at high speed
+ *
+ * The curve is a table of velocities and the acceleration allowed at each of
+ * them, linearly interpolated in between and flat past either end. Like
+ * LEADSCREW_PULSE_DELAY_STEP_US the acceleration becomes a pulse delay
+ * increment, every pulse the delay changes by the increment times the last
+ * pulse duration
+ */
+class AccelCurve {
+ private:
+  float m_velocities[ACCEL_CURVE_MAX_POINTS];
+  // the shape the curve was built with, setLimits() scales it
+  float m_baseIncrements[ACCEL_CURVE_MAX_POINTS];
+  float m_increments[ACCEL_CURVE_MAX_POINTS];
+  int m_points;
+  float m_stepsPerUnit;
+
+  const float m_initialPulseDelay;
+  float m_minPulseDelay;
+
+  // every pulse delay a deceleration from the fastest speed goes through, the
+  // amount of pulses to stop from any delay is counted from here
+  float m_stopDelays[ACCEL_CURVE_MAX_STOP_PULSES];
+  int m_stopDelayCount;
+  // pulses to stop from the slowest delay in the table
+  int m_stopTailPulses;
+
+  void buildStoppingTable();
+
+ public:
+  /**
+   * `velocities` (units/s) have to be ascending, `accelerations` are in
+   * units/s^2 with one for each velocity. `minPulseDelay` is the fastest the
+   * axis can be pulsed
+   */
+  AccelCurve(const float* velocities, const float* accelerations, int points,
+             float stepsPerUnit, float initialPulseDelay, float minPulseDelay);
+
+  // the pulse delay increment allowed when pulsing every `pulseDelay` us
+  float getIncrement(float pulseDelay);
+  /**
+   * The amount of pulses it takes to slow down from `pulseDelay` to the
+   * initial pulse delay, never less than the real amount
+   */
+  int getPulsesToStop(float pulseDelay);
+  float getInitialPulseDelay();
+
+  /**
+   * Scales the whole curve so its highest acceleration is `maxAcceleration`,
+   * in the units it was built with, and rebuilds the stopping table from
+   * `minPulseDelay`. Far too slow for the motion timer, change a curve it
+   * isn't using and hand it over through the MotionMailbox
+   */
+  void setLimits(float maxAcceleration, float minPulseDelay);
+  // the highest acceleration anywhere on the curve
+  float getMaxAcceleration();
+  float getMinPulseDelay();
+};
@@ -1,4 +1,5 @@
-#include <els_elapsedMillis.h>
+#include <clock.h>
+#include <placement.h>
 
 #include <cstdint>
 
@@ -12,20 +13,31 @@ class Axis {
  protected:
   volatile int m_currentPosition;
 
-  // the timestamp of the last pulse
-  elapsedMicros m_lastPulseMicros;
+  // everything the axis times comes from this clock
+  Clock* m_clock;
+
+  // the time since the last pulse
+  ElapsedMicros m_lastPulseMicros;
 
   // the elapsed time for the last full pulse duration
   uint32_t m_lastFullPulseDurationMicros;
 
  public:
-  Axis() {
-    m_lastPulseMicros = 0;
+  explicit Axis(Clock* clock = SystemClock::getInstance())
+      : m_clock(clock), m_lastPulseMicros(clock) {
     m_lastFullPulseDurationMicros = 0;
     m_currentPosition = 0;
   }
-  virtual int getCurrentPosition() { return m_currentPosition; }
+  ELS_FASTRUN virtual int getCurrentPosition() { return m_currentPosition; }
   virtual void resetCurrentPosition() { m_currentPosition = 0; }
+  /**
+   * Times the axis with another clock, every timer restarts from now
+   * Defaults to the clock it was constructed with
+   */
+  virtual void setClock(Clock* clock) {
+    m_clock = clock;
+    m_lastPulseMicros.setClock(clock);
+  }
   virtual uint32_t getEstimatedVelocityInPulsesPerSecond() {
     // ensure that we're not in some ridiculous state where the spindle has
     // stopped for a long time
@@ -48,11 +60,15 @@ class Axis {
 
 class RotationalAxis : public Axis {
  public:
+  explicit RotationalAxis(Clock* clock = SystemClock::getInstance())
+      : Axis(clock) {}
   virtual float getEstimatedVelocityInRPM() = 0;
 };
 
 class LinearAxis : public Axis {
  public:
+  explicit LinearAxis(Clock* clock = SystemClock::getInstance())
+      : Axis(clock) {}
   virtual float getEstimatedVelocityInMillimetersPerSecond() = 0;
 };
 
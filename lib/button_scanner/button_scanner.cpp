@@ -0,0 +1,135 @@
+#include "button_scanner.h"
+
+#include <placement.h>
+
+ButtonScanner::ButtonScanner(uint32_t heldTicks, uint32_t doubleClickTicks)
+    : m_heldTicks(heldTicks),
+      m_doubleClickTicks(doubleClickTicks),
+      // start the counters at their idle value, a change needs a full count
+      m_counterLow(UINT32_MAX),
+      m_counterHigh(UINT32_MAX),
+      m_debouncedMask(0),
+      m_heldMask(0),
+      m_clickPendingMask(0),
+      m_secondPressMask(0),
+      m_tick(0),
+      m_droppedEvents(0) {
+  for (int i = 0; i < BUTTON_SCANNER_MAX_BUTTONS; i++) {
+    m_pressedTick[i] = 0;
+    m_releasedTick[i] = 0;
+  }
+}
+
+ELS_FASTRUN void ButtonScanner::pushEvent(uint8_t button,
+                                          ButtonEventType type) {
+  ButtonEvent event = {button, type, m_tick.load(std::memory_order_relaxed)};
+  if (!m_events.push(event)) {
+    m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+ELS_FASTRUN void ButtonScanner::sample(uint32_t rawMask) {
+  uint32_t tick = m_tick.load(std::memory_order_relaxed) + 1;
+  m_tick.store(tick, std::memory_order_relaxed);
+
+  uint32_t previous = m_debouncedMask.load(std::memory_order_relaxed);
+
+  // vertical counter - any bit that differs from the debounced state counts
+  // down, any bit that matches is reset. A bit only toggles once its counter
+  // rolls over
+  uint32_t changed = rawMask ^ previous;
+  m_counterLow = ~(m_counterLow & changed);
+  m_counterHigh = m_counterLow ^ (m_counterHigh & changed);
+  changed &= m_counterLow & m_counterHigh;
+
+  uint32_t debounced = previous ^ changed;
+  m_debouncedMask.store(debounced, std::memory_order_relaxed);
+
+  uint32_t pressedEdges = debounced & changed;
+  uint32_t releasedEdges = previous & changed;
+  uint32_t heldMask = m_heldMask.load(std::memory_order_relaxed);
+
+  // time out clicks that didn't get a second press in time
+  uint32_t pending = m_clickPendingMask;
+  while (pending) {
+    uint8_t button = __builtin_ctz(pending);
+    pending &= pending - 1;
+    if (tick - m_releasedTick[button] > m_doubleClickTicks) {
+      m_clickPendingMask &= ~(1u << button);
+      pushEvent(button, SINGLE_CLICKED);
+    }
+  }
+
+  uint32_t edges = pressedEdges;
+  while (edges) {
+    uint8_t button = __builtin_ctz(edges);
+    edges &= edges - 1;
+    uint32_t bit = 1u << button;
+
+    m_pressedTick[button] = tick;
+    if (m_clickPendingMask & bit) {
+      m_clickPendingMask &= ~bit;
+      m_secondPressMask |= bit;
+    }
+    pushEvent(button, PRESSED);
+  }
+
+  // anything still down that isn't held yet is a candidate for a hold
+  uint32_t candidates = debounced & ~heldMask;
+  while (candidates) {
+    uint8_t button = __builtin_ctz(candidates);
+    candidates &= candidates - 1;
+    uint32_t bit = 1u << button;
+
+    if (tick - m_pressedTick[button] >= m_heldTicks) {
+      heldMask |= bit;
+      // a hold cancels out any double click in progress
+      m_secondPressMask &= ~bit;
+      pushEvent(button, HELD);
+    }
+  }
+
+  edges = releasedEdges;
+  while (edges) {
+    uint8_t button = __builtin_ctz(edges);
+    edges &= edges - 1;
+    uint32_t bit = 1u << button;
+
+    pushEvent(button, RELEASED);
+
+    // releasing a held button is not a click
+    if (heldMask & bit) {
+      heldMask &= ~bit;
+      continue;
+    }
+
+    pushEvent(button, CLICKED);
+    if (m_secondPressMask & bit) {
+      m_secondPressMask &= ~bit;
+      pushEvent(button, DOUBLE_CLICKED);
+    } else {
+      m_clickPendingMask |= bit;
+      m_releasedTick[button] = tick;
+    }
+  }
+
+  m_heldMask.store(heldMask, std::memory_order_relaxed);
+}
+
+bool ButtonScanner::popEvent(ButtonEvent *event) { return m_events.pop(event); }
+
+uint32_t ButtonScanner::getPressedMask() {
+  return m_debouncedMask.load(std::memory_order_relaxed);
+}
+
+uint32_t ButtonScanner::getHeldMask() {
+  return m_heldMask.load(std::memory_order_relaxed);
+}
+
+uint32_t ButtonScanner::getTick() {
+  return m_tick.load(std::memory_order_relaxed);
+}
+
+uint32_t ButtonScanner::getDroppedEvents() {
+  return m_droppedEvents.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,95 @@
+#include <spsc_queue.h>
+
+#include <cstdint>
+
+#pragma once
+
+// the maximum amount of buttons a single scanner can handle, one per mask bit
+#define BUTTON_SCANNER_MAX_BUTTONS 32
+
+// must be a power of two, see SpscQueue
+#define BUTTON_SCANNER_QUEUE_SIZE 32
+
+/**
+ * Pressed: the button has been debounced as pressed
+ * Released: the button has been debounced as released
+ * Clicked: the button was released without being held, fires immediately
+ * Single clicked: a click that wasn't followed by a second one within the
+ * double click time
+ * Double clicked: two clicks within the double click time
+ * Held: the button has been pressed for longer than the held time
+ */
+enum ButtonEventType {
+  PRESSED,
+  RELEASED,
+  CLICKED,
+  SINGLE_CLICKED,
+  DOUBLE_CLICKED,
+  HELD
+};
+
+struct ButtonEvent {
+  uint8_t button;
+  ButtonEventType type;
+  // the sample tick the event was detected on
+  uint32_t tick;
+};
+
+/**
+ * Debounces and detects events for up to 32 buttons at once
+ *
+ * All buttons are sampled together as a single bitmask at a fixed rate and
+ * debounced with a 2 bit vertical counter, so a button has to read the same
+ * for 4 consecutive samples before the debounced state changes.
+ *
+ * sample() is expected to be called from the timer interrupt, the events it
+ * detects are queued up for the main loop to read with popEvent()
+ */
+class ButtonScanner {
+ private:
+  const uint32_t m_heldTicks;
+  const uint32_t m_doubleClickTicks;
+
+  // vertical counter, one bit of the counter per mask
+  uint32_t m_counterLow;
+  uint32_t m_counterHigh;
+
+  std::atomic<uint32_t> m_debouncedMask;
+  std::atomic<uint32_t> m_heldMask;
+
+  // buttons that have been clicked once and are waiting for a second click
+  uint32_t m_clickPendingMask;
+  // buttons that were pressed while a click was pending
+  uint32_t m_secondPressMask;
+
+  std::atomic<uint32_t> m_tick;
+  uint32_t m_pressedTick[BUTTON_SCANNER_MAX_BUTTONS];
+  uint32_t m_releasedTick[BUTTON_SCANNER_MAX_BUTTONS];
+
+  SpscQueue<ButtonEvent, BUTTON_SCANNER_QUEUE_SIZE> m_events;
+  std::atomic<uint32_t> m_droppedEvents;
+
+  void pushEvent(uint8_t button, ButtonEventType type);
+
+ public:
+  /**
+   * heldTicks and doubleClickTicks are in sample ticks, i.e multiples of the
+   * sample period
+   */
+  ButtonScanner(uint32_t heldTicks, uint32_t doubleClickTicks);
+
+  /**
+   * Feed in a new raw sample, a set bit means the button is physically pressed
+   */
+  void sample(uint32_t rawMask);
+
+  /**
+   * Returns false when there are no events left to read
+   */
+  bool popEvent(ButtonEvent *event);
+
+  uint32_t getPressedMask();
+  uint32_t getHeldMask();
+  uint32_t getTick();
+  uint32_t getDroppedEvents();
+};
@@ -0,0 +1,25 @@
+#include "jog_pacer.h"
+
+JogPacer::JogPacer(Clock* clock) : m_owed(clock), m_held(false) {}
+
+int JogPacer::update(bool held, float pulseDelay) {
+  if (!held) {
+    m_held = false;
+    return 0;
+  }
+
+  if (!m_held) {
+    m_held = true;
+    m_owed = 0;
+    return 0;
+  }
+
+  // never faster than a position a microsecond, even at a ratio of 0
+  if (pulseDelay < 1) {
+    pulseDelay = 1;
+  }
+
+  int positions = (uint64_t)m_owed / pulseDelay;
+  m_owed -= (uint64_t)(positions * pulseDelay);
+  return positions;
+}
@@ -0,0 +1,30 @@
+#include <clock.h>
+
+#include <cstdint>
+
+#pragma once
+
+/**
+ * Turns how long a jog button has been held into leadscrew positions, one
+ * every pulse delay
+ *
+ * The buttons are handled far slower than the jog rate, so every call hands
+ * back all the whole delays since the last one and carries the remainder over.
+ * The count starts from 0 when the button goes down, so the time it sat idle
+ * isn't jogged all at once
+ */
+class JogPacer {
+ private:
+  // the time that hasn't been turned into positions yet
+  ElapsedMicros m_owed;
+  bool m_held;
+
+ public:
+  explicit JogPacer(Clock* clock = SystemClock::getInstance());
+
+  /**
+   * The amount of positions to jog, call it every time the buttons are handled
+   * while jogging is allowed
+   */
+  int update(bool held, float pulseDelay);
+};
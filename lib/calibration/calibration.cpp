@@ -0,0 +1,273 @@
+#include "calibration.h"
+
+#include <config.h>
+
+#include <algorithm>
+
+#ifndef PIO_UNIT_TESTING
+#include <Arduino.h>
+#endif
+
+Calibration::Calibration(Leadscrew* leadscrew, MotionMailbox* mailbox,
+                         CalibrationStore* store, AccelCurve* curve,
+                         AccelCurve* spareCurve,
+                         const CalibrationSettings& settings,
+                         float stepsPerUnit, float minPulseDelay)
+    : m_leadscrew(leadscrew),
+      m_mailbox(mailbox),
+      m_store(store),
+      m_globalState(GlobalState::getInstance()),
+      m_curves{curve, spareCurve},
+      m_search(settings),
+      m_returnLimits(settings.start),
+      m_stepsPerUnit(stepsPerUnit),
+      m_minPulseDelay(minPulseDelay),
+      m_state(CalibrationState::CALIBRATION_IDLE),
+      m_originalAcceleration(0),
+      m_originalCurvePulseDelay(0),
+      m_originalTopSpeedPulseDelay(0),
+      m_travelPulses(0),
+      m_trialFailed(false),
+      m_trialConfirmed(false),
+      m_trialCorrectedSteps(0),
+      m_trials(0) {}
+
+void Calibration::setGlobalState(GlobalState* globalState) {
+  m_globalState = globalState;
+}
+
+float Calibration::getTopSpeedPulseDelay(float topSpeed) {
+  return std::max(US_PER_SECOND / (topSpeed * m_stepsPerUnit),
+                  m_minPulseDelay);
+}
+
+AccelCurve* Calibration::getSpareCurve() {
+  AccelCurve* active = m_leadscrew->getAccelCurve();
+  if (active == m_curves[0]) {
+    return m_curves[1];
+  }
+  if (active == m_curves[1]) {
+    return m_curves[0];
+  }
+  return nullptr;
+}
+
+void Calibration::setLimits(float acceleration, float curvePulseDelay,
+                            float topSpeedPulseDelay) {
+  AccelCurve* spare = getSpareCurve();
+  spare->setLimits(acceleration, curvePulseDelay);
+  m_mailbox->postSetMotionLimits(spare, topSpeedPulseDelay);
+}
+
+bool Calibration::begin() {
+  CalibrationLimits limits;
+  AccelCurve* curve = m_leadscrew->getAccelCurve();
+  if (curve == nullptr || !m_store->load(&limits) ||
+      limits.acceleration <= 0 || limits.topSpeed <= 0) {
+    return false;
+  }
+
+  // the timer isn't running yet, so the leadscrew can be changed directly
+  float pulseDelay = getTopSpeedPulseDelay(limits.topSpeed);
+  curve->setLimits(limits.acceleration, pulseDelay);
+  m_leadscrew->setTopSpeedPulseDelay(pulseDelay);
+  return true;
+}
+
+bool Calibration::start() {
+  if (isRunning() || m_leadscrew->isStalled() ||
+      m_globalState->getMotionMode() == GlobalMotionMode::ENABLED ||
+      getSpareCurve() == nullptr) {
+    return false;
+  }
+  if (m_leadscrew->getStopPositionState(Leadscrew::StopPosition::LEFT) ==
+          LeadscrewStopState::UNSET ||
+      m_leadscrew->getStopPositionState(Leadscrew::StopPosition::RIGHT) ==
+          LeadscrewStopState::UNSET) {
+    return false;
+  }
+  int distance = m_leadscrew->getStopPosition(Leadscrew::StopPosition::RIGHT) -
+                 m_leadscrew->getStopPosition(Leadscrew::StopPosition::LEFT);
+  if (distance <= 0) {
+    return false;
+  }
+
+  AccelCurve* active = m_leadscrew->getAccelCurve();
+  m_originalAcceleration = active->getMaxAcceleration();
+  m_originalCurvePulseDelay = active->getMinPulseDelay();
+  m_originalTopSpeedPulseDelay = m_leadscrew->getTopSpeedPulseDelay();
+
+  m_travelPulses = distance * m_leadscrew->getPulsesPerPosition();
+  m_search.reset();
+  m_trials = 0;
+
+  // the trials are jogs, they don't keep the thread in sync either
+  m_globalState->setThreadSyncState(GlobalThreadSyncState::UNSYNC);
+  moveTo(Leadscrew::StopPosition::LEFT);
+  m_state = CalibrationState::CALIBRATION_HOMING;
+  return true;
+}
+
+void Calibration::abort() {
+  if (!isRunning()) {
+    return;
+  }
+  m_globalState->setMotionMode(GlobalMotionMode::DISABLED);
+  m_state = CalibrationState::CALIBRATION_STOPPING;
+}
+
+void Calibration::moveTo(Leadscrew::StopPosition stop) {
+  // a handwheel jog ends by disabling motion, take it back for the trial
+  m_globalState->setMotionMode(GlobalMotionMode::JOG);
+  m_mailbox->postIncrementExpectedPosition(
+      m_leadscrew->getStopPosition(stop) - m_leadscrew->getExpectedPosition());
+}
+
+bool Calibration::isSettled() {
+  if (m_leadscrew->isStalled()) {
+    m_trialFailed = true;
+    if (!m_mailbox->isPending()) {
+      m_mailbox->postRecoverStall();
+    }
+    return false;
+  }
+  return !m_mailbox->isPending() && m_leadscrew->isIdle();
+}
+
+void Calibration::startTrial() {
+  AccelCurve* spare = getSpareCurve();
+  while (true) {
+    CalibrationLimits trial = m_search.getTrial();
+    float pulseDelay = getTopSpeedPulseDelay(trial.topSpeed);
+    spare->setLimits(trial.acceleration, pulseDelay);
+    // speeding up takes about as long as stopping, a trial that can't get to
+    // its top speed between the stops wouldn't prove anything
+    if (2 * spare->getPulsesToStop(pulseDelay) <= m_travelPulses) {
+      m_mailbox->postSetMotionLimits(spare, pulseDelay);
+      break;
+    }
+    m_search.report(false);
+    if (m_search.isDone()) {
+      finish();
+      return;
+    }
+  }
+
+  m_trialFailed = false;
+  m_trialConfirmed = false;
+  m_trialCorrectedSteps = m_leadscrew->getCorrectedSteps();
+  m_trials++;
+  moveTo(Leadscrew::StopPosition::RIGHT);
+  m_state = CalibrationState::CALIBRATION_OUTBOUND;
+}
+
+void Calibration::startReturn() {
+  float pulseDelay = getTopSpeedPulseDelay(m_returnLimits.topSpeed);
+  setLimits(m_returnLimits.acceleration, pulseDelay, pulseDelay);
+  moveTo(Leadscrew::StopPosition::LEFT);
+  m_state = CalibrationState::CALIBRATION_RETURNING;
+}
+
+void Calibration::finishTrial(bool passed) {
+  m_search.report(passed);
+  if (m_search.isDone()) {
+    finish();
+    return;
+  }
+  startTrial();
+}
+
+void Calibration::finish() {
+  if (m_search.getPhase() == CalibrationPhase::CALIBRATION_FINISHED) {
+    CalibrationLimits result = m_search.getResult();
+    float pulseDelay = getTopSpeedPulseDelay(result.topSpeed);
+    setLimits(result.acceleration, pulseDelay, pulseDelay);
+    m_store->save(result);
+  } else {
+    setLimits(m_originalAcceleration, m_originalCurvePulseDelay,
+              m_originalTopSpeedPulseDelay);
+  }
+  m_globalState->setMotionMode(GlobalMotionMode::DISABLED);
+  m_state = CalibrationState::CALIBRATION_IDLE;
+}
+
+void Calibration::update() {
+  switch (m_state) {
+    case CalibrationState::CALIBRATION_IDLE:
+    case CalibrationState::CALIBRATION_CONFIRMING:
+      break;
+    case CalibrationState::CALIBRATION_HOMING:
+      if (isSettled()) {
+        startTrial();
+      }
+      break;
+    case CalibrationState::CALIBRATION_OUTBOUND:
+      if (isSettled()) {
+        startReturn();
+      }
+      break;
+    case CalibrationState::CALIBRATION_RETURNING:
+      if (!isSettled()) {
+        break;
+      }
+      if (!m_leadscrew->hasFeedback() && !m_trialConfirmed) {
+        m_state = CalibrationState::CALIBRATION_CONFIRMING;
+        break;
+      }
+      // a correction means the motor fell behind, even if it never stalled
+      finishTrial(!m_trialFailed && m_leadscrew->getCorrectedSteps() ==
+                                        m_trialCorrectedSteps);
+      break;
+    case CalibrationState::CALIBRATION_STOPPING:
+      // the last limits we posted may not have been picked up yet
+      if (!m_mailbox->isPending()) {
+        setLimits(m_originalAcceleration, m_originalCurvePulseDelay,
+                  m_originalTopSpeedPulseDelay);
+        m_state = CalibrationState::CALIBRATION_IDLE;
+      }
+      break;
+  }
+}
+
+void Calibration::confirm(bool onMark) {
+  if (m_state != CalibrationState::CALIBRATION_CONFIRMING) {
+    return;
+  }
+  m_trialFailed = !onMark;
+  m_trialConfirmed = true;
+  // wait for any jog back to the mark to finish first
+  m_state = CalibrationState::CALIBRATION_RETURNING;
+}
+
+bool Calibration::isRunning() {
+  return m_state != CalibrationState::CALIBRATION_IDLE &&
+         m_state != CalibrationState::CALIBRATION_STOPPING;
+}
+
+bool Calibration::isWaitingForOperator() {
+  return m_state == CalibrationState::CALIBRATION_CONFIRMING;
+}
+
+CalibrationState Calibration::getState() { return m_state; }
+
+CalibrationPhase Calibration::getPhase() { return m_search.getPhase(); }
+
+CalibrationLimits Calibration::getLimits() { return m_search.getTrial(); }
+
+int Calibration::getTrials() { return m_trials; }
+
+void Calibration::printState() {
+#ifndef PIO_UNIT_TESTING
+  Serial.print("Calibration state: ");
+  Serial.println(m_state);
+  Serial.print("Calibration phase: ");
+  Serial.println(getPhase());
+  Serial.print("Calibration trials: ");
+  Serial.println(getTrials());
+  CalibrationLimits limits = getLimits();
+  Serial.print("Calibration acceleration: ");
+  Serial.println(limits.acceleration);
+  Serial.print("Calibration top speed: ");
+  Serial.println(limits.topSpeed);
+#endif
+}
@@ -0,0 +1,129 @@
+#include <accel_curve.h>
+#include <globalstate.h>
+#include <leadscrew.h>
+#include <motion_mailbox.h>
+
+#include "calibration_search.h"
+#include "calibration_store.h"
+
+#pragma once
+
+enum CalibrationState {
+  CALIBRATION_IDLE,
+  // moving to the left stop before the first trial
+  CALIBRATION_HOMING,
+  // the two halves of a trial, left stop to right stop and back again
+  CALIBRATION_OUTBOUND,
+  CALIBRATION_RETURNING,
+  // without feedback the operator says whether the carriage came back to its
+  // mark, see confirm()
+  CALIBRATION_CONFIRMING,
+  // aborted, the original limits go back once the mailbox is free
+  CALIBRATION_STOPPING
+};
+
+/**
+ * Runs the carriage back and forth between the stops with more and more
+ * aggressive limits to find the acceleration and top speed it manages
+ * reliably, then saves them and hands them to the leadscrew
+ *
+ * Every trial goes from the left stop to the right stop and back, a trial
+ * fails if the motor lost steps on the way, or if the stops are too close
+ * together to reach its top speed and stop again. With a feedback encoder
+ * that's a stall or any correction, the missed steps are re-sent so the
+ * carriage still ends up on the stop. Without one the operator marks where the carriage sits
+ * at the left stop and confirms after every trial whether it came back to the
+ * mark, jogging it back first if it didn't
+ *
+ * Lives in the main loop, the leadscrew is only ever changed through the
+ * MotionMailbox. The spindle has to stay still while it runs
+ */
+class Calibration {
+ private:
+  Leadscrew* m_leadscrew;
+  MotionMailbox* m_mailbox;
+  CalibrationStore* m_store;
+  GlobalState* m_globalState;
+  // the curve the leadscrew starts with and a spare, new limits always go on
+  // the one the timer isn't using and are handed over through the mailbox
+  AccelCurve* m_curves[2];
+  CalibrationSearch m_search;
+  // what the way back from every trial runs at, see startReturn()
+  CalibrationLimits m_returnLimits;
+  float m_stepsPerUnit;
+  // the fastest the timer can pulse
+  float m_minPulseDelay;
+
+  CalibrationState m_state;
+  // the limits from before the calibration, put back if it fails
+  float m_originalAcceleration;
+  float m_originalCurvePulseDelay;
+  float m_originalTopSpeedPulseDelay;
+
+  // how many pulses it is from one stop to the other
+  int m_travelPulses;
+  bool m_trialFailed;
+  bool m_trialConfirmed;
+  int m_trialCorrectedSteps;
+  int m_trials;
+
+  float getTopSpeedPulseDelay(float topSpeed);
+  // the curve the timer isn't using, nullptr if the leadscrew has neither
+  AccelCurve* getSpareCurve();
+  void setLimits(float acceleration, float curvePulseDelay,
+                 float topSpeedPulseDelay);
+  void moveTo(Leadscrew::StopPosition stop);
+  /**
+   * True once everything posted has been applied and the leadscrew has come
+   * to rest. Stalls on the way fail the trial and are recovered from
+   */
+  bool isSettled();
+  void startTrial();
+  /**
+   * Heads back to the left stop at the starting limits. Those are the ones
+   * the search assumes are reliable, so whatever the trial lost on the way out
+   * is still missing when the carriage gets back to the operator's mark
+   */
+  void startReturn();
+  void finishTrial(bool passed);
+  void finish();
+
+ public:
+  Calibration(Leadscrew* leadscrew, MotionMailbox* mailbox,
+              CalibrationStore* store, AccelCurve* curve,
+              AccelCurve* spareCurve, const CalibrationSettings& settings,
+              float stepsPerUnit, float minPulseDelay);
+  // the motion mode comes from the shared GlobalState unless given another
+  void setGlobalState(GlobalState* globalState);
+
+  /**
+   * Applies any saved limits straight to the leadscrew, call it from setup()
+   * before the motion timer starts. Returns false if nothing was saved
+   */
+  bool begin();
+  /**
+   * Starts calibrating if both stops are set, motion isn't enabled and the
+   * leadscrew hasn't stalled. Returns false if it couldn't start
+   */
+  bool start();
+  // stops where it is and puts the original limits back
+  void abort();
+  // call regularly from the main loop, it moves on once the leadscrew has
+  void update();
+  /**
+   * The operator's answer after a trial without feedback, whether the carriage
+   * came back to its mark. If it didn't it has to be jogged back to the mark
+   * before answering
+   */
+  void confirm(bool onMark);
+
+  bool isRunning();
+  bool isWaitingForOperator();
+  CalibrationState getState();
+  CalibrationPhase getPhase();
+  // the trial being run, or the result once it's finished
+  CalibrationLimits getLimits();
+  int getTrials();
+
+  void printState();
+};
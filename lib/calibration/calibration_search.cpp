@@ -0,0 +1,101 @@
+#include "calibration_search.h"
+
+#include <algorithm>
+
+CalibrationSearch::CalibrationSearch(const CalibrationSettings& settings)
+    : m_settings(settings) {
+  reset();
+}
+
+void CalibrationSearch::reset() {
+  m_result = {0, 0};
+  startPhase(CalibrationPhase::CALIBRATING_ACCELERATION,
+             m_settings.start.acceleration);
+}
+
+void CalibrationSearch::startPhase(CalibrationPhase phase, float start) {
+  m_phase = phase;
+  m_trial = std::min(start, getMax());
+  m_passed = 0;
+  m_failed = 0;
+  m_refined = 0;
+  m_passes = 0;
+}
+
+float CalibrationSearch::getMax() {
+  if (m_phase == CalibrationPhase::CALIBRATING_TOP_SPEED) {
+    return m_settings.max.topSpeed;
+  }
+  return m_settings.max.acceleration;
+}
+
+void CalibrationSearch::finishPhase(float result) {
+  if (m_phase == CalibrationPhase::CALIBRATING_ACCELERATION) {
+    m_result.acceleration = result;
+    startPhase(CalibrationPhase::CALIBRATING_TOP_SPEED,
+               m_settings.start.topSpeed);
+    return;
+  }
+  m_result.topSpeed = result;
+  m_phase = CalibrationPhase::CALIBRATION_FINISHED;
+}
+
+CalibrationLimits CalibrationSearch::getTrial() {
+  if (m_phase == CalibrationPhase::CALIBRATING_ACCELERATION) {
+    // the same top speed for every trial, so they only differ in acceleration
+    return {m_trial, m_settings.start.topSpeed};
+  }
+  if (m_phase == CalibrationPhase::CALIBRATING_TOP_SPEED) {
+    return {m_result.acceleration, m_trial};
+  }
+  return m_result;
+}
+
+void CalibrationSearch::report(bool passed) {
+  if (isDone()) {
+    return;
+  }
+
+  if (passed && ++m_passes < m_settings.passes) {
+    return;
+  }
+  m_passes = 0;
+
+  if (passed) {
+    m_passed = m_trial;
+  } else {
+    // not even the start is reliable, there's nothing to go on
+    if (m_passed == 0) {
+      m_phase = CalibrationPhase::CALIBRATION_FAILED;
+      return;
+    }
+    m_failed = m_trial;
+  }
+
+  // still growing, nothing has failed yet
+  if (m_failed == 0) {
+    if (m_trial >= getMax()) {
+      // never failed, the limit is as good as the most we were allowed to try
+      finishPhase(m_passed);
+      return;
+    }
+    m_trial = std::min(m_trial * m_settings.growth, getMax());
+    return;
+  }
+
+  if (m_refined >= m_settings.refineSteps) {
+    finishPhase(m_passed * m_settings.margin);
+    return;
+  }
+  m_refined++;
+  m_trial = (m_passed + m_failed) / 2;
+}
+
+CalibrationPhase CalibrationSearch::getPhase() { return m_phase; }
+
+bool CalibrationSearch::isDone() {
+  return m_phase == CalibrationPhase::CALIBRATION_FINISHED ||
+         m_phase == CalibrationPhase::CALIBRATION_FAILED;
+}
+
+CalibrationLimits CalibrationSearch::getResult() { return m_result; }
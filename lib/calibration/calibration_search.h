@@ -0,0 +1,78 @@
+#include <cstdint>
+
+#pragma once
+
+/**
+ * What the leadscrew profile is limited to, the acceleration in the units of
+ * LEADSCREW_ACCEL and the top speed in mm/s
+ */
+struct CalibrationLimits {
+  float acceleration;
+  float topSpeed;
+};
+
+struct CalibrationSettings {
+  // the first trial and the most that will be tried
+  CalibrationLimits start;
+  CalibrationLimits max;
+  // every passed trial multiplies the limit by this until one fails
+  float growth;
+  // how many times the gap between the last pass and the first failure is
+  // halved after that
+  int refineSteps;
+  // a trial has to pass this many times in a row to count
+  int passes;
+  // the result is the highest pass times this, so a cold or dirty machine
+  // still has some headroom
+  float margin;
+};
+
+enum CalibrationPhase {
+  CALIBRATING_ACCELERATION,
+  CALIBRATING_TOP_SPEED,
+  CALIBRATION_FINISHED,
+  CALIBRATION_FAILED
+};
+
+/**
+ * Finds the highest acceleration and top speed the leadscrew manages reliably
+ *
+ * The acceleration comes first, tried at the starting top speed, then the top
+ * speed at the acceleration that was found. Each limit grows geometrically
+ * from the start until a trial fails and then bisects between the last pass
+ * and the first failure. Nothing here moves anything, the caller runs each
+ * trial and reports whether the motor kept up
+ */
+class CalibrationSearch {
+ private:
+  CalibrationSettings m_settings;
+  CalibrationPhase m_phase;
+
+  float m_trial;
+  // the highest value that passed and the lowest that failed in this phase, 0
+  // until there is one
+  float m_passed;
+  float m_failed;
+  int m_refined;
+  int m_passes;
+  CalibrationLimits m_result;
+
+  void startPhase(CalibrationPhase phase, float start);
+  void finishPhase(float result);
+  // the limit of the current phase
+  float getMax();
+
+ public:
+  explicit CalibrationSearch(const CalibrationSettings& settings);
+
+  // starts again from the beginning
+  void reset();
+  // the limits to run the next trial with
+  CalibrationLimits getTrial();
+  void report(bool passed);
+
+  CalibrationPhase getPhase();
+  bool isDone();
+  // only valid once the phase is CALIBRATION_FINISHED
+  CalibrationLimits getResult();
+};
@@ -0,0 +1,14 @@
+#include "calibration_search.h"
+
+#pragma once
+
+/**
+ * Where calibrated limits are kept between power cycles, abstracted away so
+ * the calibration can be tested without the hardware
+ */
+class CalibrationStore {
+ public:
+  // returns false if nothing valid has been saved
+  virtual bool load(CalibrationLimits* limits) = 0;
+  virtual void save(const CalibrationLimits& limits) = 0;
+};
@@ -0,0 +1,60 @@
+#include <EEPROM.h>
+#include <config.h>
+
+#include <cstddef>
+#include <cstring>
+
+#include "calibration_store.h"
+#pragma once
+
+// "ELSC", anything else at the address was never written by us
+#define CALIBRATION_STORE_MAGIC 0x43534C45
+// bump this when CalibrationLimits changes so old records are ignored
+#define CALIBRATION_STORE_VERSION 1
+
+/**
+ * Keeps the limits in the Teensy's emulated EEPROM with a checksum, so a blank
+ * or half written record reads as nothing saved
+ */
+class CalibrationStoreImpl : public CalibrationStore {
+  struct Record {
+    uint32_t magic;
+    uint32_t version;
+    CalibrationLimits limits;
+    uint32_t checksum;
+  };
+
+  static uint32_t checksum(const Record& record) {
+    // FNV-1a over everything before the checksum
+    const uint8_t* bytes = (const uint8_t*)&record;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Record, checksum); i++) {
+      hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+  }
+
+ public:
+  bool load(CalibrationLimits* limits) override {
+    Record record;
+    EEPROM.get(ELS_CALIBRATION_EEPROM_ADDRESS, record);
+    if (record.magic != CALIBRATION_STORE_MAGIC ||
+        record.version != CALIBRATION_STORE_VERSION ||
+        record.checksum != checksum(record)) {
+      return false;
+    }
+    *limits = record.limits;
+    return true;
+  }
+
+  void save(const CalibrationLimits& limits) override {
+    Record record;
+    memset(&record, 0, sizeof(record));
+    record.magic = CALIBRATION_STORE_MAGIC;
+    record.version = CALIBRATION_STORE_VERSION;
+    record.limits = limits;
+    record.checksum = checksum(record);
+    // put() only writes the bytes that changed, sparing the flash
+    EEPROM.put(ELS_CALIBRATION_EEPROM_ADDRESS, record);
+  }
+};
@@ -0,0 +1,76 @@
+#include "clock.h"
+
+#include <placement.h>
+
+#ifdef PIO_UNIT_TESTING
+#include <els_elapsedMillis.h>
+#endif
+
+CounterExtender::CounterExtender() : m_lastCount(0), m_wraps(0) {}
+
+ELS_FASTRUN uint64_t CounterExtender::extend(uint32_t count) {
+  if (count < m_lastCount) {
+    m_wraps++;
+  }
+  m_lastCount = count;
+  return (m_wraps << 32) | count;
+}
+
+CycleConverter::CycleConverter() : m_cyclesPerMicro(0), m_reciprocal(0) {}
+
+ELS_FASTRUN void CycleConverter::setCyclesPerMicro(uint32_t cyclesPerMicro) {
+  if (cyclesPerMicro == m_cyclesPerMicro) {
+    return;
+  }
+  m_cyclesPerMicro = cyclesPerMicro;
+  // rounded up, rounding down would put every whole microsecond one short
+  m_reciprocal = cyclesPerMicro == 0
+                     ? 0
+                     : ((1ull << 32) + cyclesPerMicro - 1) / cyclesPerMicro;
+}
+
+ELS_FASTRUN uint64_t CycleConverter::toMicros(uint64_t cycles) {
+  // cycles * reciprocal >> 32 without needing 96 bits
+  uint64_t high = (cycles >> 32) * m_reciprocal;
+  uint64_t low = ((cycles & 0xFFFFFFFFull) * m_reciprocal) >> 32;
+  return high + low;
+}
+
+SystemClock* SystemClock::getInstance() {
+  static SystemClock instance;
+  return &instance;
+}
+
+ELS_FASTRUN uint64_t SystemClock::nowCycles() {
+#if !defined(PIO_UNIT_TESTING) && defined(__IMXRT1062__)
+  // the loop and the timer both read the clock, the wrap check can't be
+  // interrupted half way through
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask\n" : "=r"(primask)::);
+  __disable_irq();
+  uint64_t cycles = m_cycles.extend(ARM_DWT_CYCCNT);
+  if (!primask) {
+    __enable_irq();
+  }
+  return cycles;
+#else
+  return 0;
+#endif
+}
+
+ELS_FASTRUN uint64_t SystemClock::nowMicros() {
+#if !defined(PIO_UNIT_TESTING) && defined(__IMXRT1062__)
+  // only works anything out when the CPU clock has changed
+  m_converter.setCyclesPerMicro(F_CPU_ACTUAL / 1000000);
+  return m_converter.toMicros(nowCycles());
+#else
+  return micros();
+#endif
+}
+
+TickClock::TickClock(Clock* source)
+    : m_source(source), m_micros(source->nowMicros()) {}
+
+ELS_FASTRUN void TickClock::latch() { m_micros = m_source->nowMicros(); }
+
+ELS_FASTRUN uint64_t TickClock::nowMicros() { return m_micros; }
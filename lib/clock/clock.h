@@ -0,0 +1,124 @@
+#include <cstdint>
+
+#pragma once
+
+/**
+ * A monotonic 64 bit clock in microseconds
+ *
+ * Everything that measures time takes one of these, so tests can give every
+ * object its own clock instead of sharing the global micros() mock. At 64 bits
+ * the clock can't wrap in the lifetime of the machine
+ */
+class Clock {
+ public:
+  virtual uint64_t nowMicros() = 0;
+};
+
+/**
+ * Widens a free running 32 bit counter to 64 bits
+ * The counter has to be read at least once per wrap
+ */
+class CounterExtender {
+ private:
+  uint32_t m_lastCount;
+  uint64_t m_wraps;
+
+ public:
+  CounterExtender();
+  uint64_t extend(uint32_t count);
+};
+
+/**
+ * Turns CPU cycles into microseconds with a multiply and a shift. The cycles
+ * per microsecond only change with the CPU clock, so the reciprocal is worked
+ * out then instead of dividing by a runtime value on every read. It runs a
+ * fraction of a part per million fast, well inside the crystal's tolerance
+ */
+class CycleConverter {
+ private:
+  uint32_t m_cyclesPerMicro;
+  // 2^32 / cycles per microsecond, rounded up
+  uint32_t m_reciprocal;
+
+ public:
+  CycleConverter();
+  void setCyclesPerMicro(uint32_t cyclesPerMicro);
+  uint64_t toMicros(uint64_t cycles);
+};
+
+/**
+ * The hardware clock, the CPU cycle counter widened to 64 bits on the Teensy
+ * and the mocked micros() on native builds
+ *
+ * The cycle counter wraps every few seconds, the motion timer reads the clock
+ * every tick so it never misses a wrap
+ */
+class SystemClock : public Clock {
+ private:
+  CounterExtender m_cycles;
+  CycleConverter m_converter;
+
+  SystemClock() {}
+
+ public:
+  SystemClock(SystemClock const&) = delete;
+  void operator=(SystemClock const&) = delete;
+
+  static SystemClock* getInstance();
+
+  uint64_t nowMicros() override;
+  // the raw CPU cycles since start up, always 0 on native builds
+  uint64_t nowCycles();
+};
+
+/**
+ * A clock that only moves when it's latched. The motion timer latches it from
+ * the system clock once at the start of every tick and everything the tick
+ * runs reads that, instead of each read going to the hardware counter
+ */
+class TickClock : public Clock {
+ private:
+  Clock* m_source;
+  uint64_t m_micros;
+
+ public:
+  explicit TickClock(Clock* source);
+  // reads the source, call once at the start of every tick
+  void latch();
+  uint64_t nowMicros() override;
+};
+
+/**
+ * The time since it was last reset on a Clock, it behaves like the Teensy
+ * elapsedMicros so it's a drop in replacement. Assigning a value sets the
+ * elapsed time, subtracting moves the start forward
+ */
+class ElapsedMicros {
+ private:
+  Clock* m_clock;
+  uint64_t m_start;
+
+ public:
+  explicit ElapsedMicros(Clock* clock = SystemClock::getInstance())
+      : m_clock(clock), m_start(clock->nowMicros()) {}
+
+  // moves to another clock and restarts from 0
+  void setClock(Clock* clock) {
+    m_clock = clock;
+    m_start = clock->nowMicros();
+  }
+
+  operator uint64_t() const { return m_clock->nowMicros() - m_start; }
+  ElapsedMicros& operator=(uint64_t elapsed) {
+    m_start = m_clock->nowMicros() - elapsed;
+    return *this;
+  }
+  ElapsedMicros& operator-=(uint64_t micros) {
+    m_start += micros;
+    return *this;
+  }
+  ElapsedMicros& operator+=(uint64_t micros) {
+    m_start -= micros;
+    return *this;
+  }
+};
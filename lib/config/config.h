@@ -15,10 +15,11 @@
 #define US_PER_SECOND 1000000
 
 /**
- * Uncomment this line if your spindle is driven by a motor controlled by this
- * application. If it is uncommented we will assume you have an encoder attached
- * to your spindle
- * TODO: Implement this for real
+ * Uncomment this line if your spindle is driven by a stepper or servo
+ * controlled by this application, otherwise we assume you have an encoder
+ * attached to your spindle.
+ * The spindle and leadscrew are stepped from the same timer, the leadscrew
+ * follows every spindle pulse as soon as it's sent
  */
 // #define ELS_SPINDLE_DRIVEN
 
@@ -32,6 +33,9 @@
 #else
 #define ELS_SPINDLE_ENCODER_A 14
 #define ELS_SPINDLE_ENCODER_B 15
+// uncomment this if your spindle encoder has an index (Z) channel, it corrects
+// miscounts once per revolution and references thread starts to the index
+// #define ELS_SPINDLE_ENCODER_INDEX 22
 #endif
 
 #define ELS_LEADSCREW_STEP 2
@@ -47,6 +51,30 @@
 #define ELS_JOG_LEFT_BUTTON 24
 #define ELS_JOG_RIGHT_BUTTON 25
 
+/**
+ * Buttons
+ *
+ * All buttons are sampled together from the leadscrew timer at a fixed rate,
+ * a button has to read the same for 4 samples in a row to register
+ */
+// how often the buttons are sampled in microseconds
+#define ELS_BUTTON_SAMPLE_US 1000
+// how long a button has to be pressed to count as held
+#define ELS_BUTTON_HELD_MS 500
+// how long after a click a second click still counts as a double click
+#define ELS_BUTTON_DOUBLE_CLICK_MS 300
+
+/**
+ * Main loop tasks
+ *
+ * loop() runs these cooperatively, the most urgent due task runs first.
+ * Periods are in microseconds
+ */
+#define ELS_BUTTON_TASK_PERIOD_US 1000
+#define ELS_DISPLAY_TASK_PERIOD_US 33333
+#define ELS_TELEMETRY_TASK_PERIOD_US 500000
+#define ELS_CALIBRATION_TASK_PERIOD_US 10000
+
 /**
  * Display
  *
@@ -54,22 +82,87 @@
  * The selection will hopefully grow as time goes on!
  *
  * Options:
- *   SSD1306_128_64: 128x64 oled
+ *   SSD1306_128_64: 128x64 oled over I2C
+ *   ILI9341_320_240: 320x240 SPI TFT, the oled screen at twice the size
+ *   ST7789_320_240: the same on an ST7789 panel
  */
+#define SSD1306_128_64 0
+#define ILI9341_320_240 1
+#define ST7789_320_240 2
 #define ELS_DISPLAY SSD1306_128_64
 
 #if ELS_DISPLAY == SSD1306_128_64
 // define this if you have a dedicated pin for the oled reset
 #define PIN_DISPLAY_RESET -1
+#elif ELS_DISPLAY == ILI9341_320_240 || ELS_DISPLAY == ST7789_320_240
+// on the hardware SPI pins (11 and 13), these are chip select and data/command
+#define PIN_DISPLAY_CS 36
+#define PIN_DISPLAY_DC 37
+// -1 if the reset is tied high, the controller is reset by command anyway
+#define PIN_DISPLAY_RESET -1
+// the ILI9341 is only specified to 10MHz but most run well past 30MHz, the
+// ST7789 is good for 62.5MHz. A full screen takes about 17ms at 30MHz
+#define ELS_DISPLAY_SPI_CLOCK 30000000
+// RGB565, amber on black like an old DRO
+#define ELS_DISPLAY_FOREGROUND 0xFD20
+#define ELS_DISPLAY_BACKGROUND 0x0000
+// how often loop() hands the next changed rectangle to the DMA
+#define ELS_DISPLAY_SERVICE_PERIOD_US 500
 #endif
 
+// when the spindle is driven this is the motor pulses per spindle revolution
 #define ELS_SPINDLE_ENCODER_PPR 400
+
+// The leadscrew follows the encoder one count behind and spreads its steps over
+// the time between counts. Counts further apart than this many microseconds
+// aren't interpolated, set to 0 to disable interpolation
+#define ELS_SPINDLE_INTERPOLATION_MAX_PERIOD_US 100000
+
+#ifdef ELS_SPINDLE_DRIVEN
+// the speed the spindle runs at while motion is enabled
+#define ELS_SPINDLE_DRIVEN_RPM 300
+// the fastest the spindle motor can start or stop instantly
+#define ELS_SPINDLE_START_RPM 30
+// how quickly the spindle ramps between speeds
+#define ELS_SPINDLE_ACCEL_RPM_PER_S 200
+
+// do not change - the profile in pulses per second (squared)
+#define SPINDLE_START_VELOCITY \
+  ((float)ELS_SPINDLE_START_RPM * ELS_SPINDLE_ENCODER_PPR / 60)
+#define SPINDLE_ACCELERATION \
+  ((float)ELS_SPINDLE_ACCEL_RPM_PER_S * ELS_SPINDLE_ENCODER_PPR / 60)
+#endif
 #define ELS_LEADSCREW_STEPPER_PPR 400
 #define ELS_LEADSCREW_PITCH_MM 1.25
 
 #define ELS_LEADSCREW_STEPS_PER_MM \
   (float)(ELS_LEADSCREW_STEPPER_PPR / ELS_LEADSCREW_PITCH_MM)
 
+// The backlash in the leadscrew nut in stepper pulses, this many extra pulses
+// are sent every time the leadscrew reverses. Set to 0 to disable
+#define ELS_LEADSCREW_BACKLASH_STEPS 0
+// The delay between the backlash take up pulses in microseconds, this should
+// be a speed the stepper can start at instantly
+#define ELS_LEADSCREW_BACKLASH_PULSE_DELAY_US 200
+
+/**
+ * Leadscrew motor feedback
+ *
+ * Uncomment the encoder pins if your leadscrew motor has an encoder on it.
+ * Missed steps are then re-sent at a limited rate, and if the motor falls too
+ * far behind the leadscrew stops and is flagged as stalled
+ */
+// #define ELS_LEADSCREW_FEEDBACK_ENCODER_A 16
+// #define ELS_LEADSCREW_FEEDBACK_ENCODER_B 17
+// encoder counts per motor revolution (after quadrature decoding)
+#define ELS_LEADSCREW_FEEDBACK_PPR 4000
+// how many stepper pulses the motor can lag before we correct it
+#define ELS_LEADSCREW_FEEDBACK_TOLERANCE_STEPS 2
+// how many stepper pulses the motor can lag before it is considered stalled
+#define ELS_LEADSCREW_STALL_THRESHOLD_STEPS 50
+// the delay between correction pulses in microseconds
+#define ELS_LEADSCREW_CORRECTION_PULSE_DELAY_US 200
+
 // extra config options
 // jog speed in mm/s
 #define JOG_SPEED 100
@@ -78,6 +171,30 @@
   ((float)US_PER_SECOND / \
    ((float)JOG_SPEED * (float)ELS_LEADSCREW_STEPS_PER_MM))
 
+/**
+ * MPG handwheel
+ *
+ * Uncomment the encoder pins if you have a handwheel, it jogs the leadscrew
+ * while motion isn't enabled and the buttons aren't locked. Every detent moves
+ * the leadscrew by the multiplier in jog steps, the multiplier button cycles
+ * through the multipliers
+ */
+// #define ELS_MPG_ENCODER_A 20
+// #define ELS_MPG_ENCODER_B 21
+// #define ELS_MPG_MULTIPLIER_BUTTON 26
+// encoder counts per detent (after quadrature decoding)
+#define ELS_MPG_COUNTS_PER_DETENT 4
+// the fastest the handwheel moves the leadscrew in mm/s
+#define ELS_MPG_SPEED 50
+// how many jog steps the leadscrew can fall behind the wheel, anything turned
+// past that is dropped so the carriage stops soon after the wheel does
+#define ELS_MPG_MAX_BACKLOG 400
+const int mpgMultipliers[] = {1, 10, 100};
+
+#define MPG_PULSE_DELAY   \
+  ((float)US_PER_SECOND / \
+   ((float)ELS_MPG_SPEED * (float)ELS_LEADSCREW_STEPS_PER_MM))
+
 /**
  * The unit mode the system should start up in
  * Options:
@@ -98,6 +215,25 @@
 
 #define LEADSCREW_TIMER_US 20
 
+// When nothing has moved for ELS_IDLE_AFTER_US the timer slows down to one
+// tick every ELS_IDLE_TIMER_US, and goes back to full speed on the first tick
+// that sees the spindle or leadscrew move. Set them equal to never slow down
+#define ELS_IDLE_TIMER_US 1000
+#define ELS_IDLE_AFTER_US 100000
+
+/**
+ * Interrupt priorities
+ *
+ * NVIC levels on the Teensy 4.x, lower is more urgent and only the top four
+ * bits count so levels are 16 apart. Encoder edges preempt the motion timer so
+ * no count waits for a tick, the motion timer preempts everything that talks to
+ * the outside world (USB serial, I2C and the display DMA). The Teensy core
+ * leaves all of these at the same level otherwise, see lib/irq_priority
+ */
+#define ELS_ENCODER_IRQ_PRIORITY 32
+#define ELS_MOTION_TIMER_PRIORITY 64
+#define ELS_COMMS_IRQ_PRIORITY 160
+
 // The initial delay between pulses in microseconds for the leadscrew starting
 // from 0 do not change - this is a calculated value, to change the initial
 // speed look at the jerk value
@@ -118,25 +254,87 @@
   ((float)LEADSCREW_ACCEL / ((float)ELS_LEADSCREW_STEPS_PER_MM))
 #endif
 
+/**
+ * Scope
+ *
+ * Uncomment ELS_SCOPE to capture what the motion timer is doing around a
+ * glitch. Every tick is recorded until the trigger, the capture is printed as
+ * CSV with the telemetry and the scope is armed again. See lib/scope/scope.h
+ * for the channels and triggers
+ */
+// #define ELS_SCOPE
+#define ELS_SCOPE_CHANNELS                                        \
+  {TIME_US, SPINDLE_POSITION, EXPECTED_POSITION, POSITION_ERROR, \
+   PULSE_DELAY_US, DIRECTION}
+#define ELS_SCOPE_TRIGGER ERROR_ABOVE
+#define ELS_SCOPE_THRESHOLD 20
+// how much of the capture comes from before the trigger
+#define ELS_SCOPE_PRE_TRIGGER_PERCENT 25
+
+// the most starts a multi-start thread can have, the start count also has to
+// divide ELS_SPINDLE_ENCODER_PPR so every start begins on a whole encoder count
+#define ELS_THREAD_MAX_STARTS 8
+
+/**
+ * Leadscrew acceleration curve
+ *
+ * Stepper torque drops off with speed, so the acceleration the leadscrew can
+ * manage does too. Each velocity (mm/s) has the acceleration (mm/s^2) allowed
+ * at that speed, in between the acceleration is interpolated and past either
+ * end it stays flat. The ramps and the stopping distances both follow it.
+ * Velocities have to be ascending, the default is a flat LEADSCREW_ACCEL
+ */
+const float leadscrewAccelCurveVelocity[] = {0, 20, 40, 80};
+const float leadscrewAccelCurveAccel[] = {LEADSCREW_ACCEL, LEADSCREW_ACCEL,
+                                          LEADSCREW_ACCEL, LEADSCREW_ACCEL};
+
+/**
+ * Calibration
+ *
+ * Holding enable with motion disabled runs the carriage between the stops
+ * with more and more acceleration, then more and more top speed, until the
+ * motor can't keep up. The highest that kept up times the margin is saved and
+ * used from then on. The acceleration is the peak of the curve above, in the
+ * units of LEADSCREW_ACCEL, and the top speed is in mm/s. The ramp speeds up
+ * by a fraction of the speed every pulse, so these two aren't independent,
+ * a faster top speed also means a harder ramp at the top of it
+ */
+#define ELS_CALIBRATION_START_ACCEL 20
+#define ELS_CALIBRATION_START_SPEED 10
+#define ELS_CALIBRATION_MAX_ACCEL 2000
+#define ELS_CALIBRATION_MAX_SPEED JOG_SPEED
+// each limit grows by this until a trial fails, then the gap is halved this
+// many times
+#define ELS_CALIBRATION_GROWTH 1.5
+#define ELS_CALIBRATION_REFINE_STEPS 4
+// how many times in a row a trial has to pass
+#define ELS_CALIBRATION_PASSES 2
+#define ELS_CALIBRATION_MARGIN 0.8
+// where the result is kept in EEPROM
+#define ELS_CALIBRATION_EEPROM_ADDRESS 0
+
+// the pitch tables are constexpr so the display labels can be built from them
+// at compile time, see display_text.h
 // metric thread pitch is defined as mm/rev
-const float threadPitchMetric[] = {0.35, 0.40, 0.45, 0.50, 0.60, 0.70, 0.80,
-                                   1.00, 1.25, 1.50, 1.75, 2.00, 2.50, 3.00,
-                                   3.50, 4.00, 4.50, 5.00, 5.50, 6.00};
+constexpr float threadPitchMetric[] = {
+    0.35, 0.40, 0.45, 0.50, 0.60, 0.70, 0.80, 1.00, 1.25, 1.50,
+    1.75, 2.00, 2.50, 3.00, 3.50, 4.00, 4.50, 5.00, 5.50, 6.00};
 #define DEFAULT_METRIC_THREAD_PITCH_IDX 8
 
 // defined as mm/rev
-const float feedPitchMetric[] = {0.05, 0.08, 0.10, 0.12, 0.15, 0.18, 0.20,
-                                 0.23, 0.25, 0.28, 0.30, 0.35, 0.40, 0.45,
-                                 0.50, 0.55, 0.60, 0.65, 0.70, 0.75};
+constexpr float feedPitchMetric[] = {
+    0.05, 0.08, 0.10, 0.12, 0.15, 0.18, 0.20, 0.23, 0.25, 0.28,
+    0.30, 0.35, 0.40, 0.45, 0.50, 0.55, 0.60, 0.65, 0.70, 0.75};
 #define DEFAULT_METRIC_FEED_PITCH_IDX 8
 
 // for convenience these are defined as TPI - retained as float to allow for
 // partial TPI for whatever reason
-const float threadPitchImperial[] = {80, 72, 64, 56, 48, 44, 40, 36, 32, 28,
-                                     24, 20, 18, 16, 14, 13, 12, 11, 10, 9};
+constexpr float threadPitchImperial[] = {80, 72, 64, 56, 48, 44, 40,
+                                         36, 32, 28, 24, 20, 18, 16,
+                                         14, 13, 12, 11, 10, 9};
 #define DEFAULT_IMPERIAL_THREAD_PITCH_IDX 8
-// defined as thou/rev
-const float feedPitchImperial[] = {
+// defined as inches/rev, the display shows them in thou
+constexpr float feedPitchImperial[] = {
     0.002, 0.003, 0.004, 0.005, 0.006, 0.007, 0.008, 0.009, 0.010, 0.011,
     0.012, 0.014, 0.016, 0.018, 0.020, 0.022, 0.024, 0.026, 0.028, 0.030};
 #define DEFAULT_IMPERIAL_FEED_PITCH_IDX 8
@@ -0,0 +1,84 @@
+#include "cycle_profile.h"
+
+CycleProfile::CycleProfile()
+    : m_startCycles(0), m_lastCycles(0), m_worstCycles(0), m_samples(0) {}
+
+ELS_FASTRUN void CycleProfile::start() { m_startCycles = readCycleCounter(); }
+
+ELS_FASTRUN void CycleProfile::stop() {
+  // unsigned subtraction handles the counter wrapping
+  m_lastCycles = readCycleCounter() - m_startCycles;
+  if (m_lastCycles > m_worstCycles) {
+    m_worstCycles = m_lastCycles;
+  }
+  m_samples++;
+}
+
+void CycleProfile::reset() {
+  m_worstCycles = 0;
+  m_samples = 0;
+}
+
+uint32_t CycleProfile::getLastCycles() { return m_lastCycles; }
+
+uint32_t CycleProfile::getWorstCycles() { return m_worstCycles; }
+
+uint32_t CycleProfile::getSamples() { return m_samples; }
+
+void CycleProfile::printState(const char* name) {
+#ifndef PIO_UNIT_TESTING
+  Serial.print(name);
+  Serial.print(" cycles last/worst: ");
+  Serial.print(m_lastCycles);
+  Serial.print("/");
+  Serial.println(m_worstCycles);
+#endif
+}
+
+TickLatencyProfile::TickLatencyProfile()
+    : m_lastStartCycles(0),
+      m_lastPeriodCycles(0),
+      m_lastLateCycles(0),
+      m_worstLateCycles(0),
+      m_samples(0) {}
+
+ELS_FASTRUN void TickLatencyProfile::tick(uint32_t periodCycles) {
+  tick(readCycleCounter(), periodCycles);
+}
+
+ELS_FASTRUN void TickLatencyProfile::tick(uint32_t nowCycles,
+                                          uint32_t periodCycles) {
+  // nothing to compare the first tick with
+  if (m_lastPeriodCycles != 0) {
+    uint32_t sinceLast = nowCycles - m_lastStartCycles;
+    m_lastLateCycles =
+        sinceLast > m_lastPeriodCycles ? sinceLast - m_lastPeriodCycles : 0;
+    if (m_lastLateCycles > m_worstLateCycles) {
+      m_worstLateCycles = m_lastLateCycles;
+    }
+    m_samples++;
+  }
+  m_lastStartCycles = nowCycles;
+  m_lastPeriodCycles = periodCycles;
+}
+
+void TickLatencyProfile::reset() {
+  m_worstLateCycles = 0;
+  m_samples = 0;
+}
+
+uint32_t TickLatencyProfile::getLastLateCycles() { return m_lastLateCycles; }
+
+uint32_t TickLatencyProfile::getWorstLateCycles() { return m_worstLateCycles; }
+
+uint32_t TickLatencyProfile::getSamples() { return m_samples; }
+
+void TickLatencyProfile::printState(const char* name) {
+#ifndef PIO_UNIT_TESTING
+  Serial.print(name);
+  Serial.print(" late cycles last/worst: ");
+  Serial.print(m_lastLateCycles);
+  Serial.print("/");
+  Serial.println(m_worstLateCycles);
+#endif
+}
@@ -0,0 +1,66 @@
+#include <placement.h>
+
+#include <cstdint>
+
+#pragma once
+
+/**
+ * Measures how many CPU cycles a piece of code takes
+ *
+ * Wrap the code in start() and stop(), the last and worst case counts can be
+ * read back at any time. Cycles are read with readCycleCounter() so the counts
+ * are only meaningful on hardware
+ */
+class CycleProfile {
+ private:
+  uint32_t m_startCycles;
+  uint32_t m_lastCycles;
+  uint32_t m_worstCycles;
+  uint32_t m_samples;
+
+ public:
+  CycleProfile();
+
+  void start();
+  void stop();
+  // forgets the worst case, e.g. once start up is over
+  void reset();
+
+  uint32_t getLastCycles();
+  uint32_t getWorstCycles();
+  uint32_t getSamples();
+
+  void printState(const char* name);
+};
+
+/**
+ * Measures how late a periodic interrupt starts, in CPU cycles
+ *
+ * Call tick() first thing in the callback with the period until the next one.
+ * The time since the tick before, less that tick's period, is how much later
+ * this one started than the one before it. That's what anything above it in
+ * priority, or anything that masked interrupts, cost this tick. A late tick
+ * followed by one on time reads as early and counts as 0
+ */
+class TickLatencyProfile {
+ private:
+  uint32_t m_lastStartCycles;
+  uint32_t m_lastPeriodCycles;
+  uint32_t m_lastLateCycles;
+  uint32_t m_worstLateCycles;
+  uint32_t m_samples;
+
+ public:
+  TickLatencyProfile();
+
+  void tick(uint32_t periodCycles);
+  // the same with the cycle count given, for tests
+  void tick(uint32_t nowCycles, uint32_t periodCycles);
+  void reset();
+
+  uint32_t getLastLateCycles();
+  uint32_t getWorstLateCycles();
+  uint32_t getSamples();
+
+  void printState(const char* name);
+};
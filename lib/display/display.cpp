@@ -1,5 +1,6 @@
 #include <config.h>
 #include <display.h>
+#include <display_text.h>
 #include <globalstate.h>
 
 // Images
@@ -10,20 +11,28 @@
 #include <icons/threadSymbol.h>
 #include <icons/unlockedSymbol.h>
 
-void Display::init() {
+bool Display::init() {
 #if ELS_DISPLAY == SSD1306_128_64
-  if (!this->m_ssd1306.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
-    Serial.println(F("SSD1306 allocation failed"));
-    for (;;);
+  m_available = m_panel.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS);
+  if (!m_available) {
+    Serial.println(F("SSD1306 not responding, running without a display"));
+    return false;
   }
-  m_ssd1306.clearDisplay();
+#else
+  m_available = m_panel.begin();
 #endif
+  m_panel.clearDisplay();
+  return m_available;
 }
 
+bool Display::isAvailable() { return m_available; }
+
 void Display::update() {
-#if ELS_DISPLAY == SSD1306_128_64
-  m_ssd1306.clearDisplay();
-#endif
+  if (!m_available || m_panel.isBusy()) {
+    return;
+  }
+
+  m_panel.clearDisplay();
 
   drawMode();
   drawPitch();
@@ -31,120 +40,120 @@ void Display::update() {
   drawEnabled();
   drawSpindleRpm();
   drawStopStatus();
+  drawThreadStart();
 
-#if ELS_DISPLAY == SSD1306_128_64
-  m_ssd1306.display();
-#endif
+  m_panel.display();
+}
+
+void Display::service() {
+  if (m_available) {
+    m_panel.service();
+  }
 }
 
 void Display::drawSpindleRpm() {
-#if ELS_DISPLAY == SSD1306_128_64
   int rpm = m_spindle->getEstimatedVelocityInRPM();
-  char rpmString[10];
-  m_ssd1306.setCursor(0, 0);
-  m_ssd1306.setTextSize(1);
-  m_ssd1306.setTextColor(WHITE);
+  char rpmString[DISPLAY_INTEGER_SIZE];
+  m_panel.setCursor(0, 0);
+  m_panel.setTextSize(1);
+  m_panel.setTextColor(WHITE);
   // pad the rpm with spaces so the RPM text stays in the same place
-  sprintf(rpmString, "%4dRPM", rpm);
-  m_ssd1306.print(rpmString);
-#endif
+  formatInteger(rpmString, rpm, 4);
+  m_panel.print(rpmString);
+  m_panel.print("RPM");
 }
 
 void Display::drawStopStatus() {
-#if ELS_DISPLAY == SSD1306_128_64
-  m_ssd1306.setCursor(0, 8);
-  m_ssd1306.setTextSize(1);
-  m_ssd1306.setTextColor(WHITE);
+  m_panel.setCursor(0, 8);
+  m_panel.setTextSize(1);
+  m_panel.setTextColor(WHITE);
   if (m_leadscrew->getStopPositionState(Leadscrew::StopPosition::LEFT) ==
       LeadscrewStopState::SET) {
-    m_ssd1306.print("[");
+    m_panel.print("[");
   } else {
-    m_ssd1306.print(" ");
+    m_panel.print(" ");
   }
   if (m_leadscrew->getStopPositionState(Leadscrew::StopPosition::RIGHT) ==
       LeadscrewStopState::SET) {
-    m_ssd1306.print("]");
+    m_panel.print("]");
   } else {
-    m_ssd1306.print(" ");
+    m_panel.print(" ");
   }
-#endif
+}
+
+void Display::drawThreadStart() {
+  // the leadscrew owns the start, the global state only has what's been picked
+  int starts = m_leadscrew->getThreadStarts();
+  if (GlobalState::getInstance()->getFeedMode() != GlobalFeedMode::THREAD ||
+      starts == 1) {
+    return;
+  }
+
+  char start[DISPLAY_INTEGER_SIZE];
+  m_panel.setCursor(0, 16);
+  m_panel.setTextSize(1);
+  m_panel.setTextColor(WHITE);
+  m_panel.print("S");
+  formatInteger(start, m_leadscrew->getThreadStart() + 1);
+  m_panel.print(start);
+  m_panel.print("/");
+  formatInteger(start, starts);
+  m_panel.print(start);
 }
 
 void Display::drawMode() {
   GlobalFeedMode mode = GlobalState::getInstance()->getFeedMode();
 
-#if ELS_DISPLAY == SSD1306_128_64
   if (mode == GlobalFeedMode::FEED) {
-    m_ssd1306.drawBitmap(57, 32, feedSymbol, 64, 32, WHITE);
+    m_panel.drawBitmap(57, 32, feedSymbol, 64, 32, WHITE);
   } else if (mode == GlobalFeedMode::THREAD) {
-    m_ssd1306.drawBitmap(57, 32, threadSymbol, 64, 32, WHITE);
+    m_panel.drawBitmap(57, 32, threadSymbol, 64, 32, WHITE);
   }
-#endif
 }
 
 void Display::drawPitch() {
   GlobalState *state = GlobalState::getInstance();
-  GlobalUnitMode unit = state->getUnitMode();
-  GlobalFeedMode mode = state->getFeedMode();
-  int feedSelect = state->getFeedSelect();
-  char pitch[10];
-  if (unit == GlobalUnitMode::METRIC) {
-    if (mode == GlobalFeedMode::THREAD) {
-      sprintf(pitch, "%.2fmm", threadPitchMetric[feedSelect]);
-    } else {
-      sprintf(pitch, "%.2fmm", feedPitchMetric[feedSelect]);
-    }
-  } else {
-    if (mode == GlobalFeedMode::THREAD) {
-      sprintf(pitch, "%dTPI", (int)threadPitchImperial[feedSelect]);
-    } else {
-      sprintf(pitch, "%dth", (int)(feedPitchImperial[feedSelect] * 1000));
-    }
-  }
+  // the labels were formatted by the compiler, see display_text.h
+  const char *pitch = getPitchLabel(state->getUnitMode(), state->getFeedMode(),
+                                    state->getFeedSelect());
 
-#if ELS_DISPLAY == SSD1306_128_64
-  m_ssd1306.setCursor(55, 8);
-  m_ssd1306.setTextSize(2);
-  m_ssd1306.setTextColor(WHITE);
-  m_ssd1306.print(pitch);
-#endif
+  m_panel.setCursor(55, 8);
+  m_panel.setTextSize(2);
+  m_panel.setTextColor(WHITE);
+  m_panel.print(pitch);
 }
 
 void Display::drawEnabled() {
   GlobalState *state = GlobalState::getInstance();
   GlobalMotionMode mode = state->getMotionMode();
 
-#if ELS_DISPLAY == SSD1306_128_64
-  m_ssd1306.fillRoundRect(26, 40, 20, 20, 2, WHITE);
+  m_panel.fillRoundRect(26, 40, 20, 20, 2, WHITE);
   switch (mode) {
     case GlobalMotionMode::DISABLED:
-      m_ssd1306.drawBitmap(28, 42, pauseSymbol, 16, 16, BLACK);
+      m_panel.drawBitmap(28, 42, pauseSymbol, 16, 16, BLACK);
       break;
     case GlobalMotionMode::JOG:
       // todo bitmap for jogging
-      m_ssd1306.setCursor(28, 42);
-      m_ssd1306.setTextSize(2);
-      m_ssd1306.setTextColor(BLACK);
-      m_ssd1306.print("J");
+      m_panel.setCursor(28, 42);
+      m_panel.setTextSize(2);
+      m_panel.setTextColor(BLACK);
+      m_panel.print("J");
       break;
     case GlobalMotionMode::ENABLED:
-      m_ssd1306.drawBitmap(28, 42, runSymbol, 16, 16, BLACK);
+      m_panel.drawBitmap(28, 42, runSymbol, 16, 16, BLACK);
       break;
   }
-#endif
 }
 
 void Display::drawLocked() {
   GlobalButtonLock lock = GlobalState::getInstance()->getButtonLock();
-#if ELS_DISPLAY == SSD1306_128_64
-  m_ssd1306.fillRoundRect(2, 40, 20, 20, 2, WHITE);
+  m_panel.fillRoundRect(2, 40, 20, 20, 2, WHITE);
   switch (lock) {
     case GlobalButtonLock::LOCKED:
-      m_ssd1306.drawBitmap(4, 42, lockedSymbol, 16, 16, BLACK);
+      m_panel.drawBitmap(4, 42, lockedSymbol, 16, 16, BLACK);
       break;
     case GlobalButtonLock::UNLOCKED:
-      m_ssd1306.drawBitmap(4, 42, unlockedSymbol, 16, 16, BLACK);
+      m_panel.drawBitmap(4, 42, unlockedSymbol, 16, 16, BLACK);
       break;
   }
-#endif
 }
\ No newline at end of file
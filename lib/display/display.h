@@ -4,7 +4,7 @@
 #include <leadscrew.h>
 #include <spindle.h>
 
-#define SSD1306_128_64 0
+#pragma once
 
 #if ELS_DISPLAY == SSD1306_128_64
 
@@ -16,6 +16,45 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 
+#define SSD1306_FRAMEBUFFER_SIZE (SCREEN_WIDTH * ((SCREEN_HEIGHT + 7) / 8))
+
+/**
+ * An SSD1306 that draws into a framebuffer it's given instead of one it
+ * mallocs, begin() only allocates when it doesn't have a buffer yet
+ */
+class StaticSSD1306 : public Adafruit_SSD1306 {
+ public:
+  StaticSSD1306(uint8_t* framebuffer, TwoWire* wire, int8_t resetPin)
+      : Adafruit_SSD1306(SCREEN_WIDTH, SCREEN_HEIGHT, wire, resetPin) {
+    buffer = framebuffer;
+  }
+  // the base class would free() the buffer
+  ~StaticSSD1306() { buffer = nullptr; }
+  // the whole frame goes out over I2C inside display()
+  bool isBusy() { return false; }
+  void service() {}
+};
+
+typedef StaticSSD1306 DisplayPanel;
+
+#elif ELS_DISPLAY == ILI9341_320_240 || ELS_DISPLAY == ST7789_320_240
+
+#include <spi_tft.h>
+#include <spi_tft_io_impl.h>
+
+#define SCREEN_WIDTH SPI_TFT_CANVAS_WIDTH
+#define SCREEN_HEIGHT SPI_TFT_CANVAS_HEIGHT
+#define BLACK SPI_TFT_BLACK
+#define WHITE SPI_TFT_WHITE
+
+#if ELS_DISPLAY == ILI9341_320_240
+#define DISPLAY_TFT_CONTROLLER SpiTftController::ILI9341
+#else
+#define DISPLAY_TFT_CONTROLLER SpiTftController::ST7789
+#endif
+
+typedef SpiTft DisplayPanel;
+
 #else
 
 #error "Please choose a valid display. Refer to config.h for options"
@@ -27,23 +66,44 @@ class Display {
   Spindle* m_spindle;
   Leadscrew* m_leadscrew;
   GlobalState* m_globalState;
+  // false if the display didn't respond, everything else keeps running
+  bool m_available;
 
- public:
 #if ELS_DISPLAY == SSD1306_128_64
-  Adafruit_SSD1306 m_ssd1306;
+  uint8_t m_framebuffer[SSD1306_FRAMEBUFFER_SIZE];
+#else
+  SpiTftIOImpl m_tftIO;
 #endif
-  Display(Spindle* spindle, Leadscrew* leadscrew) {
-    this->m_spindle = spindle;
-    this->m_leadscrew = leadscrew;
-    this->m_globalState = GlobalState::getInstance();
+
+ public:
+  DisplayPanel m_panel;
+  Display(Spindle* spindle, Leadscrew* leadscrew)
+      : m_spindle(spindle),
+        m_leadscrew(leadscrew),
+        m_globalState(GlobalState::getInstance()),
+        m_available(false),
 #if ELS_DISPLAY == SSD1306_128_64
-    this->m_ssd1306 =
-        Adafruit_SSD1306(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, PIN_DISPLAY_RESET);
+        m_panel(m_framebuffer, &Wire, PIN_DISPLAY_RESET)
+#else
+        m_panel(&m_tftIO, DISPLAY_TFT_CONTROLLER, ELS_DISPLAY_FOREGROUND,
+                ELS_DISPLAY_BACKGROUND)
 #endif
+  {
   }
 
-  void init();
+  /**
+   * Starts the display, returns false if it didn't respond. Motion doesn't
+   * depend on the display so this never blocks
+   */
+  bool init();
+  /**
+   * Draws a new frame, unless the last one is still being sent to the panel.
+   * Only the SPI TFT can still be sending
+   */
   void update();
+  // keeps a frame that's going out to the SPI TFT moving, call it often
+  void service();
+  bool isAvailable();
 
  protected:
   void drawMode();
@@ -52,4 +112,5 @@ class Display {
   void drawLocked();
   void drawSpindleRpm();
   void drawStopStatus();
+  void drawThreadStart();
 };
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "display_text.h"
+
+int formatInteger(char* buffer, int value, int width) {
+  // work on the magnitude as unsigned so INT_MIN doesn't overflow
+  unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : value;
+  char digits[DISPLAY_INTEGER_SIZE];
+  int count = 0;
+  do {
+    digits[count++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (value < 0) {
+    digits[count++] = '-';
+  }
+
+  if (width > DISPLAY_INTEGER_SIZE - 1) {
+    width = DISPLAY_INTEGER_SIZE - 1;
+  }
+  int length = 0;
+  while (length < width - count) {
+    buffer[length++] = ' ';
+  }
+  while (count > 0) {
+    buffer[length++] = digits[--count];
+  }
+  buffer[length] = '\0';
+  return length;
+}
+
+const char* getPitchLabel(GlobalUnitMode unit, GlobalFeedMode mode,
+                          int feedSelect) {
+  if (unit == GlobalUnitMode::METRIC) {
+    if (mode == GlobalFeedMode::THREAD) {
+      return threadPitchMetricLabels[feedSelect];
+    }
+    return feedPitchMetricLabels[feedSelect];
+  }
+  if (mode == GlobalFeedMode::THREAD) {
+    return threadPitchImperialLabels[feedSelect];
+  }
+  return feedPitchImperialLabels[feedSelect];
+}
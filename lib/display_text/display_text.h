@@ -0,0 +1,107 @@
+#include <config.h>
+#include <globalstate.h>
+
+#include <cstddef>
+
+#pragma once
+
+// the longest label is "80TPI" or "6.00mm", plus the terminator
+#define PITCH_LABEL_SIZE 8
+// a sign, the ten digits of INT32_MIN and the terminator
+#define DISPLAY_INTEGER_SIZE 12
+
+/**
+ * Writes value into buffer as decimal digits, padded on the left with spaces
+ * to at least width characters like printf's %*d. The buffer needs
+ * DISPLAY_INTEGER_SIZE chars, width is capped to fit. Returns the length
+ */
+int formatInteger(char* buffer, int value, int width = 0);
+
+enum PitchLabelUnit { MILLIMETRES, TPI, THOU };
+
+/**
+ * The text for every entry of a pitch table, worked out by the compiler so
+ * nothing has to format a float while the machine is running. Millimetres
+ * show two decimals, TPI whole threads and thou the table's inches as thou
+ */
+template <size_t Count>
+class PitchLabels {
+ private:
+  char m_labels[Count][PITCH_LABEL_SIZE];
+
+  static constexpr int countDigits(int value) {
+    int digits = 1;
+    while (value >= 10) {
+      value /= 10;
+      digits++;
+    }
+    return digits;
+  }
+
+  // returns the index after the last digit
+  static constexpr int writeDigits(char* label, int at, int value) {
+    int end = at + countDigits(value);
+    for (int i = end - 1; i >= at; i--) {
+      label[i] = '0' + value % 10;
+      value /= 10;
+    }
+    return end;
+  }
+
+  static constexpr int writeText(char* label, int at, const char* text) {
+    while (*text != '\0') {
+      label[at++] = *text++;
+    }
+    return at;
+  }
+
+  static constexpr void format(char* label, float pitch, PitchLabelUnit unit) {
+    int at = 0;
+    switch (unit) {
+      case PitchLabelUnit::MILLIMETRES: {
+        int hundredths = (int)(pitch * 100 + 0.5f);
+        at = writeDigits(label, at, hundredths / 100);
+        label[at++] = '.';
+        label[at++] = '0' + hundredths / 10 % 10;
+        label[at++] = '0' + hundredths % 10;
+        at = writeText(label, at, "mm");
+        break;
+      }
+      case PitchLabelUnit::TPI:
+        at = writeDigits(label, at, (int)pitch);
+        at = writeText(label, at, "TPI");
+        break;
+      case PitchLabelUnit::THOU:
+        at = writeDigits(label, at, (int)(pitch * 1000 + 0.5f));
+        at = writeText(label, at, "th");
+        break;
+    }
+    label[at] = '\0';
+  }
+
+ public:
+  constexpr PitchLabels(const float (&pitches)[Count], PitchLabelUnit unit)
+      : m_labels() {
+    for (size_t i = 0; i < Count; i++) {
+      format(m_labels[i], pitches[i], unit);
+    }
+  }
+
+  constexpr const char* operator[](size_t index) const {
+    return m_labels[index];
+  }
+  constexpr size_t size() const { return Count; }
+};
+
+constexpr PitchLabels<ARRAY_SIZE(threadPitchMetric)> threadPitchMetricLabels(
+    threadPitchMetric, PitchLabelUnit::MILLIMETRES);
+constexpr PitchLabels<ARRAY_SIZE(feedPitchMetric)> feedPitchMetricLabels(
+    feedPitchMetric, PitchLabelUnit::MILLIMETRES);
+constexpr PitchLabels<ARRAY_SIZE(threadPitchImperial)>
+    threadPitchImperialLabels(threadPitchImperial, PitchLabelUnit::TPI);
+constexpr PitchLabels<ARRAY_SIZE(feedPitchImperial)> feedPitchImperialLabels(
+    feedPitchImperial, PitchLabelUnit::THOU);
+
+// the label for an entry of the table the unit and feed mode select
+const char* getPitchLabel(GlobalUnitMode unit, GlobalFeedMode mode,
+                          int feedSelect);
@@ -2,11 +2,19 @@
 #include <Wire.h>
 #endif
 #include <globalstate.h>
+#include <placement.h>
+
+#include <cstdint>
+#include <new>
+
+// the instance is built in this static storage on first use, so there's no
+// heap involved and it still works from the constructors of other globals
+alignas(GlobalState) static uint8_t s_instanceStorage[sizeof(GlobalState)];
 
 GlobalState *GlobalState::m_instance = nullptr;
 GlobalState *GlobalState::getInstance() {
   if (m_instance == nullptr) {
-    m_instance = new GlobalState();
+    m_instance = new (s_instanceStorage) GlobalState();
   }
   return m_instance;
 }
@@ -43,6 +51,8 @@ void GlobalState::printState() {
       Serial.println("IMPERIAL");
       break;
   }
+  Serial.print("Thread starts: ");
+  Serial.println(m_threadStarts);
   Serial.print("Thread Sync State: ");
   switch (m_threadSyncState) {
     case SYNC:
@@ -63,7 +73,7 @@ void GlobalState::setFeedMode(GlobalFeedMode mode) {
   setFeedSelect(-1);
 }
 
-GlobalFeedMode GlobalState::getFeedMode() { return m_feedMode; }
+ELS_FASTRUN GlobalFeedMode GlobalState::getFeedMode() { return m_feedMode; }
 
 int GlobalState::getFeedSelect() { return m_feedSelect; }
 int GlobalState::getCurrentFeedSelectArraySize() {
@@ -89,7 +99,9 @@ int GlobalState::getCurrentFeedSelectArraySize() {
 
 void GlobalState::setButtonLock(GlobalButtonLock lock) { m_buttonLock = lock; }
 
-GlobalButtonLock GlobalState::getButtonLock() { return m_buttonLock; }
+ELS_FASTRUN GlobalButtonLock GlobalState::getButtonLock() {
+  return m_buttonLock;
+}
 
 void GlobalState::setFeedSelect(int select) {
   if (select >= 0 && select < getCurrentFeedSelectArraySize()) {
@@ -126,8 +138,8 @@ float GlobalState::getCurrentFeedPitch() {
     // threads are defined in TPI, not pitch
     return (1.0 / threadPitchImperial[m_feedSelect]) * 25.4;
   }
-  // feeds are defined in thou/rev, not mm/rev
-  return feedPitchImperial[m_feedSelect] * 25.4 / 1000;
+  // feeds are defined in inches/rev, not mm/rev
+  return feedPitchImperial[m_feedSelect] * 25.4;
 }
 
 int GlobalState::nextFeedPitch() {
@@ -148,7 +160,9 @@ int GlobalState::prevFeedPitch() {
 
 void GlobalState::setMotionMode(GlobalMotionMode mode) { m_motionMode = mode; }
 
-GlobalMotionMode GlobalState::getMotionMode() { return m_motionMode; }
+ELS_FASTRUN GlobalMotionMode GlobalState::getMotionMode() {
+  return m_motionMode;
+}
 
 void GlobalState::setUnitMode(GlobalUnitMode mode) { m_unitMode = mode; }
 
@@ -161,3 +175,27 @@ void GlobalState::setThreadSyncState(GlobalThreadSyncState state) {
 GlobalThreadSyncState GlobalState::getThreadSyncState() {
   return m_threadSyncState;
 }
+
+ELS_FASTRUN bool GlobalState::isValidThreadStarts(int starts) {
+  return starts >= 1 && starts <= ELS_THREAD_MAX_STARTS &&
+         ELS_SPINDLE_ENCODER_PPR % starts == 0;
+}
+
+void GlobalState::setThreadStarts(int starts) {
+  if (!isValidThreadStarts(starts)) {
+    starts = 1;
+  }
+  m_threadStarts = starts;
+}
+
+int GlobalState::getThreadStarts() { return m_threadStarts; }
+
+int GlobalState::nextThreadStarts() {
+  int starts = m_threadStarts;
+  do {
+    starts = starts >= ELS_THREAD_MAX_STARTS ? 1 : starts + 1;
+  } while (!isValidThreadStarts(starts));
+  setThreadStarts(starts);
+
+  return m_threadStarts;
+}
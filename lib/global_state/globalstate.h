@@ -36,8 +36,8 @@ enum GlobalThreadSyncState { SYNC, UNSYNC };
  */
 enum GlobalButtonLock { UNLOCKED, LOCKED };
 
-// this is a singleton class - we don't want more than one of these existing at
-// a time!
+// the firmware treats this as a singleton - there's only one machine, so there
+// should only be one of these in it!
 class GlobalState {
  private:
   static GlobalState *m_instance;
@@ -50,23 +50,32 @@ class GlobalState {
 
   int m_feedSelect;
 
+  // the amount of starts picked for a multi-start thread, the leadscrew keeps
+  // track of the one we're cutting
+  int m_threadStarts;
+
   // the position at which the spindle will be back in sync with the leadscrew
   // note that this position actually has *two* solutions, left and right
   // but we only use the "left" position and calculate the "right" position when
   // required
   int m_resyncPulseCount;
 
+ public:
+  /**
+   * The firmware shares the one from getInstance(), anything that simulates
+   * several machines at once can give every motion core its own
+   */
   GlobalState() {
     setFeedMode(DEFAULT_FEED_MODE);
     setUnitMode(DEFAULT_UNIT_MODE);
     setButtonLock(LOCKED);
     setFeedSelect(-1);
     setThreadSyncState(UNSYNC);
+    m_threadStarts = 1;
     m_motionMode = DISABLED;
     m_resyncPulseCount = 0;
   }
 
- public:
   // singleton stuff, no cloning and no copying
   GlobalState(GlobalState const &) = delete;
   void operator=(GlobalState const &) = delete;
@@ -95,6 +104,19 @@ class GlobalState {
   int nextFeedPitch();
   int prevFeedPitch();
 
+  /**
+   * Every start of a multi-start thread begins 1/starts of a revolution after
+   * the last. Only start counts that divide the spindle pulses per revolution
+   * can be spaced exactly, anything else falls back to a single start
+   * This is only the operator's choice, it's handed to the leadscrew through
+   * the motion mailbox
+   */
+  void setThreadStarts(int starts);
+  int getThreadStarts();
+  // cycles through the valid start counts, returns the new count
+  int nextThreadStarts();
+  static bool isValidThreadStarts(int starts);
+
  protected:
   int getCurrentFeedSelectArraySize();
 };
@@ -0,0 +1,129 @@
+#include "handwheel.h"
+
+#include <config.h>
+#include <globalstate.h>
+#include <placement.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+Handwheel::Handwheel(HandwheelIO* io, Leadscrew* leadscrew, int countsPerDetent,
+                     float unitPulseDelay, int maxBacklog,
+                     GlobalState* globalState, Clock* clock)
+    : m_io(io),
+      m_leadscrew(leadscrew),
+      m_globalState(globalState),
+      m_countsPerDetent(countsPerDetent),
+      m_unitPulseDelay(unitPulseDelay),
+      m_maxBacklog(maxBacklog),
+      m_multiplier(mpgMultipliers[0]),
+      m_lastCount(io->readEncoder()),
+      m_partialCounts(0),
+      m_backlog(0),
+      m_allowance(0),
+      m_sinceUpdate(clock),
+      m_jogging(false),
+      m_droppedUnits(0) {}
+
+ELS_FASTRUN float Handwheel::getMaxUnitsPerMicro() {
+  return 1.0f / (m_unitPulseDelay * fabs(m_leadscrew->getRatio()));
+}
+
+ELS_FASTRUN void Handwheel::update() {
+  int32_t count = m_io->readEncoder();
+  int32_t counts = count - m_lastCount;
+  m_lastCount = count;
+  uint64_t elapsed = m_sinceUpdate;
+  m_sinceUpdate = 0;
+
+  // the wheel is always read so nothing turned while locked jumps later
+  GlobalMotionMode motionMode = m_globalState->getMotionMode();
+  if (m_globalState->getButtonLock() == GlobalButtonLock::LOCKED ||
+      motionMode == GlobalMotionMode::ENABLED) {
+    m_partialCounts = 0;
+    m_backlog = 0;
+    m_jogging = false;
+    return;
+  }
+
+  m_partialCounts += counts;
+  int detents = m_partialCounts / m_countsPerDetent;
+  m_partialCounts -= detents * m_countsPerDetent;
+
+  int backlog = m_backlog + detents * m_multiplier;
+  if (abs(backlog) > m_maxBacklog) {
+    m_droppedUnits += abs(backlog) - m_maxBacklog;
+    backlog = backlog > 0 ? m_maxBacklog : -m_maxBacklog;
+  }
+
+  if (backlog == 0) {
+    m_backlog = 0;
+    // once the leadscrew has caught up the jog is over
+    if (m_jogging && m_leadscrew->getPositionError() == 0) {
+      m_jogging = false;
+    }
+    return;
+  }
+
+  if (m_backlog == 0 || motionMode != GlobalMotionMode::JOG) {
+    // the first unit of a move goes straight away
+    m_allowance = 1;
+  } else {
+    m_allowance += elapsed * getMaxUnitsPerMicro();
+  }
+  m_backlog = backlog;
+  m_jogging = true;
+
+  // the loop owns the motion mode, so the enable button can't be undone from
+  // here. It puts the machine into jog mode once it sees we're jogging
+  if (motionMode != GlobalMotionMode::JOG) {
+    return;
+  }
+
+  // never feed faster than the speed limit
+  int feed = std::min(abs(m_backlog), (int)m_allowance);
+  if (feed == 0) {
+    return;
+  }
+  m_allowance -= feed;
+  if (m_backlog < 0) {
+    feed = -feed;
+  }
+  m_backlog -= feed;
+  m_leadscrew->incrementExpectedPosition(feed);
+}
+
+void Handwheel::setMultiplier(int multiplier) { m_multiplier = multiplier; }
+
+int Handwheel::getMultiplier() { return m_multiplier; }
+
+void Handwheel::nextMultiplier() {
+  int count = ARRAY_SIZE(mpgMultipliers);
+  for (int i = 0; i < count; i++) {
+    if (mpgMultipliers[i] == m_multiplier) {
+      m_multiplier = mpgMultipliers[(i + 1) % count];
+      return;
+    }
+  }
+  m_multiplier = mpgMultipliers[0];
+}
+
+bool Handwheel::isJogging() { return m_jogging; }
+
+int Handwheel::getBacklog() { return m_backlog; }
+
+uint32_t Handwheel::getDroppedUnits() { return m_droppedUnits; }
+
+void Handwheel::setClock(Clock* clock) { m_sinceUpdate.setClock(clock); }
+
+void Handwheel::printState() {
+#ifndef PIO_UNIT_TESTING
+  Serial.print("Handwheel multiplier: x");
+  Serial.println(m_multiplier);
+  Serial.print("Handwheel jogging: ");
+  Serial.println(m_jogging ? "YES" : "NO");
+  Serial.print("Handwheel dropped units: ");
+  Serial.println(m_droppedUnits);
+#endif
+}
@@ -0,0 +1,84 @@
+#include <clock.h>
+#include <globalstate.h>
+#include <leadscrew.h>
+
+#include <cstdint>
+
+#include "handwheel_io.h"
+#pragma once
+
+/**
+ * An MPG handwheel that jogs the leadscrew from the motion timer
+ *
+ * Every detent moves the leadscrew's expected position by the multiplier, in
+ * the same position units as the jog buttons. The leadscrew follows with its
+ * normal acceleration, but the handwheel never feeds it faster than the max
+ * speed. Detents that would take longer than the backlog limit to catch up on
+ * are dropped, so the carriage stops shortly after the wheel does
+ */
+class Handwheel {
+ private:
+  HandwheelIO* m_io;
+  Leadscrew* m_leadscrew;
+  GlobalState* m_globalState;
+
+  const int m_countsPerDetent;
+  // the microseconds per position unit at a ratio of 1
+  const float m_unitPulseDelay;
+  const int m_maxBacklog;
+
+  int m_multiplier;
+  int32_t m_lastCount;
+  // counts that haven't made a full detent yet
+  int32_t m_partialCounts;
+
+  // position units turned on the wheel but not fed to the leadscrew yet
+  int m_backlog;
+  // how many units the speed limit lets us feed right now
+  float m_allowance;
+  ElapsedMicros m_sinceUpdate;
+
+  // true from the first detent until the leadscrew has caught up
+  bool m_jogging;
+
+  // stats
+  uint32_t m_droppedUnits;
+
+  float getMaxUnitsPerMicro();
+
+ public:
+  /**
+   * `unitPulseDelay` is scaled by the leadscrew ratio the same way the jog
+   * buttons are, `maxBacklog` is in position units. The firmware runs off the
+   * global state and the system clock, anything else can hand in its own
+   */
+  Handwheel(HandwheelIO* io, Leadscrew* leadscrew, int countsPerDetent,
+            float unitPulseDelay, int maxBacklog,
+            GlobalState* globalState = GlobalState::getInstance(),
+            Clock* clock = SystemClock::getInstance());
+
+  /**
+   * Reads the wheel and feeds the leadscrew, call every motion timer tick
+   * before the leadscrew update
+   *
+   * The wheel only jogs while motion isn't enabled and the buttons aren't
+   * locked, anything turned otherwise is ignored. It never changes the motion
+   * mode itself, turns are held back until the loop sees isJogging() and puts
+   * the machine into jog mode, and it's the loop that ends the jog as well
+   */
+  void update();
+
+  void setMultiplier(int multiplier);
+  int getMultiplier();
+  // cycles through ELS_MPG_MULTIPLIERS
+  void nextMultiplier();
+
+  // true while the handwheel wants jog mode or is still moving the leadscrew
+  bool isJogging();
+  int getBacklog();
+  uint32_t getDroppedUnits();
+
+  void setClock(Clock* clock);
+
+  void printState();
+};
@@ -0,0 +1,15 @@
+#include <config.h>
+
+#include <cstdint>
+
+#pragma once
+
+/**
+ * This defines the HW interface for the MPG handwheel encoder, abstracted away
+ * from the actual calls so we can test it more easily
+ */
+class HandwheelIO {
+ public:
+  // the absolute encoder count, this is never reset
+  virtual int32_t readEncoder() = 0;
+};
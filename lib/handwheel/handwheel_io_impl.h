@@ -0,0 +1,15 @@
+#include <Encoder.h>
+#include <config.h>
+#include <placement.h>
+
+#include "handwheel_io.h"
+#pragma once
+
+class HandwheelIOImpl : public HandwheelIO {
+  Encoder m_encoder;
+
+ public:
+  HandwheelIOImpl() : m_encoder(ELS_MPG_ENCODER_A, ELS_MPG_ENCODER_B) {}
+
+  ELS_FASTRUN int32_t readEncoder() { return m_encoder.read(); }
+};
@@ -0,0 +1,58 @@
+#include "idle_detector.h"
+
+#include <placement.h>
+
+#ifndef PIO_UNIT_TESTING
+#include <Arduino.h>
+#endif
+
+IdleDetector::IdleDetector(uint32_t activeTickUs, uint32_t idleTickUs,
+                           uint32_t idleAfterUs)
+    : m_activeTickUs(activeTickUs),
+      m_idleTickUs(idleTickUs),
+      m_idleAfterUs(idleAfterUs),
+      m_tickUs(activeTickUs),
+      m_quietUs(0),
+      m_wakeups(0),
+      m_idleTicks(0) {}
+
+ELS_FASTRUN uint32_t IdleDetector::update(bool active) {
+  if (active) {
+    if (isIdle()) {
+      m_wakeups++;
+    }
+    m_quietUs = 0;
+    m_tickUs = m_activeTickUs;
+    return m_tickUs;
+  }
+
+  if (isIdle()) {
+    m_idleTicks++;
+    return m_tickUs;
+  }
+
+  m_quietUs += m_tickUs;
+  if (m_quietUs >= m_idleAfterUs) {
+    m_tickUs = m_idleTickUs;
+  }
+  return m_tickUs;
+}
+
+ELS_FASTRUN bool IdleDetector::isIdle() { return m_tickUs != m_activeTickUs; }
+
+ELS_FASTRUN uint32_t IdleDetector::getTickUs() { return m_tickUs; }
+
+uint32_t IdleDetector::getWakeups() { return m_wakeups; }
+
+uint32_t IdleDetector::getIdleTicks() { return m_idleTicks; }
+
+void IdleDetector::printState() {
+#ifndef PIO_UNIT_TESTING
+  Serial.print("Motion timer idle: ");
+  Serial.println(isIdle() ? "YES" : "NO");
+  Serial.print("Motion timer tick: ");
+  Serial.println(m_tickUs);
+  Serial.print("Motion timer wakeups: ");
+  Serial.println(m_wakeups);
+#endif
+}
@@ -0,0 +1,43 @@
+#include <cstdint>
+
+#pragma once
+
+/**
+ * Slows the motion timer down while nothing is moving
+ *
+ * The timer tells the detector every tick whether anything needed it. Once
+ * nothing has for `idleAfterUs` the detector asks for the slower idle tick,
+ * and the first tick that sees activity again asks for the full rate straight
+ * away
+ */
+class IdleDetector {
+ private:
+  const uint32_t m_activeTickUs;
+  const uint32_t m_idleTickUs;
+  const uint32_t m_idleAfterUs;
+
+  uint32_t m_tickUs;
+  // how long nothing has been moving for
+  uint32_t m_quietUs;
+
+  // stats
+  uint32_t m_wakeups;
+  uint32_t m_idleTicks;
+
+ public:
+  IdleDetector(uint32_t activeTickUs, uint32_t idleTickUs,
+               uint32_t idleAfterUs);
+
+  /**
+   * Call once every tick, returns the tick period to use from now on
+   */
+  uint32_t update(bool active);
+  bool isIdle();
+  // the tick period we're currently running at
+  uint32_t getTickUs();
+  // how many times we've gone back to the full rate
+  uint32_t getWakeups();
+  uint32_t getIdleTicks();
+
+  void printState();
+};
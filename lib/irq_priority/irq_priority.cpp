@@ -0,0 +1,28 @@
+#include "irq_priority.h"
+
+#include <config.h>
+
+#ifndef PIO_UNIT_TESTING
+#include <Arduino.h>
+#endif
+
+static_assert(getIrqPriorityLevel(ELS_ENCODER_IRQ_PRIORITY) <
+                  getIrqPriorityLevel(ELS_MOTION_TIMER_PRIORITY),
+              "the encoder has to preempt the motion timer");
+static_assert(getIrqPriorityLevel(ELS_MOTION_TIMER_PRIORITY) <
+                  getIrqPriorityLevel(ELS_COMMS_IRQ_PRIORITY),
+              "the motion timer has to preempt the communications");
+
+void applyIrqPriorities() {
+#if !defined(PIO_UNIT_TESTING) && defined(__IMXRT1062__)
+  // every pin runs as fast GPIO, so all the encoders share this one vector
+  NVIC_SET_PRIORITY(IRQ_GPIO6789, ELS_ENCODER_IRQ_PRIORITY);
+
+  NVIC_SET_PRIORITY(IRQ_USB1, ELS_COMMS_IRQ_PRIORITY);
+  NVIC_SET_PRIORITY(IRQ_LPI2C1, ELS_COMMS_IRQ_PRIORITY);
+  // SPI picks its DMA channels when it first needs them, cover them all
+  for (int i = 0; i < 16; i++) {
+    NVIC_SET_PRIORITY(IRQ_DMA_CH0 + i, ELS_COMMS_IRQ_PRIORITY);
+  }
+#endif
+}
@@ -0,0 +1,46 @@
+#include <cstdint>
+
+#pragma once
+
+/**
+ * The interrupt priority plan, from most to least urgent
+ *
+ *   ELS_ENCODER_IRQ_PRIORITY   spindle encoder, its index and the handwheel,
+ *                              all on the one fast GPIO vector
+ *   ELS_MOTION_TIMER_PRIORITY  the motion timer, every step edge comes from it
+ *   ELS_COMMS_IRQ_PRIORITY     USB serial, I2C and the DMA behind the SPI TFT
+ *   thread mode                loop() and the scheduler's tasks
+ *
+ * A level only ever waits for the ones above it. Nothing is shared through a
+ * lock, every piece of state that crosses a level has one writer:
+ *
+ *   encoder count     GPIO -> timer  the Encoder library, read() masks
+ *                                    interrupts for a few cycles to copy it
+ *   index count       GPIO -> timer  SpindleIOImpl, a sequence count the timer
+ *                                    reads around the count and retries on
+ *   leadscrew changes loop -> timer  MotionMailbox, an SpscQueue
+ *   motion mode       loop -> timer  GlobalState, the timer only reads it
+ *   handwheel jog     timer -> loop  Handwheel::isJogging(), the loop puts the
+ *                                    machine in and out of jog mode for it
+ *   buttons           timer -> loop  ButtonScanner, atomic masks and an
+ *                                    SpscQueue of events
+ *   scope capture     timer -> loop  Scope, handed over by its atomic state
+ *   DMA done          DMA -> loop    SpiTftIOImpl, a volatile busy flag
+ *
+ * SystemClock::nowCycles() also masks interrupts for a few cycles to extend the
+ * cycle counter. The timer's own state is only ever touched by the timer and
+ * by setup() before it starts
+ */
+
+/**
+ * Puts the encoder and communication interrupts on their levels, call it from
+ * setup() once the encoders and the display have been set up. The motion timer
+ * gets its level from IntervalTimer::priority() before it's started. Does
+ * nothing on native builds
+ */
+void applyIrqPriorities();
+
+// the NVIC only looks at the top four bits
+constexpr uint8_t getIrqPriorityLevel(uint8_t priority) {
+  return priority >> 4;
+}
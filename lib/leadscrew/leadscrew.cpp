@@ -1,6 +1,7 @@
 #include "leadscrew.h"
 
 #include <globalstate.h>
+#include <placement.h>
 
 #include <cmath>
 #include <cstdint>
@@ -11,26 +12,55 @@ using namespace std;
 
 Leadscrew::Leadscrew(Spindle* spindle, LeadscrewIO* io, float initialPulseDelay,
                      float pulseDelayIncrement, int motorPulsePerRevolution,
-                     float leadscrewPitch)
-    : motorPulsePerRevolution(motorPulsePerRevolution),
+                     float leadscrewPitch, GlobalState* globalState,
+                     Clock* clock)
+    : LinearAxis(clock),
+      motorPulsePerRevolution(motorPulsePerRevolution),
       leadscrewPitch(leadscrewPitch),
       initialPulseDelay(initialPulseDelay),
       pulseDelayIncrement(pulseDelayIncrement),
       m_io(io),
       m_spindle(spindle),
+      m_globalState(globalState),
+      m_ratioRampMicros(clock),
       m_accumulator(0),
       m_currentDirection(LeadscrewDirection::UNKNOWN),
       m_leftStopState(LeadscrewStopState::UNSET),
       m_rightStopState(LeadscrewStopState::UNSET),
-      m_currentPulseDelay(initialPulseDelay) {
-  setRatio(GlobalState::getInstance()->getCurrentFeedPitch());
-  m_lastPulseMicros = 0;
+      m_currentPulseDelay(initialPulseDelay),
+      m_minPulseDelay(LEADSCREW_TIMER_US * 2),
+      m_topSpeedPulseDelay(0),
+      m_backlashSteps(0),
+      m_backlashPulseDelay(0),
+      m_backlashRemaining(0),
+      m_lastMovedDirection(LeadscrewDirection::UNKNOWN),
+      m_commandedMotorPosition(0),
+      m_feedbackOffset(0),
+      m_feedbackSynced(false),
+      m_correcting(false),
+      m_stalled(false),
+      m_feedbackTolerance(ELS_LEADSCREW_FEEDBACK_TOLERANCE_STEPS),
+      m_stallThreshold(ELS_LEADSCREW_STALL_THRESHOLD_STEPS),
+      m_correctionPulseDelay(ELS_LEADSCREW_CORRECTION_PULSE_DELAY_US),
+      m_correctedSteps(0),
+      m_correctionAttempts(0),
+      m_recoverySteps(0),
+      m_lastMotionMode(GlobalMotionMode::DISABLED),
+      m_threadStarts(1),
+      m_threadStart(0),
+      m_waitingForThreadStart(false),
+      m_threadPassStarted(false),
+      m_lastThreadAngle(0),
+      m_accelCurve(nullptr),
+      m_leftStopExact(0),
+      m_rightStopExact(0) {
+  setRatio(m_globalState->getCurrentFeedPitch());
   m_lastFullPulseDurationMicros = 0;
   m_expectedPosition = 0;
   m_currentPosition = 0;
 }
 
-void Leadscrew::setRatio(float ratio) {
+ELS_FASTRUN void Leadscrew::setRatio(float ratio) {
   // reset the positions to base values
   m_currentPosition /= m_ratio;
   if (m_leftStopState == LeadscrewStopState::SET) {
@@ -41,6 +71,7 @@ void Leadscrew::setRatio(float ratio) {
   }
 
   m_ratio = ratio;
+  m_targetRatio = ratio;
   // extrapolate the current position based on the new ratio
   m_currentPosition *= m_ratio;
   if (m_leftStopState == LeadscrewStopState::SET) {
@@ -49,21 +80,46 @@ void Leadscrew::setRatio(float ratio) {
   if (m_rightStopState == LeadscrewStopState::SET) {
     m_rightStopPosition *= m_ratio;
   }
+  m_leftStopExact = m_leftStopPosition;
+  m_rightStopExact = m_rightStopPosition;
 }
 
-float Leadscrew::getRatio() { return m_ratio; }
+ELS_FASTRUN void Leadscrew::changeRatio(float ratio) {
+  if (m_globalState->getFeedMode() == GlobalFeedMode::FEED &&
+      m_globalState->getMotionMode() == GlobalMotionMode::ENABLED) {
+    m_targetRatio = ratio;
+    m_ratioRampMicros = 0;
+    return;
+  }
+  setRatio(ratio);
+}
+
+ELS_FASTRUN float Leadscrew::getRatio() { return m_ratio; }
+
+float Leadscrew::getTargetRatio() { return m_targetRatio; }
+
+void Leadscrew::setClock(Clock* clock) {
+  Axis::setClock(clock);
+  m_ratioRampMicros.setClock(clock);
+}
 
-int Leadscrew::getExpectedPosition() {
-  return m_expectedPosition;
+ELS_FASTRUN int Leadscrew::getExpectedPosition() {
+  // follow the spindle smoothly between encoder counts
+  return m_expectedPosition + m_spindle->getInterpolationOffset() * getRatio();
 }
 
-int Leadscrew::getCurrentPosition() { return m_currentPosition; }
+ELS_FASTRUN int Leadscrew::getCurrentPosition() { return m_currentPosition; }
+
+ELS_FASTRUN float Leadscrew::getPulsesPerPosition() {
+  // every position is a pulse, plus the extra pulses the accumulator adds
+  return 1 + fabs(getAccumulatorUnit());
+}
 
-void Leadscrew::resetCurrentPosition() {
-  m_currentPosition = m_expectedPosition;
+ELS_FASTRUN void Leadscrew::resetCurrentPosition() {
+  m_currentPosition = getExpectedPosition();
 }
 
-void Leadscrew::unsetStopPosition(StopPosition position) {
+ELS_FASTRUN void Leadscrew::unsetStopPosition(StopPosition position) {
   switch (position) {
     case LEFT:
       m_leftStopState = LeadscrewStopState::UNSET;
@@ -76,14 +132,17 @@ void Leadscrew::unsetStopPosition(StopPosition position) {
   }
 }
 
-void Leadscrew::setStopPosition(StopPosition position, int stopPosition) {
+ELS_FASTRUN void Leadscrew::setStopPosition(StopPosition position,
+                                            int stopPosition) {
   switch (position) {
     case LEFT:
       m_leftStopPosition = stopPosition;
+      m_leftStopExact = stopPosition;
       m_leftStopState = LeadscrewStopState::SET;
       break;
     case RIGHT:
       m_rightStopPosition = stopPosition;
+      m_rightStopExact = stopPosition;
       m_rightStopState = LeadscrewStopState::SET;
       break;
   }
@@ -115,17 +174,358 @@ int Leadscrew::getStopPosition(StopPosition position) {
   return 0;
 }
 
+void Leadscrew::setBacklashCompensation(int steps, float pulseDelay) {
+  m_backlashSteps = max(0, steps);
+  m_backlashPulseDelay = pulseDelay;
+}
+
+int Leadscrew::getBacklashRemaining() { return m_backlashRemaining; }
+
+void Leadscrew::setFeedbackCorrection(int tolerance, int stallThreshold,
+                                      float pulseDelay) {
+  m_feedbackTolerance = tolerance;
+  m_stallThreshold = stallThreshold;
+  m_correctionPulseDelay = pulseDelay;
+}
+
+bool Leadscrew::hasFeedback() { return m_io->hasFeedback(); }
+
+ELS_FASTRUN int Leadscrew::getMissedSteps() {
+  if (!m_io->hasFeedback() || !m_feedbackSynced) {
+    return 0;
+  }
+  return m_commandedMotorPosition -
+         (m_io->readFeedbackPosition() + m_feedbackOffset);
+}
+
+int Leadscrew::getCorrectedSteps() { return m_correctedSteps; }
+
+bool Leadscrew::isStalled() { return m_stalled; }
+
+ELS_FASTRUN void Leadscrew::clearStall() {
+  // resync the feedback on the next update
+  m_feedbackSynced = false;
+  m_correcting = false;
+  m_correctionAttempts = 0;
+  m_recoverySteps = 0;
+  m_stalled = false;
+  restoreDirPin();
+}
+
+ELS_FASTRUN void Leadscrew::recoverStall() {
+  if (!m_stalled) {
+    return;
+  }
+  m_recoverySteps = abs(getMissedSteps());
+  m_correcting = false;
+  m_correctionAttempts = 0;
+  m_stalled = false;
+  restoreDirPin();
+}
+
+ELS_FASTRUN void Leadscrew::restoreDirPin() {
+  switch (m_currentDirection) {
+    case LeadscrewDirection::RIGHT:
+      m_io->writeDirPin(1);
+      break;
+    case LeadscrewDirection::LEFT:
+      m_io->writeDirPin(0);
+      break;
+    case LeadscrewDirection::UNKNOWN:
+      break;
+  }
+}
+
+ELS_FASTRUN bool Leadscrew::handleFeedback() {
+  if (!m_io->hasFeedback()) {
+    return false;
+  }
+
+  // whatever the encoder reads when we first look at it is where we are
+  if (!m_feedbackSynced) {
+    m_feedbackOffset = m_commandedMotorPosition - m_io->readFeedbackPosition();
+    m_feedbackSynced = true;
+  }
+
+  // we've either fallen too far behind, or the motor isn't responding to the
+  // correction pulses either
+  int missedSteps = getMissedSteps();
+  int stallSteps = m_stallThreshold + m_recoverySteps;
+  if (!m_stalled && (abs(missedSteps) > stallSteps ||
+                     m_correctionAttempts > stallSteps)) {
+    m_stalled = true;
+    // whatever happens next the motor starts again from rest
+    m_currentPulseDelay = initialPulseDelay;
+  }
+  if (m_stalled) {
+    return true;
+  }
+
+  // don't start a correction in the middle of a pulse, and once started keep
+  // going until we're back on the commanded position
+  bool needsCorrection =
+      m_correcting ? missedSteps != 0
+                   : abs(missedSteps) > m_feedbackTolerance &&
+                         m_io->readStepPin() == 0;
+  if (!needsCorrection) {
+    if (m_correcting) {
+      m_correcting = false;
+      restoreDirPin();
+    }
+    if (abs(missedSteps) <= m_feedbackTolerance) {
+      m_recoverySteps = 0;
+    }
+    return false;
+  }
+
+  if (!m_correcting) {
+    m_correcting = true;
+    m_correctionAttempts = 0;
+    m_io->writeDirPin(missedSteps > 0 ? 1 : 0);
+  }
+
+  // correction pulses don't count towards the commanded position, they're
+  // catching the motor up to it
+  if (m_lastPulseMicros >= m_correctionPulseDelay && sendPulse()) {
+    m_lastPulseMicros = 0;
+    m_correctedSteps++;
+    m_correctionAttempts++;
+  }
+  return true;
+}
+
+// the forward distance from one spindle angle to another
+ELS_FASTRUN int spindleAngleBetween(int from, int to) {
+  int angle = (to - from) % ELS_SPINDLE_ENCODER_PPR;
+  if (angle < 0) {
+    angle += ELS_SPINDLE_ENCODER_PPR;
+  }
+  return angle;
+}
+
+ELS_FASTRUN void Leadscrew::setThreadStarts(int starts) {
+  if (!GlobalState::isValidThreadStarts(starts)) {
+    starts = 1;
+  }
+  m_threadStart = 0;
+  m_threadStarts = starts;
+}
+
+int Leadscrew::getThreadStarts() { return m_threadStarts; }
+
+int Leadscrew::getThreadStart() { return m_threadStart; }
+
+ELS_FASTRUN int Leadscrew::nextThreadStart() {
+  int start = m_threadStart + 1;
+  m_threadStart = start < m_threadStarts ? start : 0;
+
+  return m_threadStart;
+}
+
+ELS_FASTRUN int Leadscrew::getThreadStartAngle() {
+  return m_threadStart * ELS_SPINDLE_ENCODER_PPR / m_threadStarts;
+}
+
+ELS_FASTRUN bool Leadscrew::handleThreadStart(GlobalMotionMode motionMode) {
+  if (motionMode != m_lastMotionMode) {
+    // a finished pass moves a multi-start thread on to its next start
+    if (m_lastMotionMode == GlobalMotionMode::ENABLED && m_threadPassStarted) {
+      nextThreadStart();
+    }
+    m_threadPassStarted = false;
+
+    m_lastMotionMode = motionMode;
+    m_waitingForThreadStart =
+        motionMode == GlobalMotionMode::ENABLED &&
+        m_globalState->getFeedMode() == GlobalFeedMode::THREAD &&
+        m_spindle->isIndexReferenced();
+    m_lastThreadAngle = m_spindle->getIndexedPosition();
+  }
+
+  if (!m_waitingForThreadStart) {
+    return false;
+  }
+
+  // wait for the spindle to come round to the angle of the start we're
+  // cutting, a small step backwards is encoder jitter not a whole revolution
+  int startAngle = getThreadStartAngle();
+  int angle = m_spindle->getIndexedPosition();
+  int travelled = spindleAngleBetween(m_lastThreadAngle, angle);
+  int toStart = spindleAngleBetween(m_lastThreadAngle, startAngle);
+  if (travelled > ELS_SPINDLE_ENCODER_PPR / 2) {
+    travelled = 0;
+  }
+
+  // the leadscrew follows the interpolated spindle angle, which can still be
+  // short of the start after the encoder has reached it
+  float interpolationOffset = m_spindle->getInterpolationOffset();
+  int sinceStart = spindleAngleBetween(startAngle, angle);
+  bool reachedStart = toStart <= travelled;
+  if (reachedStart) {
+    m_lastThreadAngle = startAngle;
+  } else if (travelled > 0) {
+    m_lastThreadAngle = angle;
+  }
+
+  bool behindStart = sinceStart > ELS_SPINDLE_ENCODER_PPR / 2 ||
+                     sinceStart + interpolationOffset < 0;
+  if (!reachedStart || behindStart) {
+    // hold still until the start comes round, the spindle movement until then
+    // doesn't count
+    m_expectedPosition =
+        m_currentPosition - interpolationOffset * getRatio();
+    return true;
+  }
+
+  // start from exactly where the start angle was rather than wherever the
+  // spindle got to by this update. The expected position is rebuilt from the
+  // spindle angle so every pass has the same fractional phase
+  m_waitingForThreadStart = false;
+  m_threadPassStarted = true;
+  m_expectedPosition = m_currentPosition + sinceStart * getRatio();
+  return false;
+}
+
+bool Leadscrew::isWaitingForThreadStart() { return m_waitingForThreadStart; }
+
+ELS_FASTRUN bool Leadscrew::isIdle() {
+  // half way through a pulse, or still taking up backlash or correcting
+  if (m_io->readStepPin() != 0 || m_backlashRemaining != 0 || m_correcting) {
+    return false;
+  }
+  if (m_globalState->getMotionMode() != m_lastMotionMode ||
+      m_ratio != m_targetRatio) {
+    return false;
+  }
+  if (m_io->hasFeedback() && abs(getMissedSteps()) > m_feedbackTolerance &&
+      !m_stalled) {
+    return false;
+  }
+  return getPositionError() == 0;
+}
+
 void Leadscrew::setCurrentPosition(int position) {
   m_currentPosition = position;
 }
 
-void Leadscrew::incrementCurrentPosition(int amount) {
+ELS_FASTRUN void Leadscrew::incrementCurrentPosition(int amount) {
   m_currentPosition += amount;
 }
 
-float Leadscrew::getAccumulatorUnit() { return getRatio() / leadscrewPitch; }
+ELS_FASTRUN void Leadscrew::incrementExpectedPosition(int amount) {
+  m_expectedPosition += amount;
+}
+
+ELS_FASTRUN void Leadscrew::setAccelCurve(AccelCurve* accelCurve) {
+  m_accelCurve = accelCurve;
+}
+
+AccelCurve* Leadscrew::getAccelCurve() { return m_accelCurve; }
+
+void Leadscrew::setMinPulseDelay(float minPulseDelay) {
+  m_minPulseDelay = minPulseDelay;
+}
+
+ELS_FASTRUN void Leadscrew::setTopSpeedPulseDelay(float pulseDelay) {
+  m_topSpeedPulseDelay = pulseDelay;
+}
+
+float Leadscrew::getTopSpeedPulseDelay() { return m_topSpeedPulseDelay; }
+
+void Leadscrew::setGlobalState(GlobalState* globalState) {
+  m_globalState = globalState;
+}
+
+ELS_FASTRUN float Leadscrew::getPulseDelayIncrement(float pulseDelay) {
+  if (m_accelCurve != nullptr) {
+    return m_accelCurve->getIncrement(pulseDelay);
+  }
+  return pulseDelayIncrement;
+}
+
+ELS_FASTRUN void Leadscrew::rampRatio(GlobalMotionMode motionMode) {
+  if (m_ratio == m_targetRatio) {
+    return;
+  }
+  // disabling motion or switching to threads mid ramp takes the new ratio the
+  // way changeRatio would have
+  if (m_globalState->getFeedMode() != GlobalFeedMode::FEED ||
+      motionMode != GlobalMotionMode::ENABLED) {
+    setRatio(m_targetRatio);
+    return;
+  }
+  float elapsedSeconds = (float)m_ratioRampMicros / US_PER_SECOND;
+  m_ratioRampMicros = 0;
+  float lastPulsesPerPosition = getPulsesPerPosition();
+
+  // the carriage moves at the spindle speed times the ratio, so every second
+  // the ratio can change by the acceleration over the spindle speed. Only half
+  // the acceleration is used, the leadscrew needs the rest to keep up
+  float revolutionsPerSecond =
+      m_spindle->getCountRate() / ELS_SPINDLE_ENCODER_PPR;
+  float acceleration = getPulseDelayIncrement(m_currentPulseDelay) *
+                       motorPulsePerRevolution / leadscrewPitch;
+  // a stopped spindle or no acceleration limit, nothing to ramp
+  if (revolutionsPerSecond <= 0 || acceleration <= 0) {
+    m_ratio = m_targetRatio;
+  } else {
+    float maxChange =
+        acceleration / 2 * elapsedSeconds / revolutionsPerSecond;
+    if (fabs(m_targetRatio - m_ratio) <= maxChange) {
+      m_ratio = m_targetRatio;
+    } else {
+      m_ratio += m_targetRatio > m_ratio ? maxChange : -maxChange;
+    }
+  }
+  keepStopsInPlace(lastPulsesPerPosition);
+}
+
+ELS_FASTRUN void Leadscrew::keepStopsInPlace(float lastPulsesPerPosition) {
+  float scale = lastPulsesPerPosition / getPulsesPerPosition();
+  if (m_leftStopState == LeadscrewStopState::SET) {
+    m_leftStopExact =
+        m_currentPosition + (m_leftStopExact - m_currentPosition) * scale;
+    m_leftStopPosition = lroundf(m_leftStopExact);
+  }
+  if (m_rightStopState == LeadscrewStopState::SET) {
+    m_rightStopExact =
+        m_currentPosition + (m_rightStopExact - m_currentPosition) * scale;
+    m_rightStopPosition = lroundf(m_rightStopExact);
+  }
+}
+
+ELS_FASTRUN float Leadscrew::getAccumulatorUnit() {
+  return getRatio() / leadscrewPitch;
+}
+
+ELS_FASTRUN void Leadscrew::resetAccumulator() {
+  // stopping and starting again in the same direction carries on where the
+  // last move left off, otherwise how many pulses a position takes would
+  // depend on how often we stop
+  if (m_currentDirection != m_lastMovedDirection) {
+    m_accumulator = m_currentDirection * getAccumulatorUnit();
+  }
+}
+
+ELS_FASTRUN int Leadscrew::getDistanceToStop() {
+  switch (m_currentDirection) {
+    case LeadscrewDirection::RIGHT:
+      if (m_rightStopState == LeadscrewStopState::SET) {
+        return m_rightStopPosition - m_currentPosition;
+      }
+      break;
+    case LeadscrewDirection::LEFT:
+      if (m_leftStopState == LeadscrewStopState::SET) {
+        return m_currentPosition - m_leftStopPosition;
+      }
+      break;
+    case LeadscrewDirection::UNKNOWN:
+      break;
+  }
+  return INT32_MAX;
+}
 
-bool Leadscrew::sendPulse() {
+ELS_FASTRUN bool Leadscrew::sendPulse() {
   uint8_t pinState = m_io->readStepPin();
 
   // Keep the pulse pin high as long as we're not scheduled to send a pulse
@@ -140,51 +540,58 @@ bool Leadscrew::sendPulse() {
 }
 
 /**
- * Due to the cumulative nature of the pulses when stopping, we can model the
- * stopping distance as a quadratic equation.
+ * Every pulse while decelerating grows the pulse delay by the increment times
+ * the duration of the last pulse, so the delay grows geometrically by a factor
+ * of (1 + increment) per pulse until it reaches the initial pulse delay.
  * This function calculates the number of pulses required to stop the leadscrew
- * from a given pulse delay
+ * from a given pulse delay, never faster than the timer's minimum pulse delay
  */
-int calculate_pulses_to_stop(float currentPulseDelay, float initialPulseDelay,
-                             float pulseDelayIncrement) {
-  // Calculate the discriminant
-  float discriminant = currentPulseDelay * currentPulseDelay -
-                       4 * (pulseDelayIncrement / 2.0) * (-initialPulseDelay);
-
-  // Ensure the discriminant is non-negative for real roots
-  if (discriminant >= 0) {
-    // Calculate the square root of the discriminant
-    float sqrtDiscriminant = sqrt(discriminant);
-
-    // Calculate the positive root using the quadratic formula
-    float n =
-        (-currentPulseDelay + sqrtDiscriminant) / (2 * pulseDelayIncrement);
-
-    // Round up to the nearest integer because pulses must be whole numbers
-    return abs((int)ceil(n));
-  } else {
-    // If the discriminant is negative, return 0 as a fallback (no real
-    // solution)
+ELS_FASTRUN int calculate_pulses_to_stop(float currentPulseDelay,
+                                         float initialPulseDelay,
+                                         float pulseDelayIncrement,
+                                         float minPulseDelay) {
+  // we can stop instantly from anything slower than the initial speed, or at
+  // any speed when acceleration is disabled
+  if (currentPulseDelay >= initialPulseDelay || pulseDelayIncrement <= 0) {
     return 0;
   }
+
+  // a delay of 0 means we're going as fast as the timer allows, the fastest we
+  // can actually pulse is one full pulse every two timer ticks
+  float delay = max(currentPulseDelay, minPulseDelay);
+
+  // solve delay * (1 + increment)^n >= initialPulseDelay for n
+  float n = log(initialPulseDelay / delay) / log(1 + pulseDelayIncrement);
+
+  // Round up to the nearest integer because pulses must be whole numbers
+  return max(0, (int)ceil(n));
 }
 
-void Leadscrew::update() {
-  GlobalState* globalState = GlobalState::getInstance();
+ELS_FASTRUN void Leadscrew::update() {
+  GlobalMotionMode motionMode = m_globalState->getMotionMode();
+  rampRatio(motionMode);
 
   // consume the pulses from the spindle
   // since the spindle is a rotational axis, it keeps track of the pulses that 
   m_expectedPosition += m_spindle->consumePosition() * getRatio();
 
+  if (handleThreadStart(motionMode)) {
+    return;
+  }
+
   int positionError = getPositionError();
 
-  switch (globalState->getMotionMode()) {
+  switch (motionMode) {
     case GlobalMotionMode::DISABLED:
       // ignore the spindle, pretend we're in sync all the time
       resetCurrentPosition();
       break;
     case GlobalMotionMode::JOG:
     case GlobalMotionMode::ENABLED:
+      if (handleFeedback()) {
+        break;
+      }
+
       LeadscrewDirection nextDirection = LeadscrewDirection::UNKNOWN;
 
       /**
@@ -204,7 +611,7 @@ void Leadscrew::update() {
         if (m_currentDirection == LeadscrewDirection::UNKNOWN) {
           m_io->writeDirPin(1);
           m_currentDirection = LeadscrewDirection::RIGHT;
-          m_accumulator = m_currentDirection * getAccumulatorUnit();
+          resetAccumulator();
         }
 
       } else if (positionError < 0) {
@@ -216,13 +623,34 @@ void Leadscrew::update() {
         if (m_currentDirection == LeadscrewDirection::UNKNOWN) {
           m_io->writeDirPin(0);
           m_currentDirection = LeadscrewDirection::LEFT;
-          m_accumulator = m_currentDirection * getAccumulatorUnit();
+          resetAccumulator();
         }
       } else {
         m_currentDirection = LeadscrewDirection::UNKNOWN;
         break;
       }
 
+      /**
+       * When reversing we have to take up the backlash in the nut before the
+       * carriage moves. If we reverse again half way through a take up, only
+       * the part that was already taken up needs undoing
+       */
+      if (m_currentDirection != m_lastMovedDirection) {
+        if (m_lastMovedDirection != LeadscrewDirection::UNKNOWN) {
+          m_backlashRemaining = m_backlashSteps - m_backlashRemaining;
+        }
+        m_lastMovedDirection = m_currentDirection;
+      }
+
+      if (m_backlashRemaining > 0) {
+        if (m_lastPulseMicros >= m_backlashPulseDelay && sendPulse()) {
+          m_lastPulseMicros = 0;
+          m_backlashRemaining--;
+          m_commandedMotorPosition += m_currentDirection;
+        }
+        break;
+      }
+
       bool hitEndstop = (m_rightStopState == LeadscrewStopState::SET &&
                          m_currentPosition >= m_rightStopPosition &&
                          m_currentDirection == LeadscrewDirection::RIGHT) ||
@@ -241,6 +669,7 @@ void Leadscrew::update() {
         m_lastFullPulseDurationMicros =
             min((uint32_t)m_lastPulseMicros, (uint32_t)initialPulseDelay);
         m_lastPulseMicros = 0;
+        m_commandedMotorPosition += m_currentDirection;
 
         // handle position update
         if (m_accumulator > 1 || m_accumulator < -1) {
@@ -251,20 +680,51 @@ void Leadscrew::update() {
         }
 
         // calculate the stopping time
-        int pulsesToStop = calculate_pulses_to_stop(
-            m_currentPulseDelay, initialPulseDelay, pulseDelayIncrement);
+        // the delay can drop below what the timer can actually produce, the
+        // last pulse duration is the speed we're really going at
+        float effectivePulseDelay =
+            max(m_currentPulseDelay, (float)m_lastFullPulseDurationMicros);
+        // with a speed dependent curve the estimate can be a pulse out, so
+        // make sure we could still stop if we sped up again on this pulse
+        int pulsesToStop;
+        if (m_accelCurve != nullptr) {
+          float acceleratedPulseDelay =
+              m_currentPulseDelay -
+              getPulseDelayIncrement(m_currentPulseDelay) *
+                  m_lastFullPulseDurationMicros;
+          pulsesToStop = m_accelCurve->getPulsesToStop(
+              min(effectivePulseDelay, acceleratedPulseDelay));
+        } else {
+          pulsesToStop =
+              calculate_pulses_to_stop(effectivePulseDelay, initialPulseDelay,
+                                       pulseDelayIncrement, m_minPulseDelay);
+        }
+
+        // treat the stop ahead of us as a target to decelerate into rather
+        // than a wall. The stops are in position units, thanks to the
+        // accumulator every position unit takes 1 + accumulator unit pulses,
+        // but the position reaches the stop on the first pulse of the last unit
+        int distanceToStop = getDistanceToStop();
+        bool approachingStop =
+            distanceToStop != INT32_MAX &&
+            (distanceToStop - 1) * (1 + fabs(getAccumulatorUnit())) + 1 <=
+                pulsesToStop;
 
         // if this is true we should start decelerating to stop at the
         // correct position
         bool shouldStop = abs(positionError) <= pulsesToStop ||
-                          nextDirection != m_currentDirection || hitEndstop;
-
-        float accelChange = pulseDelayIncrement * m_lastFullPulseDurationMicros;
+                          nextDirection != m_currentDirection || hitEndstop ||
+                          approachingStop;
 
         if (shouldStop) {
-          m_currentPulseDelay += accelChange;
+          // start slowing down from the speed we're actually going at so the
+          // stopping distance above holds
+          m_currentPulseDelay =
+              effectivePulseDelay + getPulseDelayIncrement(effectivePulseDelay) *
+                                        m_lastFullPulseDurationMicros;
         } else {
-          m_currentPulseDelay -= accelChange;
+          m_currentPulseDelay -= getPulseDelayIncrement(m_currentPulseDelay) *
+                                 m_lastFullPulseDurationMicros;
         }
 
         // if pulse is sent we want to calculate how much to change the timing
@@ -272,6 +732,9 @@ void Leadscrew::update() {
         // depending on accel and current speed etc
         // inital pulse delay is upper timing limit
         //
+        if (m_currentPulseDelay < m_topSpeedPulseDelay) {
+          m_currentPulseDelay = m_topSpeedPulseDelay;
+        }
         if (m_currentPulseDelay > initialPulseDelay) {
           m_currentPulseDelay = initialPulseDelay;
         }
@@ -284,14 +747,20 @@ void Leadscrew::update() {
   }
 }
 
-int Leadscrew::getPositionError() {
+ELS_FASTRUN int Leadscrew::getPositionError() {
   return getExpectedPosition() - getCurrentPosition();
 }
 
-LeadscrewDirection Leadscrew::getCurrentDirection() {
+ELS_FASTRUN LeadscrewDirection Leadscrew::getCurrentDirection() {
   return m_currentDirection;
 }
 
+ELS_FASTRUN float Leadscrew::getCurrentPulseDelay() {
+  return m_currentPulseDelay;
+}
+
+ELS_FASTRUN bool Leadscrew::isAtStop() { return getDistanceToStop() <= 0; }
+
 float Leadscrew::getEstimatedVelocityInMillimetersPerSecond() {
   return (getEstimatedVelocityInPulsesPerSecond() * leadscrewPitch) /
          motorPulsePerRevolution;
@@ -325,6 +794,22 @@ void Leadscrew::printState() {
       Serial.println("UNKNOWN");
       break;
   }
+  Serial.print("Leadscrew backlash remaining: ");
+  Serial.println(getBacklashRemaining());
+  Serial.print("Leadscrew missed steps: ");
+  Serial.println(getMissedSteps());
+  Serial.print("Leadscrew corrected steps: ");
+  Serial.println(getCorrectedSteps());
+  Serial.print("Leadscrew stalled: ");
+  Serial.println(isStalled() ? "YES" : "NO");
+  Serial.print("Leadscrew waiting for thread start: ");
+  Serial.println(isWaitingForThreadStart() ? "YES" : "NO");
+  Serial.print("Leadscrew thread start: ");
+  Serial.print(getThreadStart() + 1);
+  Serial.print("/");
+  Serial.println(getThreadStarts());
+  Serial.print("Leadscrew thread start angle: ");
+  Serial.println(getThreadStartAngle());
   Serial.print("Leadscrew current pulse delay: ");
   Serial.println(m_currentPulseDelay);
   Serial.print("Leadscrew position error: ");
@@ -332,7 +817,7 @@ void Leadscrew::printState() {
   Serial.print("Leadscrew estimated velocity: ");
   Serial.println(getEstimatedVelocityInMillimetersPerSecond());
   Serial.print("Leadscrew pulses to stop: ");
-  Serial.println(calculate_pulses_to_stop(
-      m_currentPulseDelay, initialPulseDelay, pulseDelayIncrement));
+  Serial.println(calculate_pulses_to_stop(m_currentPulseDelay, initialPulseDelay,
+                                          pulseDelayIncrement, m_minPulseDelay));
   #endif
 }
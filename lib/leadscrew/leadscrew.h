@@ -1,5 +1,6 @@
+#include <accel_curve.h>
 #include <spindle.h>
-#include <els_elapsedMillis.h>
+#include <globalstate.h>
 
 #include "leadscrew_io.h"
 #pragma once
@@ -11,6 +12,7 @@ class Leadscrew : public LinearAxis, public DerivedAxis, public DrivenAxis {
  private:
   Spindle* m_spindle;
   LeadscrewIO* m_io;
+  GlobalState* m_globalState;
 
   float m_expectedPosition;
 
@@ -18,50 +20,227 @@ class Leadscrew : public LinearAxis, public DerivedAxis, public DrivenAxis {
   const int motorPulsePerRevolution;
   const float leadscrewPitch;
   float m_ratio;
+  // feed changes ramp the ratio to the target instead of jumping straight there
+  float m_targetRatio;
+  ElapsedMicros m_ratioRampMicros;
 
   // The current delay between pulses in microseconds
   const float initialPulseDelay;
   const float pulseDelayIncrement;
   float m_currentPulseDelay;
+  // the fastest the timer can pulse, one full pulse every two ticks
+  float m_minPulseDelay;
+  // the fastest the motor is allowed to go, 0 for as fast as the timer can
+  float m_topSpeedPulseDelay;
   LeadscrewDirection m_currentDirection;
 
   float m_accumulator;
 
+  // backlash compensation, the take up pulses move the motor but not the
+  // carriage so they don't count towards the current position
+  int m_backlashSteps;
+  float m_backlashPulseDelay;
+  int m_backlashRemaining;
+  // the direction the motor last actually moved in
+  LeadscrewDirection m_lastMovedDirection;
+
+  // closed loop correction, only used if the IO has feedback
+  // every pulse we've sent to the motor, except for correction pulses
+  int m_commandedMotorPosition;
+  int m_feedbackOffset;
+  bool m_feedbackSynced;
+  bool m_correcting;
+  bool m_stalled;
+  int m_feedbackTolerance;
+  int m_stallThreshold;
+  float m_correctionPulseDelay;
+  int m_correctedSteps;
+  // correction pulses sent since the current correction started
+  int m_correctionAttempts;
+  // missed steps being re-sent after recoverStall(), they don't count as
+  // falling behind again
+  int m_recoverySteps;
+
+  // thread starts are referenced to the spindle index when there is one, the
+  // leadscrew waits for the spindle to reach the angle of the current start
+  // after being enabled. The timer owns the start we're cutting, every finished
+  // pass moves it on
+  GlobalMotionMode m_lastMotionMode;
+  volatile int m_threadStarts;
+  volatile int m_threadStart;
+  bool m_waitingForThreadStart;
+  bool m_threadPassStarted;
+  int m_lastThreadAngle;
+
+  // optional speed dependent acceleration, replaces the pulse delay increment
+  AccelCurve* m_accelCurve;
+
   // we may want more sophisticated control over positions, but for now this is
   // fine
   LeadscrewStopState m_leftStopState;
   int m_leftStopPosition;
   LeadscrewStopState m_rightStopState;
   int m_rightStopPosition;
+  // the stops before rounding, a ratio ramp moves them a fraction of a
+  // position at a time
+  float m_leftStopExact;
+  float m_rightStopExact;
 
   /**
    * This gets the "unit" of the accumulator, i.e the amount the accumulator
    * increased by when the leadscrew position increases by 1
    */
   float getAccumulatorUnit();
+  // called when we start moving
+  void resetAccumulator();
+  // the pulse delay increment at the given speed
+  float getPulseDelayIncrement(float pulseDelay);
+  /**
+   * Moves the ratio towards the target as fast as the acceleration allows.
+   * The ramp is only for feeding, anything else finishes it straight away
+   */
+  void rampRatio(GlobalMotionMode motionMode);
+  /**
+   * Every position is worth a different distance at another ratio, this moves
+   * the stops so they stay the same amount of pulses away from the carriage
+   */
+  void keepStopsInPlace(float lastPulsesPerPosition);
   bool sendPulse();
+  /**
+   * The distance to the stop we're moving towards in position units, or
+   * INT32_MAX if there's no stop set in the direction of travel
+   */
+  int getDistanceToStop();
+  /**
+   * Compares the commanded motor position to the feedback and re-sends any
+   * missed steps. Returns true if this tick was used up by a correction or we
+   * have stalled, and no other pulses should be sent
+   */
+  bool handleFeedback();
+  /**
+   * Returns true while we're waiting for the spindle to reach the start angle
+   * of the thread, and moves on to the next start once a pass is finished
+   */
+  bool handleThreadStart(GlobalMotionMode motionMode);
+  void restoreDirPin();
   // int getStoppingDistanceInPulses();
 
  public:
+  /**
+   * The firmware runs everything off the global state and the system clock,
+   * anything else can hand in its own
+   */
   Leadscrew(Spindle* spindle, LeadscrewIO* io, float initialPulseDelay,
             float pulseDelayIncrement, int motorPulsePerRevolution,
-            float leadscrewPitch);
+            float leadscrewPitch,
+            GlobalState* globalState = GlobalState::getInstance(),
+            Clock* clock = SystemClock::getInstance());
+  void setClock(Clock* clock) override;
   int getCurrentPosition();
   void resetCurrentPosition();
 
   enum StopPosition { LEFT, RIGHT };
   void setStopPosition(StopPosition position, int stopPosition);
+  /**
+   * Every time the leadscrew reverses, `steps` extra pulses are sent at a
+   * fixed `pulseDelay` before the carriage starts moving again
+   * Set steps to 0 to disable compensation
+   */
+  void setBacklashCompensation(int steps, float pulseDelay);
+  /**
+   * Accelerate and work out stopping distances from a speed dependent curve
+   * instead of the constant pulse delay increment. The curve has to have the
+   * same initial pulse delay as the leadscrew
+   */
+  void setAccelCurve(AccelCurve* accelCurve);
+  AccelCurve* getAccelCurve();
+  /**
+   * The shortest pulse delay the motion timer can produce, the stopping
+   * distances are worked out from it. Defaults to two LEADSCREW_TIMER_US ticks
+   */
+  void setMinPulseDelay(float minPulseDelay);
+  /**
+   * The fastest the leadscrew may pulse once it has accelerated, e.g. a top
+   * speed found by calibration. 0, the default, leaves only the timer's limit
+   */
+  void setTopSpeedPulseDelay(float pulseDelay);
+  float getTopSpeedPulseDelay();
+  // the modes and feed come from the constructor's GlobalState until changed
+  void setGlobalState(GlobalState* globalState);
+  int getBacklashRemaining();
+
+  /**
+   * Missed steps larger than `tolerance` are re-sent every `pulseDelay`, and
+   * if more than `stallThreshold` steps are missed we stop and flag a stall
+   */
+  void setFeedbackCorrection(int tolerance, int stallThreshold,
+                             float pulseDelay);
+  // true if the IO has an encoder on the motor
+  bool hasFeedback();
+  // the amount of stepper pulses the motor is behind by, 0 without feedback
+  int getMissedSteps();
+  int getCorrectedSteps();
+  bool isStalled();
+  /**
+   * Accept wherever the motor ended up and start moving again
+   */
+  void clearStall();
+  /**
+   * Clears the stall but keeps the steps the motor missed, they're re-sent at
+   * the correction rate before the leadscrew moves on. Only for stalls the
+   * leadscrew caused itself by going too fast, not for an obstruction
+   */
+  void recoverStall();
   LeadscrewStopState getStopPositionState(StopPosition position);
   void unsetStopPosition(StopPosition position);
   int getStopPosition(StopPosition position);
   void setRatio(float ratio);
+  /**
+   * A new pitch from the operator. While feeding with motion enabled the
+   * positions are left alone and the ratio ramps to the new one, so the
+   * carriage changes speed within its acceleration instead of jumping to the
+   * rescaled position. The stops stay where they are on the machine. Anything
+   * else is the same as setRatio
+   */
+  void changeRatio(float ratio);
   float getRatio();
+  // where the ratio is ramping to, the same as getRatio once it gets there
+  float getTargetRatio();
   int getExpectedPosition();
+  // the motor pulses one position takes on average at the current ratio
+  float getPulsesPerPosition();
   void setCurrentPosition(int position);
   void incrementCurrentPosition(int amount);
+  /**
+   * Moves where the leadscrew should be independently of the spindle, the
+   * leadscrew follows with its usual acceleration. Used by the handwheel
+   */
+  void incrementExpectedPosition(int amount);
   void update();
   int getPositionError();
   LeadscrewDirection getCurrentDirection();
+  // the delay the next pulse is scheduled with, slower is bigger
+  float getCurrentPulseDelay();
+  // true when the next pulse in the current direction would pass a stop
+  bool isAtStop();
+  bool isWaitingForThreadStart();
+  /**
+   * Cuts a thread with `starts` starts from the first one, see
+   * GlobalState::setThreadStarts
+   */
+  void setThreadStarts(int starts);
+  int getThreadStarts();
+  // the start we're cutting, 0 based
+  int getThreadStart();
+  // moves on to the next start, wrapping back to the first
+  int nextThreadStart();
+  /**
+   * True when update() has nothing to do until the spindle moves, the
+   * position or motion mode changes
+   */
+  bool isIdle();
+  // the spindle angle after the index the current thread start begins at
+  int getThreadStartAngle();
   float getEstimatedVelocityInMillimetersPerSecond();
 
   void printState();
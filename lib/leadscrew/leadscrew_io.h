@@ -1,4 +1,5 @@
 #include <config.h>
+#include <placement.h>
 
 #pragma once
 
@@ -12,4 +13,12 @@ class LeadscrewIO {
   virtual uint8_t readStepPin() = 0;
   virtual void writeDirPin(uint8_t val) = 0;
   virtual uint8_t readDirPin() = 0;
+
+  /**
+   * Optional feedback from an encoder on the leadscrew motor
+   * The position is in stepper pulses, IO without an encoder doesn't need to
+   * override these
+   */
+  ELS_FASTRUN virtual bool hasFeedback() { return false; }
+  ELS_FASTRUN virtual int readFeedbackPosition() { return 0; }
 };
@@ -1,17 +1,44 @@
 
 #include <Wire.h>
+#include <config.h>
+#include <placement.h>
+#ifdef ELS_LEADSCREW_FEEDBACK_ENCODER_A
+#include <Encoder.h>
+#endif
 
 #include "leadscrew_io.h"
 #pragma once
 
 class LeadscrewIOImpl : public LeadscrewIO {
-  inline void writeStepPin(uint8_t val) {
+#ifdef ELS_LEADSCREW_FEEDBACK_ENCODER_A
+  Encoder m_feedbackEncoder;
+
+ public:
+  LeadscrewIOImpl()
+      : m_feedbackEncoder(ELS_LEADSCREW_FEEDBACK_ENCODER_A,
+                          ELS_LEADSCREW_FEEDBACK_ENCODER_B) {}
+
+  ELS_FASTRUN bool hasFeedback() { return true; }
+  ELS_FASTRUN int readFeedbackPosition() {
+    // scale the encoder counts to stepper pulses
+    return ((int64_t)m_feedbackEncoder.read() * ELS_LEADSCREW_STEPPER_PPR) /
+           ELS_LEADSCREW_FEEDBACK_PPR;
+  }
+
+ private:
+#endif
+
+  ELS_FASTRUN void writeStepPin(uint8_t val) {
     digitalWriteFast(ELS_LEADSCREW_STEP, val);
   }
-  inline uint8_t readStepPin() { return digitalReadFast(ELS_LEADSCREW_STEP); }
+  ELS_FASTRUN uint8_t readStepPin() {
+    return digitalReadFast(ELS_LEADSCREW_STEP);
+  }
 
-  inline void writeDirPin(uint8_t val) {
+  ELS_FASTRUN void writeDirPin(uint8_t val) {
     digitalWriteFast(ELS_LEADSCREW_DIR, val);
   }
-  inline u_int8_t readDirPin() { return digitalReadFast(ELS_LEADSCREW_DIR); }
+  ELS_FASTRUN u_int8_t readDirPin() {
+    return digitalReadFast(ELS_LEADSCREW_DIR);
+  }
 };
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "motion_mailbox.h"
+
+#include <placement.h>
+
+#ifndef PIO_UNIT_TESTING
+#include <Arduino.h>
+#endif
+
+MotionMailbox::MotionMailbox() : m_droppedCommands(0) {}
+
+bool MotionMailbox::post(const MotionCommand& command) {
+  if (!m_commands.push(command)) {
+    m_droppedCommands.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool MotionMailbox::postSetRatio(float ratio) {
+  return post({MotionCommandType::SET_RATIO, Leadscrew::StopPosition::LEFT, 0,
+               ratio, nullptr, 0});
+}
+
+bool MotionMailbox::postChangeRatio(float ratio) {
+  return post({MotionCommandType::CHANGE_RATIO, Leadscrew::StopPosition::LEFT,
+               0, ratio, nullptr, 0});
+}
+
+bool MotionMailbox::postSetStopPosition(Leadscrew::StopPosition stop,
+                                        int position) {
+  return post(
+      {MotionCommandType::SET_STOP_POSITION, stop, position, 0, nullptr, 0});
+}
+
+bool MotionMailbox::postUnsetStopPosition(Leadscrew::StopPosition stop) {
+  return post(
+      {MotionCommandType::UNSET_STOP_POSITION, stop, 0, 0, nullptr, 0});
+}
+
+bool MotionMailbox::postIncrementCurrentPosition(int amount) {
+  return post({MotionCommandType::INCREMENT_CURRENT_POSITION,
+               Leadscrew::StopPosition::LEFT, amount, 0, nullptr, 0});
+}
+
+bool MotionMailbox::postIncrementExpectedPosition(int amount) {
+  return post({MotionCommandType::INCREMENT_EXPECTED_POSITION,
+               Leadscrew::StopPosition::LEFT, amount, 0, nullptr, 0});
+}
+
+bool MotionMailbox::postClearStall() {
+  return post({MotionCommandType::CLEAR_STALL, Leadscrew::StopPosition::LEFT,
+               0, 0, nullptr, 0});
+}
+
+bool MotionMailbox::postRecoverStall() {
+  return post({MotionCommandType::RECOVER_STALL, Leadscrew::StopPosition::LEFT,
+               0, 0, nullptr, 0});
+}
+
+bool MotionMailbox::postSetMotionLimits(AccelCurve* accelCurve,
+                                        float topSpeedPulseDelay) {
+  return post({MotionCommandType::SET_MOTION_LIMITS,
+               Leadscrew::StopPosition::LEFT, 0, 0, accelCurve,
+               topSpeedPulseDelay});
+}
+
+bool MotionMailbox::postSetThreadStarts(int starts) {
+  return post({MotionCommandType::SET_THREAD_STARTS,
+               Leadscrew::StopPosition::LEFT, starts, 0, nullptr, 0});
+}
+
+bool MotionMailbox::postNextThreadStart() {
+  return post({MotionCommandType::NEXT_THREAD_START,
+               Leadscrew::StopPosition::LEFT, 0, 0, nullptr, 0});
+}
+
+ELS_FASTRUN int MotionMailbox::apply(Leadscrew* leadscrew) {
+  int applied = 0;
+  MotionCommand command;
+  while (m_commands.pop(&command)) {
+    switch (command.type) {
+      case MotionCommandType::SET_RATIO:
+        leadscrew->setRatio(command.ratio);
+        break;
+      case MotionCommandType::CHANGE_RATIO:
+        leadscrew->changeRatio(command.ratio);
+        break;
+      case MotionCommandType::SET_STOP_POSITION:
+        leadscrew->setStopPosition(command.stop, command.position);
+        break;
+      case MotionCommandType::UNSET_STOP_POSITION:
+        leadscrew->unsetStopPosition(command.stop);
+        break;
+      case MotionCommandType::INCREMENT_CURRENT_POSITION:
+        leadscrew->incrementCurrentPosition(command.position);
+        break;
+      case MotionCommandType::INCREMENT_EXPECTED_POSITION:
+        leadscrew->incrementExpectedPosition(command.position);
+        break;
+      case MotionCommandType::CLEAR_STALL:
+        leadscrew->clearStall();
+        break;
+      case MotionCommandType::RECOVER_STALL:
+        leadscrew->recoverStall();
+        break;
+      case MotionCommandType::SET_MOTION_LIMITS:
+        leadscrew->setAccelCurve(command.accelCurve);
+        leadscrew->setTopSpeedPulseDelay(command.pulseDelay);
+        break;
+      case MotionCommandType::SET_THREAD_STARTS:
+        leadscrew->setThreadStarts(command.position);
+        break;
+      case MotionCommandType::NEXT_THREAD_START:
+        leadscrew->nextThreadStart();
+        break;
+    }
+    applied++;
+  }
+  return applied;
+}
+
+ELS_FASTRUN bool MotionMailbox::isPending() { return !m_commands.isEmpty(); }
+
+uint32_t MotionMailbox::getDroppedCommands() {
+  return m_droppedCommands.load(std::memory_order_relaxed);
+}
+
+void MotionMailbox::printState() {
+#ifndef PIO_UNIT_TESTING
+  Serial.print("Dropped motion commands: ");
+  Serial.println(getDroppedCommands());
+#endif
+}
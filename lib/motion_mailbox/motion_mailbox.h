@@ -0,0 +1,90 @@
+#include <leadscrew.h>
+#include <spsc_queue.h>
+
+#include <atomic>
+#include <cstdint>
+
+#pragma once
+
+// must be a power of two, see SpscQueue
+#define MOTION_MAILBOX_SIZE 16
+
+enum MotionCommandType {
+  SET_RATIO,
+  CHANGE_RATIO,
+  SET_STOP_POSITION,
+  UNSET_STOP_POSITION,
+  INCREMENT_CURRENT_POSITION,
+  INCREMENT_EXPECTED_POSITION,
+  CLEAR_STALL,
+  RECOVER_STALL,
+  SET_MOTION_LIMITS,
+  SET_THREAD_STARTS,
+  NEXT_THREAD_START
+};
+
+struct MotionCommand {
+  MotionCommandType type;
+  Leadscrew::StopPosition stop;
+  // the position, amount or thread starts, depending on the type
+  int position;
+  float ratio;
+  // SET_MOTION_LIMITS only, the curve and top speed pulse delay to switch to
+  AccelCurve* accelCurve;
+  float pulseDelay;
+};
+
+/**
+ * Hands changes to the leadscrew from the main loop to the motion timer
+ *
+ * Setting the ratio or a stop rewrites several members the timer uses in the
+ * middle of Leadscrew::update(), so the loop never calls those directly. It
+ * posts a command instead and the timer applies everything that's waiting
+ * before its next update, every change lands between two ticks as a whole.
+ * Only the loop may post and only the timer may apply, see SpscQueue
+ *
+ * Commands are applied in the order they were posted. If the timer falls
+ * behind and the mailbox fills up, new commands are dropped and counted
+ */
+class MotionMailbox {
+ private:
+  SpscQueue<MotionCommand, MOTION_MAILBOX_SIZE> m_commands;
+  std::atomic<uint32_t> m_droppedCommands;
+
+  bool post(const MotionCommand& command);
+
+ public:
+  MotionMailbox();
+
+  // loop side, these return false if the command was dropped
+  bool postSetRatio(float ratio);
+  // see Leadscrew::changeRatio, a new pitch from the operator
+  bool postChangeRatio(float ratio);
+  bool postSetStopPosition(Leadscrew::StopPosition stop, int position);
+  bool postUnsetStopPosition(Leadscrew::StopPosition stop);
+  bool postIncrementCurrentPosition(int amount);
+  // see Leadscrew::incrementExpectedPosition, a move of `amount` positions
+  bool postIncrementExpectedPosition(int amount);
+  bool postClearStall();
+  bool postRecoverStall();
+  /**
+   * Switches the leadscrew to another acceleration curve and top speed. The
+   * curve must not be changed again until the timer has stopped using it
+   */
+  bool postSetMotionLimits(AccelCurve* accelCurve, float topSpeedPulseDelay);
+  // see Leadscrew::setThreadStarts, starts again from the first start
+  bool postSetThreadStarts(int starts);
+  // skips to the next start, the timer moves on by itself after every pass
+  bool postNextThreadStart();
+
+  /**
+   * Timer side, applies every waiting command to the leadscrew and returns how
+   * many there were
+   */
+  int apply(Leadscrew* leadscrew);
+  // true while there are commands the timer hasn't applied yet
+  bool isPending();
+
+  uint32_t getDroppedCommands();
+  void printState();
+};
@@ -0,0 +1,118 @@
+#include "Adafruit_GFX.h"
+
+#include "font5x7.h"
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h)
+    : WIDTH(w),
+      HEIGHT(h),
+      _width(w),
+      _height(h),
+      cursor_x(0),
+      cursor_y(0),
+      textcolor(0xFFFF),
+      textbgcolor(0xFFFF),
+      textsize_x(1),
+      textsize_y(1),
+      wrap(true) {}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                 uint16_t color) {
+  fillRect(x, y, 1, h, color);
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                 uint16_t color) {
+  fillRect(x, y, w, 1, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  for (int16_t i = x; i < x + w; i++) {
+    for (int16_t j = y; j < y + h; j++) {
+      drawPixel(i, j, color);
+    }
+  }
+}
+
+void Adafruit_GFX::fillScreen(uint16_t color) {
+  fillRect(0, 0, _width, _height, color);
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                 int16_t r, uint16_t color) {
+  int16_t maxRadius = (w < h ? w : h) / 2;
+  if (r > maxRadius) {
+    r = maxRadius;
+  }
+
+  // each row is cut back at the corners by how far the quarter circle is
+  // from the edge at that height
+  for (int16_t row = 0; row < h; row++) {
+    int16_t inset = 0;
+    int16_t fromEdge = row < r ? r - row : row - (h - 1 - r);
+    if (fromEdge > 0) {
+      while (inset < r && (r - inset) * (r - inset) + fromEdge * fromEdge >
+                              r * r + r) {
+        inset++;
+      }
+    }
+    drawFastHLine(x + inset, y + row, w - 2 * inset, color);
+  }
+}
+
+void Adafruit_GFX::drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
+                              int16_t w, int16_t h, uint16_t color) {
+  int16_t byteWidth = (w + 7) / 8;
+  for (int16_t j = 0; j < h; j++) {
+    for (int16_t i = 0; i < w; i++) {
+      if (bitmap[j * byteWidth + i / 8] & (0x80 >> (i & 7))) {
+        drawPixel(x + i, y + j, color);
+      }
+    }
+  }
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
+                            uint16_t color, uint16_t bg, uint8_t size) {
+  // anything the font doesn't have is drawn as a blank
+  bool inFont = c >= FONT5X7_FIRST && c <= FONT5X7_LAST;
+
+  // 5 columns of glyph, 8 rows with the descender row, and a gap column
+  for (int8_t i = 0; i < 6; i++) {
+    uint8_t line = inFont && i < 5 ? font5x7[c - FONT5X7_FIRST][i] : 0;
+    for (int8_t j = 0; j < 8; j++, line >>= 1) {
+      if (line & 1) {
+        fillRect(x + i * size, y + j * size, size, size, color);
+      } else if (bg != color) {
+        fillRect(x + i * size, y + j * size, size, size, bg);
+      }
+    }
+  }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c == '\n') {
+    cursor_x = 0;
+    cursor_y += textsize_y * 8;
+    return 1;
+  }
+  if (c == '\r') {
+    return 1;
+  }
+
+  if (wrap && cursor_x + textsize_x * 6 > _width) {
+    cursor_x = 0;
+    cursor_y += textsize_y * 8;
+  }
+  drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x);
+  cursor_x += textsize_x * 6;
+  return 1;
+}
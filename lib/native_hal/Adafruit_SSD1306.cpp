@@ -0,0 +1,68 @@
+#include "Adafruit_SSD1306.h"
+
+#include <cstdlib>
+#include <cstring>
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi,
+                                   int8_t rst_pin, uint32_t clkDuring,
+                                   uint32_t clkAfter)
+    : Adafruit_GFX(w, h), buffer(nullptr), wire(twi), i2caddr(0) {}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() {
+  if (buffer != nullptr) {
+    free(buffer);
+    buffer = nullptr;
+  }
+}
+
+bool Adafruit_SSD1306::begin(uint8_t switchvcc, uint8_t addr, bool reset,
+                             bool periphBegin) {
+  if (buffer == nullptr &&
+      (buffer = (uint8_t*)malloc(WIDTH * ((HEIGHT + 7) / 8))) == nullptr) {
+    return false;
+  }
+  clearDisplay();
+
+  // the real driver picks the address from the height when it isn't given
+  i2caddr = addr != 0 ? addr : (HEIGHT == 32 ? 0x3C : 0x3D);
+  if (periphBegin) {
+    wire->begin();
+  }
+  wire->beginTransmission(i2caddr);
+  return wire->endTransmission() == 0;
+}
+
+void Adafruit_SSD1306::display() {
+  NativeHal::getInstance()->showFrame(buffer, WIDTH, HEIGHT);
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+  memset(buffer, 0, WIDTH * ((HEIGHT + 7) / 8));
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) {
+    return;
+  }
+
+  uint8_t* page = &buffer[x + (y / 8) * WIDTH];
+  uint8_t bit = 1 << (y & 7);
+  switch (color) {
+    case SSD1306_WHITE:
+      *page |= bit;
+      break;
+    case SSD1306_BLACK:
+      *page &= ~bit;
+      break;
+    case SSD1306_INVERSE:
+      *page ^= bit;
+      break;
+  }
+}
+
+bool Adafruit_SSD1306::getPixel(int16_t x, int16_t y) {
+  if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) {
+    return false;
+  }
+  return buffer[x + (y / 8) * WIDTH] & (1 << (y & 7));
+}
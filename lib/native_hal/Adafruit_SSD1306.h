@@ -0,0 +1,48 @@
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#include <cstdint>
+
+#pragma once
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define BLACK SSD1306_BLACK
+#define WHITE SSD1306_WHITE
+#define INVERSE SSD1306_INVERSE
+
+#define SSD1306_EXTERNALVCC 0x01
+#define SSD1306_SWITCHCAPVCC 0x02
+
+/**
+ * The Adafruit SSD1306 driver on the native HAL. The framebuffer has the
+ * controller's layout, 8 pixel tall pages with the top pixel in bit 0, and
+ * display() hands it to the HAL as the panel contents
+ */
+class Adafruit_SSD1306 : public Adafruit_GFX {
+ protected:
+  uint8_t* buffer;
+  TwoWire* wire;
+  uint8_t i2caddr;
+
+ public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* twi = &Wire,
+                   int8_t rst_pin = -1, uint32_t clkDuring = 400000UL,
+                   uint32_t clkAfter = 100000UL);
+  ~Adafruit_SSD1306();
+
+  /**
+   * Allocates the framebuffer unless there is one already. Unlike the real
+   * driver this fails when nothing answers at the address, so the firmware
+   * can be run without a display
+   */
+  bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0,
+             bool reset = true, bool periphBegin = true);
+  void display();
+  void clearDisplay();
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  bool getPixel(int16_t x, int16_t y);
+  uint8_t* getBuffer() { return buffer; }
+};
@@ -0,0 +1,91 @@
+#include <IntervalTimer.h>
+#include <native_hal.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef PIO_UNIT_TESTING
+// tests mock micros() and millis(), the HAL keeps the mocks on its clock
+#include <els_elapsedMillis.h>
+#endif
+
+#pragma once
+
+/**
+ * The parts of the Teensy core the firmware uses, on top of the native HAL
+ */
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+
+#define RISING 2
+#define FALLING 3
+#define CHANGE 4
+
+// there's only one kind of memory here
+#define FASTRUN
+#define FLASHMEM
+#define DMAMEM
+#define EXTMEM
+#define PROGMEM
+#define F(string) (string)
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+extern NativeSerial Serial;
+
+#ifndef PIO_UNIT_TESTING
+inline unsigned long micros() {
+  return (unsigned long)NativeHal::getInstance()->nowMicros();
+}
+inline unsigned long millis() {
+  return (unsigned long)(NativeHal::getInstance()->nowMicros() / 1000);
+}
+#endif
+
+inline void delay(uint32_t ms) {
+  NativeHal::getInstance()->advance((uint64_t)ms * 1000);
+}
+inline void delayMicroseconds(uint32_t us) {
+  NativeHal::getInstance()->advance(us);
+}
+inline void yield() {}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+  NativeHal::getInstance()->pinMode(pin, mode);
+}
+inline void digitalWrite(uint8_t pin, uint8_t val) {
+  NativeHal::getInstance()->digitalWrite(pin, val);
+}
+inline uint8_t digitalRead(uint8_t pin) {
+  return NativeHal::getInstance()->digitalRead(pin);
+}
+inline void digitalWriteFast(uint8_t pin, uint8_t val) {
+  digitalWrite(pin, val);
+}
+inline uint8_t digitalReadFast(uint8_t pin) { return digitalRead(pin); }
+
+// every pin can interrupt on the Teensy 4.x
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(uint8_t pin, void (*callback)(), int mode) {
+  NativeHal::getInstance()->attachInterrupt(pin, callback, mode);
+}
+inline void detachInterrupt(uint8_t pin) {
+  NativeHal::getInstance()->detachInterrupt(pin);
+}
+
+// interrupts only happen while the clock moves, there's nothing to mask
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+inline void noInterrupts() {}
+inline void interrupts() {}
@@ -0,0 +1,35 @@
+#include <cstdint>
+#include <cstring>
+
+#pragma once
+
+// the emulated EEPROM on a Teensy 4.1
+#define NATIVE_HAL_EEPROM_SIZE 4284
+
+/**
+ * The EEPROM library, kept in memory so it starts out erased every run
+ */
+class EEPROMClass {
+ private:
+  uint8_t m_bytes[NATIVE_HAL_EEPROM_SIZE];
+
+ public:
+  EEPROMClass() { memset(m_bytes, 0xFF, sizeof(m_bytes)); }
+
+  uint8_t read(int address) { return m_bytes[address]; }
+  void write(int address, uint8_t value) { m_bytes[address] = value; }
+  uint16_t length() { return NATIVE_HAL_EEPROM_SIZE; }
+
+  template <typename T>
+  T& get(int address, T& value) {
+    memcpy(&value, m_bytes + address, sizeof(T));
+    return value;
+  }
+  template <typename T>
+  const T& put(int address, const T& value) {
+    memcpy(m_bytes + address, &value, sizeof(T));
+    return value;
+  }
+};
+
+inline EEPROMClass EEPROM;
@@ -0,0 +1,22 @@
+#include <native_hal.h>
+
+#include <cstdint>
+
+#pragma once
+
+/**
+ * The quadrature Encoder library, the count is whatever the HAL says the
+ * encoder on these pins has turned to
+ */
+class Encoder {
+ private:
+  uint8_t m_pinA;
+
+ public:
+  Encoder(uint8_t pinA, uint8_t pinB) : m_pinA(pinA) {}
+
+  int32_t read() { return NativeHal::getInstance()->readEncoder(m_pinA); }
+  void write(int32_t count) {
+    NativeHal::getInstance()->writeEncoder(m_pinA, count);
+  }
+};
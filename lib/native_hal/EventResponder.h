@@ -0,0 +1,24 @@
+#pragma once
+
+class EventResponder;
+typedef EventResponder& EventResponderRef;
+typedef void (*EventResponderFunction)(EventResponderRef);
+
+/**
+ * The Teensy core's EventResponder on the native HAL, only immediate
+ * responders are supported and they run as soon as the event is triggered
+ */
+class EventResponder {
+ private:
+  EventResponderFunction m_function = nullptr;
+
+ public:
+  void attachImmediate(EventResponderFunction function) {
+    m_function = function;
+  }
+  void triggerEvent() {
+    if (m_function != nullptr) {
+      m_function(*this);
+    }
+  }
+};
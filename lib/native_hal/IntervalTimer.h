@@ -0,0 +1,50 @@
+#include <native_hal.h>
+
+#include <cstdint>
+
+#pragma once
+
+/**
+ * A periodic timer on the HAL's virtual clock. Like the PIT on the Teensy a
+ * new interval from update() starts once the running one is over
+ */
+class IntervalTimer {
+ private:
+  void (*m_callback)();
+  uint32_t m_periodUs;
+  uint64_t m_nextMicros;
+
+ public:
+  IntervalTimer() : m_callback(nullptr), m_periodUs(0), m_nextMicros(0) {}
+  ~IntervalTimer() { end(); }
+
+  bool begin(void (*callback)(), uint32_t microseconds) {
+    if (callback == nullptr || microseconds == 0) {
+      return false;
+    }
+    m_callback = callback;
+    m_periodUs = microseconds;
+    m_nextMicros = NativeHal::getInstance()->nowMicros() + microseconds;
+    NativeHal::getInstance()->addTimer(this);
+    return true;
+  }
+  void update(uint32_t microseconds) {
+    if (microseconds != 0) {
+      m_periodUs = microseconds;
+    }
+  }
+  void end() {
+    if (m_callback != nullptr) {
+      NativeHal::getInstance()->removeTimer(this);
+      m_callback = nullptr;
+    }
+  }
+  void priority(uint8_t priority) {}
+
+  uint64_t getNextMicros() { return m_nextMicros; }
+  // called by the HAL when the clock reaches the next tick
+  void fire() {
+    m_nextMicros += m_periodUs;
+    m_callback();
+  }
+};
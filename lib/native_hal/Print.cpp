@@ -0,0 +1,78 @@
+#include "Print.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::write(const char* str) {
+  return write((const uint8_t*)str, strlen(str));
+}
+
+size_t Print::print(const char* str) { return write(str); }
+
+size_t Print::print(char c) { return write((uint8_t)c); }
+
+size_t Print::print(int n, int base) { return print((long long)n, base); }
+
+size_t Print::print(unsigned int n, int base) {
+  return print((unsigned long long)n, base);
+}
+
+size_t Print::print(long n, int base) { return print((long long)n, base); }
+
+size_t Print::print(unsigned long n, int base) {
+  return print((unsigned long long)n, base);
+}
+
+size_t Print::print(long long n, int base) {
+  // only decimal gets a sign, like the Teensy core
+  if (n < 0 && base == DEC) {
+    return printNumber(-(unsigned long long)n, base, true);
+  }
+  return printNumber((unsigned long long)n, base, false);
+}
+
+size_t Print::print(unsigned long long n, int base) {
+  return printNumber(n, base, false);
+}
+
+size_t Print::print(double n, int digits) {
+  if (std::isnan(n)) {
+    return print("nan");
+  }
+  if (std::isinf(n)) {
+    return print("inf");
+  }
+  char text[64];
+  int length = snprintf(text, sizeof(text), "%.*f", digits, n);
+  return write((const uint8_t*)text, length);
+}
+
+size_t Print::println() { return write((const uint8_t*)"\r\n", 2); }
+
+size_t Print::printNumber(unsigned long long n, uint8_t base, bool negative) {
+  if (base < 2) {
+    base = DEC;
+  }
+
+  // enough for 64 bits in binary and the sign
+  char text[66];
+  char* digit = text + sizeof(text);
+  do {
+    uint8_t remainder = n % base;
+    n /= base;
+    *--digit = remainder < 10 ? '0' + remainder : 'A' + remainder - 10;
+  } while (n != 0);
+  if (negative) {
+    *--digit = '-';
+  }
+  return write((const uint8_t*)digit, text + sizeof(text) - digit);
+}
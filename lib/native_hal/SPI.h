@@ -0,0 +1,51 @@
+#include <Arduino.h>
+#include <EventResponder.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#pragma once
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPISettings {
+ public:
+  uint32_t clock;
+  uint8_t bitOrder;
+  uint8_t dataMode;
+
+  SPISettings() : clock(4000000), bitOrder(MSBFIRST), dataMode(SPI_MODE0) {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+      : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+};
+
+/**
+ * SPI on the native HAL, nothing is attached so every transfer reads back 0.
+ * DMA transfers are over as soon as they start, the event fires straight away
+ */
+class SPIClass {
+ public:
+  void begin() {}
+  void end() {}
+  void beginTransaction(SPISettings settings) {}
+  void endTransaction() {}
+  uint8_t transfer(uint8_t data) { return 0; }
+  uint16_t transfer16(uint16_t data) { return 0; }
+  void transfer(void* buffer, size_t count) { memset(buffer, 0, count); }
+  bool transfer(const void* txBuffer, void* rxBuffer, size_t count,
+                EventResponderRef event) {
+    if (rxBuffer != nullptr) {
+      memset(rxBuffer, 0, count);
+    }
+    event.triggerEvent();
+    return true;
+  }
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,36 @@
+#include <Arduino.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#pragma once
+
+/**
+ * I2C on the native HAL, a transmission is acknowledged when the HAL has a
+ * device at that address and the bytes themselves go nowhere
+ */
+class TwoWire {
+ private:
+  uint8_t m_address;
+
+ public:
+  TwoWire() : m_address(0) {}
+
+  void begin() {}
+  void end() {}
+  void setClock(uint32_t frequency) {}
+
+  void beginTransmission(uint8_t address) { m_address = address; }
+  size_t write(uint8_t data) { return 1; }
+  size_t write(const uint8_t* data, size_t size) { return size; }
+  // 0 is success, 2 is a NACK on the address like the Teensy core
+  uint8_t endTransmission(bool sendStop = true) {
+    return NativeHal::getInstance()->isI2cDevicePresent(m_address) ? 0 : 2;
+  }
+
+  uint8_t requestFrom(uint8_t address, uint8_t quantity) { return 0; }
+  int available() { return 0; }
+  int read() { return -1; }
+};
+
+extern TwoWire Wire;
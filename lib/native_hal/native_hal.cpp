@@ -0,0 +1,300 @@
+#include "native_hal.h"
+
+#include <Arduino.h>
+#include <IntervalTimer.h>
+#include <SPI.h>
+#include <Wire.h>
+
+#include <cmath>
+#include <cstdio>
+
+NativeSerial Serial;
+TwoWire Wire;
+SPIClass SPI;
+
+NativeHal::NativeHal() { reset(); }
+
+NativeHal* NativeHal::getInstance() {
+  static NativeHal instance;
+  return &instance;
+}
+
+void NativeHal::reset() {
+  m_loopMicros = NATIVE_HAL_DEFAULT_LOOP_US;
+  setNow(0);
+
+  for (Pin& pin : m_pins) {
+    pin = {INPUT, LOW, 0, nullptr, 0};
+  }
+  m_encoders.clear();
+  for (IntervalTimer*& timer : m_timers) {
+    timer = nullptr;
+  }
+  m_events.clear();
+
+  m_serial.clear();
+  m_echoSerial = false;
+
+  // every I2C address answers until told otherwise
+  m_i2cPresent.assign(128, true);
+  m_panel.clear();
+  m_panelWidth = 0;
+  m_panelHeight = 0;
+  m_frames = 0;
+}
+
+void NativeHal::setNow(uint64_t micros) {
+  m_nowMicros = micros;
+#ifdef PIO_UNIT_TESTING
+  MicrosSingleton::getInstance().setMicros(micros);
+  MillisSingleton::getInstance().setMillis(micros / 1000);
+#endif
+}
+
+uint64_t NativeHal::nowMicros() { return m_nowMicros; }
+
+void NativeHal::advance(uint64_t micros) {
+  uint64_t end = m_nowMicros + micros;
+
+  while (true) {
+    // whatever is due first runs first, timers win a tie with the script
+    IntervalTimer* nextTimer = nullptr;
+    uint64_t next = end;
+    for (IntervalTimer* timer : m_timers) {
+      if (timer != nullptr && timer->getNextMicros() <= next) {
+        if (nextTimer == nullptr ||
+            timer->getNextMicros() < nextTimer->getNextMicros()) {
+          nextTimer = timer;
+          next = timer->getNextMicros();
+        }
+      }
+    }
+    bool eventDue = !m_events.empty() && m_events.begin()->first <= next &&
+                    (nextTimer == nullptr || m_events.begin()->first < next);
+    if (nextTimer == nullptr && !eventDue) {
+      break;
+    }
+
+    if (eventDue) {
+      auto event = m_events.begin();
+      std::function<void()> callback = event->second;
+      // anything scheduled in the past runs straight away
+      setNow(event->first > m_nowMicros ? event->first : m_nowMicros);
+      m_events.erase(event);
+      callback();
+    } else {
+      setNow(next);
+      nextTimer->fire();
+    }
+  }
+
+  setNow(end);
+}
+
+void NativeHal::runFor(uint64_t micros, void (*loop)()) {
+  uint64_t end = m_nowMicros + micros;
+  while (m_nowMicros < end) {
+    loop();
+    advance(m_loopMicros);
+  }
+}
+
+void NativeHal::setLoopMicros(uint32_t micros) { m_loopMicros = micros; }
+
+void NativeHal::schedule(uint64_t atMicros, std::function<void()> callback) {
+  m_events.emplace(atMicros, callback);
+}
+
+void NativeHal::addTimer(IntervalTimer* timer) {
+  for (IntervalTimer*& slot : m_timers) {
+    if (slot == timer) {
+      return;
+    }
+  }
+  for (IntervalTimer*& slot : m_timers) {
+    if (slot == nullptr) {
+      slot = timer;
+      return;
+    }
+  }
+}
+
+void NativeHal::removeTimer(IntervalTimer* timer) {
+  for (IntervalTimer*& slot : m_timers) {
+    if (slot == timer) {
+      slot = nullptr;
+    }
+  }
+}
+
+void NativeHal::pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= NATIVE_HAL_PINS) {
+    return;
+  }
+  m_pins[pin].mode = mode;
+  if (mode == INPUT_PULLUP) {
+    setLevel(pin, HIGH);
+  } else if (mode == INPUT_PULLDOWN) {
+    setLevel(pin, LOW);
+  }
+}
+
+void NativeHal::setLevel(uint8_t pin, uint8_t level) {
+  Pin& state = m_pins[pin];
+  level = level ? HIGH : LOW;
+  if (level == state.level) {
+    return;
+  }
+  state.level = level;
+
+  if (level == HIGH) {
+    state.risingEdges++;
+  }
+  if (state.interrupt != nullptr &&
+      (state.interruptMode == CHANGE ||
+       (state.interruptMode == RISING && level == HIGH) ||
+       (state.interruptMode == FALLING && level == LOW))) {
+    state.interrupt();
+  }
+}
+
+void NativeHal::digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin < NATIVE_HAL_PINS) {
+    setLevel(pin, level);
+  }
+}
+
+uint8_t NativeHal::digitalRead(uint8_t pin) {
+  return pin < NATIVE_HAL_PINS ? m_pins[pin].level : LOW;
+}
+
+void NativeHal::attachInterrupt(uint8_t pin, void (*callback)(), int mode) {
+  if (pin < NATIVE_HAL_PINS) {
+    m_pins[pin].interrupt = callback;
+    m_pins[pin].interruptMode = mode;
+  }
+}
+
+void NativeHal::detachInterrupt(uint8_t pin) {
+  if (pin < NATIVE_HAL_PINS) {
+    m_pins[pin].interrupt = nullptr;
+  }
+}
+
+void NativeHal::setPin(uint8_t pin, uint8_t level) { digitalWrite(pin, level); }
+
+void NativeHal::schedulePin(uint64_t atMicros, uint8_t pin, uint8_t level) {
+  schedule(atMicros, [this, pin, level]() { setPin(pin, level); });
+}
+
+uint32_t NativeHal::getRisingEdges(uint8_t pin) {
+  return pin < NATIVE_HAL_PINS ? m_pins[pin].risingEdges : 0;
+}
+
+int32_t NativeHal::readEncoder(uint8_t pinA) {
+  auto found = m_encoders.find(pinA);
+  if (found == m_encoders.end()) {
+    return 0;
+  }
+  const EncoderState& encoder = found->second;
+  double turned =
+      encoder.countsPerSecond * (m_nowMicros - encoder.since) / 1000000.0;
+  return encoder.count + (int32_t)std::floor(turned);
+}
+
+void NativeHal::writeEncoder(uint8_t pinA, int32_t count) {
+  EncoderState& encoder = m_encoders[pinA];
+  encoder.count = count;
+  encoder.since = m_nowMicros;
+}
+
+void NativeHal::setEncoderRate(uint8_t pinA, double countsPerSecond) {
+  // fold what it has turned so far into the count before changing speed
+  int32_t count = readEncoder(pinA);
+  EncoderState& encoder = m_encoders[pinA];
+  encoder.count = count;
+  encoder.since = m_nowMicros;
+  encoder.countsPerSecond = countsPerSecond;
+}
+
+void NativeHal::writeSerial(const uint8_t* data, size_t size) {
+  m_serial.append((const char*)data, size);
+  if (m_echoSerial) {
+    fwrite(data, 1, size, stdout);
+  }
+}
+
+std::string NativeHal::takeSerial() {
+  std::string serial;
+  serial.swap(m_serial);
+  return serial;
+}
+
+void NativeHal::setEchoSerial(bool echo) { m_echoSerial = echo; }
+
+bool NativeHal::isI2cDevicePresent(uint8_t address) {
+  return address < m_i2cPresent.size() && m_i2cPresent[address];
+}
+
+void NativeHal::setI2cDevicePresent(uint8_t address, bool present) {
+  if (address < m_i2cPresent.size()) {
+    m_i2cPresent[address] = present;
+  }
+}
+
+void NativeHal::showFrame(const uint8_t* framebuffer, int16_t width,
+                          int16_t height) {
+  m_panelWidth = width;
+  m_panelHeight = height;
+  m_panel.assign(framebuffer, framebuffer + width * ((height + 7) / 8));
+  m_frames++;
+}
+
+uint32_t NativeHal::getFrames() { return m_frames; }
+
+bool NativeHal::getPanelPixel(int16_t x, int16_t y) {
+  if (x < 0 || x >= m_panelWidth || y < 0 || y >= m_panelHeight) {
+    return false;
+  }
+  return m_panel[x + (y / 8) * m_panelWidth] & (1 << (y & 7));
+}
+
+std::string NativeHal::getPanelPbm() {
+  std::string pbm = "P4\n" + std::to_string(m_panelWidth) + " " +
+                    std::to_string(m_panelHeight) + "\n";
+
+  // rows are packed most significant bit first and a set bit is black
+  for (int16_t y = 0; y < m_panelHeight; y++) {
+    for (int16_t x = 0; x < m_panelWidth; x += 8) {
+      uint8_t packed = 0;
+      for (int16_t bit = 0; bit < 8; bit++) {
+        bool lit = x + bit < m_panelWidth && getPanelPixel(x + bit, y);
+        if (!lit) {
+          packed |= 0x80 >> bit;
+        }
+      }
+      pbm.push_back((char)packed);
+    }
+  }
+  return pbm;
+}
+
+bool NativeHal::writePanelPbm(const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  std::string pbm = getPanelPbm();
+  bool written = fwrite(pbm.data(), 1, pbm.size(), file) == pbm.size();
+  return fclose(file) == 0 && written;
+}
+
+size_t NativeSerial::write(uint8_t c) {
+  NativeHal::getInstance()->writeSerial(&c, 1);
+  return 1;
+}
+
+size_t NativeSerial::write(const uint8_t* buffer, size_t size) {
+  NativeHal::getInstance()->writeSerial(buffer, size);
+  return size;
+}
@@ -0,0 +1,135 @@
+#include <Print.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#pragma once
+
+#define NATIVE_HAL_PINS 64
+#define NATIVE_HAL_MAX_TIMERS 4
+// how long a pass through loop() takes on the virtual clock
+#define NATIVE_HAL_DEFAULT_LOOP_US 10
+
+class IntervalTimer;
+
+/**
+ * Stands in for the Teensy on native builds, so the whole firmware, setup()
+ * and loop() included, can run as a Linux program and in system tests
+ *
+ * Time is virtual and only moves when loop() has run or something waits in
+ * delay(). Interval timers fire exactly on their period in between, which
+ * keeps every run deterministic and lets seconds of machining run in
+ * milliseconds. Input pins and encoders are driven from the outside, either
+ * directly or scheduled for a point in time, rising edges on every pin are
+ * counted, everything written to Serial is captured and the last frame sent to
+ * the display can be saved as a PBM image
+ */
+class NativeHal {
+ private:
+  struct Pin {
+    uint8_t mode;
+    uint8_t level;
+    uint32_t risingEdges;
+    void (*interrupt)();
+    int interruptMode;
+  };
+
+  // an encoder turns at a constant rate from `since`, keyed on its A pin
+  struct EncoderState {
+    int32_t count;
+    double countsPerSecond;
+    uint64_t since;
+  };
+
+  uint64_t m_nowMicros;
+  uint32_t m_loopMicros;
+
+  Pin m_pins[NATIVE_HAL_PINS];
+  std::map<uint8_t, EncoderState> m_encoders;
+  IntervalTimer* m_timers[NATIVE_HAL_MAX_TIMERS];
+  std::multimap<uint64_t, std::function<void()>> m_events;
+
+  std::string m_serial;
+  bool m_echoSerial;
+
+  std::vector<bool> m_i2cPresent;
+  std::vector<uint8_t> m_panel;
+  int16_t m_panelWidth;
+  int16_t m_panelHeight;
+  uint32_t m_frames;
+
+  NativeHal();
+  void setNow(uint64_t micros);
+  void setLevel(uint8_t pin, uint8_t level);
+
+ public:
+  static NativeHal* getInstance();
+
+  // back to power on, the timers are stopped and every pin is low until
+  // something drives it or pulls it up
+  void reset();
+
+  uint64_t nowMicros();
+  /**
+   * Moves the virtual clock forward, firing timers and scheduled events in
+   * time order on the way as if they had interrupted whatever was waiting
+   */
+  void advance(uint64_t micros);
+  // calls loop() over and over, each pass costs the loop time
+  void runFor(uint64_t micros, void (*loop)());
+  void setLoopMicros(uint32_t micros);
+  // runs the callback once the clock reaches the given time
+  void schedule(uint64_t atMicros, std::function<void()> callback);
+
+  void addTimer(IntervalTimer* timer);
+  void removeTimer(IntervalTimer* timer);
+
+  void pinMode(uint8_t pin, uint8_t mode);
+  void digitalWrite(uint8_t pin, uint8_t level);
+  uint8_t digitalRead(uint8_t pin);
+  void attachInterrupt(uint8_t pin, void (*callback)(), int mode);
+  void detachInterrupt(uint8_t pin);
+  // drives a pin from the outside world, buttons are pulled up so low is
+  // pressed
+  void setPin(uint8_t pin, uint8_t level);
+  void schedulePin(uint64_t atMicros, uint8_t pin, uint8_t level);
+  uint32_t getRisingEdges(uint8_t pin);
+
+  int32_t readEncoder(uint8_t pinA);
+  void writeEncoder(uint8_t pinA, int32_t count);
+  // turns the encoder at a constant rate from now on, 0 stops it
+  void setEncoderRate(uint8_t pinA, double countsPerSecond);
+
+  void writeSerial(const uint8_t* data, size_t size);
+  // returns everything printed since the last call
+  std::string takeSerial();
+  // also print the serial output to stdout as it's written
+  void setEchoSerial(bool echo);
+
+  bool isI2cDevicePresent(uint8_t address);
+  void setI2cDevicePresent(uint8_t address, bool present);
+
+  // what the panel shows, the framebuffer is copied on every display()
+  void showFrame(const uint8_t* framebuffer, int16_t width, int16_t height);
+  uint32_t getFrames();
+  bool getPanelPixel(int16_t x, int16_t y);
+  // the panel as a binary PBM, lit pixels are white like on the OLED
+  std::string getPanelPbm();
+  bool writePanelPbm(const char* path);
+};
+
+/**
+ * Serial over USB, captured by the HAL instead of going anywhere
+ */
+class NativeSerial : public Print {
+ public:
+  void begin(uint32_t baud) {}
+  operator bool() { return true; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+};
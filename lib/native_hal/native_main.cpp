@@ -0,0 +1,122 @@
+// the firmware as a Linux program, tests bring their own main()
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include <native_hal.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void setup();
+void loop();
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [-t seconds] [-s script] [-p frame.pbm] [-q]\n"
+          "  -t  how long to run on the virtual clock, default 10\n"
+          "  -s  script of pin and encoder changes, see below\n"
+          "  -p  write the last display frame to a PBM file at the end\n"
+          "  -q  don't print the serial output\n"
+          "\n"
+          "Every script line is a time in milliseconds and a command:\n"
+          "  <ms> pin <pin> <0|1>          drive an input pin\n"
+          "  <ms> encoder <pinA> <counts/s> turn an encoder at a constant rate\n"
+          "  <ms> pbm <path>               save the display as it is then\n"
+          "Lines starting with # are comments\n",
+          name);
+}
+
+// schedules every line of the script, returns false on the first bad line
+static bool loadScript(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    perror(path);
+    return false;
+  }
+
+  NativeHal* hal = NativeHal::getInstance();
+  char line[256];
+  int lineNumber = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file) != nullptr) {
+    lineNumber++;
+    double ms;
+    char command[16];
+    char argument[200];
+    double value;
+    if (line[0] == '#' || sscanf(line, "%lf %15s", &ms, command) < 2) {
+      continue;
+    }
+    uint64_t at = (uint64_t)(ms * 1000);
+
+    if (strcmp(command, "pin") == 0 &&
+        sscanf(line, "%*f %*s %199s %lf", argument, &value) == 2) {
+      hal->schedulePin(at, atoi(argument), value != 0);
+    } else if (strcmp(command, "encoder") == 0 &&
+               sscanf(line, "%*f %*s %199s %lf", argument, &value) == 2) {
+      uint8_t pinA = atoi(argument);
+      hal->schedule(at, [hal, pinA, value]() {
+        hal->setEncoderRate(pinA, value);
+      });
+    } else if (strcmp(command, "pbm") == 0 &&
+               sscanf(line, "%*f %*s %199s", argument) == 1) {
+      std::string pbmPath = argument;
+      hal->schedule(at, [hal, pbmPath]() {
+        hal->writePanelPbm(pbmPath.c_str());
+      });
+    } else {
+      fprintf(stderr, "%s:%d: can't parse: %s", path, lineNumber, line);
+      ok = false;
+    }
+  }
+  fclose(file);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  double seconds = 10;
+  const char* pbmPath = nullptr;
+  bool quiet = false;
+  NativeHal* hal = NativeHal::getInstance();
+
+  int option;
+  while ((option = getopt(argc, argv, "t:s:p:qh")) != -1) {
+    switch (option) {
+      case 't':
+        seconds = atof(optarg);
+        break;
+      case 's':
+        if (!loadScript(optarg)) {
+          return 1;
+        }
+        break;
+      case 'p':
+        pbmPath = optarg;
+        break;
+      case 'q':
+        quiet = true;
+        break;
+      default:
+        usage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+
+  hal->setEchoSerial(!quiet);
+  setup();
+  // setup() already waited a while, the run time counts from power on
+  uint64_t endMicros = (uint64_t)(seconds * 1000000);
+  if (endMicros > hal->nowMicros()) {
+    hal->runFor(endMicros - hal->nowMicros(), loop);
+  }
+
+  if (pbmPath != nullptr && !hal->writePanelPbm(pbmPath)) {
+    perror(pbmPath);
+    return 1;
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef PIO_UNIT_TESTING
+#include <Arduino.h>
+#endif
+
+#include <cstdint>
+
+#pragma once
+
+/**
+ * Memory placement for the motion path
+ *
+ * On the Teensy 4.x the tightly coupled memories are where the motion timer
+ * wants to be. ITCM runs code with no wait states or cache misses and DTCM is
+ * the same for data, flash is behind a cache that the display and serial code
+ * keep evicting.
+ *
+ * ELS_FASTRUN puts a function in ITCM and ELS_FASTDATA puts state the timer
+ * touches every tick in its own .data section. The Teensy 4.x linker script
+ * places every .data section in DTCM and copies it there from flash at boot,
+ * so the hot state is in DTCM by name rather than because globals happen to
+ * default there, and can't drift into DMAMEM or EXTMEM. Both are no-ops on
+ * native builds.
+ *
+ * Define ELS_PLACEMENT_FLASH to build the marked functions into flash
+ * instead, so the ISR cycle counts can be compared with and without ITCM.
+ * The data stays in DTCM either way, DMAMEM isn't loaded at boot so state
+ * with constant initialisers can't be moved there.
+ * scripts/placement_report.py lists where everything ended up after a build
+ */
+#if !defined(PIO_UNIT_TESTING) && defined(__IMXRT1062__)
+#ifdef ELS_PLACEMENT_FLASH
+#define ELS_FASTRUN FLASHMEM
+#else
+#define ELS_FASTRUN FASTRUN
+#endif
+#define ELS_FASTDATA __attribute__((section(".data.els_fastdata")))
+#else
+#define ELS_FASTRUN
+#define ELS_FASTDATA
+#endif
+
+/**
+ * The CPU cycle counter, the Teensy core starts it before setup()
+ * Always 0 on native builds
+ */
+static inline uint32_t readCycleCounter() {
+#if !defined(PIO_UNIT_TESTING) && defined(__IMXRT1062__)
+  return ARM_DWT_CYCCNT;
+#else
+  return 0;
+#endif
+}
+
+// CPU cycles in a microsecond, 0 on native builds like the counter itself
+static inline uint32_t getCyclesPerMicro() {
+#if !defined(PIO_UNIT_TESTING) && defined(__IMXRT1062__)
+  return F_CPU_ACTUAL / 1000000;
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,116 @@
+#include "scheduler.h"
+
+Scheduler::Scheduler() : m_taskCount(0) {}
+
+int Scheduler::addTask(const char *name, SchedulerTaskCallback callback,
+                       uint32_t periodUs, uint32_t deadlineUs) {
+  if (m_taskCount >= SCHEDULER_MAX_TASKS || callback == nullptr ||
+      periodUs == 0) {
+    return -1;
+  }
+
+  SchedulerTask &task = m_tasks[m_taskCount];
+  task.name = name;
+  task.callback = callback;
+  task.periodUs = periodUs;
+  task.deadlineUs = deadlineUs == 0 ? periodUs : deadlineUs;
+  task.nextReleaseUs = micros();
+
+  m_taskCount++;
+  resetStats();
+  return m_taskCount - 1;
+}
+
+bool Scheduler::run() {
+  uint32_t now = micros();
+
+  // earliest deadline first out of everything that has been released
+  SchedulerTask *next = nullptr;
+  for (int i = 0; i < m_taskCount; i++) {
+    SchedulerTask &task = m_tasks[i];
+    // signed difference so this survives micros() wrapping
+    if ((int32_t)(now - task.nextReleaseUs) < 0) {
+      continue;
+    }
+
+    if (next == nullptr ||
+        (int32_t)((task.nextReleaseUs + task.deadlineUs) -
+                  (next->nextReleaseUs + next->deadlineUs)) < 0) {
+      next = &task;
+    }
+  }
+
+  if (next == nullptr) {
+    return false;
+  }
+
+  uint32_t lateness = now - next->nextReleaseUs;
+  if (lateness > next->maxLatenessUs) {
+    next->maxLatenessUs = lateness;
+  }
+  if (lateness > next->deadlineUs) {
+    next->missedDeadlines++;
+  }
+
+  next->callback();
+
+  uint32_t runTime = micros() - now;
+  next->lastRunTimeUs = runTime;
+  if (runTime > next->maxRunTimeUs) {
+    next->maxRunTimeUs = runTime;
+  }
+  next->runCount++;
+
+  // keep the task on its fixed rate, unless it has fallen a whole period
+  // behind in which case there's no point trying to catch up
+  next->nextReleaseUs += next->periodUs;
+  if ((int32_t)(now - next->nextReleaseUs) >= (int32_t)next->periodUs) {
+    uint32_t behind = now - next->nextReleaseUs;
+    next->skippedReleases += behind / next->periodUs;
+    next->nextReleaseUs += (behind / next->periodUs) * next->periodUs;
+  }
+
+  return true;
+}
+
+int Scheduler::getTaskCount() { return m_taskCount; }
+
+const SchedulerTask *Scheduler::getTask(int id) {
+  if (id < 0 || id >= m_taskCount) {
+    return nullptr;
+  }
+  return &m_tasks[id];
+}
+
+void Scheduler::resetStats() {
+  for (int i = 0; i < m_taskCount; i++) {
+    m_tasks[i].lastRunTimeUs = 0;
+    m_tasks[i].maxRunTimeUs = 0;
+    m_tasks[i].maxLatenessUs = 0;
+    m_tasks[i].runCount = 0;
+    m_tasks[i].missedDeadlines = 0;
+    m_tasks[i].skippedReleases = 0;
+  }
+}
+
+void Scheduler::printState() {
+#ifndef PIO_UNIT_TESTING
+  for (int i = 0; i < m_taskCount; i++) {
+    SchedulerTask &task = m_tasks[i];
+    Serial.print("Task ");
+    Serial.print(task.name);
+    Serial.print(": runs ");
+    Serial.print(task.runCount);
+    Serial.print(", run time ");
+    Serial.print(task.lastRunTimeUs);
+    Serial.print("us (max ");
+    Serial.print(task.maxRunTimeUs);
+    Serial.print("us), max lateness ");
+    Serial.print(task.maxLatenessUs);
+    Serial.print("us, missed deadlines ");
+    Serial.print(task.missedDeadlines);
+    Serial.print(", skipped ");
+    Serial.println(task.skippedReleases);
+  }
+#endif
+}
@@ -0,0 +1,71 @@
+#include <els_elapsedMillis.h>
+
+#include <cstdint>
+
+#pragma once
+
+// the scheduler is statically allocated, bump this if you need more tasks
+#define SCHEDULER_MAX_TASKS 8
+
+typedef void (*SchedulerTaskCallback)();
+
+struct SchedulerTask {
+  const char *name;
+  SchedulerTaskCallback callback;
+
+  // how often the task should run
+  uint32_t periodUs;
+  // how long after its release the task has to have started
+  uint32_t deadlineUs;
+  // the time the task is next due to run
+  uint32_t nextReleaseUs;
+
+  // stats, these can be read at any time to see how the loop is coping
+  uint32_t lastRunTimeUs;
+  uint32_t maxRunTimeUs;
+  uint32_t maxLatenessUs;
+  uint32_t runCount;
+  uint32_t missedDeadlines;
+  // releases that were skipped entirely because the task fell a full period
+  // behind
+  uint32_t skippedReleases;
+};
+
+/**
+ * A small cooperative scheduler for the main loop
+ *
+ * Tasks are released at a fixed rate and the due task with the earliest
+ * deadline is run first. Tasks are never preempted so a slow task will still
+ * delay the others, but the delay is measured per task as the lateness and can
+ * be read back at runtime.
+ *
+ * Time comes from micros(), which is mocked on native builds
+ */
+class Scheduler {
+ private:
+  SchedulerTask m_tasks[SCHEDULER_MAX_TASKS];
+  int m_taskCount;
+
+ public:
+  Scheduler();
+
+  /**
+   * Adds a task that is first due straight away
+   * A deadline of 0 means the deadline is the same as the period
+   * Returns the id of the task, or -1 if there's no room left
+   */
+  int addTask(const char *name, SchedulerTaskCallback callback,
+              uint32_t periodUs, uint32_t deadlineUs = 0);
+
+  /**
+   * Runs the most urgent task that is due, if there is one
+   * Returns true if a task was run
+   */
+  bool run();
+
+  int getTaskCount();
+  const SchedulerTask *getTask(int id);
+  void resetStats();
+
+  void printState();
+};
@@ -0,0 +1,212 @@
+#include "scope.h"
+
+#include <globalstate.h>
+#include <placement.h>
+
+#include <cstdlib>
+
+#ifndef PIO_UNIT_TESTING
+#include <Arduino.h>
+#endif
+
+Scope::Scope(Spindle* spindle, Leadscrew* leadscrew, GlobalState* globalState,
+             Clock* clock)
+    : m_spindle(spindle),
+      m_leadscrew(leadscrew),
+      m_globalState(globalState),
+      m_channelCount(0),
+      m_depth(0),
+      m_trigger(ScopeTrigger::IMMEDIATE),
+      m_threshold(0),
+      m_preTrigger(0),
+      m_state(ScopeState::IDLE),
+      m_writeIndex(0),
+      m_samples(0),
+      m_postTriggerRemaining(0),
+      m_triggerSample(0),
+      m_lastDirection(LeadscrewDirection::UNKNOWN),
+      m_sinceArm(clock) {}
+
+bool Scope::setChannels(const ScopeChannel* channels, int count) {
+  ScopeState state = m_state.load(std::memory_order_acquire);
+  if (count < 1 || count > SCOPE_MAX_CHANNELS ||
+      state == ScopeState::ARMED || state == ScopeState::TRIGGERED) {
+    return false;
+  }
+
+  for (int i = 0; i < count; i++) {
+    m_channels[i] = channels[i];
+  }
+  m_channelCount = count;
+  m_depth = SCOPE_BUFFER_WORDS / count;
+  m_state.store(ScopeState::IDLE, std::memory_order_release);
+  return true;
+}
+
+int Scope::getChannelCount() { return m_channelCount; }
+
+int Scope::getDepth() { return m_depth; }
+
+void Scope::arm(ScopeTrigger trigger, int32_t threshold, int preTrigger) {
+  if (m_channelCount == 0) {
+    return;
+  }
+
+  // stop the timer writing before anything it reads is changed
+  m_state.store(ScopeState::IDLE, std::memory_order_release);
+
+  m_trigger = trigger;
+  m_threshold = threshold;
+  m_preTrigger = preTrigger < 0 ? 0 : preTrigger;
+  if (m_preTrigger > m_depth - 1) {
+    m_preTrigger = m_depth - 1;
+  }
+  m_writeIndex = 0;
+  m_samples = 0;
+  m_triggerSample = 0;
+  m_lastDirection = m_leadscrew->getCurrentDirection();
+  m_sinceArm = 0;
+
+  m_state.store(ScopeState::ARMED, std::memory_order_release);
+}
+
+void Scope::disarm() {
+  m_state.store(ScopeState::IDLE, std::memory_order_release);
+  m_samples = 0;
+}
+
+ELS_FASTRUN int32_t Scope::readChannel(ScopeChannel channel) {
+  switch (channel) {
+    case TIME_US:
+      return (int32_t)(uint64_t)m_sinceArm;
+    case SPINDLE_POSITION:
+      return m_spindle->getCurrentPosition();
+    case LEADSCREW_POSITION:
+      return m_leadscrew->getCurrentPosition();
+    case EXPECTED_POSITION:
+      return m_leadscrew->getExpectedPosition();
+    case POSITION_ERROR:
+      return m_leadscrew->getPositionError();
+    case PULSE_DELAY_US:
+      return (int32_t)m_leadscrew->getCurrentPulseDelay();
+    case DIRECTION:
+      return m_leadscrew->getCurrentDirection();
+    case MOTION_MODE:
+      return m_globalState->getMotionMode();
+  }
+  return 0;
+}
+
+ELS_FASTRUN bool Scope::isTriggered() {
+  switch (m_trigger) {
+    case IMMEDIATE:
+      return true;
+    case ERROR_ABOVE:
+      return abs(m_leadscrew->getPositionError()) > m_threshold;
+    case DIRECTION_FLIP: {
+      // a stop in between isn't a flip, so only a known direction counts
+      LeadscrewDirection direction = m_leadscrew->getCurrentDirection();
+      if (direction == LeadscrewDirection::UNKNOWN) {
+        return false;
+      }
+      bool flipped = m_lastDirection != LeadscrewDirection::UNKNOWN &&
+                     direction != m_lastDirection;
+      m_lastDirection = direction;
+      return flipped;
+    }
+    case STOP_REACHED:
+      return m_leadscrew->isAtStop();
+    case PULSE_DELAY_BELOW:
+      return m_leadscrew->getCurrentPulseDelay() < m_threshold;
+  }
+  return false;
+}
+
+ELS_FASTRUN void Scope::sample() {
+  ScopeState state = m_state.load(std::memory_order_relaxed);
+  if (state != ScopeState::ARMED && state != ScopeState::TRIGGERED) {
+    return;
+  }
+
+  int32_t* slot = &m_buffer[m_writeIndex * m_channelCount];
+  for (int i = 0; i < m_channelCount; i++) {
+    slot[i] = readChannel(m_channels[i]);
+  }
+  m_writeIndex = (m_writeIndex + 1) % m_depth;
+  if (m_samples < m_depth) {
+    m_samples++;
+  }
+
+  if (state == ScopeState::ARMED) {
+    if (!isTriggered()) {
+      // only the newest pre trigger samples are kept
+      if (m_samples > m_preTrigger) {
+        m_samples = m_preTrigger;
+      }
+      return;
+    }
+    m_triggerSample = m_samples - 1;
+    m_postTriggerRemaining = m_depth - m_samples;
+    state = ScopeState::TRIGGERED;
+  } else {
+    m_postTriggerRemaining--;
+  }
+
+  if (m_postTriggerRemaining <= 0) {
+    state = ScopeState::DONE;
+  }
+  m_state.store(state, std::memory_order_release);
+}
+
+ScopeState Scope::getState() {
+  return m_state.load(std::memory_order_acquire);
+}
+
+int Scope::getSampleCount() {
+  return getState() == ScopeState::DONE ? m_samples : 0;
+}
+
+int Scope::getTriggerSample() { return m_triggerSample; }
+
+bool Scope::readSample(int index, int32_t* values) {
+  if (getState() != ScopeState::DONE || index < 0 || index >= m_samples) {
+    return false;
+  }
+
+  // the oldest sample is the one the next write would have overwritten
+  int slot = (m_writeIndex - m_samples + index + m_depth) % m_depth;
+  for (int i = 0; i < m_channelCount; i++) {
+    values[i] = m_buffer[slot * m_channelCount + i];
+  }
+  return true;
+}
+
+void Scope::setClock(Clock* clock) { m_sinceArm.setClock(clock); }
+
+void Scope::printCapture() {
+#ifndef PIO_UNIT_TESTING
+  // in the same order as ScopeChannel
+  static const char* channelNames[] = {
+      "time_us",           "spindle_position", "leadscrew_position",
+      "expected_position", "position_error",   "pulse_delay_us",
+      "direction",         "motion_mode"};
+
+  Serial.print("sample,trigger");
+  for (int i = 0; i < m_channelCount; i++) {
+    Serial.print(",");
+    Serial.print(channelNames[m_channels[i]]);
+  }
+  Serial.println();
+
+  int32_t values[SCOPE_MAX_CHANNELS];
+  for (int sample = 0; readSample(sample, values); sample++) {
+    Serial.print(sample);
+    Serial.print(sample == m_triggerSample ? ",1" : ",0");
+    for (int i = 0; i < m_channelCount; i++) {
+      Serial.print(",");
+      Serial.print(values[i]);
+    }
+    Serial.println();
+  }
+#endif
+}
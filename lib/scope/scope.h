@@ -0,0 +1,136 @@
+#include <clock.h>
+#include <globalstate.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include <atomic>
+#include <cstdint>
+
+#pragma once
+
+// the capture buffer is statically allocated and shared between the channels,
+// a capture is SCOPE_BUFFER_WORDS / channels samples deep
+#define SCOPE_BUFFER_WORDS 4096
+#define SCOPE_MAX_CHANNELS 8
+
+// the values a capture can record, every sample is one tick of the timer
+enum ScopeChannel {
+  // microseconds since the scope was armed
+  TIME_US,
+  SPINDLE_POSITION,
+  LEADSCREW_POSITION,
+  EXPECTED_POSITION,
+  POSITION_ERROR,
+  PULSE_DELAY_US,
+  DIRECTION,
+  MOTION_MODE
+};
+
+// what starts a capture, the threshold is in the units of the condition
+enum ScopeTrigger {
+  // straight away, the next sample
+  IMMEDIATE,
+  // the absolute position error goes over the threshold
+  ERROR_ABOVE,
+  // the leadscrew changes direction without stopping in between
+  DIRECTION_FLIP,
+  // the leadscrew reaches a stop it's moving towards
+  STOP_REACHED,
+  // the pulse delay goes under the threshold in microseconds
+  PULSE_DELAY_BELOW
+};
+
+enum ScopeState {
+  // nothing recorded, the buffer can be read
+  IDLE,
+  // recording into the pre trigger part of the buffer, waiting to trigger
+  ARMED,
+  // recording the post trigger samples
+  TRIGGERED,
+  // a full capture is in the buffer, it won't change until the next arm
+  DONE
+};
+
+/**
+ * A logic analyser for the motion timer
+ *
+ * Once armed, sample() records the chosen channels on every tick into a ring
+ * buffer, keeping the last `preTrigger` samples. When the trigger condition
+ * is met the rest of the buffer is filled and the capture stops. The loop can
+ * then read it out at its leisure, the timer never waits on the reader and
+ * the reader only touches the buffer once the timer is done with it
+ */
+class Scope {
+ private:
+  Spindle* m_spindle;
+  Leadscrew* m_leadscrew;
+  GlobalState* m_globalState;
+
+  int32_t m_buffer[SCOPE_BUFFER_WORDS];
+  ScopeChannel m_channels[SCOPE_MAX_CHANNELS];
+  int m_channelCount;
+  int m_depth;
+
+  ScopeTrigger m_trigger;
+  int32_t m_threshold;
+  int m_preTrigger;
+
+  std::atomic<ScopeState> m_state;
+  // the next slot to write and how many slots hold samples
+  int m_writeIndex;
+  int m_samples;
+  // how many samples are still to come after the trigger
+  int m_postTriggerRemaining;
+  // where the trigger sample is counted from the oldest sample
+  int m_triggerSample;
+
+  LeadscrewDirection m_lastDirection;
+  ElapsedMicros m_sinceArm;
+
+  int32_t readChannel(ScopeChannel channel);
+  bool isTriggered();
+
+ public:
+  // the motion mode channel and the timestamps come from the global state and
+  // the system clock unless given others
+  Scope(Spindle* spindle, Leadscrew* leadscrew,
+        GlobalState* globalState = GlobalState::getInstance(),
+        Clock* clock = SystemClock::getInstance());
+
+  /**
+   * Chooses what gets recorded, returns false if there are too many channels
+   * or a capture is in progress
+   */
+  bool setChannels(const ScopeChannel* channels, int count);
+  int getChannelCount();
+  // how many samples a full capture holds
+  int getDepth();
+
+  /**
+   * Starts recording, `preTrigger` samples from before the trigger are kept
+   * and the rest of the buffer is filled after it
+   */
+  void arm(ScopeTrigger trigger, int32_t threshold, int preTrigger);
+  // stops recording and throws away whatever was captured
+  void disarm();
+
+  /**
+   * Records one sample, call at the end of every motion timer tick
+   */
+  void sample();
+
+  ScopeState getState();
+  int getSampleCount();
+  // the index of the sample that met the trigger condition
+  int getTriggerSample();
+  /**
+   * Copies sample `index` (oldest first) into `values`, one value per channel
+   * Only works once the capture is DONE
+   */
+  bool readSample(int index, int32_t* values);
+
+  void setClock(Clock* clock);
+
+  // dumps a finished capture as CSV
+  void printCapture();
+};
@@ -0,0 +1,233 @@
+#include "spi_tft.h"
+
+#include <cstring>
+
+struct SpiTftInitCommand {
+  uint8_t command;
+  uint8_t size;
+  uint8_t data;
+  uint16_t waitMillis;
+};
+
+// MADCTL 0x28 is landscape with the ILI9341's BGR colour order
+static const SpiTftInitCommand ili9341Init[] = {
+    {SPI_TFT_SWRESET, 0, 0, 150}, {SPI_TFT_SLPOUT, 0, 0, 120},
+    {SPI_TFT_COLMOD, 1, 0x55, 0}, {SPI_TFT_MADCTL, 1, 0x28, 0},
+    {SPI_TFT_DISPON, 0, 0, 20},
+};
+
+// MADCTL 0x60 turns the 240x320 panel to landscape, IPS panels are inverted
+static const SpiTftInitCommand st7789Init[] = {
+    {SPI_TFT_SWRESET, 0, 0, 150}, {SPI_TFT_SLPOUT, 0, 0, 120},
+    {SPI_TFT_COLMOD, 1, 0x55, 10}, {SPI_TFT_MADCTL, 1, 0x60, 0},
+    {SPI_TFT_INVON, 0, 0, 10},     {SPI_TFT_NORON, 0, 0, 10},
+    {SPI_TFT_DISPON, 0, 0, 20},
+};
+
+SpiTft::SpiTft(SpiTftIO* io, SpiTftController controller, uint16_t foreground,
+               uint16_t background)
+    : Adafruit_GFX(SPI_TFT_CANVAS_WIDTH, SPI_TFT_CANVAS_HEIGHT),
+      m_io(io),
+      m_controller(controller),
+      m_foreground(foreground),
+      m_background(background),
+      m_runCount(0),
+      m_nextRun(0),
+      m_preparedRun(-1),
+      m_sendingBuffer(-1),
+      m_preparedBuffer(0),
+      m_preparedSize(0),
+      m_framesSent(0),
+      m_framesDropped(0),
+      m_bytesSent(0) {
+  memset(m_frame, 0, sizeof(m_frame));
+  memset(m_shown, 0, sizeof(m_shown));
+}
+
+bool SpiTft::begin() {
+  m_io->begin();
+
+  const SpiTftInitCommand* init = ili9341Init;
+  size_t initSize = sizeof(ili9341Init) / sizeof(ili9341Init[0]);
+  if (m_controller == SpiTftController::ST7789) {
+    init = st7789Init;
+    initSize = sizeof(st7789Init) / sizeof(st7789Init[0]);
+  }
+  for (size_t i = 0; i < initSize; i++) {
+    m_io->writeCommand(init[i].command, &init[i].data, init[i].size);
+    if (init[i].waitMillis > 0) {
+      m_io->waitMillis(init[i].waitMillis);
+    }
+  }
+
+  // the border around the canvas is never sent again, clear it all once
+  uint8_t* buffer = m_buffers[0];
+  for (size_t i = 0; i < SPI_TFT_BUFFER_SIZE; i += 2) {
+    buffer[i] = m_background >> 8;
+    buffer[i + 1] = m_background & 0xFF;
+  }
+  setAddressWindow(0, 0, SPI_TFT_WIDTH, SPI_TFT_HEIGHT);
+  m_io->writeCommand(SPI_TFT_RAMWR);
+  size_t remaining = SPI_TFT_WIDTH * SPI_TFT_HEIGHT * 2;
+  while (remaining > 0) {
+    size_t size =
+        remaining < SPI_TFT_BUFFER_SIZE ? remaining : SPI_TFT_BUFFER_SIZE;
+    m_io->writeData(buffer, size);
+    while (m_io->isBusy()) {
+    }
+    remaining -= size;
+  }
+
+  memset(m_frame, 0, sizeof(m_frame));
+  memset(m_shown, 0, sizeof(m_shown));
+  m_runCount = 0;
+  m_nextRun = 0;
+  m_preparedRun = -1;
+  m_sendingBuffer = -1;
+  return true;
+}
+
+void SpiTft::clearDisplay() { memset(m_frame, 0, sizeof(m_frame)); }
+
+bool SpiTft::display() {
+  if (isBusy()) {
+    m_framesDropped++;
+    return false;
+  }
+
+  m_runCount = 0;
+  for (int page = 0; page < SPI_TFT_PAGES; page++) {
+    for (int tile = 0; tile < SPI_TFT_TILES_X; tile++) {
+      size_t offset =
+          page * SPI_TFT_CANVAS_WIDTH + tile * SPI_TFT_TILE_SIZE;
+      if (memcmp(&m_frame[offset], &m_shown[offset], SPI_TFT_TILE_SIZE) ==
+          0) {
+        continue;
+      }
+      SpiTftRun* last = m_runCount > 0 ? &m_runs[m_runCount - 1] : nullptr;
+      if (last != nullptr && last->page == page &&
+          last->firstTile + last->tiles == tile) {
+        last->tiles++;
+      } else {
+        m_runs[m_runCount++] = {(uint8_t)page, (uint8_t)tile, 1};
+      }
+    }
+  }
+
+  // the runs are made from this copy, the canvas can be drawn on again
+  memcpy(m_shown, m_frame, sizeof(m_shown));
+  m_nextRun = 0;
+  m_preparedRun = -1;
+  m_framesSent++;
+  service();
+  return true;
+}
+
+void SpiTft::service() {
+  if (!m_io->isBusy()) {
+    m_sendingBuffer = -1;
+    if (m_nextRun < m_runCount) {
+      if (m_preparedRun != m_nextRun) {
+        m_preparedBuffer = 0;
+        m_preparedSize =
+            prepareRun(m_runs[m_nextRun], m_buffers[m_preparedBuffer]);
+      }
+      m_sendingBuffer = m_preparedBuffer;
+      sendRun(m_runs[m_nextRun], m_buffers[m_sendingBuffer], m_preparedSize);
+      m_nextRun++;
+      m_preparedRun = -1;
+    }
+  }
+
+  // get the next run ready while this one goes out
+  if (m_nextRun < m_runCount && m_preparedRun != m_nextRun) {
+    m_preparedBuffer = m_sendingBuffer == 0 ? 1 : 0;
+    m_preparedSize =
+        prepareRun(m_runs[m_nextRun], m_buffers[m_preparedBuffer]);
+    m_preparedRun = m_nextRun;
+  }
+}
+
+bool SpiTft::isBusy() { return m_nextRun < m_runCount || m_io->isBusy(); }
+
+void SpiTft::setAddressWindow(int16_t x, int16_t y, int16_t w, int16_t h) {
+  int16_t right = x + w - 1;
+  int16_t bottom = y + h - 1;
+  uint8_t columns[] = {(uint8_t)(x >> 8), (uint8_t)x, (uint8_t)(right >> 8),
+                       (uint8_t)right};
+  uint8_t rows[] = {(uint8_t)(y >> 8), (uint8_t)y, (uint8_t)(bottom >> 8),
+                    (uint8_t)bottom};
+  m_io->writeCommand(SPI_TFT_CASET, columns, sizeof(columns));
+  m_io->writeCommand(SPI_TFT_RASET, rows, sizeof(rows));
+}
+
+size_t SpiTft::prepareRun(const SpiTftRun& run, uint8_t* buffer) {
+  uint8_t* out = buffer;
+  const uint8_t* page = &m_shown[run.page * SPI_TFT_CANVAS_WIDTH +
+                                 run.firstTile * SPI_TFT_TILE_SIZE];
+  int columns = run.tiles * SPI_TFT_TILE_SIZE;
+
+  for (int row = 0; row < 8; row++) {
+    uint8_t bit = 1 << row;
+    uint8_t* line = out;
+    for (int column = 0; column < columns; column++) {
+      uint16_t colour = page[column] & bit ? m_foreground : m_background;
+      for (int i = 0; i < SPI_TFT_SCALE; i++) {
+        *out++ = colour >> 8;
+        *out++ = colour & 0xFF;
+      }
+    }
+    // every canvas row is SPI_TFT_SCALE panel rows
+    size_t lineSize = out - line;
+    for (int i = 1; i < SPI_TFT_SCALE; i++) {
+      memcpy(out, line, lineSize);
+      out += lineSize;
+    }
+  }
+  return out - buffer;
+}
+
+void SpiTft::sendRun(const SpiTftRun& run, uint8_t* buffer, size_t size) {
+  setAddressWindow(
+      SPI_TFT_OFFSET_X + run.firstTile * SPI_TFT_TILE_SIZE * SPI_TFT_SCALE,
+      SPI_TFT_OFFSET_Y + run.page * 8 * SPI_TFT_SCALE,
+      run.tiles * SPI_TFT_TILE_SIZE * SPI_TFT_SCALE, 8 * SPI_TFT_SCALE);
+  m_io->writeCommand(SPI_TFT_RAMWR);
+  m_io->writeData(buffer, size);
+  m_bytesSent += size;
+}
+
+void SpiTft::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || x >= SPI_TFT_CANVAS_WIDTH || y < 0 ||
+      y >= SPI_TFT_CANVAS_HEIGHT) {
+    return;
+  }
+
+  uint8_t* page = &m_frame[x + (y / 8) * SPI_TFT_CANVAS_WIDTH];
+  uint8_t bit = 1 << (y & 7);
+  switch (color) {
+    case SPI_TFT_WHITE:
+      *page |= bit;
+      break;
+    case SPI_TFT_BLACK:
+      *page &= ~bit;
+      break;
+    case SPI_TFT_INVERSE:
+      *page ^= bit;
+      break;
+  }
+}
+
+bool SpiTft::getPixel(int16_t x, int16_t y) {
+  if (x < 0 || x >= SPI_TFT_CANVAS_WIDTH || y < 0 ||
+      y >= SPI_TFT_CANVAS_HEIGHT) {
+    return false;
+  }
+  return m_frame[x + (y / 8) * SPI_TFT_CANVAS_WIDTH] & (1 << (y & 7));
+}
+
+uint32_t SpiTft::getFramesSent() { return m_framesSent; }
+
+uint32_t SpiTft::getFramesDropped() { return m_framesDropped; }
+
+uint32_t SpiTft::getBytesSent() { return m_bytesSent; }
@@ -0,0 +1,136 @@
+#include <Adafruit_GFX.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "spi_tft_io.h"
+
+#pragma once
+
+// the panel in landscape
+#define SPI_TFT_WIDTH 320
+#define SPI_TFT_HEIGHT 240
+/**
+ * What gets drawn on, the same 128x64 screen as the OLED. Every canvas pixel
+ * is a SPI_TFT_SCALE square on the panel, centred
+ */
+#define SPI_TFT_CANVAS_WIDTH 128
+#define SPI_TFT_CANVAS_HEIGHT 64
+#define SPI_TFT_SCALE 2
+#define SPI_TFT_OFFSET_X \
+  ((SPI_TFT_WIDTH - SPI_TFT_CANVAS_WIDTH * SPI_TFT_SCALE) / 2)
+#define SPI_TFT_OFFSET_Y \
+  ((SPI_TFT_HEIGHT - SPI_TFT_CANVAS_HEIGHT * SPI_TFT_SCALE) / 2)
+
+// one bit a pixel in 8 pixel tall pages, the same layout as the SSD1306
+#define SPI_TFT_FRAMEBUFFER_SIZE \
+  (SPI_TFT_CANVAS_WIDTH * ((SPI_TFT_CANVAS_HEIGHT + 7) / 8))
+// the canvas is compared in tiles of one page by 8 columns
+#define SPI_TFT_TILE_SIZE 8
+#define SPI_TFT_TILES_X (SPI_TFT_CANVAS_WIDTH / SPI_TFT_TILE_SIZE)
+#define SPI_TFT_PAGES ((SPI_TFT_CANVAS_HEIGHT + 7) / 8)
+// a whole page of the canvas on the panel, two bytes a pixel
+#define SPI_TFT_BUFFER_SIZE \
+  (SPI_TFT_CANVAS_WIDTH * SPI_TFT_SCALE * 8 * SPI_TFT_SCALE * 2)
+
+// the commands both controllers share
+#define SPI_TFT_SWRESET 0x01
+#define SPI_TFT_SLPOUT 0x11
+#define SPI_TFT_NORON 0x13
+#define SPI_TFT_INVON 0x21
+#define SPI_TFT_DISPON 0x29
+#define SPI_TFT_CASET 0x2A
+#define SPI_TFT_RASET 0x2B
+#define SPI_TFT_RAMWR 0x2C
+#define SPI_TFT_MADCTL 0x36
+#define SPI_TFT_COLMOD 0x3A
+
+#define SPI_TFT_BLACK 0
+#define SPI_TFT_WHITE 1
+#define SPI_TFT_INVERSE 2
+
+enum SpiTftController { ILI9341, ST7789 };
+
+// changed tiles next to each other in a page go out as one rectangle
+struct SpiTftRun {
+  uint8_t page;
+  uint8_t firstTile;
+  uint8_t tiles;
+};
+
+/**
+ * An ILI9341 or ST7789 class SPI TFT, drawn on like the OLED
+ *
+ * Drawing goes into a one bit canvas. display() compares it with what the
+ * panel already shows and only sends the tiles that changed, each run of them
+ * through its own address window. The runs are turned into RGB565 one at a
+ * time while the previous one is still going out by DMA, service() keeps that
+ * going from loop() and display() drops the frame while a frame is still
+ * being sent
+ *
+ * Everything is static, the buffers are members
+ */
+class SpiTft : public Adafruit_GFX {
+ private:
+  SpiTftIO* m_io;
+  SpiTftController m_controller;
+  // RGB565 for the lit and unlit canvas pixels
+  uint16_t m_foreground;
+  uint16_t m_background;
+
+  uint8_t m_frame[SPI_TFT_FRAMEBUFFER_SIZE];
+  // what the panel shows once the runs have all gone out
+  uint8_t m_shown[SPI_TFT_FRAMEBUFFER_SIZE];
+
+  SpiTftRun m_runs[SPI_TFT_PAGES * SPI_TFT_TILES_X];
+  int m_runCount;
+  // the next run to send and the one waiting in the other buffer, -1 if none
+  int m_nextRun;
+  int m_preparedRun;
+
+  uint8_t m_buffers[2][SPI_TFT_BUFFER_SIZE];
+  // the buffer the DMA is reading, -1 if none, and where the prepared run is
+  int m_sendingBuffer;
+  int m_preparedBuffer;
+  size_t m_preparedSize;
+
+  uint32_t m_framesSent;
+  uint32_t m_framesDropped;
+  uint32_t m_bytesSent;
+
+  void setAddressWindow(int16_t x, int16_t y, int16_t w, int16_t h);
+  // turns a run into pixels in the buffer that isn't being sent, returns the
+  // number of bytes
+  size_t prepareRun(const SpiTftRun& run, uint8_t* buffer);
+  void sendRun(const SpiTftRun& run, uint8_t* buffer, size_t size);
+
+ public:
+  SpiTft(SpiTftIO* io, SpiTftController controller, uint16_t foreground,
+         uint16_t background);
+
+  /**
+   * Resets and sets up the controller and fills the whole panel with the
+   * background, this waits for the panel. Always returns true, the bus can't
+   * tell whether a panel is there
+   */
+  bool begin();
+  void clearDisplay();
+  /**
+   * Starts sending what changed since the last frame. Returns false and drops
+   * the frame if the last one is still going out, draw the next one once
+   * isBusy() is false
+   */
+  bool display();
+  // sends the next run once the bus is free and prepares the one after
+  void service();
+  bool isBusy();
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  bool getPixel(int16_t x, int16_t y);
+  uint8_t* getBuffer() { return m_frame; }
+
+  uint32_t getFramesSent();
+  uint32_t getFramesDropped();
+  // pixel data only, the commands and windows aren't counted
+  uint32_t getBytesSent();
+};
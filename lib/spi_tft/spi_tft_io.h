@@ -0,0 +1,25 @@
+#include <cstddef>
+#include <cstdint>
+
+#pragma once
+
+/**
+ * The bus to an SPI TFT controller, abstracted away from the SPI library so
+ * the rendering can be checked against an emulated panel on native builds
+ */
+class SpiTftIO {
+ public:
+  // sets up the pins and the bus and resets the controller
+  virtual void begin() = 0;
+  // sends a command and its parameters, returns once they're out
+  virtual void writeCommand(uint8_t command, const uint8_t* data = nullptr,
+                            size_t size = 0) = 0;
+  /**
+   * Starts sending pixel data after a memory write command and returns
+   * straight away. The data has to stay as it is until isBusy() is false
+   */
+  virtual void writeData(const uint8_t* data, size_t size) = 0;
+  // true while writeData is still sending
+  virtual bool isBusy() = 0;
+  virtual void waitMillis(uint32_t millis) = 0;
+};
@@ -0,0 +1,82 @@
+#include <Arduino.h>
+#include <EventResponder.h>
+#include <SPI.h>
+#include <config.h>
+
+#include "spi_tft_io.h"
+#pragma once
+
+/**
+ * The controller on the hardware SPI bus, with chip select and data/command
+ * on plain pins. Pixel data goes out by DMA and chip select is released from
+ * the DMA interrupt, so nothing waits for the panel in loop()
+ *
+ * The DMA reads straight from the buffers it's given. Globals live in DTCM on
+ * the Teensy 4, which isn't cached, so they don't need flushing first
+ */
+class SpiTftIOImpl : public SpiTftIO {
+  SPISettings m_settings;
+  EventResponder m_dmaDone;
+  volatile bool m_busy;
+
+  // the event responder can't take a member function
+  static SpiTftIOImpl*& instance() {
+    static SpiTftIOImpl* instance = nullptr;
+    return instance;
+  }
+
+  static void dmaDone(EventResponderRef event) {
+    SpiTftIOImpl* io = instance();
+    digitalWrite(PIN_DISPLAY_CS, HIGH);
+    SPI.endTransaction();
+    io->m_busy = false;
+  }
+
+ public:
+  SpiTftIOImpl()
+      : m_settings(ELS_DISPLAY_SPI_CLOCK, MSBFIRST, SPI_MODE0),
+        m_busy(false) {}
+
+  void begin() {
+    instance() = this;
+    m_dmaDone.attachImmediate(dmaDone);
+
+    pinMode(PIN_DISPLAY_CS, OUTPUT);
+    digitalWrite(PIN_DISPLAY_CS, HIGH);
+    pinMode(PIN_DISPLAY_DC, OUTPUT);
+    digitalWrite(PIN_DISPLAY_DC, HIGH);
+    SPI.begin();
+
+#if PIN_DISPLAY_RESET >= 0
+    pinMode(PIN_DISPLAY_RESET, OUTPUT);
+    digitalWrite(PIN_DISPLAY_RESET, LOW);
+    delay(10);
+    digitalWrite(PIN_DISPLAY_RESET, HIGH);
+    delay(120);
+#endif
+  }
+
+  void writeCommand(uint8_t command, const uint8_t* data, size_t size) {
+    SPI.beginTransaction(m_settings);
+    digitalWrite(PIN_DISPLAY_CS, LOW);
+    digitalWrite(PIN_DISPLAY_DC, LOW);
+    SPI.transfer(command);
+    digitalWrite(PIN_DISPLAY_DC, HIGH);
+    for (size_t i = 0; i < size; i++) {
+      SPI.transfer(data[i]);
+    }
+    digitalWrite(PIN_DISPLAY_CS, HIGH);
+    SPI.endTransaction();
+  }
+
+  void writeData(const uint8_t* data, size_t size) {
+    m_busy = true;
+    SPI.beginTransaction(m_settings);
+    digitalWrite(PIN_DISPLAY_CS, LOW);
+    digitalWrite(PIN_DISPLAY_DC, HIGH);
+    SPI.transfer(data, nullptr, size, m_dmaDone);
+  }
+
+  inline bool isBusy() { return m_busy; }
+  inline void waitMillis(uint32_t millis) { delay(millis); }
+};
@@ -1,27 +1,91 @@
 #include "spindle.h"
 
 #include <config.h>
-#include <els_elapsedMillis.h>
+#include <globalstate.h>
 #include <math.h>
+#include <placement.h>
 
-#ifndef ELS_SPINDLE_DRIVEN
-Spindle::Spindle(int pinA, int pinB) : m_encoder(pinA, pinB) {
-#else
-Spindle::Spindle() {
-#endif
+#include <algorithm>
 
+Spindle::Spindle() : Spindle((SpindleIO*)nullptr) {}
+
+Spindle::Spindle(SpindleIO* io, GlobalState* globalState, Clock* clock)
+    : Spindle(io, nullptr, 0, 0, globalState, clock) {}
+
+Spindle::Spindle(SpindleDriverIO* driver, float startVelocity,
+                 float acceleration, GlobalState* globalState, Clock* clock)
+    : Spindle(nullptr, driver, startVelocity, acceleration, globalState,
+              clock) {
+  // we know exactly where a driven spindle is, so it's referenced from the
+  // start and "indexes" every time it passes position 0
+  m_indexReferenced = true;
+}
+
+Spindle::Spindle(SpindleIO* io, SpindleDriverIO* driver, float startVelocity,
+                 float acceleration, GlobalState* globalState, Clock* clock)
+    : RotationalAxis(clock),
+      m_io(io),
+      m_globalState(globalState),
+      m_lastEdgeMicros(clock),
+      m_driver(driver),
+      m_startVelocity(startVelocity),
+      m_acceleration(acceleration) {
   m_unconsumedPosition = 0;
-  m_lastPulseMicros = 0;
   m_lastFullPulseDurationMicros = 0;
   m_currentPosition = 0;
+  m_lastEncoderCount = 0;
+  m_indexReferenced = false;
+  m_indexPosition = 0;
+  m_revolutions = 0;
+  m_lastIndexError = 0;
+  m_indexCorrections = 0;
+  m_targetVelocity = 0;
+  m_currentVelocity = 0;
+  m_edgePeriodMicros = 0;
+  m_lastEdgeDirection = 0;
+  m_interpolationMaxPeriod = ELS_SPINDLE_INTERPOLATION_MAX_PERIOD_US;
 }
 
-void Spindle::update() {
+ELS_FASTRUN int Spindle::wrapPosition(int position) {
+  position %= ELS_SPINDLE_ENCODER_PPR;
+  if (position < 0) {
+    position += ELS_SPINDLE_ENCODER_PPR;
+  }
+  return position;
+}
+
+ELS_FASTRUN void Spindle::update() {
+  if (m_driver != nullptr) {
+    updateDriven();
+    return;
+  }
+
+  if (m_io == nullptr) {
+    return;
+  }
+
   // read the encoder and update the current position
-  // todo: we should keep the absolute position of the spindle, cbf right now
-  int position = m_encoder.read();
-  incrementCurrentPosition(position);
-  m_encoder.write(0);
+  // the encoder count is absolute, so an index pulse latched at any point
+  // between two updates can be placed exactly
+  int32_t count = m_io->readEncoder();
+  int32_t countAtIndex = count;
+  bool index = m_io->consumeIndex(&countAtIndex);
+
+  int positionAtIndex = m_currentPosition + (countAtIndex - m_lastEncoderCount);
+
+  int32_t counts = count - m_lastEncoderCount;
+  if (counts != 0) {
+    m_edgePeriodMicros = (float)m_lastEdgeMicros / abs(counts);
+    m_lastEdgeMicros = 0;
+    m_lastEdgeDirection = counts > 0 ? 1 : -1;
+  }
+
+  incrementCurrentPosition(counts);
+  m_lastEncoderCount = count;
+
+  if (index) {
+    handleIndex(positionAtIndex);
+  }
 }
 
 void Spindle::setCurrentPosition(int position) {
@@ -30,20 +94,217 @@ void Spindle::setCurrentPosition(int position) {
   m_currentPosition = newPosition;
 }
 
-void Spindle::incrementCurrentPosition(int amount) {
-  setCurrentPosition(getCurrentPosition() + amount);
+ELS_FASTRUN void Spindle::incrementCurrentPosition(int amount) {
+  // don't go through setCurrentPosition, wrapping over a full revolution would
+  // look like the spindle went a whole turn backwards
+  m_currentPosition = (m_currentPosition + amount) % ELS_SPINDLE_ENCODER_PPR;
+  m_unconsumedPosition += amount;
   if (amount != 0) {
     m_lastFullPulseDurationMicros = m_lastPulseMicros / abs(amount);
     m_lastPulseMicros = 0;
   }
 }
 
+void Spindle::setClock(Clock* clock) {
+  Axis::setClock(clock);
+  m_lastEdgeMicros.setClock(clock);
+}
+
+void Spindle::setGlobalState(GlobalState* globalState) {
+  m_globalState = globalState;
+}
+
+ELS_FASTRUN float Spindle::getInterpolationOffset() {
+  if (m_interpolationMaxPeriod == 0 || m_edgePeriodMicros <= 0 ||
+      m_edgePeriodMicros > m_interpolationMaxPeriod) {
+    return 0;
+  }
+
+  // once the next edge is overdue the spindle is slowing down, we stay on the
+  // last count rather than guessing past it
+  float progress = (float)m_lastEdgeMicros / m_edgePeriodMicros;
+  if (progress >= 1) {
+    return 0;
+  }
+  return -(1 - progress) * m_lastEdgeDirection;
+}
+
+void Spindle::setInterpolationMaxPeriod(uint32_t maxPeriod) {
+  m_interpolationMaxPeriod = maxPeriod;
+}
+
+ELS_FASTRUN float Spindle::getCountRate() {
+  if (m_driver != nullptr) {
+    return fabs(m_currentVelocity);
+  }
+  if (m_edgePeriodMicros <= 0) {
+    return 0;
+  }
+  float period = std::max(m_edgePeriodMicros, (float)m_lastEdgeMicros);
+  return US_PER_SECOND / period;
+}
+
 float Spindle::getEstimatedVelocityInRPM() {
-  return getEstimatedVelocityInPulsesPerSecond() / ELS_SPINDLE_ENCODER_PPR;
+  return getEstimatedVelocityInPulsesPerSecond() * 60.0f /
+         ELS_SPINDLE_ENCODER_PPR;
 }
 
-int Spindle::consumePosition() {
+ELS_FASTRUN int Spindle::consumePosition() {
   int position = m_unconsumedPosition;
   m_unconsumedPosition = 0;
   return position;
-}
\ No newline at end of file
+}
+
+ELS_FASTRUN bool Spindle::isIdle() {
+  // an interpolated count still being spread out is movement too
+  if (m_unconsumedPosition != 0 || getInterpolationOffset() != 0) {
+    return false;
+  }
+  if (m_driver != nullptr) {
+    bool enabled =
+        m_globalState->getMotionMode() == GlobalMotionMode::ENABLED;
+    return m_currentVelocity == 0 && (m_targetVelocity == 0 || !enabled);
+  }
+  return true;
+}
+
+ELS_FASTRUN void Spindle::handleIndex(int positionAtIndex) {
+  positionAtIndex = wrapPosition(positionAtIndex);
+  m_revolutions++;
+
+  if (!m_indexReferenced) {
+    m_indexPosition = positionAtIndex;
+    m_indexReferenced = true;
+    return;
+  }
+
+  // the index should always land on the same position, anything else is
+  // encoder counts that were gained or lost. Take the shortest way round
+  int error = positionAtIndex - m_indexPosition;
+  if (error > ELS_SPINDLE_ENCODER_PPR / 2) {
+    error -= ELS_SPINDLE_ENCODER_PPR;
+  } else if (error < -ELS_SPINDLE_ENCODER_PPR / 2) {
+    error += ELS_SPINDLE_ENCODER_PPR;
+  }
+
+  m_lastIndexError = error;
+  if (error != 0) {
+    // pass the correction on to the driven axes too, they followed the bad
+    // counts
+    m_currentPosition = (m_currentPosition - error) % ELS_SPINDLE_ENCODER_PPR;
+    m_unconsumedPosition -= error;
+    m_indexCorrections++;
+  }
+}
+
+ELS_FASTRUN bool Spindle::isIndexReferenced() { return m_indexReferenced; }
+
+ELS_FASTRUN int Spindle::getIndexedPosition() {
+  if (!m_indexReferenced) {
+    return 0;
+  }
+  return wrapPosition(m_currentPosition - m_indexPosition);
+}
+
+uint32_t Spindle::getRevolutionCount() { return m_revolutions; }
+
+int Spindle::getLastIndexError() { return m_lastIndexError; }
+
+uint32_t Spindle::getIndexCorrections() { return m_indexCorrections; }
+
+ELS_FASTRUN bool Spindle::sendPulse() {
+  uint8_t pinState = m_driver->readStepPin();
+
+  // a pulse is only complete on the falling edge
+  if (pinState == 1) {
+    m_driver->writeStepPin(0);
+  } else {
+    m_driver->writeStepPin(1);
+  }
+
+  return pinState == 1;
+}
+
+ELS_FASTRUN void Spindle::updateDriven() {
+  // the spindle only runs while motion is enabled, anything else winds it down
+  float targetVelocity =
+      m_globalState->getMotionMode() == GlobalMotionMode::ENABLED
+          ? m_targetVelocity
+          : 0;
+
+  if (m_currentVelocity == 0) {
+    if (targetVelocity == 0) {
+      return;
+    }
+
+    // anything up to the start velocity can be reached instantly
+    m_currentVelocity = targetVelocity > 0
+                            ? std::min(targetVelocity, m_startVelocity)
+                            : std::max(targetVelocity, -m_startVelocity);
+    m_driver->writeDirPin(m_currentVelocity > 0 ? 1 : 0);
+  }
+
+  float pulseDelay = US_PER_SECOND / fabs(m_currentVelocity);
+  if (m_lastPulseMicros < pulseDelay || !sendPulse()) {
+    return;
+  }
+
+  // the late part of every pulse is carried over to the next one, otherwise
+  // the timer resolution and the falling edge tick would make the spindle run
+  // slow. That makes the average pulse exactly the pulse delay, unless we're
+  // coming out of a standstill
+  uint32_t pulseDuration = pulseDelay;
+  if (m_lastPulseMicros >= 2 * pulseDelay) {
+    m_lastPulseMicros = 0;
+  } else {
+    m_lastPulseMicros -= pulseDelay;
+  }
+  m_lastFullPulseDurationMicros = pulseDuration;
+
+  // every pulse is a spindle position, the driven axes see it in this same
+  // update rather than whenever an encoder gets read
+  int direction = m_currentVelocity > 0 ? 1 : -1;
+  int position = wrapPosition(m_currentPosition + direction);
+  if ((direction > 0 && position == 0) ||
+      (direction < 0 && position == ELS_SPINDLE_ENCODER_PPR - 1)) {
+    m_revolutions++;
+  }
+  m_currentPosition = position;
+  m_unconsumedPosition += direction;
+
+  // constant acceleration towards the target
+  float velocityChange = m_acceleration * pulseDuration / US_PER_SECOND;
+  float nextVelocity = m_currentVelocity;
+  if (m_currentVelocity < targetVelocity) {
+    nextVelocity = std::min(targetVelocity, m_currentVelocity + velocityChange);
+  } else if (m_currentVelocity > targetVelocity) {
+    nextVelocity = std::max(targetVelocity, m_currentVelocity - velocityChange);
+  }
+
+  // stopping or reversing, once we're slow enough we can stop instantly. A
+  // reverse starts again from a standstill with the direction pin flipped
+  bool slowingDown = targetVelocity * m_currentVelocity <= 0;
+  bool crossedZero = nextVelocity * m_currentVelocity <= 0;
+  if (slowingDown && (crossedZero || fabs(nextVelocity) <= m_startVelocity)) {
+    nextVelocity = 0;
+  }
+  m_currentVelocity = nextVelocity;
+}
+
+void Spindle::setTargetRPM(float rpm) {
+  m_targetVelocity = rpm * ELS_SPINDLE_ENCODER_PPR / 60;
+}
+
+float Spindle::getTargetRPM() {
+  return m_targetVelocity * 60 / ELS_SPINDLE_ENCODER_PPR;
+}
+
+float Spindle::getCommandedRPM() {
+  return m_currentVelocity * 60 / ELS_SPINDLE_ENCODER_PPR;
+}
+
+bool Spindle::isDriven() { return m_driver != nullptr; }
+
+int Spindle::getExpectedPosition() { return m_currentPosition; }
+
+int Spindle::getPositionError() { return 0; }
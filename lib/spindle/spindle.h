@@ -1,31 +1,139 @@
-#include <Encoder.h>
 #include <axis.h>
-#include <els_elapsedMillis.h>
+#include <clock.h>
+#include <globalstate.h>
 
+#include "spindle_driver_io.h"
+#include "spindle_io.h"
 #pragma once
 
-class Spindle : public RotationalAxis {
+class Spindle : public RotationalAxis, public DrivenAxis {
  private:
   // the unconsumed position is the position that has been read from the encoder
   // but hasn't been used to update the current position of any driven axes
   int m_unconsumedPosition;
 
-#ifndef ELS_SPINDLE_DRIVEN
-  Encoder m_encoder;
-#endif
+  SpindleIO* m_io;
+  GlobalState* m_globalState;
+  int32_t m_lastEncoderCount;
+
+  // every encoder edge is timestamped so the angle between edges can be
+  // interpolated from the measured period
+  ElapsedMicros m_lastEdgeMicros;
+  float m_edgePeriodMicros;
+  int m_lastEdgeDirection;
+  uint32_t m_interpolationMaxPeriod;
+
+  // index channel state, the index position is where the spindle position was
+  // when we saw the first index pulse
+  bool m_indexReferenced;
+  int m_indexPosition;
+  volatile uint32_t m_revolutions;
+  int m_lastIndexError;
+  uint32_t m_indexCorrections;
+
+  // only used when we drive the spindle ourselves
+  SpindleDriverIO* m_driver;
+  // the profile is in pulses per second, the velocity is signed
+  const float m_startVelocity;
+  const float m_acceleration;
+  float m_targetVelocity;
+  float m_currentVelocity;
+
+  Spindle(SpindleIO* io, SpindleDriverIO* driver, float startVelocity,
+          float acceleration, GlobalState* globalState, Clock* clock);
+
+  // wraps a position to within a single revolution
+  int wrapPosition(int position);
+  /**
+   * Steps the spindle motor along the acceleration profile, every pulse is
+   * passed on to the driven axes straight away
+   */
+  void updateDriven();
+  bool sendPulse();
 
  public:
-#ifndef ELS_SPINDLE_DRIVEN
-  Spindle(int pinA, int pinB);
-#endif
+  /**
+   * A spindle without IO has to be moved with setCurrentPosition or
+   * incrementCurrentPosition
+   * The firmware runs everything off the global state and the system clock,
+   * anything else can hand in its own
+   */
+  Spindle();
+  Spindle(SpindleIO* io, GlobalState* globalState = GlobalState::getInstance(),
+          Clock* clock = SystemClock::getInstance());
+  /**
+   * A spindle driven by a motor we control, it ramps between speeds at
+   * `acceleration` pulses/s^2 and can start and stop instantly below
+   * `startVelocity` pulses/s
+   * There is no encoder, every pulse we send is the spindle position
+   */
+  Spindle(SpindleDriverIO* driver, float startVelocity, float acceleration,
+          GlobalState* globalState = GlobalState::getInstance(),
+          Clock* clock = SystemClock::getInstance());
 
   void update();
   void setCurrentPosition(int position);
   void incrementCurrentPosition(int amount);
+  void setClock(Clock* clock) override;
+  // the motion mode comes from the constructor's GlobalState until changed
+  void setGlobalState(GlobalState* globalState);
   /**
    * This will return the unconsumed position and reset it to 0
    * used for updating the expected position of any driven axes
    */
   int consumePosition();
+  /**
+   * True when there's nothing for the driven axes to follow, no unconsumed
+   * position and a driven spindle isn't about to move
+   */
+  bool isIdle();
   float getEstimatedVelocityInRPM();
-};
\ No newline at end of file
+
+  /**
+   * Driven axes follow the spindle one encoder count behind, and catch up to
+   * the last count over the time the count before it took. This smooths out
+   * the steps between counts instead of sending them in a burst at every edge
+   * Returns how far behind the last count that is, from 0 to -1 counts in the
+   * direction of travel
+   */
+  float getInterpolationOffset();
+  /**
+   * Counts further apart than `maxPeriod` microseconds aren't interpolated,
+   * the spindle is starting or stopping. 0 disables interpolation
+   */
+  void setInterpolationMaxPeriod(uint32_t maxPeriod);
+  /**
+   * How fast the spindle is turning in encoder counts per second, measured
+   * between the last two counts and falling off once the next one is overdue.
+   * Always positive, 0 until the spindle has moved
+   */
+  float getCountRate();
+
+  /**
+   * The speed a driven spindle runs at while motion is enabled, negative
+   * speeds run it in reverse. Ignored without a driver
+   */
+  void setTargetRPM(float rpm);
+  float getTargetRPM();
+  // the speed the profile is currently commanding
+  float getCommandedRPM();
+  bool isDriven();
+  // a driven spindle is open loop, the expected position is the current one
+  int getExpectedPosition();
+  int getPositionError();
+
+  /**
+   * Called once per index pulse with the spindle position at the moment the
+   * index fired. The first call sets the reference, every call after that
+   * corrects any encoder counts that were gained or lost in the last revolution
+   */
+  void handleIndex(int positionAtIndex);
+  bool isIndexReferenced();
+  // the spindle angle in encoder counts since the index, 0 if unreferenced
+  int getIndexedPosition();
+  // the amount of index pulses seen so far
+  uint32_t getRevolutionCount();
+  // the miscount corrected at the last index pulse
+  int getLastIndexError();
+  uint32_t getIndexCorrections();
+};
@@ -0,0 +1,18 @@
+#include <config.h>
+
+#include <cstdint>
+
+#pragma once
+
+/**
+ * This defines the HW interface for a spindle that is driven by a stepper or
+ * servo we control, abstracted away from the actual calls so we can test it
+ * more easily
+ */
+class SpindleDriverIO {
+ public:
+  virtual void writeStepPin(uint8_t val) = 0;
+  virtual uint8_t readStepPin() = 0;
+  virtual void writeDirPin(uint8_t val) = 0;
+  virtual uint8_t readDirPin() = 0;
+};
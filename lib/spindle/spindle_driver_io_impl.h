@@ -0,0 +1,20 @@
+#include <config.h>
+#include <placement.h>
+
+#include "spindle_driver_io.h"
+#pragma once
+
+class SpindleDriverIOImpl : public SpindleDriverIO {
+ public:
+  ELS_FASTRUN void writeStepPin(uint8_t val) {
+    digitalWriteFast(ELS_SPINDLE_STEP, val);
+  }
+  ELS_FASTRUN uint8_t readStepPin() {
+    return digitalReadFast(ELS_SPINDLE_STEP);
+  }
+
+  ELS_FASTRUN void writeDirPin(uint8_t val) {
+    digitalWriteFast(ELS_SPINDLE_DIR, val);
+  }
+  ELS_FASTRUN uint8_t readDirPin() { return digitalReadFast(ELS_SPINDLE_DIR); }
+};
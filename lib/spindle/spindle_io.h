@@ -0,0 +1,26 @@
+#include <config.h>
+#include <placement.h>
+
+#include <cstdint>
+
+#pragma once
+
+/**
+ * This defines the HW interface for the spindle encoder, abstracted away from
+ * the actual calls so we can test it more easily
+ */
+class SpindleIO {
+ public:
+  // the absolute encoder count, this is never reset
+  virtual int32_t readEncoder() = 0;
+
+  /**
+   * Optional index (Z) channel, fires once per revolution
+   * Returns true once per index pulse, with the absolute encoder count latched
+   * at the moment the pulse arrived. IO without an index doesn't need to
+   * override this
+   */
+  ELS_FASTRUN virtual bool consumeIndex(int32_t* encoderCountAtIndex) {
+    return false;
+  }
+};
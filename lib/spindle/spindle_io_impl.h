@@ -0,0 +1,78 @@
+#include <Encoder.h>
+#include <config.h>
+#include <placement.h>
+
+#include <atomic>
+
+#include "spindle_io.h"
+#pragma once
+
+class SpindleIOImpl : public SpindleIO {
+  Encoder m_encoder;
+
+#ifdef ELS_SPINDLE_ENCODER_INDEX
+  /**
+   * The index interrupt preempts the motion timer, so it can land while the
+   * timer is reading. It only stores the count and then bumps the sequence,
+   * the timer reads the sequence either side of the count and tries again if
+   * it moved, see lib/irq_priority
+   */
+  volatile int32_t m_countAtIndex;
+  std::atomic<uint32_t> m_indexSequence;
+  // the timer's side, the last sequence it handed on
+  uint32_t m_consumedSequence;
+
+  // attachInterrupt can't take a member function
+  static SpindleIOImpl*& instance() {
+    static SpindleIOImpl* instance = nullptr;
+    return instance;
+  }
+
+  static void indexInterrupt() {
+    SpindleIOImpl* io = instance();
+    io->m_countAtIndex = io->m_encoder.read();
+    io->m_indexSequence.fetch_add(1, std::memory_order_release);
+  }
+#endif
+
+ public:
+  SpindleIOImpl()
+      : m_encoder(ELS_SPINDLE_ENCODER_A, ELS_SPINDLE_ENCODER_B) {
+#ifdef ELS_SPINDLE_ENCODER_INDEX
+    m_countAtIndex = 0;
+    m_indexSequence = 0;
+    m_consumedSequence = 0;
+#endif
+  }
+
+  // must be called from setup, after the pin modes have been set
+  void begin() {
+#ifdef ELS_SPINDLE_ENCODER_INDEX
+    instance() = this;
+    attachInterrupt(digitalPinToInterrupt(ELS_SPINDLE_ENCODER_INDEX),
+                    indexInterrupt, RISING);
+#endif
+  }
+
+  ELS_FASTRUN int32_t readEncoder() { return m_encoder.read(); }
+
+#ifdef ELS_SPINDLE_ENCODER_INDEX
+  ELS_FASTRUN bool consumeIndex(int32_t* encoderCountAtIndex) {
+    uint32_t sequence = m_indexSequence.load(std::memory_order_acquire);
+    if (sequence == m_consumedSequence) {
+      return false;
+    }
+    int32_t count = m_countAtIndex;
+    uint32_t after = m_indexSequence.load(std::memory_order_acquire);
+    while (after != sequence) {
+      // another index arrived while we were reading, the newest count wins
+      sequence = after;
+      count = m_countAtIndex;
+      after = m_indexSequence.load(std::memory_order_acquire);
+    }
+    *encoderCountAtIndex = count;
+    m_consumedSequence = sequence;
+    return true;
+  }
+#endif
+};
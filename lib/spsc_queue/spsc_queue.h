@@ -0,0 +1,71 @@
+#include <atomic>
+#include <cstdint>
+
+#pragma once
+
+/**
+ * A wait-free single producer, single consumer ring buffer
+ *
+ * This is used to hand data between an interrupt and the main loop without
+ * having to disable interrupts. Only one context may push and only one context
+ * may pop, otherwise all bets are off.
+ *
+ * Size must be a power of two, one slot is always kept empty to tell a full
+ * queue apart from an empty one
+ */
+template <typename T, uint32_t Size>
+class SpscQueue {
+  static_assert(Size >= 2 && (Size & (Size - 1)) == 0,
+                "SpscQueue size must be a power of two");
+
+ private:
+  T m_buffer[Size];
+
+  // only ever written by the producer
+  std::atomic<uint32_t> m_head;
+  // only ever written by the consumer
+  std::atomic<uint32_t> m_tail;
+
+ public:
+  SpscQueue() : m_head(0), m_tail(0) {}
+
+  // no copying, the indices are shared between contexts
+  SpscQueue(SpscQueue const &) = delete;
+  void operator=(SpscQueue const &) = delete;
+
+  /**
+   * Producer side, returns false if the queue is full and the item was dropped
+   */
+  bool push(const T &item) {
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    uint32_t next = (head + 1) & (Size - 1);
+    if (next == m_tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    m_buffer[head] = item;
+    m_head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side, returns false if there was nothing to pop
+   */
+  bool pop(T *item) {
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    *item = m_buffer[tail];
+    m_tail.store((tail + 1) & (Size - 1), std::memory_order_release);
+    return true;
+  }
+
+  bool isEmpty() {
+    return m_tail.load(std::memory_order_acquire) ==
+           m_head.load(std::memory_order_acquire);
+  }
+
+  uint32_t capacity() { return Size - 1; }
+};
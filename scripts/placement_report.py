@@ -0,0 +1,263 @@
+# Post build report of where the motion path ended up in the Teensy 4.x memory
+# map, see lib/placement/placement.h, and how much RAM each subsystem uses
+#
+# Runs after the firmware is linked and prints the region of every hot function
+# and the state they touch, a copy is written to placement_report.txt in the
+# build directory. Anything in the motion path that isn't in ITCM or DTCM is
+# flagged so it can be fixed before the cycle counts are compared.
+#
+# The hot functions are found from the disassembly, by following every direct
+# call and tail call out of the timer. A call through a vtable can't be
+# followed, so the functions the timer only reaches that way are listed by hand
+#
+# The firmware doesn't use the heap, every object is static, so the RAM usage
+# per subsystem is everything it will ever use
+
+import os
+import re
+import subprocess
+
+Import("env")  # noqa: F821
+
+# name, start, end
+REGIONS = [
+    ("ITCM", 0x00000000, 0x00080000),
+    ("DTCM", 0x20000000, 0x20080000),
+    ("OCRAM", 0x20200000, 0x20280000),
+    ("FLASH", 0x60000000, 0x61000000),
+    ("EXTMEM", 0x70000000, 0x71000000),
+]
+
+# demangled names that start with these are where the motion path starts, the
+# timer and everything it calls through a pointer. Their callees are found by
+# following the calls in the disassembly
+HOT_CODE = [
+    "timerCallback(",
+    # the Axis virtuals the mailbox, handwheel and scope call
+    "Leadscrew::setRatio(",
+    "Leadscrew::getRatio(",
+    "Leadscrew::getCurrentPosition(",
+    "Leadscrew::resetCurrentPosition(",
+    "Leadscrew::incrementCurrentPosition(",
+    "Leadscrew::getExpectedPosition(",
+    "Leadscrew::getPositionError(",
+    "Spindle::incrementCurrentPosition(",
+    "Axis::getCurrentPosition(",
+    # the IO behind the spindle, leadscrew and handwheel
+    "SpindleIO::consumeIndex(",
+    "SpindleIOImpl::readEncoder(",
+    "SpindleIOImpl::consumeIndex(",
+    "SpindleDriverIOImpl::writeStepPin(",
+    "SpindleDriverIOImpl::readStepPin(",
+    "SpindleDriverIOImpl::writeDirPin(",
+    "SpindleDriverIOImpl::readDirPin(",
+    "LeadscrewIO::hasFeedback(",
+    "LeadscrewIO::readFeedbackPosition(",
+    "LeadscrewIOImpl::hasFeedback(",
+    "LeadscrewIOImpl::readFeedbackPosition(",
+    "LeadscrewIOImpl::writeStepPin(",
+    "LeadscrewIOImpl::readStepPin(",
+    "LeadscrewIOImpl::writeDirPin(",
+    "LeadscrewIOImpl::readDirPin(",
+    "HandwheelIOImpl::readEncoder(",
+    # every ElapsedMicros reads its Clock
+    "TickClock::nowMicros(",
+    "SystemClock::nowMicros(",
+]
+# any branch with a symbol as its target, bl for calls and b for tail calls.
+# Jumps inside a function have an offset after the name and are skipped
+BRANCH = re.compile(r"\sb[a-z]*(?:\.[nw])?\s+[0-9a-f]+ <([^>+]+)>$")
+FUNCTION = re.compile(r"^[0-9a-f]+ <([^>]+)>:$")
+# the linker's long branch stubs between ITCM and flash, named after the target
+VENEER = re.compile(r"^__(.+)_veneer$")
+HOT_DATA = [
+    "motionClock",
+    "spindle",
+    "spindleIOImpl",
+    "spindleDriverIOImpl",
+    "leadscrew",
+    "leadscrewIOImpl",
+    "leadscrewAccelCurve",
+    "leadscrewSpareAccelCurve",
+    "handwheel",
+    "handwheelIOImpl",
+    "idleDetector",
+    "motionMailbox",
+    "scope",
+    "timerProfile",
+    "timerLatency",
+]
+# which subsystem the RAM belongs to. Globals are matched by name, entries
+# ending in :: or ( match static members and function statics by prefix
+SUBSYSTEMS = [
+    ("motion", [
+        "spindle", "spindleIOImpl", "spindleDriverIOImpl", "leadscrew",
+        "leadscrewIOImpl", "leadscrewAccelCurve", "leadscrewSpareAccelCurve",
+        "handwheel", "handwheelIOImpl", "scope", "idleDetector",
+        "motionMailbox", "timerProfile", "timerLatency", "timer",
+        "motionClock",
+        "timerCallback(", "Spindle::",
+        "Leadscrew::", "AccelCurve::", "IdleDetector::", "MotionMailbox::",
+    ]),
+    ("display", ["display", "Display::"]),
+    ("buttons", ["keyPad", "ButtonHandler::", "ButtonScanner::"]),
+    ("scheduler", ["scheduler", "Scheduler::"]),
+    ("global state", ["globalState", "GlobalState::", "s_instanceStorage"]),
+]
+# nm types for functions and for symbols that take up RAM
+CODE_TYPES = "tTwW"
+RAM_TYPES = "bBdD"
+FAST_CODE_REGIONS = ["ITCM"]
+FAST_DATA_REGIONS = ["DTCM"]
+
+
+def region_of(address):
+    for name, start, end in REGIONS:
+        if start <= address < end:
+            return name
+    return "?"
+
+
+def read_symbols(nm, elf):
+    output = subprocess.check_output(
+        [nm, "-C", "--defined-only", "--print-size", elf], text=True)
+    symbols = []
+    for line in output.splitlines():
+        # address size type name, the name can have spaces in it
+        parts = line.split(None, 3)
+        if len(parts) != 4:
+            continue
+        address, size, symbolType, name = parts
+        symbols.append((name, int(address, 16), int(size, 16), symbolType))
+    return symbols
+
+
+# every function in the ELF and the functions it branches to, all mangled
+def read_calls(objdump, elf):
+    output = subprocess.check_output(
+        [objdump, "-d", "--no-show-raw-insn", elf], text=True)
+    calls = {}
+    current = None
+    for line in output.splitlines():
+        match = FUNCTION.match(line)
+        if match:
+            current = calls.setdefault(match.group(1), set())
+            continue
+        match = BRANCH.search(line)
+        if match and current is not None:
+            target = match.group(1)
+            veneer = VENEER.match(target)
+            current.add(veneer.group(1) if veneer else target)
+    return calls
+
+
+# one c++filt for every name, it prints them back in the same order
+def demangle(cxxfilt, names):
+    names = sorted(names)
+    output = subprocess.run([cxxfilt], input="\n".join(names), text=True,
+                            capture_output=True, check=True).stdout
+    return dict(zip(names, output.splitlines()))
+
+
+# the demangled names of the roots in HOT_CODE and everything they call
+def find_hot_code(calls, demangled):
+    pending = [name for name in calls if any(
+        demangled.get(name, name).startswith(hot) for hot in HOT_CODE)]
+    hot = set()
+    while pending:
+        name = pending.pop()
+        if name in hot:
+            continue
+        hot.add(name)
+        pending.extend(calls.get(name, ()))
+    return {demangled.get(name, name) for name in hot}
+
+
+def is_library_code(name):
+    # C functions demangle without a parameter list, our code is all C++
+    return "(" not in name or name.startswith(("std::", "__"))
+
+
+def build_report(symbols, hotCode):
+    lines = []
+    misplaced = 0
+    library = 0
+
+    def add(name, address, size, wanted):
+        nonlocal misplaced, library
+        region = region_of(address)
+        flag = ""
+        if region not in wanted:
+            flag = "  <-- expected " + "/".join(wanted)
+            misplaced += 1
+            if is_library_code(name):
+                flag += ", library code"
+                library += 1
+        lines.append("  %-8s 0x%08x %6d  %s%s" %
+                     (region, address, size, name, flag))
+
+    lines.append("Motion path code:")
+    for name, address, size, symbolType in symbols:
+        if symbolType in CODE_TYPES and name in hotCode:
+            add(name, address, size, FAST_CODE_REGIONS)
+
+    lines.append("Motion path data:")
+    for name, address, size, _ in symbols:
+        if name in HOT_DATA:
+            add(name, address, size, FAST_DATA_REGIONS)
+
+    lines.append("%d symbol(s) outside tightly coupled memory, %d of them "
+                 "library code that can't be moved" % (misplaced, library))
+    lines.append("")
+    lines.extend(ram_report(symbols))
+    return "\n".join(lines)
+
+
+def subsystem_of(name):
+    for subsystem, prefixes in SUBSYSTEMS:
+        for prefix in prefixes:
+            if name == prefix or (prefix.endswith(("::", "(")) and
+                                  name.startswith(prefix)):
+                return subsystem
+    return "core and libraries"
+
+
+def ram_report(symbols):
+    # subsystem -> region -> bytes
+    usage = {}
+    heap = False
+    for name, address, size, symbolType in symbols:
+        if name in ("malloc", "_malloc_r"):
+            heap = True
+        if symbolType not in RAM_TYPES:
+            continue
+        regions = usage.setdefault(subsystem_of(name), {})
+        region = region_of(address)
+        regions[region] = regions.get(region, 0) + size
+
+    lines = ["RAM usage by subsystem (bytes):"]
+    for subsystem in [s for s, _ in SUBSYSTEMS] + ["core and libraries"]:
+        regions = usage.get(subsystem, {})
+        detail = ", ".join("%s %d" % (region, regions[region])
+                           for region in sorted(regions))
+        lines.append(("  %-20s %7d  %s" %
+                      (subsystem, sum(regions.values()), detail)).rstrip())
+    # malloc can still be linked in by the core, it just shouldn't be called
+    lines.append("malloc linked in: %s" % ("yes" if heap else "no"))
+    return lines
+
+
+def placement_report(source, target, env):
+    elf = str(target[0])
+    tool = env.subst("$CC")
+    calls = read_calls(tool.replace("gcc", "objdump"), elf)
+    demangled = demangle(tool.replace("gcc", "c++filt"), calls.keys())
+    report = build_report(read_symbols(tool.replace("gcc", "nm"), elf),
+                          find_hot_code(calls, demangled))
+    print(report)
+    with open(os.path.join(env.subst("$BUILD_DIR"),
+                           "placement_report.txt"), "w") as out:
+        out.write(report + "\n")
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", placement_report)  # noqa: F821
@@ -1,140 +1,182 @@
 #include "buttons.h"
 
+#include <Arduino.h>
 #include <config.h>
 #include <globalstate.h>
+#include <placement.h>
 
-ButtonHandler::ButtonHandler(Spindle* spindle, Leadscrew* leadscrew)
+ButtonHandler::ButtonHandler(Spindle* spindle, Leadscrew* leadscrew,
+                             MotionMailbox* mailbox)
     : m_spindle(spindle),
       m_leadscrew(leadscrew),
-      m_rateIncrease(ELS_RATE_INCREASE_BUTTON),
-      m_rateDecrease(ELS_RATE_DECREASE_BUTTON),
-      m_modeCycle(ELS_MODE_CYCLE_BUTTON),
-      m_threadSync(ELS_THREAD_SYNC_BUTTON),
-      m_halfNut(ELS_HALF_NUT_BUTTON),
-      m_enable(ELS_ENABLE_BUTTON),
-      m_lock(ELS_LOCK_BUTTON),
-      m_jogLeft(ELS_JOG_LEFT_BUTTON),
-      m_jogRight(ELS_JOG_RIGHT_BUTTON) {
-  Button setHeldTime(50);
-  Button setClickTime(200);
+      m_mailbox(mailbox),
+      m_handwheel(nullptr),
+      m_calibration(nullptr),
+      m_scanner((ELS_BUTTON_HELD_MS * 1000) / ELS_BUTTON_SAMPLE_US,
+                (ELS_BUTTON_DOUBLE_CLICK_MS * 1000) / ELS_BUTTON_SAMPLE_US) {}
+
+void ButtonHandler::setHandwheel(Handwheel* handwheel) {
+  m_handwheel = handwheel;
 }
 
-void ButtonHandler::handle() {
-  // update the state of the application based on the button state
-  rateIncreaseHandler();
-  rateDecreaseHandler();
-  modeCycleHandler();
-  threadSyncHandler();
-  halfNutHandler();
-  enableHandler();
-  lockHandler();
-  jogHandler();
+void ButtonHandler::setCalibration(Calibration* calibration) {
+  m_calibration = calibration;
 }
 
-void ButtonHandler::rateIncreaseHandler() {
-  m_rateIncrease.handle();
+ELS_FASTRUN void ButtonHandler::sample() {
+  // buttons are pulled up, so a low pin means the button is pressed
+  uint32_t mask = 0;
+  mask |= !digitalReadFast(ELS_RATE_INCREASE_BUTTON) << RATE_INCREASE;
+  mask |= !digitalReadFast(ELS_RATE_DECREASE_BUTTON) << RATE_DECREASE;
+  mask |= !digitalReadFast(ELS_MODE_CYCLE_BUTTON) << MODE_CYCLE;
+  mask |= !digitalReadFast(ELS_THREAD_SYNC_BUTTON) << THREAD_SYNC;
+  mask |= !digitalReadFast(ELS_HALF_NUT_BUTTON) << HALF_NUT;
+  mask |= !digitalReadFast(ELS_ENABLE_BUTTON) << ENABLE;
+  mask |= !digitalReadFast(ELS_LOCK_BUTTON) << LOCK;
+  mask |= !digitalReadFast(ELS_JOG_LEFT_BUTTON) << JOG_LEFT;
+  mask |= !digitalReadFast(ELS_JOG_RIGHT_BUTTON) << JOG_RIGHT;
+#ifdef ELS_MPG_MULTIPLIER_BUTTON
+  mask |= !digitalReadFast(ELS_MPG_MULTIPLIER_BUTTON) << MPG_MULTIPLIER;
+#endif
+
+  m_scanner.sample(mask);
+}
 
-  GlobalButtonLock lockState = GlobalState::getInstance()->getButtonLock();
-  if (lockState == GlobalButtonLock::LOCKED) {
-    m_rateIncrease.resetClicked();
-    m_rateIncrease.resetSingleClicked();
-    m_rateIncrease.resetDoubleClicked();
+void ButtonHandler::handle() {
+  // update the state of the application based on the queued button events
+  ButtonEvent event;
+  while (m_scanner.popEvent(&event)) {
+    // the lock button is the only one that works while locked
+    if (event.button == LOCK) {
+      lockHandler(event.type);
+      continue;
+    }
 
-    return;
+    if (GlobalState::getInstance()->getButtonLock() ==
+        GlobalButtonLock::LOCKED) {
+      continue;
+    }
+
+    if (isCalibrating()) {
+      calibrationHandler(event);
+      continue;
+    }
+
+    switch (event.button) {
+      case RATE_INCREASE:
+        rateIncreaseHandler(event.type);
+        break;
+      case RATE_DECREASE:
+        rateDecreaseHandler(event.type);
+        break;
+      case MODE_CYCLE:
+        modeCycleHandler(event.type);
+        break;
+      case THREAD_SYNC:
+        threadSyncHandler(event.type);
+        break;
+      case HALF_NUT:
+        halfNutHandler(event.type);
+        break;
+      case ENABLE:
+        enableHandler(event.type);
+        break;
+      case JOG_LEFT:
+        if (event.type == ButtonEventType::DOUBLE_CLICKED) {
+          jogStopHandler(JogDirection::LEFT);
+        }
+        break;
+      case JOG_RIGHT:
+        if (event.type == ButtonEventType::DOUBLE_CLICKED) {
+          jogStopHandler(JogDirection::RIGHT);
+        }
+        break;
+      case MPG_MULTIPLIER:
+        mpgMultiplierHandler(event.type);
+        break;
+    }
   }
 
-  if (m_rateIncrease.resetSingleClicked()) {
+  jogHandler();
+}
+
+void ButtonHandler::rateIncreaseHandler(ButtonEventType event) {
+  if (event == ButtonEventType::SINGLE_CLICKED) {
     GlobalState::getInstance()->nextFeedPitch();
-    m_leadscrew->setRatio(GlobalState::getInstance()->getCurrentFeedPitch());
+    m_mailbox->postChangeRatio(
+        GlobalState::getInstance()->getCurrentFeedPitch());
   }
 }
 
-void ButtonHandler::printState() {
-  Serial.print("Enable: ");
-  if (m_enable.isHeld()) {
+void ButtonHandler::printButtonState(ButtonBit button) {
+  uint32_t bit = 1u << button;
+  if (m_scanner.getHeldMask() & bit) {
     Serial.println("held");
-  } else if (m_enable.isPressed()) {
+  } else if (m_scanner.getPressedMask() & bit) {
     Serial.println("pressed");
-  } else if (m_enable.isDoubleClicked()) {
-    Serial.println("double clicked");
   } else {
     Serial.println("released");
   }
+}
+
+void ButtonHandler::printState() {
+  Serial.print("Enable: ");
+  printButtonState(ENABLE);
   Serial.print("Left jog: ");
-  if (m_jogLeft.isHeld()) {
-    Serial.println("held");
-  } else if (m_jogLeft.isPressed()) {
-    Serial.println("pressed");
-  } else if (m_jogLeft.isDoubleClicked()) {
-    Serial.println("double clicked");
-  } else {
-    Serial.println("released");
-  }
+  printButtonState(JOG_LEFT);
   Serial.print("Right jog: ");
-  if (m_jogRight.isHeld()) {
-    Serial.println("held");
-  } else if (m_jogRight.isPressed()) {
-    Serial.println("pressed");
-  } else if (m_jogRight.isDoubleClicked()) {
-    Serial.println("double clicked");
-  } else {
-    Serial.println("released");
-  }
+  printButtonState(JOG_RIGHT);
+  Serial.print("Dropped button events: ");
+  Serial.println(m_scanner.getDroppedEvents());
 }
 
-void ButtonHandler::rateDecreaseHandler() {
-  m_rateDecrease.handle();
-
-  GlobalButtonLock lockState = GlobalState::getInstance()->getButtonLock();
-  if (lockState == GlobalButtonLock::LOCKED) {
-    m_rateDecrease.resetClicked();
-    m_rateDecrease.resetSingleClicked();
-    m_rateDecrease.resetDoubleClicked();
-    return;
-  }
-
-  if (m_rateDecrease.resetSingleClicked()) {
+void ButtonHandler::rateDecreaseHandler(ButtonEventType event) {
+  if (event == ButtonEventType::SINGLE_CLICKED) {
     GlobalState::getInstance()->prevFeedPitch();
-    m_leadscrew->setRatio(GlobalState::getInstance()->getCurrentFeedPitch());
+    m_mailbox->postChangeRatio(
+        GlobalState::getInstance()->getCurrentFeedPitch());
   }
 }
 
-void ButtonHandler::halfNutHandler() {
-  m_halfNut.handle();
+void ButtonHandler::halfNutHandler(ButtonEventType event) {
+  GlobalState* globalState = GlobalState::getInstance();
 
-  GlobalButtonLock lockState = GlobalState::getInstance()->getButtonLock();
-  if (lockState == GlobalButtonLock::LOCKED) {
-    m_halfNut.resetClicked();
-    m_halfNut.resetSingleClicked();
-    m_halfNut.resetDoubleClicked();
+  // the half nut button picks the multi-start thread settings, which can't
+  // change in the middle of a pass
+  if (globalState->getFeedMode() != GlobalFeedMode::THREAD ||
+      globalState->getMotionMode() == GlobalMotionMode::ENABLED) {
     return;
   }
 
-  // honestly I don't know what this button should do after the refactor...
-
-  /*if (event == Button::SINGLE_CLICKED_EVENT &&
-      globalState->getFeedMode() == GlobalFeedMode::THREAD) {
-    readyToThread = true;
-    globalState->setMotionMode(GlobalMotionMode::ENABLED);
-    globalState->setThreadSyncState(GlobalThreadSyncState::SYNC);
-    pulsesBackToSync = 0;
-  }*/
+  // clicking cycles the amount of starts, holding skips to the next start.
+  // The timer moves on a start after every pass, so it owns the pass counter
+  if (event == ButtonEventType::SINGLE_CLICKED) {
+    m_mailbox->postSetThreadStarts(globalState->nextThreadStarts());
+  }
+  if (event == ButtonEventType::HELD) {
+    m_mailbox->postNextThreadStart();
+  }
 }
 
-void ButtonHandler::enableHandler() {
-  m_enable.handle();
-
-  GlobalButtonLock lockState = GlobalState::getInstance()->getButtonLock();
+void ButtonHandler::enableHandler(ButtonEventType event) {
   GlobalMotionMode motionMode = GlobalState::getInstance()->getMotionMode();
-  if (lockState == GlobalButtonLock::LOCKED) {
-    m_enable.resetClicked();
-    m_enable.resetSingleClicked();
-    m_enable.resetDoubleClicked();
-    return;
+
+  // holding enable with motion disabled calibrates between the stops
+  if (event == ButtonEventType::HELD && m_calibration != nullptr &&
+      motionMode == GlobalMotionMode::DISABLED) {
+    m_calibration->start();
   }
 
-  if (m_enable.resetClicked()) {
+  if (event == ButtonEventType::CLICKED) {
     Serial.println("Enable button clicked");
+
+    // a stall has to be acknowledged before anything is allowed to move again
+    if (m_leadscrew->isStalled()) {
+      m_mailbox->postClearStall();
+      GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+      return;
+    }
+
     if (motionMode == GlobalMotionMode::ENABLED) {
       GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
     }
@@ -144,12 +186,10 @@ void ButtonHandler::enableHandler() {
   }
 }
 
-void ButtonHandler::lockHandler() {
-  m_lock.handle();
-
+void ButtonHandler::lockHandler(ButtonEventType event) {
   GlobalState* globalState = GlobalState::getInstance();
 
-  if (m_lock.resetClicked()) {
+  if (event == ButtonEventType::CLICKED) {
     if (globalState->getButtonLock() == GlobalButtonLock::LOCKED) {
       globalState->setButtonLock(GlobalButtonLock::UNLOCKED);
     } else {
@@ -158,18 +198,41 @@ void ButtonHandler::lockHandler() {
   }
 }
 
-void ButtonHandler::threadSyncHandler() {
-  m_threadSync.handle();
+void ButtonHandler::mpgMultiplierHandler(ButtonEventType event) {
+  if (m_handwheel != nullptr && event == ButtonEventType::CLICKED) {
+    m_handwheel->nextMultiplier();
+  }
+}
 
-  GlobalButtonLock lockState = GlobalState::getInstance()->getButtonLock();
-  if (lockState == GlobalButtonLock::LOCKED) {
-    m_threadSync.resetClicked();
-    m_threadSync.resetSingleClicked();
-    m_threadSync.resetDoubleClicked();
+void ButtonHandler::calibrationHandler(const ButtonEvent& event) {
+  if (event.type != ButtonEventType::CLICKED) {
     return;
   }
 
-  if (m_threadSync.resetClicked()) {
+  // after a trial enable means the carriage came back to its mark and mode
+  // cycle means it didn't, the rest of the time enable aborts
+  switch (event.button) {
+    case ENABLE:
+      if (m_calibration->isWaitingForOperator()) {
+        m_calibration->confirm(true);
+      } else {
+        m_calibration->abort();
+      }
+      break;
+    case MODE_CYCLE:
+      if (m_calibration->isWaitingForOperator()) {
+        m_calibration->confirm(false);
+      }
+      break;
+  }
+}
+
+bool ButtonHandler::isCalibrating() {
+  return m_calibration != nullptr && m_calibration->isRunning();
+}
+
+void ButtonHandler::threadSyncHandler(ButtonEventType event) {
+  if (event == ButtonEventType::CLICKED) {
     if (GlobalState::getInstance()->getMotionMode() ==
         GlobalMotionMode::ENABLED) {
       GlobalState::getInstance()->setThreadSyncState(
@@ -181,111 +244,117 @@ void ButtonHandler::threadSyncHandler() {
   }
 }
 
-void ButtonHandler::modeCycleHandler() {
-  m_modeCycle.handle();
-
+void ButtonHandler::modeCycleHandler(ButtonEventType event) {
   GlobalState* globalState = GlobalState::getInstance();
-  GlobalButtonLock lockState = globalState->getButtonLock();
-
-  if (lockState == GlobalButtonLock::LOCKED) {
-    m_modeCycle.resetClicked();
-    m_modeCycle.resetSingleClicked();
-    m_modeCycle.resetDoubleClicked();
-    return;
-  }
 
   // pressing mode button swaps between feed and thread
-  if (m_modeCycle.resetClicked()) {
-    switch (GlobalState::getInstance()->getFeedMode()) {
+  if (event == ButtonEventType::CLICKED) {
+    switch (globalState->getFeedMode()) {
       case GlobalFeedMode::FEED:
-        GlobalState::getInstance()->setFeedMode(GlobalFeedMode::THREAD);
+        globalState->setFeedMode(GlobalFeedMode::THREAD);
         break;
       case GlobalFeedMode::THREAD:
-        GlobalState::getInstance()->setFeedMode(GlobalFeedMode::FEED);
+        globalState->setFeedMode(GlobalFeedMode::FEED);
         break;
     }
-    m_leadscrew->setRatio(globalState->getCurrentFeedPitch());
+    m_mailbox->postChangeRatio(globalState->getCurrentFeedPitch());
   }
 
   // holding mode button swaps between metric and imperial
-  if (m_modeCycle.isHeld()) {
-    switch (GlobalState::getInstance()->getUnitMode()) {
+  if (event == ButtonEventType::HELD) {
+    switch (globalState->getUnitMode()) {
       case GlobalUnitMode::METRIC:
-        GlobalState::getInstance()->setUnitMode(GlobalUnitMode::IMPERIAL);
+        globalState->setUnitMode(GlobalUnitMode::IMPERIAL);
         break;
       case GlobalUnitMode::IMPERIAL:
-        GlobalState::getInstance()->setUnitMode(GlobalUnitMode::METRIC);
+        globalState->setUnitMode(GlobalUnitMode::METRIC);
         break;
     }
-    m_leadscrew->setRatio(globalState->getCurrentFeedPitch());
+    m_mailbox->postChangeRatio(globalState->getCurrentFeedPitch());
   }
 }
 
-void ButtonHandler::jogDirectionHandler(JogDirection direction) {
-  GlobalState* globalState = GlobalState::getInstance();
-  GlobalButtonLock lockState = globalState->getButtonLock();
-  GlobalMotionMode motionMode = globalState->getMotionMode();
-
-  Button* jogButton =
-      direction == JogDirection::LEFT ? &m_jogLeft : &m_jogRight;
-
-  // no jogging functionality allowed during lock or enable
-  if (lockState == GlobalButtonLock::LOCKED ||
-      motionMode == GlobalMotionMode::ENABLED) {
-    jogButton->resetClicked();
-    jogButton->resetSingleClicked();
-    jogButton->resetDoubleClicked();
+void ButtonHandler::jogStopHandler(JogDirection direction) {
+  // no setting stops during enable
+  if (GlobalState::getInstance()->getMotionMode() ==
+      GlobalMotionMode::ENABLED) {
     return;
   }
 
-  if (jogButton->isDoubleClicked()) {
-    switch (direction) {
-      case JogDirection::LEFT:
-        if (m_leadscrew->getStopPositionState(Leadscrew::StopPosition::LEFT) ==
-            LeadscrewStopState::UNSET) {
-          m_leadscrew->setStopPosition(Leadscrew::StopPosition::LEFT,
+  switch (direction) {
+    case JogDirection::LEFT:
+      if (m_leadscrew->getStopPositionState(Leadscrew::StopPosition::LEFT) ==
+          LeadscrewStopState::UNSET) {
+        m_mailbox->postSetStopPosition(Leadscrew::StopPosition::LEFT,
                                        m_leadscrew->getCurrentPosition());
-        } else {
-          m_leadscrew->unsetStopPosition(Leadscrew::StopPosition::LEFT);
-        }
-        break;
-      case JogDirection::RIGHT:
-        if (m_leadscrew->getStopPositionState(Leadscrew::StopPosition::RIGHT) ==
-            LeadscrewStopState::UNSET) {
-          m_leadscrew->setStopPosition(Leadscrew::StopPosition::RIGHT,
+      } else {
+        m_mailbox->postUnsetStopPosition(Leadscrew::StopPosition::LEFT);
+      }
+      break;
+    case JogDirection::RIGHT:
+      if (m_leadscrew->getStopPositionState(Leadscrew::StopPosition::RIGHT) ==
+          LeadscrewStopState::UNSET) {
+        m_mailbox->postSetStopPosition(Leadscrew::StopPosition::RIGHT,
                                        m_leadscrew->getCurrentPosition());
-        } else {
-          m_leadscrew->unsetStopPosition(Leadscrew::StopPosition::RIGHT);
-        }
-        break;
-    }
-    jogButton->resetDoubleClicked();
+      } else {
+        m_mailbox->postUnsetStopPosition(Leadscrew::StopPosition::RIGHT);
+      }
+      break;
   }
+}
 
-  static elapsedMicros jogTimer;
-
-  if (jogButton->isHeld() &&
-      jogTimer > JOG_PULSE_DELAY * m_leadscrew->getRatio()) {
+void ButtonHandler::jogDirectionHandler(JogDirection direction) {
+  GlobalState* globalState = GlobalState::getInstance();
+  uint32_t jogBit = 1u << (direction == JogDirection::LEFT ? JOG_LEFT
+                                                           : JOG_RIGHT);
+  JogPacer& pacer = direction == JogDirection::LEFT ? m_jogLeft : m_jogRight;
+
+  // the buttons are handled every few jog pulses, so send them all at once
+  int positions = pacer.update(m_scanner.getHeldMask() & jogBit,
+                               JOG_PULSE_DELAY * m_leadscrew->getRatio());
+  if (positions > 0) {
     globalState->setMotionMode(GlobalMotionMode::JOG);
     globalState->setThreadSyncState(GlobalThreadSyncState::UNSYNC);
 
-    jogTimer -= JOG_PULSE_DELAY * m_leadscrew->getRatio();
-    m_leadscrew->incrementCurrentPosition(direction);
+    m_mailbox->postIncrementCurrentPosition(direction * positions);
   }
 }
 
 void ButtonHandler::jogHandler() {
-  GlobalMotionMode motionMode = GlobalState::getInstance()->getMotionMode();
-  m_jogLeft.handle();
-  m_jogRight.handle();
+  GlobalState* globalState = GlobalState::getInstance();
+  GlobalMotionMode motionMode = globalState->getMotionMode();
 
-  jogDirectionHandler(JogDirection::LEFT);
-  jogDirectionHandler(JogDirection::RIGHT);
+  // no jogging functionality allowed during lock or enable. A calibration
+  // only lets the carriage be jogged back to its mark after a trial
+  bool calibrating = isCalibrating();
+  bool jogAllowed =
+      globalState->getButtonLock() == GlobalButtonLock::UNLOCKED &&
+      motionMode != GlobalMotionMode::ENABLED &&
+      (!calibrating || m_calibration->isWaitingForOperator());
+  if (jogAllowed) {
+    jogDirectionHandler(JogDirection::LEFT);
+    jogDirectionHandler(JogDirection::RIGHT);
+  } else {
+    // a button held through a lock starts jogging from scratch afterwards
+    m_jogLeft.update(false, JOG_PULSE_DELAY);
+    m_jogRight.update(false, JOG_PULSE_DELAY);
+  }
 
   // common jog functionality
-  // if neither jog button is held, reset the motion mode
-  if (!m_jogLeft.isHeld() && !m_jogRight.isHeld() &&
-      motionMode == GlobalMotionMode::JOG) {
-    GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+  // the handwheel only asks for a jog from the timer, the motion mode is only
+  // ever changed from the loop so a click can't race it
+  bool handwheelJogging = m_handwheel != nullptr && m_handwheel->isJogging();
+  if (jogAllowed && handwheelJogging &&
+      motionMode == GlobalMotionMode::DISABLED) {
+    globalState->setMotionMode(GlobalMotionMode::JOG);
+    globalState->setThreadSyncState(GlobalThreadSyncState::UNSYNC);
+  }
+
+  // if neither jog button is held, reset the motion mode. The handwheel's
+  // jog is over once the leadscrew has caught up with it
+  uint32_t jogMask = (1u << JOG_LEFT) | (1u << JOG_RIGHT);
+  if (!(m_scanner.getHeldMask() & jogMask) && !handwheelJogging &&
+      !calibrating && motionMode == GlobalMotionMode::JOG) {
+    globalState->setMotionMode(GlobalMotionMode::DISABLED);
   }
 }
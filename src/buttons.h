@@ -1,41 +1,72 @@
-#include <AbleButtons.h>
+#include <button_scanner.h>
+#include <calibration.h>
+#include <handwheel.h>
+#include <jog_pacer.h>
 #include <leadscrew.h>
+#include <motion_mailbox.h>
 #include <spindle.h>
 
-using Button = AblePullupDoubleClickerButton;
-using ButtonList = AblePullupDoubleClickerButtonList;
-
 class ButtonHandler {
  private:
   Spindle *m_spindle;
   Leadscrew *m_leadscrew;
+  // every change to the leadscrew goes through here to the motion timer
+  MotionMailbox *m_mailbox;
+  Handwheel *m_handwheel;
+  Calibration *m_calibration;
+
+  ButtonScanner m_scanner;
+  JogPacer m_jogLeft;
+  JogPacer m_jogRight;
+
+  // the bit of each button in the scanner masks
+  enum ButtonBit {
+    RATE_INCREASE,
+    RATE_DECREASE,
+    MODE_CYCLE,
+    THREAD_SYNC,
+    HALF_NUT,
+    ENABLE,
+    LOCK,
+    JOG_LEFT,
+    JOG_RIGHT,
+    MPG_MULTIPLIER
+  };
 
-  Button m_rateIncrease;
-  Button m_rateDecrease;
-  Button m_modeCycle;
-  Button m_threadSync;
-  Button m_halfNut;
-  Button m_enable;
-  Button m_lock;
-  Button m_jogLeft;
-  Button m_jogRight;
-
-  void rateIncreaseHandler();
-  void rateDecreaseHandler();
-  void modeCycleHandler();
-  void threadSyncHandler();
-  void halfNutHandler();
-  void enableHandler();
-  void lockHandler();
+  void rateIncreaseHandler(ButtonEventType event);
+  void rateDecreaseHandler(ButtonEventType event);
+  void modeCycleHandler(ButtonEventType event);
+  void threadSyncHandler(ButtonEventType event);
+  void halfNutHandler(ButtonEventType event);
+  void enableHandler(ButtonEventType event);
+  void lockHandler(ButtonEventType event);
+  void mpgMultiplierHandler(ButtonEventType event);
+  // takes every button but lock while a calibration runs
+  void calibrationHandler(const ButtonEvent &event);
+  bool isCalibrating();
 
   enum JogDirection { LEFT = -1, RIGHT = 1 };
 
+  void jogStopHandler(JogDirection direction);
   void jogDirectionHandler(JogDirection direction);
   void jogHandler();
 
+  void printButtonState(ButtonBit button);
+
  public:
-  ButtonHandler(Spindle *spindle, Leadscrew *leadscrew);
+  ButtonHandler(Spindle *spindle, Leadscrew *leadscrew,
+                MotionMailbox *mailbox);
+
+  // the handwheel is optional, without one the multiplier button does nothing
+  void setHandwheel(Handwheel *handwheel);
+  // without one holding enable does nothing
+  void setCalibration(Calibration *calibration);
 
+  /**
+   * Reads all the button pins into a single mask and feeds the scanner
+   * Must be called every ELS_BUTTON_SAMPLE_US, usually from the timer
+   */
+  void sample();
   void handle();
   void printState();
 };
@@ -2,10 +2,34 @@
 
 #include <SPI.h>
 #include <Wire.h>
+#include <accel_curve.h>
+#ifndef ACCEL_DISABLED
+#include <calibration.h>
+#include <calibration_store_impl.h>
+#endif
+#include <clock.h>
+#include <cycle_profile.h>
 #include <globalstate.h>
+#ifdef ELS_MPG_ENCODER_A
+#include <handwheel.h>
+#include <handwheel_io_impl.h>
+#endif
+#include <idle_detector.h>
+#include <irq_priority.h>
 #include <leadscrew.h>
 #include <leadscrew_io_impl.h>
+#include <motion_mailbox.h>
+#include <placement.h>
+#include <scheduler.h>
+#ifdef ELS_SCOPE
+#include <scope.h>
+#endif
 #include <spindle.h>
+#ifdef ELS_SPINDLE_DRIVEN
+#include <spindle_driver_io_impl.h>
+#else
+#include <spindle_io_impl.h>
+#endif
 
 #include "buttons.h"
 #include "config.h"
@@ -14,24 +38,171 @@
 IntervalTimer timer;
 
 GlobalState* globalState = GlobalState::getInstance();
+// everything the motion timer touches is kept in DTCM, see placement.h
+// the motion timer reads the time once a tick and everything it runs uses that
+ELS_FASTDATA TickClock motionClock(SystemClock::getInstance());
 #ifdef ELS_SPINDLE_DRIVEN
-Spindle spindle;
+ELS_FASTDATA SpindleDriverIOImpl spindleDriverIOImpl;
+ELS_FASTDATA Spindle spindle(&spindleDriverIOImpl, SPINDLE_START_VELOCITY,
+                             SPINDLE_ACCELERATION, globalState, &motionClock);
 #else
-Spindle spindle(ELS_SPINDLE_ENCODER_A, ELS_SPINDLE_ENCODER_B);
-#endif
-LeadscrewIOImpl leadscrewIOImpl;
-Leadscrew leadscrew(&spindle, &leadscrewIOImpl,
-                    LEADSCREW_INITIAL_PULSE_DELAY_US,
-                    LEADSCREW_PULSE_DELAY_STEP_US, ELS_LEADSCREW_STEPPER_PPR,
-                    ELS_LEADSCREW_PITCH_MM);
-ButtonHandler keyPad(&spindle, &leadscrew);
+ELS_FASTDATA SpindleIOImpl spindleIOImpl;
+ELS_FASTDATA Spindle spindle(&spindleIOImpl, globalState, &motionClock);
+#endif
+ELS_FASTDATA LeadscrewIOImpl leadscrewIOImpl;
+ELS_FASTDATA Leadscrew leadscrew(&spindle, &leadscrewIOImpl,
+                                 LEADSCREW_INITIAL_PULSE_DELAY_US,
+                                 LEADSCREW_PULSE_DELAY_STEP_US,
+                                 ELS_LEADSCREW_STEPPER_PPR,
+                                 ELS_LEADSCREW_PITCH_MM, globalState,
+                                 &motionClock);
+ELS_FASTDATA AccelCurve leadscrewAccelCurve(
+    leadscrewAccelCurveVelocity, leadscrewAccelCurveAccel,
+    ARRAY_SIZE(leadscrewAccelCurveVelocity), ELS_LEADSCREW_STEPS_PER_MM,
+    LEADSCREW_INITIAL_PULSE_DELAY_US, LEADSCREW_TIMER_US * 2);
+#ifndef ACCEL_DISABLED
+// calibration builds new limits here while the timer uses the other curve
+ELS_FASTDATA AccelCurve leadscrewSpareAccelCurve(
+    leadscrewAccelCurveVelocity, leadscrewAccelCurveAccel,
+    ARRAY_SIZE(leadscrewAccelCurveVelocity), ELS_LEADSCREW_STEPS_PER_MM,
+    LEADSCREW_INITIAL_PULSE_DELAY_US, LEADSCREW_TIMER_US * 2);
+#endif
+#ifdef ELS_MPG_ENCODER_A
+ELS_FASTDATA HandwheelIOImpl handwheelIOImpl;
+ELS_FASTDATA Handwheel handwheel(&handwheelIOImpl, &leadscrew,
+                                 ELS_MPG_COUNTS_PER_DETENT, MPG_PULSE_DELAY,
+                                 ELS_MPG_MAX_BACKLOG, globalState,
+                                 &motionClock);
+#endif
+// the loop changes the leadscrew through here, the timer applies the changes
+ELS_FASTDATA MotionMailbox motionMailbox;
+ButtonHandler keyPad(&spindle, &leadscrew, &motionMailbox);
 Display display(&spindle, &leadscrew);
+Scheduler scheduler;
+#ifndef ACCEL_DISABLED
+CalibrationStoreImpl calibrationStore;
+Calibration calibration(
+    &leadscrew, &motionMailbox, &calibrationStore, &leadscrewAccelCurve,
+    &leadscrewSpareAccelCurve,
+    {{ELS_CALIBRATION_START_ACCEL, ELS_CALIBRATION_START_SPEED},
+     {ELS_CALIBRATION_MAX_ACCEL, ELS_CALIBRATION_MAX_SPEED},
+     ELS_CALIBRATION_GROWTH,
+     ELS_CALIBRATION_REFINE_STEPS,
+     ELS_CALIBRATION_PASSES,
+     ELS_CALIBRATION_MARGIN},
+    ELS_LEADSCREW_STEPS_PER_MM, LEADSCREW_TIMER_US * 2);
+#endif
+ELS_FASTDATA IdleDetector idleDetector(LEADSCREW_TIMER_US, ELS_IDLE_TIMER_US,
+                                       ELS_IDLE_AFTER_US);
+#ifdef ELS_SCOPE
+ELS_FASTDATA Scope scope(&spindle, &leadscrew, globalState, &motionClock);
+const ScopeChannel scopeChannels[] = ELS_SCOPE_CHANNELS;
+
+void armScope() {
+  scope.arm(ELS_SCOPE_TRIGGER, ELS_SCOPE_THRESHOLD,
+            scope.getDepth() * ELS_SCOPE_PRE_TRIGGER_PERCENT / 100);
+}
+#endif
+// how long the timer callback takes, printed with the telemetry
+ELS_FASTDATA CycleProfile timerProfile;
+// how late it starts, i.e. what the encoder interrupts cost the step edges
+ELS_FASTDATA TickLatencyProfile timerLatency;
 
 // have to handle the leadscrew updates in a timer callback so we can update the
-// screen independently without losing pulses
-void timerCallback() {
+// screen independently without losing pulses. A driven spindle is stepped in
+// the same pass, so the leadscrew follows its pulses with no delay
+ELS_FASTRUN void timerCallback() {
+  timerProfile.start();
+  uint32_t tickUs = idleDetector.getTickUs();
+  timerLatency.tick(tickUs * getCyclesPerMicro());
+
+  // the one read of the hardware clock this tick. The cycle counter wraps
+  // every few seconds, reading it every tick keeps it counting even when
+  // nothing else needs the time
+  motionClock.latch();
+
+  // the encoder keeps counting between ticks, so the spindle is always read
+  // and nothing is lost while we're idle
   spindle.update();
-  leadscrew.update();
+#ifdef ELS_MPG_ENCODER_A
+  handwheel.update();
+#endif
+
+  // anything the loop changed lands here, between two updates
+  motionMailbox.apply(&leadscrew);
+
+  // fast path, skip the leadscrew entirely while nothing is moving
+  bool active = !spindle.isIdle() || !leadscrew.isIdle();
+  if (active) {
+    leadscrew.update();
+  }
+
+  uint32_t nextTickUs = idleDetector.update(active);
+  if (nextTickUs != tickUs) {
+    timer.update(nextTickUs);
+  }
+
+  // sample the buttons at a fixed rate so debouncing and click timing don't
+  // depend on how fast loop() is running or how fast this timer is ticking
+  static uint32_t buttonSampleUs = 0;
+  buttonSampleUs += tickUs;
+  if (buttonSampleUs >= ELS_BUTTON_SAMPLE_US) {
+    buttonSampleUs = 0;
+    keyPad.sample();
+  }
+#ifdef ELS_SCOPE
+  scope.sample();
+#endif
+  timerProfile.stop();
+}
+
+void buttonTask() { keyPad.handle(); }
+
+void displayTask() { display.update(); }
+
+#ifdef ELS_DISPLAY_SERVICE_PERIOD_US
+void displayServiceTask() { display.service(); }
+#endif
+
+#ifndef ACCEL_DISABLED
+void calibrationTask() { calibration.update(); }
+#endif
+
+void telemetryTask() {
+  globalState->printState();
+  Serial.print("Uptime us: ");
+  Serial.println(SystemClock::getInstance()->nowMicros());
+  leadscrew.printState();
+  Serial.print("Spindle position: ");
+  Serial.println(spindle.getCurrentPosition());
+  Serial.print("Spindle velocity: ");
+  Serial.println(spindle.getEstimatedVelocityInRPM());
+  Serial.print("Spindle velocity pulses: ");
+  Serial.println(spindle.getEstimatedVelocityInPulsesPerSecond());
+  if (spindle.isDriven()) {
+    Serial.print("Spindle commanded RPM: ");
+    Serial.println(spindle.getCommandedRPM());
+  }
+  keyPad.printState();
+  motionMailbox.printState();
+#ifndef ACCEL_DISABLED
+  calibration.printState();
+#endif
+  scheduler.printState();
+  idleDetector.printState();
+#ifdef ELS_MPG_ENCODER_A
+  handwheel.printState();
+#endif
+  timerProfile.printState("Motion timer");
+  timerLatency.printState("Motion timer");
+#ifdef ELS_SCOPE
+  // the capture can be read while the timer keeps running, it only writes to
+  // the buffer again once it's armed
+  if (scope.getState() == ScopeState::DONE) {
+    scope.printCapture();
+    armScope();
+  }
+#endif
 }
 
 void setup() {
@@ -44,12 +215,28 @@ void setup() {
                "DEFAULT_IMPERIAL_THREAD_PITCH_IDX out of bounds");
   CHECK_BOUNDS(DEFAULT_IMPERIAL_FEED_PITCH_IDX, feedPitchImperial,
                "DEFAULT_IMPERIAL_FEED_PITCH_IDX out of bounds");
+  static_assert(ARRAY_SIZE(leadscrewAccelCurveVelocity) ==
+                    ARRAY_SIZE(leadscrewAccelCurveAccel),
+                "leadscrew accel curve needs an accel for every velocity");
+  static_assert(ARRAY_SIZE(leadscrewAccelCurveVelocity) <=
+                    ACCEL_CURVE_MAX_POINTS,
+                "leadscrew accel curve has too many points");
+  static_assert(ELS_IDLE_TIMER_US <= ELS_BUTTON_SAMPLE_US,
+                "the idle timer has to tick at least as often as the buttons "
+                "are sampled");
 
   // Pinmodes
 
-#ifndef ELS_SPINDLE_DRIVEN
+#ifdef ELS_SPINDLE_DRIVEN
+  pinMode(ELS_SPINDLE_STEP, OUTPUT);  // spindle step output pin
+  pinMode(ELS_SPINDLE_DIR, OUTPUT);   // spindle direction output pin
+#else
   pinMode(ELS_SPINDLE_ENCODER_A, INPUT_PULLUP);  // encoder pin 1
   pinMode(ELS_SPINDLE_ENCODER_B, INPUT_PULLUP);  // encoder pin 2
+#ifdef ELS_SPINDLE_ENCODER_INDEX
+  pinMode(ELS_SPINDLE_ENCODER_INDEX, INPUT_PULLUP);  // encoder index
+#endif
+  spindleIOImpl.begin();
 #endif
   pinMode(ELS_LEADSCREW_STEP, OUTPUT);              // step output pin
   pinMode(ELS_LEADSCREW_DIR, OUTPUT);               // direction output pin
@@ -68,9 +255,31 @@ void setup() {
   display.init();
 
   leadscrew.setRatio(globalState->getCurrentFeedPitch());
+#ifdef ELS_MPG_ENCODER_A
+  keyPad.setHandwheel(&handwheel);
+#endif
+  leadscrew.setBacklashCompensation(ELS_LEADSCREW_BACKLASH_STEPS,
+                                    ELS_LEADSCREW_BACKLASH_PULSE_DELAY_US);
+#ifndef ACCEL_DISABLED
+  leadscrew.setAccelCurve(&leadscrewAccelCurve);
+  // a saved calibration replaces the configured limits
+  calibration.begin();
+  keyPad.setCalibration(&calibration);
+#endif
+#ifdef ELS_SPINDLE_DRIVEN
+  spindle.setTargetRPM(ELS_SPINDLE_DRIVEN_RPM);
+#endif
 
   display.update();
 
+#ifdef ELS_SCOPE
+  scope.setChannels(scopeChannels, ARRAY_SIZE(scopeChannels));
+  armScope();
+#endif
+
+  // see lib/irq_priority for the levels and what's shared across them
+  applyIrqPriorities();
+  timer.priority(ELS_MOTION_TIMER_PRIORITY);
   timer.begin(timerCallback, LEADSCREW_TIMER_US);
 
   delay(2000);
@@ -79,26 +288,19 @@ void setup() {
   Serial.println(LEADSCREW_INITIAL_PULSE_DELAY_US);
   Serial.print("Pulse delay step: ");
   Serial.println(LEADSCREW_PULSE_DELAY_STEP_US);
-}
 
-void loop() {
-  keyPad.handle();
-
-  static elapsedMicros lastPrint;
-  if (lastPrint > 1000 * 500) {
-    lastPrint = 0;
-    globalState->printState();
-    Serial.print("Micros: ");
-    Serial.println(micros());
-    leadscrew.printState();
-    Serial.print("Spindle position: ");
-    Serial.println(spindle.getCurrentPosition());
-    Serial.print("Spindle velocity: ");
-    Serial.println(spindle.getEstimatedVelocityInRPM());
-    Serial.print("Spindle velocity pulses: ");
-    Serial.println(spindle.getEstimatedVelocityInPulsesPerSecond());
-    keyPad.printState();
-  }
-
-  display.update();
+  // the scheduler runs the due task with the earliest deadline first
+  scheduler.addTask("buttons", buttonTask, ELS_BUTTON_TASK_PERIOD_US);
+  scheduler.addTask("display", displayTask, ELS_DISPLAY_TASK_PERIOD_US);
+#ifdef ELS_DISPLAY_SERVICE_PERIOD_US
+  scheduler.addTask("display service", displayServiceTask,
+                    ELS_DISPLAY_SERVICE_PERIOD_US);
+#endif
+  scheduler.addTask("telemetry", telemetryTask, ELS_TELEMETRY_TASK_PERIOD_US);
+#ifndef ACCEL_DISABLED
+  scheduler.addTask("calibration", calibrationTask,
+                    ELS_CALIBRATION_TASK_PERIOD_US);
+#endif
 }
+
+void loop() { scheduler.run(); }
@@ -0,0 +1,200 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <accel_curve.h>
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include <cmath>
+#include <vector>
+
+using std::vector;
+
+#include "mocks/leadscrewio_mock.h"
+
+#define CURVE_TEST_INITIAL_DELAY 1000
+#define CURVE_TEST_MIN_DELAY (LEADSCREW_TIMER_US * 2)
+// with 1000 steps per unit the velocity in units/s is 1000 / pulse delay, so
+// the curve goes from the initial speed to the fastest the timer can pulse
+#define CURVE_TEST_STEPS_PER_UNIT 1000
+
+// a motor that can accelerate 10x harder at low speed than at high speed
+const float curveTestVelocity[] = {0, 1, 5, 25};
+const float curveTestAccel[] = {300, 300, 100, 30};
+// the same motor if the acceleration had to be safe at every speed
+const float flatTestAccel[] = {30, 30, 30, 30};
+
+AccelCurve makeCurve(const float* accelerations) {
+  return AccelCurve(curveTestVelocity, accelerations,
+                    ARRAY_SIZE(curveTestVelocity), CURVE_TEST_STEPS_PER_UNIT,
+                    CURVE_TEST_INITIAL_DELAY, CURVE_TEST_MIN_DELAY);
+}
+
+struct curveRun {
+  int maxPosition;
+  int minPosition;
+  unsigned long duration;
+  vector<unsigned long> pulseIntervals;
+};
+
+// runs the leadscrew until it has settled, recording every pulse
+curveRun runCurveUntilSettled(Leadscrew& leadscrew, LeadscrewIOMock& io) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  curveRun run = {leadscrew.getCurrentPosition(),
+                  leadscrew.getCurrentPosition(),
+                  0,
+                  {}};
+  unsigned long start = micros.micros();
+  unsigned long lastPulse = micros.micros();
+  int lastPulseCount = io.getPulseCount();
+  unsigned long idleTicks = 0;
+
+  while (idleTicks < 10000) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    leadscrew.update();
+
+    if (io.getPulseCount() != lastPulseCount) {
+      lastPulseCount = io.getPulseCount();
+      run.pulseIntervals.push_back(micros.micros() - lastPulse);
+      lastPulse = micros.micros();
+      run.duration = micros.micros() - start;
+      idleTicks = 0;
+    } else {
+      idleTicks++;
+    }
+
+    run.maxPosition = std::max(run.maxPosition, leadscrew.getCurrentPosition());
+    run.minPosition = std::min(run.minPosition, leadscrew.getCurrentPosition());
+  }
+  return run;
+}
+
+TEST(AccelCurveTest, TestIncrementIsInterpolated) {
+  AccelCurve curve = makeCurve(curveTestAccel);
+
+  // 1 unit/s
+  ASSERT_FLOAT_EQ(curve.getIncrement(1000), 0.3);
+  // 3 units/s, half way between 1 and 5
+  ASSERT_FLOAT_EQ(curve.getIncrement(1000.0 / 3), 0.2);
+  ASSERT_FLOAT_EQ(curve.getIncrement(40), 0.03);
+  // flat past either end
+  ASSERT_FLOAT_EQ(curve.getIncrement(10), 0.03);
+  ASSERT_FLOAT_EQ(curve.getIncrement(5000), 0.3);
+}
+
+TEST(AccelCurveTest, TestPulsesToStopIsAnUpperBound) {
+  AccelCurve curve = makeCurve(curveTestAccel);
+
+  for (float delay = CURVE_TEST_MIN_DELAY; delay < CURVE_TEST_INITIAL_DELAY;
+       delay += 3.7) {
+    // decelerate one pulse at a time the way the leadscrew does
+    int pulses = 0;
+    for (float d = delay; d < CURVE_TEST_INITIAL_DELAY; pulses++) {
+      d += curve.getIncrement(d) * d;
+    }
+
+    int estimate = curve.getPulsesToStop(delay);
+    ASSERT_GE(estimate, pulses) << "delay " << delay;
+    ASSERT_LE(estimate, pulses + 1) << "delay " << delay;
+  }
+
+  ASSERT_EQ(curve.getPulsesToStop(CURVE_TEST_INITIAL_DELAY), 0);
+  ASSERT_EQ(curve.getPulsesToStop(CURVE_TEST_INITIAL_DELAY * 2), 0);
+}
+
+TEST(AccelCurveTest, TestFlatCurveMatchesConstantIncrement) {
+  AccelCurve curve = makeCurve(flatTestAccel);
+
+  for (float delay = CURVE_TEST_MIN_DELAY; delay < CURVE_TEST_INITIAL_DELAY;
+       delay += 3.7) {
+    int pulses = ceil(log(CURVE_TEST_INITIAL_DELAY / delay) / log(1.03));
+    ASSERT_NEAR(curve.getPulsesToStop(delay), pulses, 1) << "delay " << delay;
+  }
+}
+
+TEST(AccelCurveTest, TestDeceleratesIntoStop) {
+  GlobalState* globalState = GlobalState::getInstance();
+  globalState->setMotionMode(GlobalMotionMode::ENABLED);
+
+  for (int target : {600, 2000, -2000}) {
+    MicrosSingleton::getInstance().setMicros(0);
+    AccelCurve curve = makeCurve(curveTestAccel);
+    LeadscrewIOMock io;
+    Spindle spindle;
+    Leadscrew leadscrew(&spindle, &io, CURVE_TEST_INITIAL_DELAY, 0, 100, 1);
+    leadscrew.setAccelCurve(&curve);
+    leadscrew.setRatio(1);
+    if (target > 0) {
+      leadscrew.setStopPosition(Leadscrew::StopPosition::RIGHT, target);
+    } else {
+      leadscrew.setStopPosition(Leadscrew::StopPosition::LEFT, target);
+    }
+
+    spindle.incrementCurrentPosition(target > 0 ? 5000 : -5000);
+    curveRun run = runCurveUntilSettled(leadscrew, io);
+
+    // exactly on the stop, without going past it on the way
+    ASSERT_EQ(leadscrew.getCurrentPosition(), target);
+    ASSERT_EQ(target > 0 ? run.maxPosition : run.minPosition, target);
+
+    // and slow enough to stop dead by the last pulse
+    unsigned long last = run.pulseIntervals.back();
+    ASSERT_GE(last * (1 + curve.getIncrement(last)), CURVE_TEST_INITIAL_DELAY);
+  }
+
+  globalState->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(AccelCurveTest, TestStopsOnTargetWhenSpindleStops) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState* globalState = GlobalState::getInstance();
+  globalState->setMotionMode(GlobalMotionMode::ENABLED);
+
+  AccelCurve curve = makeCurve(curveTestAccel);
+  LeadscrewIOMock io;
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, CURVE_TEST_INITIAL_DELAY, 0, 100, 1);
+  leadscrew.setAccelCurve(&curve);
+  leadscrew.setRatio(1);
+
+  spindle.incrementCurrentPosition(3000);
+  curveRun run = runCurveUntilSettled(leadscrew, io);
+
+  ASSERT_EQ(leadscrew.getCurrentPosition(), 3000);
+  ASSERT_EQ(run.maxPosition, 3000);
+  globalState->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(AccelCurveTest, TestCurveIsFasterThanSafeConstant) {
+  GlobalState* globalState = GlobalState::getInstance();
+  globalState->setMotionMode(GlobalMotionMode::ENABLED);
+
+  unsigned long durations[2];
+  const float* accelerations[2] = {curveTestAccel, flatTestAccel};
+  for (int i = 0; i < 2; i++) {
+    MicrosSingleton::getInstance().setMicros(0);
+    AccelCurve curve = makeCurve(accelerations[i]);
+    LeadscrewIOMock io;
+    Spindle spindle;
+    Leadscrew leadscrew(&spindle, &io, CURVE_TEST_INITIAL_DELAY, 0, 100, 1);
+    leadscrew.setAccelCurve(&curve);
+    leadscrew.setRatio(1);
+    leadscrew.setStopPosition(Leadscrew::StopPosition::RIGHT, 1000);
+
+    spindle.incrementCurrentPosition(5000);
+    curveRun run = runCurveUntilSettled(leadscrew, io);
+    ASSERT_EQ(leadscrew.getCurrentPosition(), 1000);
+    durations[i] = run.duration;
+  }
+
+  // the hard low speed acceleration gets through the slow part of the ramps
+  // much quicker
+  ASSERT_LT(durations[0] * 1.5, durations[1]);
+
+  globalState->setMotionMode(GlobalMotionMode::DISABLED);
+}
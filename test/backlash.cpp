@@ -0,0 +1,116 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include "mocks/leadscrewio_mock.h"
+
+#define BACKLASH_STEPS 7
+#define BACKLASH_PULSE_DELAY 100
+#define BACKLASH_INITIAL_DELAY 1000
+#define BACKLASH_DELAY_INCREMENT 0.3
+
+// runs the leadscrew until it has caught up with the spindle
+void settle(Leadscrew& leadscrew) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  int settledTicks = 0;
+  while (settledTicks < 1000) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    leadscrew.update();
+    if (leadscrew.getPositionError() == 0 &&
+        leadscrew.getBacklashRemaining() == 0) {
+      settledTicks++;
+    } else {
+      settledTicks = 0;
+    }
+  }
+}
+
+TEST(BacklashTest, TestPositionPreservedAcrossReversals) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  LeadscrewIOMock io;
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, BACKLASH_INITIAL_DELAY,
+                      BACKLASH_DELAY_INCREMENT, 100, 1);
+  leadscrew.setRatio(0.5);
+  leadscrew.setBacklashCompensation(BACKLASH_STEPS, BACKLASH_PULSE_DELAY);
+
+  // the same moves without compensation, to compare the pulse counts against
+  LeadscrewIOMock referenceIo;
+  Spindle referenceSpindle;
+  Leadscrew reference(&referenceSpindle, &referenceIo, BACKLASH_INITIAL_DELAY,
+                      BACKLASH_DELAY_INCREMENT, 100, 1);
+  reference.setRatio(0.5);
+
+  int moves[] = {200, -300, 150, -50, 400, -400, 10, -10};
+  int reversals = 0;
+  for (size_t i = 0; i < ARRAY_SIZE(moves); i++) {
+    spindle.incrementCurrentPosition(moves[i]);
+    settle(leadscrew);
+    referenceSpindle.incrementCurrentPosition(moves[i]);
+    settle(reference);
+
+    if (i > 0) {
+      reversals++;
+    }
+
+    // the logical position never sees the take up pulses
+    ASSERT_EQ(leadscrew.getCurrentPosition(), reference.getCurrentPosition());
+    ASSERT_EQ(leadscrew.getCurrentPosition(),
+              leadscrew.getExpectedPosition());
+    ASSERT_EQ(io.getPulseCount(),
+              referenceIo.getPulseCount() + reversals * BACKLASH_STEPS);
+  }
+
+  // we finished moving left, so the motor is exactly one backlash left of
+  // where the carriage thinks it is compared to the uncompensated run
+  ASSERT_EQ(io.getMotorPosition(),
+            referenceIo.getMotorPosition() - BACKLASH_STEPS);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(BacklashTest, TestTakeUpIsFastAndComesFirst) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  micros.setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  LeadscrewIOMock io;
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, BACKLASH_INITIAL_DELAY,
+                      BACKLASH_DELAY_INCREMENT, 100, 1);
+  leadscrew.setRatio(0.5);
+  leadscrew.setBacklashCompensation(BACKLASH_STEPS, BACKLASH_PULSE_DELAY);
+
+  spindle.incrementCurrentPosition(100);
+  settle(leadscrew);
+  int position = leadscrew.getCurrentPosition();
+  int pulses = io.getPulseCount();
+
+  spindle.incrementCurrentPosition(-100);
+  unsigned long start = micros.micros();
+  while (io.getPulseCount() < pulses + BACKLASH_STEPS) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    leadscrew.update();
+    // the carriage doesn't move while the backlash is taken up
+    ASSERT_EQ(leadscrew.getCurrentPosition(), position);
+  }
+
+  // all the take up pulses went out at the backlash rate, much faster than
+  // the leadscrew would start from a standstill
+  unsigned long takeUpTime = micros.micros() - start;
+  ASSERT_LE(takeUpTime,
+            BACKLASH_STEPS * (BACKLASH_PULSE_DELAY + 2 * LEADSCREW_TIMER_US));
+  ASSERT_EQ(leadscrew.getBacklashRemaining(), 0);
+
+  settle(leadscrew);
+  ASSERT_EQ(leadscrew.getCurrentPosition(), leadscrew.getExpectedPosition());
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
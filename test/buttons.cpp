@@ -0,0 +1,216 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <button_scanner.h>
+#include <config.h>
+#include <gmock/gmock.h>
+#include <jog_pacer.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "mocks/clock_mock.h"
+
+using std::vector;
+
+#define HELD_TICKS 50
+#define DOUBLE_CLICK_TICKS 30
+#define JOG_TEST_SECONDS 2
+
+// feeds every mask in the recording into the scanner, one per sample tick
+vector<ButtonEvent> replay(ButtonScanner& scanner,
+                           const vector<uint32_t>& recording) {
+  vector<ButtonEvent> events;
+  for (uint32_t mask : recording) {
+    scanner.sample(mask);
+    ButtonEvent event;
+    while (scanner.popEvent(&event)) {
+      events.push_back(event);
+    }
+  }
+  return events;
+}
+
+// appends `ticks` samples of the same mask to the recording
+void hold(vector<uint32_t>& recording, uint32_t mask, int ticks) {
+  for (int i = 0; i < ticks; i++) {
+    recording.push_back(mask);
+  }
+}
+
+vector<ButtonEvent> eventsOfType(const vector<ButtonEvent>& events,
+                                 ButtonEventType type) {
+  vector<ButtonEvent> filtered;
+  for (auto& event : events) {
+    if (event.type == type) {
+      filtered.push_back(event);
+    }
+  }
+  return filtered;
+}
+
+TEST(ButtonScannerTest, TestBounceIsFiltered) {
+  ButtonScanner scanner(HELD_TICKS, DOUBLE_CLICK_TICKS);
+
+  // contact bounce on press, never 4 samples in a row until tick 6
+  vector<uint32_t> recording = {0b1, 0b0, 0b1, 0b1, 0b0, 0b1, 0b1, 0b1, 0b1};
+  vector<ButtonEvent> events = replay(scanner, recording);
+
+  ASSERT_EQ(events.size(), 1);
+  ASSERT_EQ(events[0].type, ButtonEventType::PRESSED);
+  ASSERT_EQ(events[0].button, 0);
+  ASSERT_EQ(events[0].tick, 9);
+  ASSERT_EQ(scanner.getPressedMask(), 0b1);
+}
+
+TEST(ButtonScannerTest, TestClickTiming) {
+  ButtonScanner scanner(HELD_TICKS, DOUBLE_CLICK_TICKS);
+
+  vector<uint32_t> recording;
+  hold(recording, 0b100, 10);
+  hold(recording, 0b000, DOUBLE_CLICK_TICKS + 10);
+  vector<ButtonEvent> events = replay(scanner, recording);
+
+  // every transition is seen exactly 4 samples after it happened
+  ASSERT_EQ(eventsOfType(events, PRESSED).size(), 1);
+  ASSERT_EQ(eventsOfType(events, PRESSED)[0].tick, 4);
+  ASSERT_EQ(eventsOfType(events, RELEASED).size(), 1);
+  ASSERT_EQ(eventsOfType(events, RELEASED)[0].tick, 14);
+  ASSERT_EQ(eventsOfType(events, CLICKED).size(), 1);
+  ASSERT_EQ(eventsOfType(events, CLICKED)[0].tick, 14);
+  ASSERT_EQ(eventsOfType(events, CLICKED)[0].button, 2);
+
+  // the single click is only confirmed once the double click time is over
+  ASSERT_EQ(eventsOfType(events, SINGLE_CLICKED).size(), 1);
+  ASSERT_EQ(eventsOfType(events, SINGLE_CLICKED)[0].tick,
+            14 + DOUBLE_CLICK_TICKS + 1);
+  ASSERT_EQ(eventsOfType(events, DOUBLE_CLICKED).size(), 0);
+  ASSERT_EQ(eventsOfType(events, HELD).size(), 0);
+}
+
+TEST(ButtonScannerTest, TestDoubleClick) {
+  ButtonScanner scanner(HELD_TICKS, DOUBLE_CLICK_TICKS);
+
+  vector<uint32_t> recording;
+  hold(recording, 0b1, 8);
+  hold(recording, 0b0, 10);
+  hold(recording, 0b1, 8);
+  hold(recording, 0b0, DOUBLE_CLICK_TICKS + 10);
+  vector<ButtonEvent> events = replay(scanner, recording);
+
+  ASSERT_EQ(eventsOfType(events, CLICKED).size(), 2);
+  ASSERT_EQ(eventsOfType(events, DOUBLE_CLICKED).size(), 1);
+  ASSERT_EQ(eventsOfType(events, DOUBLE_CLICKED)[0].tick, 8 + 10 + 8 + 4);
+  ASSERT_EQ(eventsOfType(events, SINGLE_CLICKED).size(), 0);
+}
+
+TEST(ButtonScannerTest, TestSlowSecondClickIsTwoSingleClicks) {
+  ButtonScanner scanner(HELD_TICKS, DOUBLE_CLICK_TICKS);
+
+  vector<uint32_t> recording;
+  hold(recording, 0b1, 8);
+  hold(recording, 0b0, DOUBLE_CLICK_TICKS + 5);
+  hold(recording, 0b1, 8);
+  hold(recording, 0b0, DOUBLE_CLICK_TICKS + 10);
+  vector<ButtonEvent> events = replay(scanner, recording);
+
+  ASSERT_EQ(eventsOfType(events, SINGLE_CLICKED).size(), 2);
+  ASSERT_EQ(eventsOfType(events, DOUBLE_CLICKED).size(), 0);
+}
+
+TEST(ButtonScannerTest, TestHeldTiming) {
+  ButtonScanner scanner(HELD_TICKS, DOUBLE_CLICK_TICKS);
+
+  vector<uint32_t> recording;
+  hold(recording, 0b1, HELD_TICKS + 20);
+  hold(recording, 0b0, DOUBLE_CLICK_TICKS + 10);
+  vector<ButtonEvent> events = replay(scanner, recording);
+
+  ASSERT_EQ(eventsOfType(events, HELD).size(), 1);
+  ASSERT_EQ(eventsOfType(events, HELD)[0].tick, 4 + HELD_TICKS);
+
+  // letting go of a held button is not a click
+  ASSERT_EQ(eventsOfType(events, RELEASED).size(), 1);
+  ASSERT_EQ(eventsOfType(events, CLICKED).size(), 0);
+  ASSERT_EQ(eventsOfType(events, SINGLE_CLICKED).size(), 0);
+  ASSERT_EQ(scanner.getHeldMask(), 0);
+}
+
+TEST(ButtonScannerTest, TestButtonsAreIndependent) {
+  ButtonScanner scanner(HELD_TICKS, DOUBLE_CLICK_TICKS);
+
+  // button 7 is held down the whole time while button 8 gets clicked
+  vector<uint32_t> recording;
+  uint32_t jogLeft = 1u << 7;
+  uint32_t jogRight = 1u << 8;
+  hold(recording, jogLeft, 20);
+  hold(recording, jogLeft | jogRight, 10);
+  hold(recording, jogLeft, HELD_TICKS);
+  vector<ButtonEvent> events = replay(scanner, recording);
+
+  vector<ButtonEvent> held = eventsOfType(events, HELD);
+  ASSERT_EQ(held.size(), 1);
+  ASSERT_EQ(held[0].button, 7);
+  ASSERT_EQ(held[0].tick, 4 + HELD_TICKS);
+
+  vector<ButtonEvent> clicked = eventsOfType(events, CLICKED);
+  ASSERT_EQ(clicked.size(), 1);
+  ASSERT_EQ(clicked[0].button, 8);
+  ASSERT_EQ(clicked[0].tick, 34);
+
+  ASSERT_EQ(scanner.getHeldMask(), jogLeft);
+  ASSERT_EQ(scanner.getPressedMask(), jogLeft);
+}
+
+// jogs for the given time, handling the buttons as often as the firmware does
+int jog(JogPacer& pacer, ClockMock& clock, uint64_t micros, float pulseDelay) {
+  int positions = 0;
+  for (uint64_t t = 0; t < micros; t += ELS_BUTTON_TASK_PERIOD_US) {
+    clock.incrementMicros(ELS_BUTTON_TASK_PERIOD_US);
+    positions += pacer.update(true, pulseDelay);
+  }
+  return positions;
+}
+
+TEST(JogPacerTest, TestJogsAtThePulseRate) {
+  ClockMock clock;
+  JogPacer pacer(&clock);
+  pacer.update(true, JOG_PULSE_DELAY);
+
+  // far more positions than there are button updates
+  int positions =
+      jog(pacer, clock, JOG_TEST_SECONDS * US_PER_SECOND, JOG_PULSE_DELAY);
+  int expected = JOG_TEST_SECONDS * US_PER_SECOND / JOG_PULSE_DELAY;
+  ASSERT_GT(expected, JOG_TEST_SECONDS * US_PER_SECOND /
+                          ELS_BUTTON_TASK_PERIOD_US);
+  ASSERT_NEAR(positions, expected, 1);
+}
+
+TEST(JogPacerTest, TestRemainderCarriesOver) {
+  ClockMock clock;
+  JogPacer pacer(&clock);
+  pacer.update(true, 300);
+
+  // a delay that doesn't divide the button period still averages out
+  int positions = jog(pacer, clock, JOG_TEST_SECONDS * US_PER_SECOND, 300);
+  ASSERT_NEAR(positions, JOG_TEST_SECONDS * US_PER_SECOND / 300, 1);
+}
+
+TEST(JogPacerTest, TestIdleTimeIsNotJogged) {
+  ClockMock clock;
+  JogPacer pacer(&clock);
+  ASSERT_EQ(pacer.update(false, JOG_PULSE_DELAY), 0);
+
+  // the first update of a hold starts the count
+  clock.incrementMicros(10 * US_PER_SECOND);
+  ASSERT_EQ(pacer.update(true, JOG_PULSE_DELAY), 0);
+  clock.incrementMicros(ELS_BUTTON_TASK_PERIOD_US);
+  ASSERT_NEAR(pacer.update(true, JOG_PULSE_DELAY),
+              ELS_BUTTON_TASK_PERIOD_US / JOG_PULSE_DELAY, 1);
+
+  // and so does the next one after a release
+  clock.incrementMicros(10 * US_PER_SECOND);
+  ASSERT_EQ(pacer.update(false, JOG_PULSE_DELAY), 0);
+  ASSERT_EQ(pacer.update(true, JOG_PULSE_DELAY), 0);
+}
@@ -0,0 +1,273 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <accel_curve.h>
+#include <calibration.h>
+#include <calibration_search.h>
+#include <config.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <motion_mailbox.h>
+#include <spindle.h>
+
+#include "mocks/calibration_store_mock.h"
+#include "mocks/motion_rig.h"
+#include "mocks/stepper_motor_mock.h"
+
+// the simulated machine in steps, it stalls past 2000mm/s^2 at a standstill
+// and can't go faster than 60mm/s at all
+#define CALIBRATION_TEST_MOTOR_ACCEL (2000 * ELS_LEADSCREW_STEPS_PER_MM)
+#define CALIBRATION_TEST_MOTOR_SPEED (60 * ELS_LEADSCREW_STEPS_PER_MM)
+#define CALIBRATION_TEST_MOTOR_PULL_IN 500
+#define CALIBRATION_TEST_MOTOR_FREQUENCY 2000
+// correction pulses slow enough for the motor to start at from rest
+#define CALIBRATION_TEST_CORRECTION_DELAY 2000
+#define CALIBRATION_TEST_STOP_DISTANCE 3000
+// how many motion timer ticks between calibration updates, 10ms
+#define CALIBRATION_TEST_UPDATE_TICKS 500
+
+const float calibrationTestVelocities[] = {0, 80};
+const float calibrationTestAccels[] = {LEADSCREW_ACCEL, LEADSCREW_ACCEL};
+const CalibrationSettings calibrationTestSettings = {
+    {5, 10}, {3000, 75}, 1.5, 4, 1, 0.8};
+
+struct CalibrationRig : MotionRig<StepperMotorMock> {
+  StepperMotorMock& motor;
+  AccelCurve curve;
+  AccelCurve spareCurve;
+  CalibrationStoreMock store;
+  Calibration calibration;
+  uint64_t ticks = 0;
+
+  CalibrationRig(double motorAccel = CALIBRATION_TEST_MOTOR_ACCEL)
+      : MotionRig(LEADSCREW_INITIAL_PULSE_DELAY_US,
+                  LEADSCREW_PULSE_DELAY_STEP_US, motorAccel,
+                  CALIBRATION_TEST_MOTOR_SPEED, CALIBRATION_TEST_MOTOR_PULL_IN,
+                  CALIBRATION_TEST_MOTOR_FREQUENCY),
+        motor(leadscrewIo),
+        curve(calibrationTestVelocities, calibrationTestAccels, 2,
+              ELS_LEADSCREW_STEPS_PER_MM, LEADSCREW_INITIAL_PULSE_DELAY_US,
+              LEADSCREW_TIMER_US * 2),
+        spareCurve(calibrationTestVelocities, calibrationTestAccels, 2,
+                   ELS_LEADSCREW_STEPS_PER_MM,
+                   LEADSCREW_INITIAL_PULSE_DELAY_US, LEADSCREW_TIMER_US * 2),
+        calibration(&leadscrew, &mailbox, &store, &curve, &spareCurve,
+                    calibrationTestSettings, ELS_LEADSCREW_STEPS_PER_MM,
+                    LEADSCREW_TIMER_US * 2) {
+    calibration.setGlobalState(&globalState);
+    globalState.setMotionMode(GlobalMotionMode::DISABLED);
+    leadscrew.setRatio(0.1);
+    leadscrew.setAccelCurve(&curve);
+    leadscrew.setFeedbackCorrection(ELS_LEADSCREW_FEEDBACK_TOLERANCE_STEPS,
+                                    ELS_LEADSCREW_STALL_THRESHOLD_STEPS,
+                                    CALIBRATION_TEST_CORRECTION_DELAY);
+    leadscrew.setStopPosition(Leadscrew::StopPosition::LEFT, 0);
+    leadscrew.setStopPosition(Leadscrew::StopPosition::RIGHT,
+                              CALIBRATION_TEST_STOP_DISTANCE);
+  }
+
+  void tick() {
+    motor.advance(LEADSCREW_TIMER_US / 1e6);
+    MotionRig::tick();
+    if (++ticks % CALIBRATION_TEST_UPDATE_TICKS == 0) {
+      calibration.update();
+    }
+  }
+
+  // runs the calibration to the end, answering for the operator if asked
+  void calibrate() {
+    ASSERT_TRUE(calibration.start());
+    for (int i = 0; i < 50000000 && calibration.isRunning(); i++) {
+      if (calibration.isWaitingForOperator()) {
+        bool onMark = motor.getLostSteps() == 0;
+        motor.realign();
+        calibration.confirm(onMark);
+      }
+      tick();
+    }
+    ASSERT_FALSE(calibration.isRunning());
+    // the timer picks up the final limits on its next tick
+    tick();
+  }
+
+  void move(int amount) {
+    mailbox.postIncrementExpectedPosition(amount);
+    tick();
+    for (int i = 0; i < 2000000 && !leadscrew.isIdle(); i++) {
+      tick();
+    }
+  }
+
+  // a round trip between the stops, returns how often the motor stalled
+  int roundTrip(CalibrationLimits limits) {
+    // the timer isn't running, the leadscrew can be changed directly
+    float pulseDelay =
+        US_PER_SECOND / (limits.topSpeed * ELS_LEADSCREW_STEPS_PER_MM);
+    spareCurve.setLimits(limits.acceleration, pulseDelay);
+    leadscrew.setAccelCurve(&spareCurve);
+    leadscrew.setTopSpeedPulseDelay(pulseDelay);
+
+    int stalls = motor.getStalls();
+    globalState.setMotionMode(GlobalMotionMode::JOG);
+    move(CALIBRATION_TEST_STOP_DISTANCE);
+    move(-CALIBRATION_TEST_STOP_DISTANCE);
+    globalState.setMotionMode(GlobalMotionMode::DISABLED);
+    return motor.getStalls() - stalls;
+  }
+
+  void expectReliableResult() {
+    ASSERT_EQ(calibration.getPhase(), CalibrationPhase::CALIBRATION_FINISHED);
+    CalibrationLimits result = calibration.getLimits();
+    ASSERT_GT(result.acceleration, calibrationTestSettings.start.acceleration);
+    ASSERT_GT(result.topSpeed, 0);
+
+    // saved and handed to the leadscrew
+    ASSERT_EQ(store.getSaves(), 1);
+    ASSERT_FLOAT_EQ(store.getLimits().acceleration, result.acceleration);
+    ASSERT_FLOAT_EQ(store.getLimits().topSpeed, result.topSpeed);
+    ASSERT_FLOAT_EQ(leadscrew.getAccelCurve()->getMaxAcceleration(),
+                    result.acceleration);
+    ASSERT_FLOAT_EQ(leadscrew.getTopSpeedPulseDelay(),
+                    US_PER_SECOND /
+                        (result.topSpeed * ELS_LEADSCREW_STEPS_PER_MM));
+    ASSERT_EQ(globalState.getMotionMode(), GlobalMotionMode::DISABLED);
+
+    // the motor keeps up with the result
+    int lostSteps = motor.getLostSteps();
+    ASSERT_EQ(roundTrip(result), 0);
+    ASSERT_EQ(motor.getLostSteps(), lostSteps);
+    ASSERT_EQ(leadscrew.getCurrentPosition(), 0);
+
+    // but not with a little more than the margin gave away
+    float over = 1.25 / calibrationTestSettings.margin;
+    ASSERT_GT(roundTrip({result.acceleration * over,
+                         calibrationTestSettings.start.topSpeed}),
+              0);
+    ASSERT_GT(roundTrip({result.acceleration, result.topSpeed * over}), 0);
+  }
+};
+
+TEST(CalibrationTest, TestSearchConvergesBelowTheThreshold) {
+  CalibrationSearch search(calibrationTestSettings);
+
+  int trials = 0;
+  while (!search.isDone() && trials < 100) {
+    CalibrationLimits trial = search.getTrial();
+    search.report(trial.acceleration <= 700 && trial.topSpeed <= 30);
+    trials++;
+  }
+
+  ASSERT_EQ(search.getPhase(), CalibrationPhase::CALIBRATION_FINISHED);
+  CalibrationLimits result = search.getResult();
+  // the margin below the highest pass, which is within the last bisection
+  ASSERT_LE(result.acceleration, 700 * calibrationTestSettings.margin);
+  ASSERT_GT(result.acceleration, 600 * calibrationTestSettings.margin);
+  ASSERT_LE(result.topSpeed, 30 * calibrationTestSettings.margin);
+  ASSERT_GT(result.topSpeed, 27 * calibrationTestSettings.margin);
+}
+
+TEST(CalibrationTest, TestSearchFailsIfTheStartFails) {
+  CalibrationSearch search(calibrationTestSettings);
+  search.report(false);
+  ASSERT_EQ(search.getPhase(), CalibrationPhase::CALIBRATION_FAILED);
+}
+
+TEST(CalibrationTest, TestFeedbackFindsReliableLimits) {
+  CalibrationRig rig;
+  rig.motor.enableFeedback();
+  rig.calibrate();
+
+  // the trials that failed did stall, and the stops still line up
+  ASSERT_GT(rig.motor.getStalls(), 0);
+  ASSERT_GT(rig.leadscrew.getCorrectedSteps(), 0);
+  ASSERT_LE(abs(rig.leadscrew.getMissedSteps()),
+            ELS_LEADSCREW_FEEDBACK_TOLERANCE_STEPS);
+  ASSERT_EQ(rig.leadscrew.getCurrentPosition(), 0);
+  rig.expectReliableResult();
+}
+
+TEST(CalibrationTest, TestOperatorFindsReliableLimits) {
+  CalibrationRig rig;
+  rig.calibrate();
+
+  ASSERT_GT(rig.motor.getStalls(), 0);
+  rig.expectReliableResult();
+}
+
+TEST(CalibrationTest, TestStopsTooCloseForTheStart) {
+  CalibrationRig rig;
+  rig.motor.enableFeedback();
+  // the first trial can't get up to its top speed and stop again in time
+  rig.leadscrew.setStopPosition(Leadscrew::StopPosition::RIGHT, 100);
+  rig.calibrate();
+
+  ASSERT_EQ(rig.calibration.getPhase(), CalibrationPhase::CALIBRATION_FAILED);
+  ASSERT_EQ(rig.calibration.getTrials(), 0);
+  ASSERT_EQ(rig.store.getSaves(), 0);
+  ASSERT_FLOAT_EQ(rig.leadscrew.getAccelCurve()->getMaxAcceleration(),
+                  LEADSCREW_ACCEL);
+}
+
+TEST(CalibrationTest, TestFailureRestoresTheLimits) {
+  // too weak for even the first trial
+  CalibrationRig rig(100 * ELS_LEADSCREW_STEPS_PER_MM);
+  rig.motor.enableFeedback();
+  rig.calibrate();
+
+  ASSERT_EQ(rig.calibration.getPhase(), CalibrationPhase::CALIBRATION_FAILED);
+  ASSERT_EQ(rig.store.getSaves(), 0);
+  for (int i = 0; i < 10; i++) {
+    rig.tick();
+  }
+  ASSERT_FLOAT_EQ(rig.leadscrew.getAccelCurve()->getMaxAcceleration(),
+                  LEADSCREW_ACCEL);
+  ASSERT_FLOAT_EQ(rig.leadscrew.getAccelCurve()->getMinPulseDelay(),
+                  LEADSCREW_TIMER_US * 2);
+  ASSERT_EQ(rig.leadscrew.getTopSpeedPulseDelay(), 0);
+  ASSERT_EQ(rig.globalState.getMotionMode(), GlobalMotionMode::DISABLED);
+}
+
+TEST(CalibrationTest, TestAbortRestoresTheLimits) {
+  CalibrationRig rig;
+  rig.motor.enableFeedback();
+  ASSERT_TRUE(rig.calibration.start());
+  for (int i = 0; i < 500000; i++) {
+    rig.tick();
+  }
+  ASSERT_GT(rig.calibration.getTrials(), 1);
+
+  rig.calibration.abort();
+  ASSERT_FALSE(rig.calibration.isRunning());
+  ASSERT_EQ(rig.globalState.getMotionMode(), GlobalMotionMode::DISABLED);
+  for (int i = 0; i < CALIBRATION_TEST_UPDATE_TICKS * 2; i++) {
+    rig.tick();
+  }
+  ASSERT_EQ(rig.calibration.getState(), CalibrationState::CALIBRATION_IDLE);
+  ASSERT_FLOAT_EQ(rig.leadscrew.getAccelCurve()->getMaxAcceleration(),
+                  LEADSCREW_ACCEL);
+  ASSERT_EQ(rig.leadscrew.getTopSpeedPulseDelay(), 0);
+  ASSERT_EQ(rig.store.getSaves(), 0);
+}
+
+TEST(CalibrationTest, TestStartNeedsBothStops) {
+  CalibrationRig rig;
+  rig.leadscrew.unsetStopPosition(Leadscrew::StopPosition::RIGHT);
+  ASSERT_FALSE(rig.calibration.start());
+  ASSERT_EQ(rig.globalState.getMotionMode(), GlobalMotionMode::DISABLED);
+}
+
+TEST(CalibrationTest, TestBeginAppliesSavedLimits) {
+  CalibrationRig rig;
+  ASSERT_FALSE(rig.calibration.begin());
+  ASSERT_EQ(rig.leadscrew.getTopSpeedPulseDelay(), 0);
+
+  rig.store.save({400, 25});
+  ASSERT_TRUE(rig.calibration.begin());
+  ASSERT_FLOAT_EQ(rig.curve.getMaxAcceleration(), 400);
+  ASSERT_FLOAT_EQ(rig.leadscrew.getTopSpeedPulseDelay(),
+                  US_PER_SECOND / (25 * ELS_LEADSCREW_STEPS_PER_MM));
+  ASSERT_FLOAT_EQ(rig.curve.getMinPulseDelay(),
+                  rig.leadscrew.getTopSpeedPulseDelay());
+}
@@ -0,0 +1,120 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <clock.h>
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <gmock/gmock.h>
+#include <spindle.h>
+
+#include <cstdint>
+
+#include "mocks/clock_mock.h"
+#include "mocks/spindleio_mock.h"
+
+TEST(ClockTest, TestCounterExtenderCarriesWraps) {
+  CounterExtender extender;
+
+  ASSERT_EQ(extender.extend(0xFFFFFF00u), 0xFFFFFF00ull);
+  ASSERT_EQ(extender.extend(0x10u), 0x100000010ull);
+  ASSERT_EQ(extender.extend(0x20u), 0x100000020ull);
+  ASSERT_EQ(extender.extend(0xFFFFFFFFu), 0x1FFFFFFFFull);
+  ASSERT_EQ(extender.extend(0u), 0x200000000ull);
+}
+
+TEST(ClockTest, TestElapsedMicrosPastThirtyTwoBits) {
+  ClockMock clock;
+  clock.setMicros(UINT32_MAX - 10);
+  ElapsedMicros elapsed(&clock);
+
+  clock.incrementMicros(20);
+  ASSERT_EQ((uint64_t)elapsed, 20);
+
+  // a week is well past where 32 bit microseconds wrap
+  uint64_t week = 7ull * 24 * 60 * 60 * US_PER_SECOND;
+  clock.incrementMicros(week);
+  ASSERT_EQ((uint64_t)elapsed, week + 20);
+
+  elapsed -= week;
+  ASSERT_EQ((uint64_t)elapsed, 20);
+  elapsed = 5;
+  ASSERT_EQ((uint64_t)elapsed, 5);
+}
+
+TEST(ClockTest, TestAxesRunOnIndependentClocks) {
+  // the global micros() mock stays where it is the whole time
+  MicrosSingleton::getInstance().setMicros(0);
+
+  ClockMock fastClock;
+  ClockMock slowClock;
+  // start right before 32 bit microseconds wrap
+  fastClock.setMicros(UINT32_MAX - 250);
+  slowClock.setMicros(UINT32_MAX - 250);
+
+  SpindleIOMock fastIo;
+  SpindleIOMock slowIo;
+  Spindle fastSpindle(&fastIo);
+  Spindle slowSpindle(&slowIo);
+  fastSpindle.setClock(&fastClock);
+  slowSpindle.setClock(&slowClock);
+
+  for (int i = 0; i < 10; i++) {
+    fastClock.incrementMicros(100);
+    fastIo.rotate(1);
+    fastSpindle.update();
+
+    slowClock.incrementMicros(500);
+    slowIo.rotate(1);
+    slowSpindle.update();
+
+    if (i == 0) {
+      continue;
+    }
+    ASSERT_EQ(fastSpindle.getEstimatedVelocityInPulsesPerSecond(), 10000);
+    ASSERT_EQ(slowSpindle.getEstimatedVelocityInPulsesPerSecond(), 2000);
+  }
+
+  // half way to the next count, each spindle is interpolated on its own clock
+  fastClock.incrementMicros(50);
+  slowClock.incrementMicros(250);
+  ASSERT_FLOAT_EQ(fastSpindle.getInterpolationOffset(), -0.5);
+  ASSERT_FLOAT_EQ(slowSpindle.getInterpolationOffset(), -0.5);
+
+  ASSERT_EQ(MicrosSingleton::getInstance().micros(), 0);
+}
+
+TEST(ClockTest, TestCycleConverterMatchesDividing) {
+  CycleConverter converter;
+  // the Teensy 4.x at its default 600MHz
+  converter.setCyclesPerMicro(600);
+
+  ASSERT_EQ(converter.toMicros(0), 0);
+  ASSERT_EQ(converter.toMicros(599), 0);
+  ASSERT_EQ(converter.toMicros(600), 1);
+  // past a wrap of the 32 bit cycle counter and a week on, the error stays
+  // well under a part per million
+  uint64_t cycles = 0x3123456789ull;
+  ASSERT_GE(converter.toMicros(cycles), cycles / 600);
+  ASSERT_NEAR((double)converter.toMicros(cycles), (double)(cycles / 600),
+              cycles / 600 * 1e-7);
+  uint64_t week = 7ull * 24 * 60 * 60 * US_PER_SECOND;
+  ASSERT_NEAR((double)converter.toMicros(week * 600), (double)week,
+              week * 1e-7);
+
+  // a new CPU clock takes effect straight away
+  converter.setCyclesPerMicro(150);
+  ASSERT_EQ(converter.toMicros(150 * 1000), 1000);
+}
+
+TEST(ClockTest, TestTickClockOnlyMovesWhenLatched) {
+  ClockMock source;
+  source.setMicros(100);
+  TickClock clock(&source);
+  ASSERT_EQ(clock.nowMicros(), 100);
+
+  source.incrementMicros(20);
+  ASSERT_EQ(clock.nowMicros(), 100);
+  clock.latch();
+  ASSERT_EQ(clock.nowMicros(), 120);
+}
@@ -0,0 +1,75 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <display_text.h>
+#include <gmock/gmock.h>
+
+#include <climits>
+#include <cstdio>
+
+// the labels really are there at compile time
+static_assert(threadPitchMetricLabels[DEFAULT_METRIC_THREAD_PITCH_IDX][0] ==
+                  '1',
+              "pitch labels should be constant expressions");
+
+TEST(DisplayTextTest, TestFormatIntegerMatchesPrintf) {
+  const int values[] = {0,   1,    -1,    9,     10,     -10,     99,
+                        100, 999,  -999,  1000,  9999,   10000,   -12345,
+                        3000, 65535, 123456, INT_MAX, INT_MIN};
+  for (int value : values) {
+    for (int width = 0; width < 8; width++) {
+      char expected[32];
+      char actual[DISPLAY_INTEGER_SIZE];
+      snprintf(expected, sizeof(expected), "%*d", width, value);
+      int length = formatInteger(actual, value, width);
+      ASSERT_STREQ(actual, expected) << value << " width " << width;
+      ASSERT_EQ(length, (int)strlen(expected));
+    }
+  }
+}
+
+TEST(DisplayTextTest, TestFormatIntegerCapsTheWidth) {
+  char buffer[DISPLAY_INTEGER_SIZE];
+  ASSERT_EQ(formatInteger(buffer, 5, 100), DISPLAY_INTEGER_SIZE - 1);
+  ASSERT_EQ(buffer[DISPLAY_INTEGER_SIZE - 2], '5');
+}
+
+// every label reads the same as the sprintf the display used to call
+template <size_t Count>
+void checkPitchLabels(const PitchLabels<Count>& labels,
+                      const float (&pitches)[Count], const char* format,
+                      float scale) {
+  for (size_t i = 0; i < Count; i++) {
+    char expected[32];
+    if (scale == 0) {
+      snprintf(expected, sizeof(expected), format, pitches[i]);
+    } else {
+      snprintf(expected, sizeof(expected), format, (int)(pitches[i] * scale));
+    }
+    ASSERT_STREQ(labels[i], expected) << "entry " << i;
+    ASSERT_LT(strlen(labels[i]), (size_t)PITCH_LABEL_SIZE);
+  }
+}
+
+TEST(DisplayTextTest, TestPitchLabelsMatchPrintf) {
+  checkPitchLabels(threadPitchMetricLabels, threadPitchMetric, "%.2fmm", 0);
+  checkPitchLabels(feedPitchMetricLabels, feedPitchMetric, "%.2fmm", 0);
+  checkPitchLabels(threadPitchImperialLabels, threadPitchImperial, "%dTPI", 1);
+  checkPitchLabels(feedPitchImperialLabels, feedPitchImperial, "%dth", 1000);
+}
+
+TEST(DisplayTextTest, TestPitchLabelForTheMode) {
+  ASSERT_STREQ(
+      getPitchLabel(GlobalUnitMode::METRIC, GlobalFeedMode::THREAD, 8),
+      "1.25mm");
+  ASSERT_STREQ(getPitchLabel(GlobalUnitMode::METRIC, GlobalFeedMode::FEED, 8),
+               "0.25mm");
+  ASSERT_STREQ(
+      getPitchLabel(GlobalUnitMode::IMPERIAL, GlobalFeedMode::THREAD, 8),
+      "32TPI");
+  ASSERT_STREQ(
+      getPitchLabel(GlobalUnitMode::IMPERIAL, GlobalFeedMode::FEED, 8),
+      "10th");
+}
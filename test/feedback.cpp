@@ -0,0 +1,129 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include "mocks/leadscrewio_mock.h"
+
+#define FEEDBACK_TOLERANCE 2
+#define FEEDBACK_STALL_THRESHOLD 40
+#define FEEDBACK_PULSE_DELAY 100
+
+// runs the leadscrew for a while, losing steps part way through the move
+void runLosingSteps(Leadscrew& leadscrew, LeadscrewIOMock& io, int loseAfter,
+                    int stepsToLose, int ticks) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  for (int i = 0; i < ticks; i++) {
+    if (i == loseAfter) {
+      io.loseSteps(stepsToLose);
+    }
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    leadscrew.update();
+  }
+}
+
+TEST(FeedbackTest, TestNoFeedbackMeansNoCorrection) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  LeadscrewIOMock io;
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, 1000, 0.3, 100, 1);
+  leadscrew.setRatio(0.5);
+  leadscrew.setFeedbackCorrection(FEEDBACK_TOLERANCE, FEEDBACK_STALL_THRESHOLD,
+                                  FEEDBACK_PULSE_DELAY);
+
+  spindle.incrementCurrentPosition(400);
+  runLosingSteps(leadscrew, io, 100, 10, 50000);
+
+  // open loop, the lost steps are gone for good
+  ASSERT_EQ(leadscrew.getMissedSteps(), 0);
+  ASSERT_EQ(leadscrew.getCorrectedSteps(), 0);
+  ASSERT_EQ(io.readFeedbackPosition(), io.getMotorPosition() - 10);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(FeedbackTest, TestMissedStepsAreRecovered) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  LeadscrewIOMock io;
+  io.enableFeedback();
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, 1000, 0.3, 100, 1);
+  leadscrew.setRatio(0.5);
+  leadscrew.setFeedbackCorrection(FEEDBACK_TOLERANCE, FEEDBACK_STALL_THRESHOLD,
+                                  FEEDBACK_PULSE_DELAY);
+
+  // the same move with a motor that never misses a step
+  LeadscrewIOMock referenceIo;
+  Spindle referenceSpindle;
+  Leadscrew reference(&referenceSpindle, &referenceIo, 1000, 0.3, 100, 1);
+  reference.setRatio(0.5);
+
+  spindle.incrementCurrentPosition(400);
+  referenceSpindle.incrementCurrentPosition(400);
+  runLosingSteps(leadscrew, io, 100, 10, 50000);
+  runLosingSteps(reference, referenceIo, 0, 0, 50000);
+
+  ASSERT_EQ(leadscrew.getCurrentPosition(), reference.getCurrentPosition());
+  ASSERT_FALSE(leadscrew.isStalled());
+  ASSERT_EQ(leadscrew.getMissedSteps(), 0);
+  ASSERT_EQ(leadscrew.getCorrectedSteps(), 10);
+  // the motor really ended up where it would have without the lost steps
+  ASSERT_EQ(io.readFeedbackPosition(), referenceIo.getMotorPosition());
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(FeedbackTest, TestSmallLagIsTolerated) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  LeadscrewIOMock io;
+  io.enableFeedback();
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, 1000, 0.3, 100, 1);
+  leadscrew.setRatio(0.5);
+  leadscrew.setFeedbackCorrection(FEEDBACK_TOLERANCE, FEEDBACK_STALL_THRESHOLD,
+                                  FEEDBACK_PULSE_DELAY);
+
+  spindle.incrementCurrentPosition(400);
+  runLosingSteps(leadscrew, io, 100, FEEDBACK_TOLERANCE, 50000);
+
+  ASSERT_EQ(leadscrew.getMissedSteps(), FEEDBACK_TOLERANCE);
+  ASSERT_EQ(leadscrew.getCorrectedSteps(), 0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(FeedbackTest, TestStallIsFlagged) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  LeadscrewIOMock io;
+  io.enableFeedback();
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, 1000, 0.3, 100, 1);
+  leadscrew.setRatio(0.5);
+  leadscrew.setFeedbackCorrection(FEEDBACK_TOLERANCE, FEEDBACK_STALL_THRESHOLD,
+                                  FEEDBACK_PULSE_DELAY);
+
+  // the motor stops responding entirely part way through the move
+  spindle.incrementCurrentPosition(400);
+  runLosingSteps(leadscrew, io, 100, 100000, 10000);
+
+  ASSERT_TRUE(leadscrew.isStalled());
+  int pulses = io.getPulseCount();
+  runLosingSteps(leadscrew, io, -1, 0, 10000);
+  // nothing else is sent once we've stalled
+  ASSERT_EQ(io.getPulseCount(), pulses);
+
+  leadscrew.clearStall();
+  ASSERT_FALSE(leadscrew.isStalled());
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
@@ -0,0 +1,104 @@
+#include <cstdint>
+
+#pragma once
+
+// the time of evenly spaced steps from the first to the last
+#define STEP_TRACE_CHECKPOINTS 8
+
+struct StepTraceGolden {
+  const char* table;
+  int feedSelect;
+  // rising edges on the step pin
+  int steps;
+  // the steps added up with their direction
+  int motorPosition;
+  // FNV-1a of every step and dir edge with its time
+  uint32_t hash;
+  uint32_t checkpointMicros[STEP_TRACE_CHECKPOINTS];
+};
+
+// generated by test/step_traces.cpp, see there before editing
+// clang-format off
+const StepTraceGolden stepTraceGoldens[] = {
+    {"metric_feed", 0, 43, 29, 0x7a3be1fc, {145180, 452760, 658620, 781240, 901240, 1001240, 1269400, 1599340}},
+    {"metric_feed", 1, 70, 48, 0x86d35239, {116540, 415280, 631680, 763740, 876220, 995000, 1269440, 1628600}},
+    {"metric_feed", 2, 90, 60, 0x74539959, {105140, 427760, 646960, 771220, 881240, 1001240, 1299900, 1678920}},
+    {"metric_feed", 3, 109, 75, 0xa207bccf, {96940, 415280, 636880, 763780, 876240, 1001240, 1269420, 1628020}},
+    {"metric_feed", 4, 141, 95, 0x7e58654f, {88060, 419440, 642980, 774840, 897900, 1018420, 1291160, 1640820}},
+    {"metric_feed", 5, 173, 117, 0x448b02a8, {81480, 408320, 645220, 780880, 901980, 1020160, 1287980, 1650680}},
+    {"metric_feed", 6, 195, 131, 0x221be442, {77720, 415260, 646320, 783540, 899780, 1019560, 1299900, 1678920}},
+    {"metric_feed", 7, 228, 154, 0x8e36195a, {73600, 413400, 650560, 781340, 900280, 1019480, 1296640, 1697940}},
+    {"metric_feed", 8, 251, 171, 0x7a8cf50c, {70980, 412760, 655040, 782140, 897660, 1019140, 1294760, 1654000}},
+    {"metric_feed", 9, 287, 195, 0x81816ea0, {68340, 407320, 654940, 778980, 901100, 1019660, 1301720, 1659560}},
+    {"metric_feed", 10, 314, 210, 0x1333e2f9, {66320, 411220, 656220, 782820, 901580, 1024900, 1303720, 1694700}},
+    {"metric_feed", 11, 377, 255, 0xf3f3745b, {63500, 422600, 657420, 781720, 899360, 1020880, 1298600, 1659600}},
+    {"metric_feed", 12, 444, 300, 0x5dfd0e6b, {60080, 427080, 654400, 778920, 900640, 1019900, 1303580, 1678920}},
+    {"metric_feed", 13, 516, 348, 0xbbcf47e3, {57280, 429560, 655300, 780320, 901360, 1019920, 1304360, 1668940}},
+    {"metric_feed", 14, 590, 398, 0xa1af58e3, {55040, 429820, 655520, 779340, 899600, 1019680, 1309260, 1688360}},
+    {"metric_feed", 15, 667, 449, 0x07460cf1, {55040, 427860, 653040, 777760, 898220, 1018800, 1315920, 1714520}},
+    {"metric_feed", 16, 747, 505, 0x3c9aaa30, {53720, 426020, 651940, 776920, 897040, 1016980, 1317980, 1694700}},
+    {"metric_feed", 17, 831, 561, 0xb7c95f33, {52040, 426940, 651920, 775880, 896660, 1016500, 1320760, 1711400}},
+    {"metric_feed", 18, 919, 621, 0x7ea77343, {50600, 428780, 651660, 776040, 896560, 1017040, 1317940, 1689120}},
+    {"metric_feed", 19, 1010, 682, 0xee9e85de, {49360, 427540, 651100, 775720, 895640, 1016200, 1320300, 1702940}},
+    {"metric_thread", 0, 377, 255, 0xf3f3745b, {63500, 422600, 657420, 781720, 899360, 1020880, 1298600, 1659600}},
+    {"metric_thread", 1, 444, 300, 0x5dfd0e6b, {60080, 427080, 654400, 778920, 900640, 1019900, 1303580, 1678920}},
+    {"metric_thread", 2, 516, 348, 0xbbcf47e3, {57280, 429560, 655300, 780320, 901360, 1019920, 1304360, 1668940}},
+    {"metric_thread", 3, 590, 398, 0xa1af58e3, {55040, 429820, 655520, 779340, 899600, 1019680, 1309260, 1688360}},
+    {"metric_thread", 4, 747, 505, 0x3c9aaa30, {53720, 426020, 651940, 776920, 897040, 1016980, 1317980, 1694700}},
+    {"metric_thread", 5, 919, 621, 0x7ea77343, {50600, 428780, 651660, 776040, 896560, 1017040, 1317940, 1689120}},
+    {"metric_thread", 6, 1102, 746, 0x4d7a3c1a, {48260, 426100, 649780, 774300, 894720, 1014420, 1317940, 1695300}},
+    {"metric_thread", 7, 1513, 1025, 0x8972498d, {44980, 425260, 649300, 773600, 893760, 1014020, 1319040, 1709240}},
+    {"metric_thread", 8, 2101, 1423, 0xdf681ed1, {44980, 423100, 647660, 772420, 892180, 1011940, 1319460, 1730260}},
+    {"metric_thread", 9, 2774, 1878, 0x8b2ff3c9, {44980, 420860, 646140, 771320, 891440, 1011560, 1317180, 1738780}},
+    {"metric_thread", 10, 3530, 2388, 0x64abede5, {44980, 420260, 645480, 770480, 890540, 1010600, 1318380, 1762540}},
+    {"metric_thread", 11, 4372, 2958, 0xfe34989c, {44980, 419380, 644560, 770060, 889920, 1010420, 1316240, 1763580}},
+    {"metric_thread", 12, 6304, 4266, 0x67303e42, {44640, 417900, 643680, 769080, 889160, 1009380, 1315740, 1784000}},
+    {"metric_thread", 13, 8572, 5806, 0x10e70210, {42520, 415760, 642660, 767820, 887820, 1008100, 1313820, 1799920}},
+    {"metric_thread", 14, 11182, 7566, 0xc1f913a9, {41000, 415280, 641980, 767140, 887320, 1007480, 1313160, 1821420}},
+    {"metric_thread", 15, 14127, 9559, 0x628d89a8, {39860, 414540, 641240, 766520, 886640, 1006900, 1312760, 1835420}},
+    {"metric_thread", 16, 17408, 11778, 0x709d369f, {38980, 413720, 640600, 766080, 886160, 1006340, 1312460, 1859260}},
+    {"metric_thread", 17, 21024, 14226, 0xf1b50411, {38260, 412960, 640040, 765620, 885780, 1005960, 1311100, 1873220}},
+    {"metric_thread", 18, 24979, 16901, 0x6088b799, {37680, 412020, 639640, 782480, 925240, 1067960, 1310580, 1891400}},
+    {"metric_thread", 19, 28628, 19802, 0x56a40d43, {37200, 404760, 634280, 797840, 961440, 1125000, 1316300, 1901580}},
+    {"imperial_feed", 0, 43, 29, 0x9af4717a, {144140, 447260, 653940, 775240, 893360, 991780, 1302480, 1668180}},
+    {"imperial_feed", 1, 66, 46, 0x4232c9fb, {119120, 430860, 630080, 755560, 873680, 991780, 1147240, 1613100}},
+    {"imperial_feed", 2, 91, 61, 0x3bcfc5ab, {104600, 422660, 642240, 765400, 883520, 1001620, 1302480, 1668180}},
+    {"imperial_feed", 3, 116, 80, 0xf17020b7, {94760, 417740, 636360, 763440, 879960, 999660, 1266300, 1629880}},
+    {"imperial_feed", 4, 143, 97, 0x70a4fd1d, {87420, 414460, 638260, 770120, 896920, 1014900, 1284700, 1668120}},
+    {"imperial_feed", 5, 169, 115, 0x7bb6ba30, {81940, 418380, 643380, 781400, 900440, 1016580, 1295340, 1638300}},
+    {"imperial_feed", 6, 198, 134, 0x5c03db69, {77720, 416620, 647780, 780740, 898660, 1016480, 1289520, 1668180}},
+    {"imperial_feed", 7, 226, 154, 0x349bda38, {73800, 415260, 652540, 781260, 899520, 1016040, 1284720, 1642860}},
+    {"imperial_feed", 8, 257, 173, 0x5c41ccc0, {70980, 410600, 657220, 780700, 901380, 1018960, 1302460, 1674400}},
+    {"imperial_feed", 9, 288, 194, 0xd2bbaf9e, {68400, 415940, 660800, 783300, 904440, 1024660, 1304280, 1708660}},
+    {"imperial_feed", 10, 319, 215, 0xdbc71c64, {65880, 412520, 654340, 780920, 900980, 1022220, 1300400, 1674400}},
+    {"imperial_feed", 11, 384, 260, 0x636ebce4, {63220, 422440, 656180, 781420, 899460, 1020480, 1297640, 1668180}},
+    {"imperial_feed", 12, 454, 306, 0x6e306d25, {59680, 425340, 656640, 780620, 899220, 1021200, 1305260, 1674460}},
+    {"imperial_feed", 13, 527, 355, 0x8908b431, {56940, 431900, 654840, 780040, 900360, 1020220, 1304920, 1674420}},
+    {"imperial_feed", 14, 602, 406, 0xdafa6058, {55040, 425860, 653280, 778500, 898360, 1019580, 1312000, 1668120}},
+    {"imperial_feed", 15, 681, 459, 0x1d60d468, {55040, 428720, 653880, 778340, 898100, 1018340, 1318780, 1714940}},
+    {"imperial_feed", 16, 763, 515, 0x47b52168, {53380, 425220, 651360, 776980, 897260, 1016920, 1319900, 1705240}},
+    {"imperial_feed", 17, 851, 573, 0x08cc66f2, {51720, 429200, 652080, 777740, 897120, 1018980, 1321460, 1708820}},
+    {"imperial_feed", 18, 940, 634, 0xd8ca32ca, {50300, 429580, 652040, 776080, 896620, 1017300, 1318120, 1700220}},
+    {"imperial_feed", 19, 1031, 697, 0x6ce74012, {49080, 427900, 650440, 775220, 895760, 1015400, 1320520, 1704320}},
+    {"imperial_thread", 0, 335, 225, 0xa0e8c691, {64780, 411360, 655980, 781040, 898720, 1020880, 1302060, 1684260}},
+    {"imperial_thread", 1, 381, 257, 0x2c506757, {63440, 425640, 657160, 781240, 902820, 1021320, 1297960, 1693580}},
+    {"imperial_thread", 2, 440, 296, 0x4ab8e789, {60280, 427160, 656340, 780320, 899420, 1020900, 1308300, 1700480}},
+    {"imperial_thread", 3, 520, 352, 0x895f4555, {57100, 431080, 655320, 778620, 899280, 1017740, 1303020, 1663520}},
+    {"imperial_thread", 4, 633, 429, 0xaf7ca8d7, {55040, 428980, 653420, 776700, 897880, 1017840, 1313040, 1670080}},
+    {"imperial_thread", 5, 710, 480, 0xd29895a9, {54580, 428980, 652760, 776740, 898160, 1018040, 1318380, 1690040}},
+    {"imperial_thread", 6, 806, 544, 0x0516d9bb, {52520, 428440, 652020, 777740, 897600, 1017940, 1319300, 1684260}},
+    {"imperial_thread", 7, 930, 628, 0x65afcbfa, {50460, 427980, 651660, 776640, 896400, 1016900, 1319820, 1693580}},
+    {"imperial_thread", 8, 1093, 737, 0xe5334bc8, {48400, 427940, 651020, 776020, 896320, 1017100, 1321560, 1706760}},
+    {"imperial_thread", 9, 1317, 891, 0x1fcd23d1, {46340, 426320, 650240, 774640, 895260, 1015460, 1318620, 1704720}},
+    {"imperial_thread", 10, 1643, 1113, 0x613d565d, {44980, 424060, 648200, 772920, 893100, 1013260, 1318100, 1715220}},
+    {"imperial_thread", 11, 2153, 1457, 0xfa69708e, {44980, 422220, 647320, 772020, 892460, 1012440, 1319340, 1735160}},
+    {"imperial_thread", 12, 2528, 1708, 0x0a254093, {44980, 422120, 646620, 772380, 892680, 1013080, 1319760, 1745360}},
+    {"imperial_thread", 13, 3030, 2050, 0x688189aa, {44980, 420580, 646580, 771060, 891040, 1011320, 1317880, 1748900}},
+    {"imperial_thread", 14, 3737, 2531, 0xd20609db, {44980, 419180, 644920, 770240, 890080, 1010320, 1317680, 1758080}},
+    {"imperial_thread", 15, 4211, 2849, 0x1b52a5ad, {44980, 419460, 644760, 770220, 890320, 1010560, 1317500, 1765100}},
+    {"imperial_thread", 16, 4789, 3245, 0x364db2f0, {44980, 418200, 644480, 769420, 889460, 1009540, 1316180, 1768580}},
+    {"imperial_thread", 17, 5527, 3739, 0xc4d1832f, {44980, 417400, 644100, 769320, 889300, 1009680, 1316320, 1782900}},
+    {"imperial_thread", 18, 6473, 4381, 0x17ee0beb, {44440, 417440, 643580, 768860, 889020, 1009140, 1315740, 1786720}},
+    {"imperial_thread", 19, 7730, 5230, 0x769ea7ac, {43180, 416440, 643320, 768500, 888500, 1008740, 1314700, 1793260}},
+};
+// clang-format on
@@ -0,0 +1,245 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <handwheel.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include "mocks/handwheelio_mock.h"
+#include "mocks/motion_rig.h"
+
+#define HANDWHEEL_TEST_COUNTS_PER_DETENT 4
+// one position unit every 100us at a ratio of 1
+#define HANDWHEEL_TEST_UNIT_PULSE_DELAY 100
+#define HANDWHEEL_TEST_MAX_BACKLOG 500
+#define HANDWHEEL_TEST_TICK_US 20
+
+struct HandwheelRig : MotionRig<> {
+  HandwheelIOMock io;
+  Handwheel handwheel;
+  uint64_t sinceLoop = 0;
+
+  HandwheelRig(int maxBacklog = HANDWHEEL_TEST_MAX_BACKLOG)
+      : MotionRig(0, 0),
+        handwheel(&io, &leadscrew, HANDWHEEL_TEST_COUNTS_PER_DETENT,
+                  HANDWHEEL_TEST_UNIT_PULSE_DELAY, maxBacklog, &globalState,
+                  &clock) {
+    globalState.setButtonLock(GlobalButtonLock::UNLOCKED);
+    leadscrew.setRatio(1.0);
+  }
+
+  // what ButtonHandler::jogHandler does for the handwheel, only the loop
+  // changes the motion mode
+  void loop() {
+    GlobalMotionMode motionMode = globalState.getMotionMode();
+    if (handwheel.isJogging() && motionMode == GlobalMotionMode::DISABLED) {
+      globalState.setMotionMode(GlobalMotionMode::JOG);
+      globalState.setThreadSyncState(GlobalThreadSyncState::UNSYNC);
+    }
+    if (!handwheel.isJogging() && motionMode == GlobalMotionMode::JOG) {
+      globalState.setMotionMode(GlobalMotionMode::DISABLED);
+    }
+  }
+
+  // one motion timer tick, the wheel is read between the spindle and the
+  // leadscrew like the firmware does. The loop gets a turn every button task
+  void tick() {
+    startTick(HANDWHEEL_TEST_TICK_US);
+    handwheel.update();
+    finishTick();
+
+    sinceLoop += HANDWHEEL_TEST_TICK_US;
+    if (sinceLoop >= ELS_BUTTON_TASK_PERIOD_US) {
+      sinceLoop = 0;
+      loop();
+    }
+  }
+
+  // ticks at least once, so a turn that hasn't been read yet is picked up,
+  // and lets the loop end the jog
+  void tickUntilSettled() {
+    int ticks = 0;
+    do {
+      tick();
+    } while (handwheel.isJogging() && ++ticks < 1000000);
+    loop();
+  }
+
+  void turnDetents(int detents) {
+    io.turn(detents * HANDWHEEL_TEST_COUNTS_PER_DETENT);
+  }
+};
+
+TEST(HandwheelTest, TestMultipliers) {
+  HandwheelRig rig;
+  ASSERT_EQ(rig.handwheel.getMultiplier(), 1);
+
+  int expected = 0;
+  for (int multiplier : mpgMultipliers) {
+    ASSERT_EQ(rig.handwheel.getMultiplier(), multiplier);
+    rig.turnDetents(3);
+    rig.tickUntilSettled();
+    expected += 3 * multiplier;
+    ASSERT_EQ(rig.leadscrew.getExpectedPosition(), expected);
+    ASSERT_EQ(rig.leadscrew.getCurrentPosition(), expected);
+    rig.handwheel.nextMultiplier();
+  }
+
+  // and back round to the first
+  ASSERT_EQ(rig.handwheel.getMultiplier(), mpgMultipliers[0]);
+
+  // anticlockwise goes back the other way
+  rig.handwheel.setMultiplier(10);
+  rig.turnDetents(-2);
+  rig.tickUntilSettled();
+  ASSERT_EQ(rig.leadscrew.getCurrentPosition(), expected - 20);
+}
+
+TEST(HandwheelTest, TestOnlyWholeDetentsMove) {
+  HandwheelRig rig;
+
+  rig.io.turn(HANDWHEEL_TEST_COUNTS_PER_DETENT - 1);
+  rig.tick();
+  ASSERT_FALSE(rig.handwheel.isJogging());
+  ASSERT_EQ(rig.leadscrew.getExpectedPosition(), 0);
+
+  // the last count of the detent asks the loop for a jog, then moves
+  // straight away. There's no waiting for the speed limit on the first unit
+  rig.io.turn(1);
+  rig.tick();
+  ASSERT_TRUE(rig.handwheel.isJogging());
+  ASSERT_EQ(rig.leadscrew.getExpectedPosition(), 0);
+  rig.loop();
+  ASSERT_EQ(rig.globalState.getMotionMode(),
+            GlobalMotionMode::JOG);
+  rig.tick();
+  ASSERT_EQ(rig.leadscrew.getExpectedPosition(), 1);
+
+  // wobbling back and forth inside a detent doesn't move anything
+  rig.tickUntilSettled();
+  for (int i = 0; i < 10; i++) {
+    rig.io.turn(-2);
+    rig.tick();
+    rig.io.turn(2);
+    rig.tick();
+  }
+  ASSERT_EQ(rig.leadscrew.getExpectedPosition(), 1);
+}
+
+TEST(HandwheelTest, TestFeedIsVelocityLimited) {
+  HandwheelRig rig;
+  rig.handwheel.setMultiplier(100);
+  rig.turnDetents(1);
+  rig.tick();
+  rig.loop();
+
+  // the first unit goes straight away, then one every unit pulse delay
+  uint64_t start = rig.clock.nowMicros();
+  while (rig.handwheel.getBacklog() != 0 ||
+         rig.leadscrew.getExpectedPosition() == 0) {
+    rig.tick();
+    uint64_t elapsed = rig.clock.nowMicros() - start;
+    int limit = 1 + elapsed / HANDWHEEL_TEST_UNIT_PULSE_DELAY;
+    ASSERT_LE(rig.leadscrew.getExpectedPosition(), limit);
+    // and it isn't any slower than that either
+    ASSERT_GE(rig.leadscrew.getExpectedPosition(), limit - 1);
+  }
+  ASSERT_EQ(rig.leadscrew.getExpectedPosition(), 100);
+
+  // the limit scales with the ratio the same as the jog buttons
+  rig.tickUntilSettled();
+  rig.leadscrew.setRatio(2.0);
+  rig.turnDetents(1);
+  rig.tick();
+  rig.loop();
+  rig.tick();
+  int before = rig.leadscrew.getExpectedPosition();
+  for (int i = 0; i < 100; i++) {
+    rig.tick();
+  }
+  int unitsPerTicks = 100 * HANDWHEEL_TEST_TICK_US /
+                      (HANDWHEEL_TEST_UNIT_PULSE_DELAY * 2);
+  ASSERT_NEAR(rig.leadscrew.getExpectedPosition() - before, unitsPerTicks, 1);
+}
+
+TEST(HandwheelTest, TestBacklogIsLimited) {
+  HandwheelRig rig(50);
+  rig.handwheel.setMultiplier(100);
+
+  // spinning the wheel far faster than the leadscrew can follow
+  rig.turnDetents(100);
+  rig.tick();
+  ASSERT_EQ(rig.handwheel.getBacklog(), 50);
+  rig.loop();
+  rig.tick();
+  ASSERT_EQ(rig.handwheel.getBacklog(), 49);
+  ASSERT_EQ(rig.handwheel.getDroppedUnits(), 100 * 100 - 50);
+
+  rig.tickUntilSettled();
+  ASSERT_EQ(rig.leadscrew.getCurrentPosition(), 50);
+  ASSERT_EQ(rig.globalState.getMotionMode(),
+            GlobalMotionMode::DISABLED);
+}
+
+TEST(HandwheelTest, TestIgnoredWhileLockedOrEnabled) {
+  HandwheelRig rig;
+
+  rig.globalState.setButtonLock(GlobalButtonLock::LOCKED);
+  rig.turnDetents(5);
+  rig.tick();
+  rig.globalState.setButtonLock(GlobalButtonLock::UNLOCKED);
+  rig.tick();
+  ASSERT_FALSE(rig.handwheel.isJogging());
+  ASSERT_EQ(rig.leadscrew.getExpectedPosition(), 0);
+
+  rig.globalState.setMotionMode(GlobalMotionMode::ENABLED);
+  rig.turnDetents(5);
+  rig.tick();
+  rig.globalState.setMotionMode(GlobalMotionMode::DISABLED);
+  rig.tick();
+  ASSERT_FALSE(rig.handwheel.isJogging());
+  ASSERT_EQ(rig.leadscrew.getExpectedPosition(), 0);
+}
+
+TEST(HandwheelTest, TestJogEndsOnceCaughtUp) {
+  HandwheelRig rig;
+  rig.handwheel.setMultiplier(10);
+  rig.turnDetents(2);
+
+  int motorPosition = rig.leadscrewIo.getMotorPosition();
+  rig.tick();
+  ASSERT_TRUE(rig.handwheel.isJogging());
+  rig.tickUntilSettled();
+
+  ASSERT_FALSE(rig.handwheel.isJogging());
+  ASSERT_EQ(rig.globalState.getMotionMode(),
+            GlobalMotionMode::DISABLED);
+  ASSERT_EQ(rig.leadscrew.getPositionError(), 0);
+  ASSERT_GT(rig.leadscrewIo.getMotorPosition(), motorPosition);
+}
+
+TEST(HandwheelTest, TestTimerNeverChangesTheMotionMode) {
+  HandwheelRig rig;
+  rig.turnDetents(5);
+
+  // without the loop the turn waits, whatever the timer does
+  for (int i = 0; i < 100; i++) {
+    rig.startTick(HANDWHEEL_TEST_TICK_US);
+    rig.handwheel.update();
+    rig.finishTick();
+  }
+  ASSERT_TRUE(rig.handwheel.isJogging());
+  ASSERT_EQ(rig.globalState.getMotionMode(), GlobalMotionMode::DISABLED);
+  ASSERT_EQ(rig.leadscrew.getExpectedPosition(), 0);
+
+  // so enabling in the meantime sticks, and the waiting turn is dropped
+  rig.globalState.setMotionMode(GlobalMotionMode::ENABLED);
+  rig.tick();
+  ASSERT_FALSE(rig.handwheel.isJogging());
+  ASSERT_EQ(rig.globalState.getMotionMode(), GlobalMotionMode::ENABLED);
+  ASSERT_EQ(rig.leadscrew.getExpectedPosition(), 0);
+}
@@ -0,0 +1,116 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <idle_detector.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include "mocks/leadscrewio_mock.h"
+#include "mocks/spindleio_mock.h"
+
+#define IDLE_TEST_TICK_US 20
+#define IDLE_TEST_IDLE_TICK_US 1000
+#define IDLE_TEST_IDLE_AFTER_US 10000
+#define IDLE_TEST_RATIO 1.0
+
+TEST(IdleDetectorTest, TestSlowsDownAfterQuietPeriod) {
+  IdleDetector detector(IDLE_TEST_TICK_US, IDLE_TEST_IDLE_TICK_US,
+                        IDLE_TEST_IDLE_AFTER_US);
+
+  int quietTicks = IDLE_TEST_IDLE_AFTER_US / IDLE_TEST_TICK_US;
+  for (int i = 0; i < quietTicks - 1; i++) {
+    ASSERT_EQ(detector.update(false), IDLE_TEST_TICK_US);
+  }
+  ASSERT_FALSE(detector.isIdle());
+  ASSERT_EQ(detector.update(false), IDLE_TEST_IDLE_TICK_US);
+  ASSERT_TRUE(detector.isIdle());
+  ASSERT_EQ(detector.update(false), IDLE_TEST_IDLE_TICK_US);
+  ASSERT_EQ(detector.getIdleTicks(), 1);
+
+  // the first active tick goes straight back to the full rate
+  ASSERT_EQ(detector.update(true), IDLE_TEST_TICK_US);
+  ASSERT_FALSE(detector.isIdle());
+  ASSERT_EQ(detector.getWakeups(), 1);
+
+  // and activity restarts the quiet period
+  for (int i = 0; i < quietTicks - 1; i++) {
+    ASSERT_EQ(detector.update(false), IDLE_TEST_TICK_US);
+  }
+  ASSERT_EQ(detector.update(true), IDLE_TEST_TICK_US);
+  ASSERT_EQ(detector.getWakeups(), 1);
+}
+
+// one pass of the motion timer, the same as the firmware's timer callback
+uint32_t idleTestTick(IdleDetector& detector, Spindle& spindle,
+                      Leadscrew& leadscrew) {
+  spindle.update();
+  bool active = !spindle.isIdle() || !leadscrew.isIdle();
+  if (active) {
+    leadscrew.update();
+  }
+  return detector.update(active);
+}
+
+TEST(IdleDetectorTest, TestNoSpindleCountsLostWhileIdle) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  micros.setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  SpindleIOMock spindleIo;
+  Spindle spindle(&spindleIo);
+  LeadscrewIOMock io;
+  Leadscrew leadscrew(&spindle, &io, 0, 0, ELS_LEADSCREW_STEPPER_PPR,
+                      ELS_LEADSCREW_PITCH_MM);
+  leadscrew.setRatio(IDLE_TEST_RATIO);
+  IdleDetector detector(IDLE_TEST_TICK_US, IDLE_TEST_IDLE_TICK_US,
+                        IDLE_TEST_IDLE_AFTER_US);
+
+  // bursts of spindle movement at awkward times, some of them reversing. The
+  // pauses are longer than a count can be interpolated over, so the timer has
+  // time to drop to the idle rate
+  const int bursts[] = {7, 1, -3, 25, 2, -11, 40, 1, 1, -1};
+  const uint32_t burstGapUs = ELS_SPINDLE_INTERPOLATION_MAX_PERIOD_US +
+                              IDLE_TEST_IDLE_AFTER_US * 3 + 137;
+  int totalCounts = 0;
+  uint32_t nextBurst = burstGapUs;
+
+  for (int burst : bursts) {
+    // quiet until the burst, the encoder keeps counting between ticks so the
+    // burst lands part way through whatever tick we're on
+    while (micros.micros() < nextBurst) {
+      micros.incrementMicros(detector.getTickUs());
+      idleTestTick(detector, spindle, leadscrew);
+    }
+    ASSERT_TRUE(detector.isIdle());
+
+    int direction = burst > 0 ? 1 : -1;
+    for (int i = 0; i != burst; i += direction) {
+      spindleIo.rotate(direction);
+      totalCounts += direction;
+      micros.incrementMicros(detector.getTickUs());
+
+      // the first tick that sees the count is back at the full rate
+      ASSERT_EQ(idleTestTick(detector, spindle, leadscrew), IDLE_TEST_TICK_US);
+    }
+    nextBurst += burstGapUs;
+  }
+
+  // let the leadscrew catch up and settle
+  while (!detector.isIdle()) {
+    micros.incrementMicros(detector.getTickUs());
+    idleTestTick(detector, spindle, leadscrew);
+  }
+
+  ASSERT_EQ(spindle.getCurrentPosition(), totalCounts);
+  ASSERT_EQ(leadscrew.getCurrentPosition(), totalCounts * IDLE_TEST_RATIO);
+  ASSERT_EQ(leadscrew.getPositionError(), 0);
+  ASSERT_EQ(detector.getWakeups(), ARRAY_SIZE(bursts));
+  ASSERT_GT(detector.getIdleTicks(), 0);
+
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
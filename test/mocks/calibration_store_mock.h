@@ -0,0 +1,26 @@
+#include <calibration_store.h>
+
+#pragma once
+
+// keeps the limits in memory and counts the saves
+class CalibrationStoreMock : public CalibrationStore {
+  bool m_saved = false;
+  int m_saves = 0;
+  CalibrationLimits m_limits = {0, 0};
+
+ public:
+  bool load(CalibrationLimits* limits) override {
+    if (m_saved) {
+      *limits = m_limits;
+    }
+    return m_saved;
+  }
+  void save(const CalibrationLimits& limits) override {
+    m_limits = limits;
+    m_saved = true;
+    m_saves++;
+  }
+
+  int getSaves() { return m_saves; }
+  CalibrationLimits getLimits() { return m_limits; }
+};
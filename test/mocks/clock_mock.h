@@ -0,0 +1,17 @@
+#include <clock.h>
+
+#pragma once
+
+/**
+ * A clock that only moves when the test moves it, every object under test can
+ * have its own
+ */
+class ClockMock : public Clock {
+  uint64_t m_micros = 0;
+
+ public:
+  uint64_t nowMicros() override { return m_micros; }
+
+  void setMicros(uint64_t micros) { m_micros = micros; }
+  void incrementMicros(uint64_t micros) { m_micros += micros; }
+};
@@ -0,0 +1,13 @@
+#include <handwheel_io.h>
+
+#pragma once
+
+class HandwheelIOMock : public HandwheelIO {
+  int32_t m_count = 0;
+
+ public:
+  int32_t readEncoder() override { return m_count; }
+
+  // turn the wheel by `counts` encoder counts, negative is anticlockwise
+  void turn(int counts) { m_count += counts; }
+};
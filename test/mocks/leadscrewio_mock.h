@@ -3,12 +3,43 @@
 #pragma once
 
 class LeadscrewIOMock : public LeadscrewIO {
-  uint8_t m_stepPinState;
-  uint8_t m_dirPinState;
+  uint8_t m_stepPinState = 0;
+  uint8_t m_dirPinState = 0;
+
+  // every completed pulse, and where the motor would be because of them
+  int m_pulseCount = 0;
+  int m_motorPosition = 0;
+
+  // simulated motor encoder, the motor ignores pulses while it is losing steps
+  bool m_hasFeedback = false;
+  int m_stepsToLose = 0;
+  int m_feedbackPosition = 0;
 
  public:
-  void writeStepPin(uint8_t state) override { m_stepPinState = state; }
+  void writeStepPin(uint8_t state) override {
+    // the leadscrew counts a pulse on the falling edge
+    if (m_stepPinState == 1 && state == 0) {
+      m_pulseCount++;
+      m_motorPosition += m_dirPinState == 1 ? 1 : -1;
+      if (m_stepsToLose > 0) {
+        m_stepsToLose--;
+      } else {
+        m_feedbackPosition += m_dirPinState == 1 ? 1 : -1;
+      }
+    }
+    m_stepPinState = state;
+  }
   void writeDirPin(uint8_t state) override { m_dirPinState = state; }
   uint8_t readStepPin() override { return m_stepPinState; }
   uint8_t readDirPin() override { return m_dirPinState; }
-};
\ No newline at end of file
+
+  bool hasFeedback() override { return m_hasFeedback; }
+  int readFeedbackPosition() override { return m_feedbackPosition; }
+
+  void enableFeedback() { m_hasFeedback = true; }
+  // the next `steps` pulses won't move the motor
+  void loseSteps(int steps) { m_stepsToLose += steps; }
+
+  int getPulseCount() { return m_pulseCount; }
+  int getMotorPosition() { return m_motorPosition; }
+};
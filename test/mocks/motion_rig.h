@@ -0,0 +1,61 @@
+#include <config.h>
+#include <globalstate.h>
+#include <leadscrew.h>
+#include <motion_mailbox.h>
+#include <spindle.h>
+
+#include <cstdint>
+#include <utility>
+
+#include "clock_mock.h"
+#include "leadscrewio_mock.h"
+#include "spindleio_mock.h"
+
+#pragma once
+
+/**
+ * A spindle and leadscrew on their own clock and GlobalState, built through the
+ * constructors so nothing here touches the firmware's singletons. Tests that
+ * drive more of the machine build their rig around this one
+ *
+ * `IO` is the leadscrew's motor, it's built from whatever is passed after the
+ * pulse delays
+ */
+template <typename IO = LeadscrewIOMock>
+struct MotionRig {
+  ClockMock clock;
+  GlobalState globalState;
+  SpindleIOMock spindleIo;
+  IO leadscrewIo;
+  Spindle spindle;
+  Leadscrew leadscrew;
+  MotionMailbox mailbox;
+
+  template <typename... IOArgs>
+  explicit MotionRig(float initialPulseDelay = LEADSCREW_INITIAL_PULSE_DELAY_US,
+                     float pulseDelayIncrement = LEADSCREW_PULSE_DELAY_STEP_US,
+                     IOArgs&&... ioArgs)
+      : leadscrewIo(std::forward<IOArgs>(ioArgs)...),
+        spindle(&spindleIo, &globalState, &clock),
+        leadscrew(&spindle, &leadscrewIo, initialPulseDelay,
+                  pulseDelayIncrement, ELS_LEADSCREW_STEPPER_PPR,
+                  ELS_LEADSCREW_PITCH_MM, &globalState, &clock) {}
+
+  // the timer up to the spindle update, the handwheel is read after this
+  void startTick(uint64_t micros = LEADSCREW_TIMER_US) {
+    clock.incrementMicros(micros);
+    spindle.update();
+  }
+
+  // the rest of the timer, whatever the loop posted lands before the update
+  void finishTick() {
+    mailbox.apply(&leadscrew);
+    leadscrew.update();
+  }
+
+  // one motion timer tick, in the same order as the firmware
+  void tick(uint64_t micros = LEADSCREW_TIMER_US) {
+    startTick(micros);
+    finishTick();
+  }
+};
@@ -0,0 +1,136 @@
+#include <spi_tft.h>
+#include <spi_tft_io.h>
+
+#include <cstdint>
+#include <vector>
+
+#pragma once
+
+/**
+ * An emulated ILI9341/ST7789 on the other end of the bus, with the panel as
+ * RGB565 in memory. Address windows, memory writes and the controller set up
+ * are decoded like the real thing
+ *
+ * Pixel data can be made to take a number of isBusy() polls to go out, like
+ * DMA. It's only read once it's done, so a buffer changed while it was still
+ * being sent shows up on the panel
+ */
+class SpiTftIOMock : public SpiTftIO {
+  std::vector<uint16_t> m_panel;
+
+  int16_t m_windowLeft = 0;
+  int16_t m_windowRight = SPI_TFT_WIDTH - 1;
+  int16_t m_windowTop = 0;
+  int16_t m_windowBottom = SPI_TFT_HEIGHT - 1;
+  int16_t m_cursorX = 0;
+  int16_t m_cursorY = 0;
+  bool m_writing = false;
+
+  int m_busyPolls = 0;
+  int m_busyRemaining = 0;
+  const uint8_t* m_pendingData = nullptr;
+  size_t m_pendingSize = 0;
+
+  void applyData(const uint8_t* data, size_t size) {
+    for (size_t i = 0; i + 1 < size; i += 2) {
+      if (!m_writing || m_cursorY > m_windowBottom) {
+        return;
+      }
+      m_panel[m_cursorY * SPI_TFT_WIDTH + m_cursorX] =
+          (data[i] << 8) | data[i + 1];
+      if (++m_cursorX > m_windowRight) {
+        m_cursorX = m_windowLeft;
+        m_cursorY++;
+      }
+    }
+  }
+
+  static int16_t readWord(const uint8_t* data) {
+    return (data[0] << 8) | data[1];
+  }
+
+ public:
+  // what the controller was told
+  uint8_t madctl = 0;
+  uint8_t colmod = 0;
+  bool inverted = false;
+  bool on = false;
+
+  int windows = 0;
+  size_t dataBytes = 0;
+  // writes that came while pixel data was still going out
+  int writesWhileBusy = 0;
+
+  // a panel full of noise until something clears it
+  SpiTftIOMock() : m_panel(SPI_TFT_WIDTH * SPI_TFT_HEIGHT, 0x1234) {}
+
+  void begin() override {}
+
+  void writeCommand(uint8_t command, const uint8_t* data,
+                    size_t size) override {
+    if (m_busyRemaining > 0) {
+      writesWhileBusy++;
+    }
+    m_writing = false;
+    switch (command) {
+      case SPI_TFT_CASET:
+        m_windowLeft = readWord(data);
+        m_windowRight = readWord(data + 2);
+        windows++;
+        break;
+      case SPI_TFT_RASET:
+        m_windowTop = readWord(data);
+        m_windowBottom = readWord(data + 2);
+        break;
+      case SPI_TFT_RAMWR:
+        m_cursorX = m_windowLeft;
+        m_cursorY = m_windowTop;
+        m_writing = true;
+        break;
+      case SPI_TFT_MADCTL:
+        madctl = data[0];
+        break;
+      case SPI_TFT_COLMOD:
+        colmod = data[0];
+        break;
+      case SPI_TFT_INVON:
+        inverted = true;
+        break;
+      case SPI_TFT_DISPON:
+        on = true;
+        break;
+    }
+  }
+
+  void writeData(const uint8_t* data, size_t size) override {
+    if (m_busyRemaining > 0) {
+      writesWhileBusy++;
+    }
+    dataBytes += size;
+    if (m_busyPolls == 0) {
+      applyData(data, size);
+      return;
+    }
+    m_pendingData = data;
+    m_pendingSize = size;
+    m_busyRemaining = m_busyPolls;
+  }
+
+  bool isBusy() override {
+    if (m_busyRemaining == 0) {
+      return false;
+    }
+    if (--m_busyRemaining == 0) {
+      applyData(m_pendingData, m_pendingSize);
+    }
+    return true;
+  }
+
+  void waitMillis(uint32_t millis) override {}
+
+  // every writeData takes this many isBusy() polls to finish
+  void setBusyPolls(int polls) { m_busyPolls = polls; }
+  uint16_t getPanelPixel(int16_t x, int16_t y) {
+    return m_panel[y * SPI_TFT_WIDTH + x];
+  }
+};
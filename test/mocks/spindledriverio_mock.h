@@ -0,0 +1,28 @@
+#include <spindle_driver_io.h>
+
+#pragma once
+
+class SpindleDriverIOMock : public SpindleDriverIO {
+  uint8_t m_stepPinState = 0;
+  uint8_t m_dirPinState = 0;
+
+  // where the spindle would be because of the completed pulses
+  int m_pulseCount = 0;
+  int m_motorPosition = 0;
+
+ public:
+  void writeStepPin(uint8_t state) override {
+    // the spindle counts a pulse on the falling edge
+    if (m_stepPinState == 1 && state == 0) {
+      m_pulseCount++;
+      m_motorPosition += m_dirPinState == 1 ? 1 : -1;
+    }
+    m_stepPinState = state;
+  }
+  void writeDirPin(uint8_t state) override { m_dirPinState = state; }
+  uint8_t readStepPin() override { return m_stepPinState; }
+  uint8_t readDirPin() override { return m_dirPinState; }
+
+  int getPulseCount() { return m_pulseCount; }
+  int getMotorPosition() { return m_motorPosition; }
+};
@@ -0,0 +1,50 @@
+#include <spindle_io.h>
+
+#pragma once
+
+/**
+ * A simulated spindle encoder with an index at angle 0
+ * The true angle is tracked separately from the count so miscounts can be
+ * injected
+ */
+class SpindleIOMock : public SpindleIO {
+  int32_t m_count = 0;
+  int m_trueAngle = 0;
+  bool m_hasIndex = false;
+  bool m_indexPending = false;
+  int32_t m_countAtIndex = 0;
+
+ public:
+  int32_t readEncoder() override { return m_count; }
+
+  bool consumeIndex(int32_t* encoderCountAtIndex) override {
+    if (!m_indexPending) {
+      return false;
+    }
+    *encoderCountAtIndex = m_countAtIndex;
+    m_indexPending = false;
+    return true;
+  }
+
+  void enableIndex() { m_hasIndex = true; }
+
+  // turn the spindle by `counts`, one count at a time
+  void rotate(int counts) {
+    int direction = counts > 0 ? 1 : -1;
+    for (int i = 0; i != counts; i += direction) {
+      m_count += direction;
+      m_trueAngle =
+          (m_trueAngle + direction + ELS_SPINDLE_ENCODER_PPR) %
+          ELS_SPINDLE_ENCODER_PPR;
+      if (m_hasIndex && m_trueAngle == 0) {
+        m_countAtIndex = m_count;
+        m_indexPending = true;
+      }
+    }
+  }
+
+  // counts that the encoder sees but the spindle didn't actually turn
+  void miscount(int counts) { m_count += counts; }
+
+  int getTrueAngle() { return m_trueAngle; }
+};
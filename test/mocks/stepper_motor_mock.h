@@ -0,0 +1,122 @@
+#include <leadscrew_io.h>
+#include <math.h>
+
+#include <algorithm>
+
+#pragma once
+
+// how finely advance() integrates the rotor
+#define STEPPER_MOTOR_MOCK_STEP_S 5e-6
+// a rotor more than this many steps behind its detent slips
+#define STEPPER_MOTOR_MOCK_SLIP_STEPS 2
+
+/**
+ * A stepper that can stall, in steps
+ *
+ * Every pulse moves the detent the rotor is pulled towards. The pull is a
+ * spring with some damping, limited by a torque that falls off linearly to
+ * nothing at `maxSpeed`. Asked for more acceleration than the torque allows
+ * the rotor falls behind, and once it's more than a couple of steps behind it
+ * slips and ignores every pulse until it has coasted down to `pullInSpeed`,
+ * then locks onto the nearest detent. The encoder reads where the rotor really
+ * is. advance() moves the rotor on, call it as time passes
+ */
+class StepperMotorMock : public LeadscrewIO {
+  uint8_t m_stepPinState = 0;
+  uint8_t m_dirPinState = 0;
+  bool m_hasFeedback = false;
+
+  double m_maxAcceleration;
+  double m_maxSpeed;
+  double m_pullInSpeed;
+  double m_naturalFrequency;
+
+  // every pulse sent and the detent they've put the rotor on
+  int m_pulses = 0;
+  int m_detent = 0;
+  double m_position = 0;
+  double m_velocity = 0;
+  // the speed of the pulse train, what the damping pulls the rotor towards
+  double m_pulseVelocity = 0;
+  double m_sinceLastPulse = 1;
+  double m_lastPulseInterval = 1;
+  bool m_slipping = false;
+  int m_stalls = 0;
+
+ public:
+  StepperMotorMock(double maxAcceleration, double maxSpeed,
+                   double pullInSpeed, double naturalFrequency)
+      : m_maxAcceleration(maxAcceleration),
+        m_maxSpeed(maxSpeed),
+        m_pullInSpeed(pullInSpeed),
+        m_naturalFrequency(naturalFrequency) {}
+
+  void writeStepPin(uint8_t state) override {
+    // a pulse is counted on the falling edge like LeadscrewIOMock
+    if (m_stepPinState == 1 && state == 0) {
+      int direction = m_dirPinState == 1 ? 1 : -1;
+      m_pulses += direction;
+      if (!m_slipping) {
+        m_detent += direction;
+      }
+      m_pulseVelocity = direction / m_sinceLastPulse;
+      m_lastPulseInterval = m_sinceLastPulse;
+      m_sinceLastPulse = 0;
+    }
+    m_stepPinState = state;
+  }
+  void writeDirPin(uint8_t state) override { m_dirPinState = state; }
+  uint8_t readStepPin() override { return m_stepPinState; }
+  uint8_t readDirPin() override { return m_dirPinState; }
+
+  bool hasFeedback() override { return m_hasFeedback; }
+  int readFeedbackPosition() override { return lround(m_position); }
+
+  void enableFeedback() { m_hasFeedback = true; }
+
+  void advance(double seconds) {
+    for (double t = 0; t < seconds; t += STEPPER_MOTOR_MOCK_STEP_S) {
+      double dt = STEPPER_MOTOR_MOCK_STEP_S;
+      m_sinceLastPulse += dt;
+      // the pulse train has stopped
+      if (m_sinceLastPulse > 2 * m_lastPulseInterval) {
+        m_pulseVelocity = 0;
+      }
+
+      double limit = m_maxAcceleration *
+                     std::max(0.0, 1 - fabs(m_velocity) / m_maxSpeed);
+      double acceleration;
+      if (m_slipping) {
+        // coasting down against the detents
+        acceleration = m_velocity > 0 ? -limit / 4 : limit / 4;
+      } else {
+        acceleration = m_naturalFrequency * m_naturalFrequency *
+                           (m_detent - m_position) +
+                       1.4 * m_naturalFrequency *
+                           (m_pulseVelocity - m_velocity);
+        acceleration = std::min(std::max(acceleration, -limit), limit);
+      }
+      m_velocity += acceleration * dt;
+      m_position += m_velocity * dt;
+
+      if (!m_slipping &&
+          fabs(m_detent - m_position) > STEPPER_MOTOR_MOCK_SLIP_STEPS) {
+        m_slipping = true;
+        m_stalls++;
+      }
+      if (m_slipping && fabs(m_velocity) < m_pullInSpeed) {
+        m_slipping = false;
+        m_detent = lround(m_position);
+      }
+    }
+  }
+
+  // the pulses that never moved the rotor
+  int getLostSteps() { return m_pulses - m_detent; }
+  int getStalls() { return m_stalls; }
+  // as if the carriage had been jogged back to where the pulses say it is
+  void realign() {
+    m_position += getLostSteps();
+    m_detent = m_pulses;
+  }
+};
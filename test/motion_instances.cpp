@@ -0,0 +1,40 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include "mocks/motion_rig.h"
+
+// a spindle and leadscrew with nothing shared, like every thread of the sweep
+struct IndependentMachine : MotionRig<> {
+  IndependentMachine() : MotionRig(0, 0) { leadscrew.setRatio(1); }
+};
+
+TEST(MotionInstancesTest, TestMachinesHaveTheirOwnModes) {
+  GlobalState* shared = GlobalState::getInstance();
+  shared->setMotionMode(GlobalMotionMode::DISABLED);
+
+  IndependentMachine enabled;
+  IndependentMachine disabled;
+  enabled.globalState.setMotionMode(GlobalMotionMode::ENABLED);
+
+  for (int i = 0; i < 1000; i++) {
+    if (i % 10 == 0) {
+      enabled.spindleIo.rotate(1);
+      disabled.spindleIo.rotate(1);
+    }
+    enabled.tick(LEADSCREW_TIMER_US);
+    disabled.tick(LEADSCREW_TIMER_US);
+  }
+
+  // only the enabled machine follows its spindle, the shared state is untouched
+  ASSERT_GT(enabled.leadscrewIo.getPulseCount(), 0);
+  ASSERT_EQ(disabled.leadscrewIo.getPulseCount(), 0);
+  ASSERT_EQ(shared->getMotionMode(), GlobalMotionMode::DISABLED);
+}
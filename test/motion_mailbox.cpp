@@ -0,0 +1,155 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <motion_mailbox.h>
+#include <spindle.h>
+
+#include <atomic>
+#include <thread>
+
+#include "mocks/motion_rig.h"
+
+#define MAILBOX_TEST_COMMANDS 2000
+
+struct MailboxRig : MotionRig<> {
+  MailboxRig() { leadscrew.setRatio(1); }
+};
+
+TEST(MotionMailboxTest, TestCommandsWaitForTheTimer) {
+  MailboxRig rig;
+
+  rig.mailbox.postSetStopPosition(Leadscrew::StopPosition::LEFT, -100);
+  rig.mailbox.postSetStopPosition(Leadscrew::StopPosition::RIGHT, 100);
+  rig.mailbox.postSetRatio(2);
+
+  // nothing changes until the timer gets to it
+  ASSERT_TRUE(rig.mailbox.isPending());
+  ASSERT_EQ(rig.leadscrew.getStopPositionState(Leadscrew::StopPosition::LEFT),
+            LeadscrewStopState::UNSET);
+  ASSERT_EQ(rig.leadscrew.getRatio(), 1);
+
+  ASSERT_EQ(rig.mailbox.apply(&rig.leadscrew), 3);
+  ASSERT_FALSE(rig.mailbox.isPending());
+  // the ratio was set after the stops, so they were scaled with the position
+  ASSERT_EQ(rig.leadscrew.getStopPosition(Leadscrew::StopPosition::LEFT), -200);
+  ASSERT_EQ(rig.leadscrew.getStopPosition(Leadscrew::StopPosition::RIGHT), 200);
+  ASSERT_EQ(rig.leadscrew.getRatio(), 2);
+
+  // commands are applied in order, the last one wins
+  rig.mailbox.postSetStopPosition(Leadscrew::StopPosition::RIGHT, 50);
+  rig.mailbox.postUnsetStopPosition(Leadscrew::StopPosition::RIGHT);
+  rig.mailbox.apply(&rig.leadscrew);
+  ASSERT_EQ(rig.leadscrew.getStopPositionState(Leadscrew::StopPosition::RIGHT),
+            LeadscrewStopState::UNSET);
+}
+
+TEST(MotionMailboxTest, TestThreadStartsWaitForTheTimer) {
+  MailboxRig rig;
+
+  rig.mailbox.postSetThreadStarts(4);
+  rig.mailbox.postNextThreadStart();
+  ASSERT_EQ(rig.leadscrew.getThreadStarts(), 1);
+  ASSERT_EQ(rig.leadscrew.getThreadStart(), 0);
+
+  ASSERT_EQ(rig.mailbox.apply(&rig.leadscrew), 2);
+  ASSERT_EQ(rig.leadscrew.getThreadStarts(), 4);
+  ASSERT_EQ(rig.leadscrew.getThreadStart(), 1);
+
+  // the count was picked again, so the passes start over
+  rig.mailbox.postSetThreadStarts(2);
+  rig.mailbox.apply(&rig.leadscrew);
+  ASSERT_EQ(rig.leadscrew.getThreadStarts(), 2);
+  ASSERT_EQ(rig.leadscrew.getThreadStart(), 0);
+}
+
+TEST(MotionMailboxTest, TestFullMailboxDropsCommands) {
+  MailboxRig rig;
+
+  // one slot is always kept empty
+  for (int i = 0; i < MOTION_MAILBOX_SIZE - 1; i++) {
+    ASSERT_TRUE(rig.mailbox.postIncrementCurrentPosition(1));
+  }
+  ASSERT_FALSE(rig.mailbox.postIncrementCurrentPosition(1));
+  ASSERT_EQ(rig.mailbox.getDroppedCommands(), 1);
+
+  rig.mailbox.apply(&rig.leadscrew);
+  ASSERT_EQ(rig.leadscrew.getCurrentPosition(), MOTION_MAILBOX_SIZE - 1);
+  ASSERT_TRUE(rig.mailbox.postIncrementCurrentPosition(1));
+}
+
+// runs a move with the ratio changed before the given tick, either straight
+// away or through the mailbox, returns the pulses sent
+int runMailboxRatioChange(int changeAt, bool throughMailbox) {
+  MailboxRig rig;
+  rig.globalState.setMotionMode(GlobalMotionMode::ENABLED);
+
+  for (int tick = 0; tick < 8000; tick++) {
+    if (tick < 400 && tick % 4 == 0) {
+      rig.spindleIo.rotate(1);
+    }
+    if (tick == changeAt) {
+      if (throughMailbox) {
+        rig.mailbox.postSetRatio(2);
+      } else {
+        rig.leadscrew.setRatio(2);
+      }
+    }
+    rig.tick();
+  }
+
+  EXPECT_EQ(rig.leadscrew.getRatio(), 2);
+  EXPECT_EQ(rig.leadscrew.getPositionError(), 0);
+  return rig.leadscrewIo.getPulseCount();
+}
+
+TEST(MotionMailboxTest, TestRatioChangeAtEveryPointOfAMove) {
+  // wherever in the move the ratio is posted, it lands between two updates
+  // exactly as if it had been set there with the timer stopped
+  for (int changeAt = 0; changeAt < 400; changeAt += 3) {
+    ASSERT_EQ(runMailboxRatioChange(changeAt, true),
+              runMailboxRatioChange(changeAt, false))
+        << "ratio changed at tick " << changeAt;
+  }
+}
+
+TEST(MotionMailboxTest, TestLoopAndTimerOnSeparateThreads) {
+  MailboxRig rig;
+  std::atomic<bool> posted(false);
+
+  // the loop posts as fast as it can, retrying whenever the mailbox is full
+  std::thread loop([&rig, &posted]() {
+    for (int i = 1; i <= MAILBOX_TEST_COMMANDS; i++) {
+      while (!rig.mailbox.postIncrementCurrentPosition(i)) {
+        std::this_thread::yield();
+      }
+      while (!rig.mailbox.postSetStopPosition(Leadscrew::StopPosition::RIGHT,
+                                              i)) {
+        std::this_thread::yield();
+      }
+    }
+    posted = true;
+  });
+
+  // the timer applies whatever has arrived, interleaving with the posts
+  int applied = 0;
+  while (!posted || rig.mailbox.isPending()) {
+    int count = rig.mailbox.apply(&rig.leadscrew);
+    if (count == 0) {
+      std::this_thread::yield();
+    }
+    applied += count;
+  }
+  loop.join();
+  applied += rig.mailbox.apply(&rig.leadscrew);
+
+  ASSERT_EQ(applied, MAILBOX_TEST_COMMANDS * 2);
+  ASSERT_EQ(rig.leadscrew.getCurrentPosition(),
+            MAILBOX_TEST_COMMANDS * (MAILBOX_TEST_COMMANDS + 1) / 2);
+  ASSERT_EQ(rig.leadscrew.getStopPosition(Leadscrew::StopPosition::RIGHT),
+            MAILBOX_TEST_COMMANDS);
+}
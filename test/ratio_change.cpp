@@ -0,0 +1,225 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "mocks/motion_rig.h"
+
+// 750 RPM, one encoder count every 10 ticks
+#define RATIO_CHANGE_TICKS_PER_COUNT 10
+#define RATIO_CHANGE_SETTLE_TICKS 50000
+#define RATIO_CHANGE_RUN_TICKS 100000
+// positions ahead of the carriage a stop is set, close enough to get there
+// before a ramp between 0.25 and 1 finishes
+#define RATIO_CHANGE_STOP_DISTANCE 150
+
+struct RatioChangeRun {
+  // the most the carriage moved backwards at any point
+  int reversedSteps;
+  int maxError;
+  // the shortest time between two pulses after the change
+  uint64_t shortestPulseMicros;
+  uint64_t steadyPulseMicros;
+  float finalRatio;
+};
+
+struct RatioChangeRig : MotionRig<> {
+  int ticks;
+
+  RatioChangeRig(GlobalFeedMode feedMode, float ratio) : ticks(0) {
+    globalState.setFeedMode(feedMode);
+    globalState.setMotionMode(GlobalMotionMode::ENABLED);
+    leadscrew.setRatio(ratio);
+  }
+
+  void step() {
+    if (ticks % RATIO_CHANGE_TICKS_PER_COUNT == 0) {
+      spindleIo.rotate(1);
+    }
+    ticks++;
+    tick();
+  }
+
+  // feeds at the first ratio, changes to the second at speed and carries on,
+  // either ramping or rescaling the position like setRatio always did
+  RatioChangeRun changeAtSpeed(float ratio, bool ramp) {
+    for (int i = 0; i < RATIO_CHANGE_SETTLE_TICKS; i++) {
+      step();
+    }
+    if (ramp) {
+      leadscrew.changeRatio(ratio);
+    } else {
+      leadscrew.setRatio(ratio);
+    }
+
+    RatioChangeRun run = {0, 0, UINT64_MAX, 0, 0};
+    int furthest = leadscrewIo.getMotorPosition();
+    int pulses = leadscrewIo.getPulseCount();
+    uint64_t lastPulseMicros = 0;
+    for (int i = 0; i < RATIO_CHANGE_RUN_TICKS; i++) {
+      step();
+
+      int position = leadscrewIo.getMotorPosition();
+      if (furthest - position > run.reversedSteps) {
+        run.reversedSteps = furthest - position;
+      }
+      if (position > furthest) {
+        furthest = position;
+      }
+      if (abs(leadscrew.getPositionError()) > run.maxError) {
+        run.maxError = abs(leadscrew.getPositionError());
+      }
+
+      if (leadscrewIo.getPulseCount() != pulses) {
+        pulses = leadscrewIo.getPulseCount();
+        if (lastPulseMicros != 0) {
+          uint64_t interval = clock.nowMicros() - lastPulseMicros;
+          if (interval < run.shortestPulseMicros) {
+            run.shortestPulseMicros = interval;
+          }
+          run.steadyPulseMicros = interval;
+        }
+        lastPulseMicros = clock.nowMicros();
+      }
+    }
+    run.finalRatio = leadscrew.getRatio();
+    return run;
+  }
+
+  /**
+   * Sets a stop `distance` positions ahead at speed, changes to `ratio` and
+   * feeds into the stop. Returns how many pulses the carriage went from where
+   * the stop was set, `rampedToStop` is if the ramp was still going when the
+   * carriage got there
+   */
+  int feedToStop(int distance, float ratio, bool* rampedToStop) {
+    for (int i = 0; i < RATIO_CHANGE_SETTLE_TICKS; i++) {
+      step();
+    }
+    int start = leadscrewIo.getMotorPosition();
+    leadscrew.setStopPosition(Leadscrew::StopPosition::RIGHT,
+                              leadscrew.getCurrentPosition() + distance);
+    leadscrew.changeRatio(ratio);
+
+    *rampedToStop = false;
+    bool atStop = false;
+    for (int i = 0; i < RATIO_CHANGE_RUN_TICKS; i++) {
+      step();
+      if (!atStop && leadscrew.isAtStop()) {
+        atStop = true;
+        *rampedToStop = leadscrew.getRatio() != leadscrew.getTargetRatio();
+      }
+    }
+    return leadscrewIo.getMotorPosition() - start;
+  }
+};
+
+TEST(RatioChangeTest, TestFeedIncreaseAtSpeed) {
+  RatioChangeRig rig(GlobalFeedMode::FEED, 0.25);
+  RatioChangeRun run = rig.changeAtSpeed(0.5, true);
+
+  ASSERT_EQ(run.finalRatio, 0.5);
+  ASSERT_EQ(run.reversedSteps, 0);
+  ASSERT_LT(run.maxError, 20);
+  // the leadscrew never goes faster than it ends up going
+  ASSERT_GE(run.shortestPulseMicros, run.steadyPulseMicros);
+}
+
+TEST(RatioChangeTest, TestFeedDecreaseAtSpeed) {
+  RatioChangeRig rig(GlobalFeedMode::FEED, 0.5);
+  RatioChangeRun settled = rig.changeAtSpeed(0.5, true);
+
+  RatioChangeRun run = rig.changeAtSpeed(0.25, true);
+  ASSERT_EQ(run.finalRatio, 0.25);
+  ASSERT_EQ(run.reversedSteps, 0);
+  ASSERT_LT(run.maxError, 20);
+  // and never faster than it already was
+  ASSERT_GE(run.shortestPulseMicros, settled.shortestPulseMicros);
+  ASSERT_GT(run.steadyPulseMicros, settled.steadyPulseMicros);
+}
+
+TEST(RatioChangeTest, TestRescalingAtSpeedBursts) {
+  // what the ramp avoids, rescaling the position at speed either runs the
+  // carriage back or sends a burst of pulses to catch up
+  RatioChangeRig increase(GlobalFeedMode::FEED, 0.25);
+  RatioChangeRun run = increase.changeAtSpeed(0.5, false);
+  ASSERT_GT(run.reversedSteps, 0);
+  ASSERT_LT(run.shortestPulseMicros, run.steadyPulseMicros);
+
+  RatioChangeRig decrease(GlobalFeedMode::FEED, 0.5);
+  run = decrease.changeAtSpeed(0.25, false);
+  ASSERT_GT(run.maxError, 20);
+}
+
+TEST(RatioChangeTest, TestThreadChangeStillRescales) {
+  // threads must stay in phase with the spindle, there's nothing to ramp
+  RatioChangeRig rig(GlobalFeedMode::THREAD, 0.25);
+  rig.changeAtSpeed(0.25, true);
+  int position = rig.leadscrew.getCurrentPosition();
+
+  rig.leadscrew.changeRatio(0.5);
+  ASSERT_EQ(rig.leadscrew.getRatio(), 0.5);
+  ASSERT_EQ(rig.leadscrew.getCurrentPosition(), position * 2);
+}
+
+TEST(RatioChangeTest, TestStoppedSpindleChangesStraightAway) {
+  RatioChangeRig rig(GlobalFeedMode::FEED, 0.25);
+  rig.leadscrew.changeRatio(0.5);
+  rig.tick();
+  ASSERT_EQ(rig.leadscrew.getRatio(), 0.5);
+}
+
+TEST(RatioChangeTest, TestStopStaysPutDuringARamp) {
+  float changes[][2] = {{0.25, 1}, {1, 0.25}};
+  for (auto& change : changes) {
+    // where the carriage stops without a ratio change is where the stop is
+    RatioChangeRig steady(GlobalFeedMode::FEED, change[0]);
+    bool ramped;
+    int stop =
+        steady.feedToStop(RATIO_CHANGE_STOP_DISTANCE, change[0], &ramped);
+    ASSERT_FALSE(ramped);
+
+    // every position is worth more pulses at a bigger ratio, so a stop left
+    // alone would move further away as the ratio ramps up
+    RatioChangeRig rig(GlobalFeedMode::FEED, change[0]);
+    int stopped =
+        rig.feedToStop(RATIO_CHANGE_STOP_DISTANCE, change[1], &ramped);
+    ASSERT_TRUE(ramped) << change[0] << " to " << change[1];
+    ASSERT_NEAR(stopped, stop, 2) << change[0] << " to " << change[1];
+  }
+}
+
+TEST(RatioChangeTest, TestModeChangeFinishesTheRamp) {
+  RatioChangeRig disable(GlobalFeedMode::FEED, 0.25);
+  disable.changeAtSpeed(0.25, true);
+  disable.leadscrew.changeRatio(0.5);
+  disable.step();
+  ASSERT_NE(disable.leadscrew.getRatio(), 0.5);
+
+  disable.globalState.setMotionMode(GlobalMotionMode::DISABLED);
+  disable.step();
+  ASSERT_EQ(disable.leadscrew.getRatio(), 0.5);
+
+  // threads can't ramp, the position is rescaled the way setRatio does
+  RatioChangeRig thread(GlobalFeedMode::FEED, 0.25);
+  thread.changeAtSpeed(0.25, true);
+  thread.leadscrew.changeRatio(0.5);
+  thread.step();
+  float ratio = thread.leadscrew.getRatio();
+  ASSERT_NE(ratio, 0.5);
+  int position = thread.leadscrew.getCurrentPosition();
+
+  thread.globalState.setFeedMode(GlobalFeedMode::THREAD);
+  thread.leadscrew.update();
+  ASSERT_EQ(thread.leadscrew.getRatio(), 0.5);
+  ASSERT_NEAR(thread.leadscrew.getCurrentPosition(), position / ratio * 0.5,
+              1);
+}
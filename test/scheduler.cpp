@@ -0,0 +1,124 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <els_elapsedMillis.h>
+#include <gmock/gmock.h>
+#include <scheduler.h>
+
+#include <string>
+
+using std::string;
+
+// the tasks have to be plain function pointers, so they record into globals
+static string taskLog;
+static unsigned long fastTaskCost = 0;
+static unsigned long slowTaskCost = 0;
+
+void fastTask() {
+  taskLog += "f";
+  MicrosSingleton::getInstance().incrementMicros(fastTaskCost);
+}
+
+void slowTask() {
+  taskLog += "s";
+  MicrosSingleton::getInstance().incrementMicros(slowTaskCost);
+}
+
+// runs the scheduler for the given amount of time in 1us steps
+void runFor(Scheduler& scheduler, unsigned long us) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  unsigned long end = micros.micros() + us;
+  while (micros.micros() < end) {
+    if (!scheduler.run()) {
+      micros.incrementMicros();
+    }
+  }
+}
+
+TEST(SchedulerTest, TestTasksRunAtTheirPeriod) {
+  MicrosSingleton::getInstance().setMicros(0);
+  taskLog = "";
+  fastTaskCost = 0;
+  slowTaskCost = 0;
+
+  Scheduler scheduler;
+  int fast = scheduler.addTask("fast", fastTask, 1000);
+  int slow = scheduler.addTask("slow", slowTask, 33333);
+
+  runFor(scheduler, 100000);
+
+  ASSERT_EQ(scheduler.getTask(fast)->runCount, 100);
+  ASSERT_EQ(scheduler.getTask(slow)->runCount, 4);
+  ASSERT_EQ(scheduler.getTask(fast)->maxLatenessUs, 0);
+  ASSERT_EQ(scheduler.getTask(fast)->missedDeadlines, 0);
+}
+
+TEST(SchedulerTest, TestEarliestDeadlineRunsFirst) {
+  MicrosSingleton::getInstance().setMicros(0);
+  taskLog = "";
+  fastTaskCost = 0;
+  slowTaskCost = 0;
+
+  Scheduler scheduler;
+  // the slow task is added first, but the fast task has the tighter deadline
+  scheduler.addTask("slow", slowTask, 33333);
+  scheduler.addTask("fast", fastTask, 1000);
+
+  scheduler.run();
+  scheduler.run();
+  ASSERT_EQ(taskLog, "fs");
+  ASSERT_FALSE(scheduler.run());
+}
+
+TEST(SchedulerTest, TestSlowTaskLatenessIsRecorded) {
+  MicrosSingleton::getInstance().setMicros(0);
+  taskLog = "";
+  fastTaskCost = 10;
+  slowTaskCost = 5000;
+
+  Scheduler scheduler;
+  int fast = scheduler.addTask("fast", fastTask, 1000);
+  int slow = scheduler.addTask("slow", slowTask, 33333);
+
+  runFor(scheduler, 100000);
+
+  const SchedulerTask* fastStats = scheduler.getTask(fast);
+  const SchedulerTask* slowStats = scheduler.getTask(slow);
+
+  ASSERT_EQ(slowStats->maxRunTimeUs, 5000);
+  ASSERT_EQ(slowStats->lastRunTimeUs, 5000);
+  ASSERT_EQ(fastStats->maxRunTimeUs, 10);
+
+  // the fast task runs first at t=0, the slow task starts at t=10 and blocks
+  // the fast task until t=5010, so its t=1000 release is at least 4010us late.
+  // It can never be later than one slow run plus one fast run
+  ASSERT_GE(fastStats->maxLatenessUs, 4010);
+  ASSERT_LE(fastStats->maxLatenessUs, slowTaskCost + fastTaskCost);
+  ASSERT_GT(fastStats->missedDeadlines, 0);
+
+  // a 5ms stall is more than a period, the missed releases are skipped rather
+  // than run back to back
+  ASSERT_GT(fastStats->skippedReleases, 0);
+  ASSERT_LE(fastStats->runCount, 100);
+}
+
+TEST(SchedulerTest, TestSurvivesMicrosWrap) {
+  MicrosSingleton::getInstance().setMicros(UINT32_MAX - 2500);
+  taskLog = "";
+  fastTaskCost = 0;
+  slowTaskCost = 0;
+
+  Scheduler scheduler;
+  int fast = scheduler.addTask("fast", fastTask, 1000);
+
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  for (int i = 0; i < 10000; i++) {
+    if (!scheduler.run()) {
+      micros.setMicros((uint32_t)(micros.micros() + 1));
+    }
+  }
+
+  ASSERT_EQ(scheduler.getTask(fast)->runCount, 10);
+  ASSERT_EQ(scheduler.getTask(fast)->maxLatenessUs, 0);
+}
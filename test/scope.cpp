@@ -0,0 +1,159 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <scope.h>
+#include <spindle.h>
+
+#include <vector>
+
+using std::vector;
+
+#include "mocks/motion_rig.h"
+
+#define SCOPE_TEST_TICK_US 20
+#define SCOPE_TEST_TICKS_PER_COUNT 100
+
+struct ScopeRig : MotionRig<> {
+  Scope scope;
+
+  ScopeRig() : scope(&spindle, &leadscrew, &globalState, &clock) {
+    globalState.setMotionMode(GlobalMotionMode::ENABLED);
+    leadscrew.setRatio(1.0);
+  }
+
+  // one motion timer tick, the scope samples at the end like the firmware
+  void tick() {
+    MotionRig::tick(SCOPE_TEST_TICK_US);
+    scope.sample();
+  }
+
+  // a steady spindle, turning `direction` every few ticks
+  void run(int ticks, int direction = 1) {
+    for (int i = 0; i < ticks; i++) {
+      if (i % SCOPE_TEST_TICKS_PER_COUNT == 0) {
+        spindleIo.rotate(direction);
+      }
+      tick();
+    }
+  }
+
+  vector<vector<int32_t>> readCapture() {
+    vector<vector<int32_t>> capture;
+    vector<int32_t> values(scope.getChannelCount());
+    for (int i = 0; scope.readSample(i, values.data()); i++) {
+      capture.push_back(values);
+    }
+    return capture;
+  }
+};
+
+const ScopeChannel scopeTestChannels[] = {TIME_US, SPINDLE_POSITION,
+                                          POSITION_ERROR, DIRECTION};
+
+TEST(ScopeTest, TestChannelsShareTheBuffer) {
+  ScopeRig rig;
+
+  ASSERT_TRUE(rig.scope.setChannels(scopeTestChannels, 4));
+  ASSERT_EQ(rig.scope.getDepth(), SCOPE_BUFFER_WORDS / 4);
+  ASSERT_TRUE(rig.scope.setChannels(scopeTestChannels, 1));
+  ASSERT_EQ(rig.scope.getDepth(), SCOPE_BUFFER_WORDS);
+  ASSERT_FALSE(rig.scope.setChannels(scopeTestChannels, 0));
+  ASSERT_FALSE(
+      rig.scope.setChannels(scopeTestChannels, SCOPE_MAX_CHANNELS + 1));
+
+  // the channels can't change under a capture
+  rig.scope.arm(ScopeTrigger::ERROR_ABOVE, 1000, 10);
+  ASSERT_FALSE(rig.scope.setChannels(scopeTestChannels, 4));
+  rig.scope.disarm();
+  ASSERT_TRUE(rig.scope.setChannels(scopeTestChannels, 4));
+}
+
+TEST(ScopeTest, TestCapturesAroundAGlitch) {
+  ScopeRig rig;
+  rig.scope.setChannels(scopeTestChannels, 4);
+  int depth = rig.scope.getDepth();
+  int preTrigger = 100;
+  int threshold = 20;
+
+  // a steady spindle that the leadscrew keeps up with
+  rig.run(SCOPE_TEST_TICKS_PER_COUNT * 50);
+  rig.scope.arm(ScopeTrigger::ERROR_ABOVE, threshold, preTrigger);
+  rig.run(SCOPE_TEST_TICKS_PER_COUNT * 50);
+  ASSERT_EQ(rig.scope.getState(), ScopeState::ARMED);
+
+  // the encoder glitches and jumps a load of counts in one tick
+  rig.spindleIo.miscount(threshold * 2);
+  rig.tick();
+  ASSERT_EQ(rig.scope.getState(), ScopeState::TRIGGERED);
+
+  // nothing to read until the post trigger part is full
+  int32_t values[4];
+  ASSERT_FALSE(rig.scope.readSample(0, values));
+  rig.run(depth - preTrigger - 2);
+  ASSERT_EQ(rig.scope.getState(), ScopeState::TRIGGERED);
+  rig.run(1);
+  ASSERT_EQ(rig.scope.getState(), ScopeState::DONE);
+
+  vector<vector<int32_t>> capture = rig.readCapture();
+  ASSERT_EQ(capture.size(), depth);
+  ASSERT_EQ(rig.scope.getTriggerSample(), preTrigger);
+
+  // the trigger sample is the first one past the threshold
+  int trigger = rig.scope.getTriggerSample();
+  ASSERT_GT(abs(capture[trigger][2]), threshold);
+  for (int i = 0; i < trigger; i++) {
+    ASSERT_LE(abs(capture[i][2]), threshold);
+  }
+  ASSERT_EQ(capture[trigger][1] - capture[trigger - 1][1], threshold * 2);
+
+  // every tick was recorded, with no gaps
+  for (int i = 1; i < depth; i++) {
+    ASSERT_EQ(capture[i][0] - capture[i - 1][0], SCOPE_TEST_TICK_US);
+  }
+
+  // the capture stays put while the motion carries on
+  rig.run(1000);
+  ASSERT_EQ(rig.readCapture(), capture);
+}
+
+TEST(ScopeTest, TestShortPreTriggerHistory) {
+  ScopeRig rig;
+  rig.scope.setChannels(scopeTestChannels, 4);
+
+  // triggering before the pre trigger part has filled keeps what there is
+  rig.scope.arm(ScopeTrigger::ERROR_ABOVE, 5, 100);
+  rig.run(3);
+  rig.spindleIo.miscount(10);
+  rig.tick();
+  ASSERT_EQ(rig.scope.getTriggerSample(), 3);
+  rig.run(rig.scope.getDepth());
+  ASSERT_EQ(rig.scope.getState(), ScopeState::DONE);
+  // the post trigger part makes up the difference
+  ASSERT_EQ(rig.scope.getSampleCount(), rig.scope.getDepth());
+}
+
+TEST(ScopeTest, TestDirectionFlipTrigger) {
+  ScopeRig rig;
+  rig.scope.setChannels(scopeTestChannels, 4);
+
+  rig.run(SCOPE_TEST_TICKS_PER_COUNT * 20);
+  rig.scope.arm(ScopeTrigger::DIRECTION_FLIP, 0, 10);
+  rig.run(SCOPE_TEST_TICKS_PER_COUNT * 20);
+  ASSERT_EQ(rig.scope.getState(), ScopeState::ARMED);
+
+  // reversing the spindle reverses the leadscrew
+  rig.run(SCOPE_TEST_TICKS_PER_COUNT * 20 + rig.scope.getDepth(), -1);
+  ASSERT_EQ(rig.scope.getState(), ScopeState::DONE);
+
+  vector<vector<int32_t>> capture = rig.readCapture();
+  int trigger = rig.scope.getTriggerSample();
+  ASSERT_EQ(capture[trigger][3], LeadscrewDirection::LEFT);
+  for (int i = 0; i < trigger; i++) {
+    ASSERT_NE(capture[i][3], LeadscrewDirection::LEFT);
+  }
+}
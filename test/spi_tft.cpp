@@ -0,0 +1,179 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <gmock/gmock.h>
+#include <spi_tft.h>
+
+#include "mocks/spi_tft_io_mock.h"
+
+#define SPI_TFT_TEST_FOREGROUND 0xFD20
+#define SPI_TFT_TEST_BACKGROUND 0x0841
+// the bus clock config.h suggests for these panels
+#define SPI_TFT_TEST_CLOCK 30000000
+// a single changed tile on the panel
+#define SPI_TFT_TILE_BYTES \
+  (SPI_TFT_TILE_SIZE * SPI_TFT_SCALE * 8 * SPI_TFT_SCALE * 2)
+
+// keeps calling service() like loop() would until the frame is out
+void flushSpiTft(SpiTft* tft) {
+  for (int polls = 0; tft->isBusy() && polls < 10000; polls++) {
+    tft->service();
+  }
+  ASSERT_FALSE(tft->isBusy());
+}
+
+// every pixel of the panel against the canvas scaled up, and the border
+void expectPanelShowsCanvas(SpiTftIOMock* io, SpiTft* tft) {
+  int wrong = 0;
+  for (int16_t y = 0; y < SPI_TFT_HEIGHT; y++) {
+    for (int16_t x = 0; x < SPI_TFT_WIDTH; x++) {
+      int16_t canvasX = (x - SPI_TFT_OFFSET_X) / SPI_TFT_SCALE;
+      int16_t canvasY = (y - SPI_TFT_OFFSET_Y) / SPI_TFT_SCALE;
+      bool inCanvas = x >= SPI_TFT_OFFSET_X && y >= SPI_TFT_OFFSET_Y &&
+                      canvasX < SPI_TFT_CANVAS_WIDTH &&
+                      canvasY < SPI_TFT_CANVAS_HEIGHT;
+      uint16_t expected = inCanvas && tft->getPixel(canvasX, canvasY)
+                              ? SPI_TFT_TEST_FOREGROUND
+                              : SPI_TFT_TEST_BACKGROUND;
+      if (io->getPanelPixel(x, y) != expected && wrong++ < 5) {
+        ADD_FAILURE() << "panel pixel " << x << "," << y << " is "
+                      << io->getPanelPixel(x, y) << " not " << expected;
+      }
+    }
+  }
+  ASSERT_EQ(wrong, 0);
+}
+
+struct SpiTftRig {
+  SpiTftIOMock io;
+  SpiTft tft;
+
+  SpiTftRig(SpiTftController controller = SpiTftController::ILI9341)
+      : tft(&io, controller, SPI_TFT_TEST_FOREGROUND,
+            SPI_TFT_TEST_BACKGROUND) {
+    tft.begin();
+  }
+
+  // roughly what the main screen has on it
+  void drawScreen(const char* pitch) {
+    tft.clearDisplay();
+    tft.setCursor(0, 0);
+    tft.setTextSize(1);
+    tft.setTextColor(SPI_TFT_WHITE);
+    tft.print(" 750RPM");
+    tft.setCursor(55, 8);
+    tft.setTextSize(2);
+    tft.print(pitch);
+    tft.fillRoundRect(2, 40, 20, 20, 2, SPI_TFT_WHITE);
+    tft.fillRect(6, 44, 12, 12, SPI_TFT_BLACK);
+  }
+};
+
+TEST(SpiTftTest, TestBeginClearsThePanel) {
+  SpiTftRig rig;
+  ASSERT_TRUE(rig.io.on);
+  ASSERT_EQ(rig.io.colmod, 0x55);
+  ASSERT_EQ(rig.io.madctl, 0x28);
+  ASSERT_FALSE(rig.io.inverted);
+  expectPanelShowsCanvas(&rig.io, &rig.tft);
+}
+
+TEST(SpiTftTest, TestST7789IsSetUpForItsPanel) {
+  SpiTftRig rig(SpiTftController::ST7789);
+  ASSERT_EQ(rig.io.madctl, 0x60);
+  ASSERT_TRUE(rig.io.inverted);
+  expectPanelShowsCanvas(&rig.io, &rig.tft);
+}
+
+TEST(SpiTftTest, TestFrameMatchesTheCanvas) {
+  SpiTftRig rig;
+  rig.drawScreen("1.25mm");
+  ASSERT_TRUE(rig.tft.display());
+  flushSpiTft(&rig.tft);
+  expectPanelShowsCanvas(&rig.io, &rig.tft);
+
+  rig.drawScreen("0.25mm");
+  ASSERT_TRUE(rig.tft.display());
+  flushSpiTft(&rig.tft);
+  expectPanelShowsCanvas(&rig.io, &rig.tft);
+}
+
+TEST(SpiTftTest, TestOnlyChangedTilesAreSent) {
+  SpiTftRig rig;
+  rig.drawScreen("1.25mm");
+  rig.tft.display();
+  flushSpiTft(&rig.tft);
+
+  // the same frame again sends nothing at all
+  size_t bytes = rig.io.dataBytes;
+  int windows = rig.io.windows;
+  rig.drawScreen("1.25mm");
+  rig.tft.display();
+  flushSpiTft(&rig.tft);
+  ASSERT_EQ(rig.io.dataBytes, bytes);
+  ASSERT_EQ(rig.io.windows, windows);
+
+  // one pixel is one tile in its own window
+  rig.tft.drawPixel(100, 60, SPI_TFT_WHITE);
+  rig.tft.display();
+  flushSpiTft(&rig.tft);
+  ASSERT_EQ(rig.io.dataBytes, bytes + SPI_TFT_TILE_BYTES);
+  ASSERT_EQ(rig.io.windows, windows + 1);
+  expectPanelShowsCanvas(&rig.io, &rig.tft);
+}
+
+TEST(SpiTftTest, TestNeighbouringTilesShareAWindow) {
+  SpiTftRig rig;
+  size_t bytes = rig.io.dataBytes;
+  int windows = rig.io.windows;
+
+  // three tiles side by side in one page, and one further along
+  rig.tft.drawFastHLine(16, 12, 24, SPI_TFT_WHITE);
+  rig.tft.drawPixel(80, 12, SPI_TFT_WHITE);
+  rig.tft.display();
+  flushSpiTft(&rig.tft);
+  ASSERT_EQ(rig.io.dataBytes, bytes + 4 * SPI_TFT_TILE_BYTES);
+  ASSERT_EQ(rig.io.windows, windows + 2);
+  expectPanelShowsCanvas(&rig.io, &rig.tft);
+}
+
+TEST(SpiTftTest, TestFramesWhileSendingAreDropped) {
+  SpiTftRig rig;
+  rig.io.setBusyPolls(3);
+
+  rig.tft.fillScreen(SPI_TFT_WHITE);
+  ASSERT_TRUE(rig.tft.display());
+  ASSERT_TRUE(rig.tft.isBusy());
+
+  // the loop keeps drawing while the last frame is still going out
+  rig.drawScreen("1.25mm");
+  ASSERT_FALSE(rig.tft.display());
+  ASSERT_EQ(rig.tft.getFramesDropped(), 1);
+
+  flushSpiTft(&rig.tft);
+  ASSERT_EQ(rig.io.writesWhileBusy, 0);
+  ASSERT_TRUE(rig.tft.display());
+  flushSpiTft(&rig.tft);
+  ASSERT_EQ(rig.io.writesWhileBusy, 0);
+  expectPanelShowsCanvas(&rig.io, &rig.tft);
+}
+
+TEST(SpiTftTest, TestWholeScreenFitsInAFrame) {
+  SpiTftRig rig;
+  size_t bytes = rig.io.dataBytes;
+
+  rig.tft.fillScreen(SPI_TFT_WHITE);
+  rig.tft.display();
+  flushSpiTft(&rig.tft);
+
+  // every pixel of the canvas changed and still goes out well within the
+  // display task's period
+  size_t frameBytes = rig.io.dataBytes - bytes;
+  ASSERT_EQ(frameBytes, (size_t)SPI_TFT_CANVAS_WIDTH * SPI_TFT_SCALE *
+                            SPI_TFT_CANVAS_HEIGHT * SPI_TFT_SCALE * 2);
+  ASSERT_LT(frameBytes * 8.0 / SPI_TFT_TEST_CLOCK * US_PER_SECOND,
+            ELS_DISPLAY_TASK_PERIOD_US);
+  expectPanelShowsCanvas(&rig.io, &rig.tft);
+}
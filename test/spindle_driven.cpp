@@ -0,0 +1,157 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include <vector>
+
+using std::vector;
+
+#include "mocks/leadscrewio_mock.h"
+#include "mocks/spindledriverio_mock.h"
+
+// 30 rpm and 300 rpm/s at 400 pulses per revolution
+#define DRIVEN_TEST_START_VELOCITY 200
+#define DRIVEN_TEST_ACCELERATION 2000
+
+// runs the spindle from the timer for `duration` microseconds, recording the
+// time between every pulse
+vector<unsigned long> runSpindle(Spindle& spindle, SpindleDriverIOMock& io,
+                                 unsigned long duration) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  vector<unsigned long> intervals;
+  unsigned long lastPulse = micros.micros();
+  int lastPulseCount = io.getPulseCount();
+
+  for (unsigned long t = 0; t < duration; t += LEADSCREW_TIMER_US) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    spindle.update();
+    if (io.getPulseCount() != lastPulseCount) {
+      intervals.push_back(micros.micros() - lastPulse);
+      lastPulse = micros.micros();
+      lastPulseCount = io.getPulseCount();
+    }
+  }
+  return intervals;
+}
+
+TEST(DrivenSpindleTest, TestRampsToTargetSpeed) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  SpindleDriverIOMock io;
+  Spindle spindle(&io, DRIVEN_TEST_START_VELOCITY, DRIVEN_TEST_ACCELERATION);
+  spindle.setTargetRPM(300);
+
+  vector<unsigned long> intervals = runSpindle(spindle, io, 2000000);
+
+  // the motor only ever speeds up, give or take a timer tick of jitter
+  ASSERT_GT(intervals.size(), 100);
+  for (size_t i = 1; i < intervals.size(); i++) {
+    ASSERT_LE(intervals[i], intervals[i - 1] + LEADSCREW_TIMER_US);
+  }
+
+  // 300 rpm is 2000 pulses per second, reached after 0.9s of ramping
+  ASSERT_FLOAT_EQ(spindle.getCommandedRPM(), 300);
+  // the timer only ticks every 20us, but on average we're spot on
+  unsigned long total = 0;
+  for (size_t i = intervals.size() - 100; i < intervals.size(); i++) {
+    total += intervals[i];
+  }
+  ASSERT_NEAR(total / 100.0, 500, 1);
+  ASSERT_NEAR(spindle.getEstimatedVelocityInRPM(), 300, 1);
+
+  // every pulse is a spindle position
+  ASSERT_EQ(io.getMotorPosition(), io.getPulseCount());
+  ASSERT_EQ(spindle.getCurrentPosition(),
+            io.getMotorPosition() % ELS_SPINDLE_ENCODER_PPR);
+  ASSERT_EQ(spindle.getRevolutionCount(),
+            io.getMotorPosition() / ELS_SPINDLE_ENCODER_PPR);
+
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(DrivenSpindleTest, TestDeceleratesToStopWhenDisabled) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  SpindleDriverIOMock io;
+  Spindle spindle(&io, DRIVEN_TEST_START_VELOCITY, DRIVEN_TEST_ACCELERATION);
+  spindle.setTargetRPM(300);
+  runSpindle(spindle, io, 2000000);
+
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+  vector<unsigned long> intervals = runSpindle(spindle, io, 2000000);
+
+  ASSERT_FLOAT_EQ(spindle.getCommandedRPM(), 0);
+  ASSERT_EQ(io.readStepPin(), 0);
+  for (size_t i = 1; i < intervals.size(); i++) {
+    ASSERT_GE(intervals[i] + LEADSCREW_TIMER_US, intervals[i - 1]);
+  }
+  // we only stop once we're slow enough to stop instantly
+  ASSERT_GE(intervals.back(), 0.9 * 1000000 / DRIVEN_TEST_START_VELOCITY);
+
+  int position = io.getMotorPosition();
+  runSpindle(spindle, io, 100000);
+  ASSERT_EQ(io.getMotorPosition(), position);
+}
+
+TEST(DrivenSpindleTest, TestReverses) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  SpindleDriverIOMock io;
+  Spindle spindle(&io, DRIVEN_TEST_START_VELOCITY, DRIVEN_TEST_ACCELERATION);
+  spindle.setTargetRPM(120);
+  runSpindle(spindle, io, 1000000);
+  ASSERT_EQ(io.readDirPin(), 1);
+
+  spindle.setTargetRPM(-120);
+  runSpindle(spindle, io, 3000000);
+  ASSERT_FLOAT_EQ(spindle.getCommandedRPM(), -120);
+  ASSERT_EQ(io.readDirPin(), 0);
+
+  // the pulses that were sent still add up to where the spindle is
+  int expected = io.getMotorPosition() % ELS_SPINDLE_ENCODER_PPR;
+  if (expected < 0) {
+    expected += ELS_SPINDLE_ENCODER_PPR;
+  }
+  ASSERT_LT(io.getMotorPosition(), 0);
+  ASSERT_EQ(spindle.getCurrentPosition(), expected);
+
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(DrivenSpindleTest, TestLeadscrewFollowsInTheSamePass) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  SpindleDriverIOMock spindleIo;
+  Spindle spindle(&spindleIo, DRIVEN_TEST_START_VELOCITY,
+                  DRIVEN_TEST_ACCELERATION);
+  spindle.setTargetRPM(300);
+  LeadscrewIOMock io;
+  Leadscrew leadscrew(&spindle, &io, 0, 0, 100, 1);
+  leadscrew.setRatio(0.5);
+
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  for (int i = 0; i < 100000; i++) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    spindle.update();
+    leadscrew.update();
+
+    // no encoder to wait for, the leadscrew already knows about every pulse
+    // the spindle sent in this pass
+    ASSERT_EQ(leadscrew.getExpectedPosition(),
+              (int)(spindleIo.getMotorPosition() * 0.5));
+  }
+  ASSERT_LE(abs(leadscrew.getPositionError()), 1);
+
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
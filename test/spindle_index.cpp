@@ -0,0 +1,137 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include "mocks/leadscrewio_mock.h"
+#include "mocks/spindleio_mock.h"
+
+// rotates the spindle in small chunks, updating it like the timer would
+void turn(Spindle& spindle, SpindleIOMock& io, int counts, int chunk = 7) {
+  int direction = counts > 0 ? 1 : -1;
+  int remaining = abs(counts);
+  while (remaining > 0) {
+    int step = remaining < chunk ? remaining : chunk;
+    io.rotate(step * direction);
+    spindle.update();
+    remaining -= step;
+  }
+}
+
+TEST(SpindleIndexTest, TestCountsWithoutIndex) {
+  SpindleIOMock io;
+  Spindle spindle(&io);
+
+  turn(spindle, io, 1000);
+  ASSERT_EQ(spindle.consumePosition(), 1000);
+  ASSERT_EQ(spindle.getCurrentPosition(), 1000 % ELS_SPINDLE_ENCODER_PPR);
+  ASSERT_FALSE(spindle.isIndexReferenced());
+  ASSERT_EQ(spindle.getIndexedPosition(), 0);
+}
+
+TEST(SpindleIndexTest, TestIndexReferencesPosition) {
+  SpindleIOMock io;
+  io.enableIndex();
+  Spindle spindle(&io);
+
+  // power up part way round, the index is 150 counts away
+  io.rotate(250);
+  spindle.update();
+  spindle.consumePosition();
+  ASSERT_FALSE(spindle.isIndexReferenced());
+
+  turn(spindle, io, 180);
+  ASSERT_TRUE(spindle.isIndexReferenced());
+  ASSERT_EQ(spindle.getRevolutionCount(), 1);
+  // the index is placed exactly, even though it fired part way through an
+  // update
+  ASSERT_EQ(spindle.getIndexedPosition(), io.getTrueAngle());
+  ASSERT_EQ(spindle.getIndexedPosition(), 30);
+}
+
+TEST(SpindleIndexTest, TestMiscountsAreCorrected) {
+  SpindleIOMock io;
+  io.enableIndex();
+  Spindle spindle(&io);
+
+  turn(spindle, io, 50);
+  turn(spindle, io, ELS_SPINDLE_ENCODER_PPR);
+  ASSERT_TRUE(spindle.isIndexReferenced());
+  spindle.consumePosition();
+
+  // electrical noise adds 3 counts and then loses 5 over the next revolutions
+  int consumed = 0;
+  turn(spindle, io, 100);
+  io.miscount(3);
+  turn(spindle, io, 100);
+  consumed += spindle.consumePosition();
+  ASSERT_NE(spindle.getIndexedPosition(), io.getTrueAngle());
+
+  turn(spindle, io, ELS_SPINDLE_ENCODER_PPR);
+  consumed += spindle.consumePosition();
+  ASSERT_EQ(spindle.getLastIndexError(), 3);
+  ASSERT_EQ(spindle.getIndexedPosition(), io.getTrueAngle());
+
+  io.miscount(-5);
+  turn(spindle, io, ELS_SPINDLE_ENCODER_PPR);
+  consumed += spindle.consumePosition();
+  ASSERT_EQ(spindle.getLastIndexError(), -5);
+  ASSERT_EQ(spindle.getIndexedPosition(), io.getTrueAngle());
+  ASSERT_EQ(spindle.getIndexCorrections(), 2);
+
+  // whatever the driven axes consumed matches how far the spindle really went
+  ASSERT_EQ(consumed, 200 + 2 * ELS_SPINDLE_ENCODER_PPR);
+}
+
+TEST(SpindleIndexTest, TestThreadStartWaitsForIndex) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState* globalState = GlobalState::getInstance();
+  globalState->setFeedMode(GlobalFeedMode::THREAD);
+  globalState->setMotionMode(GlobalMotionMode::DISABLED);
+
+  SpindleIOMock spindleIo;
+  spindleIo.enableIndex();
+  Spindle spindle(&spindleIo);
+  LeadscrewIOMock io;
+  Leadscrew leadscrew(&spindle, &io, 0, 0, 100, 1);
+  leadscrew.setRatio(0.5);
+
+  // reference the index, then stop somewhere random
+  turn(spindle, spindleIo, 500);
+  leadscrew.update();
+  ASSERT_TRUE(spindle.isIndexReferenced());
+
+  globalState->setMotionMode(GlobalMotionMode::ENABLED);
+  leadscrew.update();
+  ASSERT_TRUE(leadscrew.isWaitingForThreadStart());
+
+  // the leadscrew doesn't move until the index comes round
+  int startPosition = leadscrew.getCurrentPosition();
+  for (int i = 0; i < 29; i++) {
+    spindleIo.rotate(10);
+    spindle.update();
+    leadscrew.update();
+    ASSERT_TRUE(leadscrew.isWaitingForThreadStart());
+    ASSERT_EQ(leadscrew.getCurrentPosition(), startPosition);
+  }
+  ASSERT_EQ(io.getPulseCount(), 0);
+
+  // past the index by 7 counts
+  spindleIo.rotate(17);
+  spindle.update();
+  leadscrew.update();
+  ASSERT_FALSE(leadscrew.isWaitingForThreadStart());
+  ASSERT_EQ(spindleIo.getTrueAngle(), 7);
+
+  // the leadscrew is referenced to the index, so it owes the 7 counts since
+  ASSERT_EQ(leadscrew.getPositionError(), (int)(7 * 0.5));
+
+  globalState->setMotionMode(GlobalMotionMode::DISABLED);
+  globalState->setFeedMode(GlobalFeedMode::FEED);
+}
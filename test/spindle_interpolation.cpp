@@ -0,0 +1,149 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include <vector>
+
+using std::vector;
+
+#include "mocks/leadscrewio_mock.h"
+#include "mocks/spindleio_mock.h"
+
+// a coarse thread on a slow spindle, every encoder count is a lot of leadscrew
+// steps, the same as a low PPR encoder would give
+#define INTERPOLATION_TEST_RATIO 6.0
+#define INTERPOLATION_TEST_TICKS_PER_COUNT 100
+#define INTERPOLATION_TEST_COUNTS 200
+// counts to ignore at the start while the period is measured
+#define INTERPOLATION_TEST_WARMUP_COUNTS 20
+
+struct interpolationRun {
+  int pulses;
+  double meanInterval;
+  double intervalVariance;
+  bool reversed;
+};
+
+interpolationRun runSteadySpindle(bool interpolate) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  micros.setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  SpindleIOMock spindleIo;
+  Spindle spindle(&spindleIo);
+  if (!interpolate) {
+    spindle.setInterpolationMaxPeriod(0);
+  }
+  LeadscrewIOMock io;
+  Leadscrew leadscrew(&spindle, &io, 0, 0, ELS_LEADSCREW_STEPPER_PPR,
+                      ELS_LEADSCREW_PITCH_MM);
+  leadscrew.setRatio(INTERPOLATION_TEST_RATIO);
+
+  vector<unsigned long> intervals;
+  interpolationRun run = {0, 0, 0, false};
+  unsigned long lastPulse = 0;
+  int lastPulseCount = 0;
+  int lastMotorPosition = 0;
+  int ticks = INTERPOLATION_TEST_TICKS_PER_COUNT * INTERPOLATION_TEST_COUNTS;
+  for (int tick = 0; tick < ticks; tick++) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    if (tick % INTERPOLATION_TEST_TICKS_PER_COUNT == 0) {
+      spindleIo.rotate(1);
+    }
+    spindle.update();
+    leadscrew.update();
+
+    run.reversed |= io.getMotorPosition() < lastMotorPosition;
+    lastMotorPosition = io.getMotorPosition();
+
+    if (io.getPulseCount() != lastPulseCount) {
+      lastPulseCount = io.getPulseCount();
+      if (tick > INTERPOLATION_TEST_TICKS_PER_COUNT *
+                     INTERPOLATION_TEST_WARMUP_COUNTS) {
+        intervals.push_back(micros.micros() - lastPulse);
+      }
+      lastPulse = micros.micros();
+    }
+  }
+
+  for (unsigned long interval : intervals) {
+    run.meanInterval += interval;
+  }
+  run.meanInterval /= intervals.size();
+  for (unsigned long interval : intervals) {
+    run.intervalVariance +=
+        (interval - run.meanInterval) * (interval - run.meanInterval);
+  }
+  run.intervalVariance /= intervals.size();
+  run.pulses = io.getPulseCount();
+
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+  return run;
+}
+
+TEST(SpindleInterpolationTest, TestStepsAreSpreadBetweenCounts) {
+  interpolationRun bursts = runSteadySpindle(false);
+  interpolationRun smooth = runSteadySpindle(true);
+
+  // both follow the same spindle, the interpolated one is at most a count
+  // behind
+  double pulsesPerCount = (double)bursts.pulses / INTERPOLATION_TEST_COUNTS;
+  ASSERT_GT(pulsesPerCount, 10);
+  ASSERT_NEAR(smooth.pulses, bursts.pulses, pulsesPerCount + 1);
+  ASSERT_NEAR(smooth.meanInterval, bursts.meanInterval,
+              bursts.meanInterval * 0.05);
+  ASSERT_FALSE(smooth.reversed);
+
+  // without interpolation every count is a burst of pulses as fast as the
+  // timer goes, then nothing until the next count. With it the steps are
+  // spread over the count, only grouped by how many pulses a position unit
+  // takes
+  ASSERT_LT(smooth.intervalVariance * 5, bursts.intervalVariance);
+}
+
+TEST(SpindleInterpolationTest, TestStopsOnTheLastCount) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  micros.setMicros(0);
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::ENABLED);
+
+  SpindleIOMock spindleIo;
+  Spindle spindle(&spindleIo);
+  LeadscrewIOMock io;
+  Leadscrew leadscrew(&spindle, &io, 0, 0, ELS_LEADSCREW_STEPPER_PPR,
+                      ELS_LEADSCREW_PITCH_MM);
+  leadscrew.setRatio(INTERPOLATION_TEST_RATIO);
+
+  for (int tick = 0; tick < INTERPOLATION_TEST_TICKS_PER_COUNT * 50; tick++) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    if (tick % INTERPOLATION_TEST_TICKS_PER_COUNT == 0) {
+      spindleIo.rotate(1);
+    }
+    spindle.update();
+    leadscrew.update();
+
+    // never ahead of the encoder
+    ASSERT_LE(leadscrew.getExpectedPosition(),
+              (int)(spindleIo.readEncoder() * INTERPOLATION_TEST_RATIO));
+  }
+
+  // the spindle stopped, the leadscrew catches up with the last count and
+  // stays there
+  for (int tick = 0; tick < INTERPOLATION_TEST_TICKS_PER_COUNT * 10; tick++) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    spindle.update();
+    leadscrew.update();
+  }
+  ASSERT_FLOAT_EQ(spindle.getInterpolationOffset(), 0);
+  ASSERT_EQ(leadscrew.getExpectedPosition(),
+            (int)(spindleIo.readEncoder() * INTERPOLATION_TEST_RATIO));
+  ASSERT_EQ(leadscrew.getPositionError(), 0);
+
+  GlobalState::getInstance()->setMotionMode(GlobalMotionMode::DISABLED);
+}
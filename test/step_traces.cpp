@@ -0,0 +1,273 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <accel_curve.h>
+#include <config.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+#include "golden/step_traces.h"
+#include "mocks/motion_rig.h"
+
+/**
+ * Golden step traces
+ *
+ * Every pitch table entry is run through the same spindle profile and the
+ * step and direction edges the leadscrew produces are compared to
+ * golden/step_traces.h. Anything in the motion core that changes when or how
+ * many steps are sent shows up here, along with how far the step timing moved.
+ * If the change is intended, run the tests with ELS_PRINT_STEP_TRACES=1 set and
+ * replace the table in golden/step_traces.h with what's printed
+ */
+
+#define STEP_TRACE_TICK_US LEADSCREW_TIMER_US
+
+// the spindle speed ramps linearly from start to end over each segment
+struct SpindleSegment {
+  uint32_t durationMicros;
+  int32_t startCountsPerSecond;
+  int32_t endCountsPerSecond;
+};
+
+// up to speed, faster, through 0 into reverse and back to a stop, then enough
+// time for the coarse pitches that fell behind to catch up
+const SpindleSegment stepTraceProfile[] = {
+    {200000, 0, 400},     {300000, 400, 400},  {200000, 400, 1000},
+    {300000, 1000, 1000}, {300000, 1000, -400}, {200000, -400, -400},
+    {200000, -400, 0},    {500000, 0, 0},
+};
+
+struct StepTraceTable {
+  const char* name;
+  GlobalUnitMode unitMode;
+  GlobalFeedMode feedMode;
+  int size;
+};
+
+const StepTraceTable stepTraceTables[] = {
+    {"metric_feed", GlobalUnitMode::METRIC, GlobalFeedMode::FEED,
+     ARRAY_SIZE(feedPitchMetric)},
+    {"metric_thread", GlobalUnitMode::METRIC, GlobalFeedMode::THREAD,
+     ARRAY_SIZE(threadPitchMetric)},
+    {"imperial_feed", GlobalUnitMode::IMPERIAL, GlobalFeedMode::FEED,
+     ARRAY_SIZE(feedPitchImperial)},
+    {"imperial_thread", GlobalUnitMode::IMPERIAL, GlobalFeedMode::THREAD,
+     ARRAY_SIZE(threadPitchImperial)},
+};
+
+// hashes every edge on the step and dir pins with the time it happened
+class TraceLeadscrewIO : public LeadscrewIO {
+  Clock* m_clock = nullptr;
+  uint8_t m_stepPinState = 0;
+  uint8_t m_dirPinState = 0;
+  uint32_t m_hash = 2166136261u;
+  int m_motorPosition = 0;
+  vector<uint32_t> m_stepMicros;
+
+  void hashEdge(uint8_t pin, uint8_t state) {
+    uint32_t now = m_clock->nowMicros();
+    uint8_t bytes[] = {(uint8_t)now,         (uint8_t)(now >> 8),
+                       (uint8_t)(now >> 16), (uint8_t)(now >> 24), pin,
+                       state};
+    // FNV-1a
+    for (uint8_t byte : bytes) {
+      m_hash = (m_hash ^ byte) * 16777619u;
+    }
+  }
+
+ public:
+  // the edges are timed by `clock`, it has to be set before the first one
+  void setClock(Clock* clock) { m_clock = clock; }
+
+  void writeStepPin(uint8_t state) override {
+    if (state == m_stepPinState) {
+      return;
+    }
+    hashEdge(0, state);
+    if (state == 1) {
+      m_stepMicros.push_back(m_clock->nowMicros());
+      m_motorPosition += m_dirPinState == 1 ? 1 : -1;
+    }
+    m_stepPinState = state;
+  }
+  void writeDirPin(uint8_t state) override {
+    if (state == m_dirPinState) {
+      return;
+    }
+    hashEdge(1, state);
+    m_dirPinState = state;
+  }
+  uint8_t readStepPin() override { return m_stepPinState; }
+  uint8_t readDirPin() override { return m_dirPinState; }
+
+  uint32_t getHash() { return m_hash; }
+  int getMotorPosition() { return m_motorPosition; }
+  vector<uint32_t>& getStepMicros() { return m_stepMicros; }
+};
+
+// the leadscrew set up like the firmware, on its own clock and state
+struct StepTraceRig : MotionRig<TraceLeadscrewIO> {
+  AccelCurve accelCurve;
+
+  StepTraceRig(const StepTraceTable& table, int feedSelect)
+      : accelCurve(leadscrewAccelCurveVelocity, leadscrewAccelCurveAccel,
+                   ARRAY_SIZE(leadscrewAccelCurveVelocity),
+                   ELS_LEADSCREW_STEPS_PER_MM, LEADSCREW_INITIAL_PULSE_DELAY_US,
+                   LEADSCREW_TIMER_US * 2) {
+    leadscrewIo.setClock(&clock);
+    globalState.setUnitMode(table.unitMode);
+    globalState.setFeedMode(table.feedMode);
+    globalState.setFeedSelect(feedSelect);
+    globalState.setMotionMode(GlobalMotionMode::ENABLED);
+
+    leadscrew.setAccelCurve(&accelCurve);
+    leadscrew.setRatio(globalState.getCurrentFeedPitch());
+  }
+
+  // all integer maths, so the spindle moves exactly the same on every run
+  void runProfile() {
+    // counts * microseconds
+    int64_t travel = 0;
+    int32_t counts = 0;
+    for (const SpindleSegment& segment : stepTraceProfile) {
+      for (uint32_t elapsed = 0; elapsed < segment.durationMicros;
+           elapsed += STEP_TRACE_TICK_US) {
+        int64_t countsPerSecond =
+            segment.startCountsPerSecond +
+            (int64_t)(segment.endCountsPerSecond -
+                      segment.startCountsPerSecond) *
+                elapsed / segment.durationMicros;
+        travel += countsPerSecond * STEP_TRACE_TICK_US;
+        int32_t target = travel >= 0 ? travel / US_PER_SECOND
+                                     : -((-travel) / US_PER_SECOND);
+        if (target != counts) {
+          spindleIo.rotate(target - counts);
+          counts = target;
+        }
+
+        tick(STEP_TRACE_TICK_US);
+      }
+    }
+  }
+
+  StepTraceGolden getTrace(const char* table, int feedSelect) {
+    StepTraceGolden trace = {table, feedSelect,
+                             (int)leadscrewIo.getStepMicros().size(),
+                             leadscrewIo.getMotorPosition(),
+                             leadscrewIo.getHash()};
+    vector<uint32_t>& steps = leadscrewIo.getStepMicros();
+    for (int i = 0; i < STEP_TRACE_CHECKPOINTS && !steps.empty(); i++) {
+      trace.checkpointMicros[i] =
+          steps[(steps.size() - 1) * i / (STEP_TRACE_CHECKPOINTS - 1)];
+    }
+    return trace;
+  }
+};
+
+string formatGolden(const StepTraceGolden& trace) {
+  char line[256];
+  int length = snprintf(line, sizeof(line), "    {\"%s\", %d, %d, %d, 0x%08x, {",
+                        trace.table, trace.feedSelect, trace.steps,
+                        trace.motorPosition, trace.hash);
+  for (int i = 0; i < STEP_TRACE_CHECKPOINTS; i++) {
+    length += snprintf(line + length, sizeof(line) - length, "%s%u",
+                       i == 0 ? "" : ", ", trace.checkpointMicros[i]);
+  }
+  snprintf(line + length, sizeof(line) - length, "}},");
+  return line;
+}
+
+// what changed between the golden trace and this one, empty if nothing
+string describeStepTraceChange(const StepTraceGolden& golden,
+                               const StepTraceGolden& trace) {
+  if (golden.steps == trace.steps &&
+      golden.motorPosition == trace.motorPosition &&
+      golden.hash == trace.hash) {
+    return "";
+  }
+
+  char text[512];
+  int length =
+      snprintf(text, sizeof(text),
+               "%s[%d]: %d steps (golden %d, %+d), motor at %d (golden %d), "
+               "hash 0x%08x (golden 0x%08x)\n  step timing deltas in us at "
+               "0..100%% of the steps:",
+               trace.table, trace.feedSelect, trace.steps, golden.steps,
+               trace.steps - golden.steps, trace.motorPosition,
+               golden.motorPosition, trace.hash, golden.hash);
+  for (int i = 0; i < STEP_TRACE_CHECKPOINTS; i++) {
+    length += snprintf(
+        text + length, sizeof(text) - length, " %+lld",
+        (long long)trace.checkpointMicros[i] - golden.checkpointMicros[i]);
+  }
+  snprintf(text + length, sizeof(text) - length, "\n  new golden line:\n%s",
+           formatGolden(trace).c_str());
+  return text;
+}
+
+const StepTraceGolden* findGolden(const char* table, int feedSelect) {
+  for (const StepTraceGolden& golden : stepTraceGoldens) {
+    if (string(golden.table) == table && golden.feedSelect == feedSelect) {
+      return &golden;
+    }
+  }
+  return nullptr;
+}
+
+void checkStepTraces(const StepTraceTable& table) {
+  bool print = getenv("ELS_PRINT_STEP_TRACES") != nullptr;
+
+  for (int feedSelect = 0; feedSelect < table.size; feedSelect++) {
+    StepTraceRig rig(table, feedSelect);
+    rig.runProfile();
+    StepTraceGolden trace = rig.getTrace(table.name, feedSelect);
+    if (print) {
+      printf("%s\n", formatGolden(trace).c_str());
+    }
+
+    const StepTraceGolden* golden = findGolden(table.name, feedSelect);
+    if (golden == nullptr) {
+      ADD_FAILURE() << "no golden trace for " << table.name << "["
+                    << feedSelect << "], add:\n"
+                    << formatGolden(trace);
+      continue;
+    }
+    string change = describeStepTraceChange(*golden, trace);
+    EXPECT_TRUE(change.empty()) << change;
+  }
+}
+
+TEST(StepTraceTest, TestMetricFeed) { checkStepTraces(stepTraceTables[0]); }
+
+TEST(StepTraceTest, TestMetricThread) { checkStepTraces(stepTraceTables[1]); }
+
+TEST(StepTraceTest, TestImperialFeed) { checkStepTraces(stepTraceTables[2]); }
+
+TEST(StepTraceTest, TestImperialThread) {
+  checkStepTraces(stepTraceTables[3]);
+}
+
+TEST(StepTraceTest, TestDeltasAreReported) {
+  StepTraceGolden golden = {"metric_feed", 0, 100, 100, 0x1234, {0, 10, 20}};
+  StepTraceGolden trace = golden;
+  ASSERT_EQ(describeStepTraceChange(golden, trace), "");
+
+  trace.hash = 0x4321;
+  trace.steps = 101;
+  trace.checkpointMicros[2] = 60;
+  string change = describeStepTraceChange(golden, trace);
+  ASSERT_THAT(change, testing::HasSubstr("101 steps (golden 100, +1)"));
+  ASSERT_THAT(change, testing::HasSubstr("0..100% of the steps: +0 +0 +40"));
+}
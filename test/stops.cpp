@@ -0,0 +1,133 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+#include "mocks/leadscrewio_mock.h"
+
+#define STOP_TEST_INITIAL_DELAY 1000
+#define STOP_TEST_DELAY_INCREMENT 0.3
+
+struct stopRun {
+  int maxPosition;
+  int minPosition;
+  // the time between pulses, in order
+  vector<unsigned long> pulseIntervals;
+};
+
+// runs the leadscrew until it has settled, recording every pulse
+stopRun runUntilSettled(Leadscrew& leadscrew, LeadscrewIOMock& io) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  stopRun run = {leadscrew.getCurrentPosition(),
+                 leadscrew.getCurrentPosition(),
+                 {}};
+  unsigned long lastPulse = micros.micros();
+  uint8_t lastStepPin = io.readStepPin();
+  unsigned long idleTicks = 0;
+
+  while (idleTicks < 10000) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    leadscrew.update();
+
+    uint8_t stepPin = io.readStepPin();
+    if (lastStepPin == 1 && stepPin == 0) {
+      run.pulseIntervals.push_back(micros.micros() - lastPulse);
+      lastPulse = micros.micros();
+      idleTicks = 0;
+    } else {
+      idleTicks++;
+    }
+    lastStepPin = stepPin;
+
+    run.maxPosition = std::max(run.maxPosition, leadscrew.getCurrentPosition());
+    run.minPosition = std::min(run.minPosition, leadscrew.getCurrentPosition());
+  }
+  return run;
+}
+
+TEST(StopTest, TestDeceleratesIntoRightStop) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState* globalState = GlobalState::getInstance();
+  globalState->setMotionMode(GlobalMotionMode::ENABLED);
+
+  LeadscrewIOMock io;
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, STOP_TEST_INITIAL_DELAY,
+                      STOP_TEST_DELAY_INCREMENT, 100, 1);
+  leadscrew.setRatio(1);
+  leadscrew.setStopPosition(Leadscrew::StopPosition::RIGHT, 2000);
+
+  // ask for far more than the stop allows so we're at full speed when we get
+  // close to it
+  spindle.incrementCurrentPosition(5000);
+  stopRun run = runUntilSettled(leadscrew, io);
+
+  ASSERT_EQ(leadscrew.getCurrentPosition(), 2000);
+  ASSERT_EQ(run.maxPosition, 2000);
+
+  // we were going a lot faster than the initial speed at some point
+  unsigned long fastest = run.pulseIntervals[0];
+  for (auto interval : run.pulseIntervals) {
+    fastest = std::min(fastest, interval);
+  }
+  ASSERT_LT(fastest, STOP_TEST_INITIAL_DELAY / 10);
+
+  // but the last pulse into the stop was within one deceleration step of the
+  // starting speed
+  ASSERT_GE(run.pulseIntervals.back() * (1 + STOP_TEST_DELAY_INCREMENT),
+            STOP_TEST_INITIAL_DELAY);
+  globalState->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(StopTest, TestDeceleratesIntoLeftStop) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState* globalState = GlobalState::getInstance();
+  globalState->setMotionMode(GlobalMotionMode::ENABLED);
+
+  LeadscrewIOMock io;
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, STOP_TEST_INITIAL_DELAY,
+                      STOP_TEST_DELAY_INCREMENT, 100, 1);
+  leadscrew.setRatio(1);
+  leadscrew.setStopPosition(Leadscrew::StopPosition::LEFT, -1500);
+
+  spindle.incrementCurrentPosition(-5000);
+  stopRun run = runUntilSettled(leadscrew, io);
+
+  ASSERT_EQ(leadscrew.getCurrentPosition(), -1500);
+  ASSERT_EQ(run.minPosition, -1500);
+  ASSERT_GE(run.pulseIntervals.back() * (1 + STOP_TEST_DELAY_INCREMENT),
+            STOP_TEST_INITIAL_DELAY);
+  globalState->setMotionMode(GlobalMotionMode::DISABLED);
+}
+
+TEST(StopTest, TestStopFurtherThanTargetIsIgnored) {
+  MicrosSingleton::getInstance().setMicros(0);
+  GlobalState* globalState = GlobalState::getInstance();
+  globalState->setMotionMode(GlobalMotionMode::ENABLED);
+
+  LeadscrewIOMock io;
+  Spindle spindle;
+  Leadscrew leadscrew(&spindle, &io, STOP_TEST_INITIAL_DELAY,
+                      STOP_TEST_DELAY_INCREMENT, 100, 1);
+  leadscrew.setRatio(1);
+  leadscrew.setStopPosition(Leadscrew::StopPosition::RIGHT, 5000);
+
+  spindle.incrementCurrentPosition(1000);
+  stopRun run = runUntilSettled(leadscrew, io);
+
+  ASSERT_EQ(leadscrew.getCurrentPosition(), 1000);
+  ASSERT_EQ(run.maxPosition, 1000);
+  globalState->setMotionMode(GlobalMotionMode::DISABLED);
+}
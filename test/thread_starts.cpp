@@ -0,0 +1,176 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <config.h>
+#include <els_elapsedMillis.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <motion_mailbox.h>
+#include <spindle.h>
+
+#include <vector>
+
+using std::vector;
+
+#include "mocks/leadscrewio_mock.h"
+#include "mocks/spindleio_mock.h"
+
+// how many timer ticks the spindle takes per encoder count, and how far each
+// pass is recorded for
+#define STARTS_TEST_TICKS_PER_COUNT 4
+#define STARTS_TEST_PASS_COUNTS 100
+
+/**
+ * Cuts one pass of `start` with a fresh leadscrew, the way the carriage would
+ * be back at the same place for every pass. The start is picked through the
+ * mailbox like the half nut button does. Returns the true spindle angle at
+ * every leadscrew pulse once the pass started
+ */
+vector<int> cutPass(Spindle& spindle, SpindleIOMock& spindleIo, int starts,
+                    int start) {
+  MicrosSingleton& micros = MicrosSingleton::getInstance();
+  GlobalState* globalState = GlobalState::getInstance();
+
+  LeadscrewIOMock io;
+  Leadscrew leadscrew(&spindle, &io, 0, 0, ELS_LEADSCREW_STEPPER_PPR,
+                      ELS_LEADSCREW_PITCH_MM);
+  leadscrew.setRatio(globalState->getCurrentFeedPitch());
+
+  MotionMailbox mailbox;
+  mailbox.postSetThreadStarts(starts);
+  for (int skip = 0; skip < start; skip++) {
+    mailbox.postNextThreadStart();
+  }
+  mailbox.apply(&leadscrew);
+  EXPECT_EQ(leadscrew.getThreadStart(), start);
+
+  globalState->setMotionMode(GlobalMotionMode::ENABLED);
+  vector<int> pulseAngles;
+  int countsSinceStart = 0;
+  int lastPulseCount = 0;
+  for (int tick = 0; countsSinceStart < STARTS_TEST_PASS_COUNTS; tick++) {
+    micros.incrementMicros(LEADSCREW_TIMER_US);
+    if (tick % STARTS_TEST_TICKS_PER_COUNT == 0) {
+      spindleIo.rotate(1);
+      if (!leadscrew.isWaitingForThreadStart()) {
+        countsSinceStart++;
+      }
+    }
+    spindle.update();
+    leadscrew.update();
+
+    if (io.getPulseCount() != lastPulseCount) {
+      lastPulseCount = io.getPulseCount();
+      pulseAngles.push_back(spindleIo.getTrueAngle());
+    }
+  }
+
+  // this finishes the pass, the leadscrew moves on to the next start by itself
+  globalState->setMotionMode(GlobalMotionMode::DISABLED);
+  leadscrew.update();
+  EXPECT_EQ(leadscrew.getThreadStart(), (start + 1) % starts);
+  return pulseAngles;
+}
+
+void checkStartSpacing(GlobalUnitMode unit, int pitches) {
+  GlobalState* globalState = GlobalState::getInstance();
+  globalState->setUnitMode(unit);
+  globalState->setFeedMode(GlobalFeedMode::THREAD);
+
+  SpindleIOMock spindleIo;
+  spindleIo.enableIndex();
+  Spindle spindle(&spindleIo);
+  spindleIo.rotate(ELS_SPINDLE_ENCODER_PPR + 123);
+  spindle.update();
+  ASSERT_TRUE(spindle.isIndexReferenced());
+
+  for (int pitch = 0; pitch < pitches; pitch++) {
+    globalState->setFeedSelect(pitch);
+    for (int starts = 1; starts <= ELS_THREAD_MAX_STARTS; starts++) {
+      if (!GlobalState::isValidThreadStarts(starts)) {
+        continue;
+      }
+      globalState->setThreadStarts(starts);
+
+      vector<vector<int>> passes;
+      for (int start = 0; start < starts; start++) {
+        passes.push_back(cutPass(spindle, spindleIo, starts, start));
+      }
+
+      // every start moves the leadscrew the same way, exactly 1/starts of a
+      // revolution after the start before it
+      ASSERT_FALSE(passes[0].empty());
+      for (int start = 1; start < starts; start++) {
+        ASSERT_EQ(passes[start].size(), passes[0].size())
+            << "pitch " << pitch << " start " << start << "/" << starts;
+        for (size_t pulse = 0; pulse < passes[0].size(); pulse++) {
+          int shifted = (passes[0][pulse] +
+                         start * ELS_SPINDLE_ENCODER_PPR / starts) %
+                        ELS_SPINDLE_ENCODER_PPR;
+          ASSERT_EQ(passes[start][pulse], shifted)
+              << "pitch " << pitch << " start " << start << "/" << starts
+              << " pulse " << pulse;
+        }
+      }
+    }
+  }
+
+  globalState->setThreadStarts(1);
+  globalState->setUnitMode(GlobalUnitMode::METRIC);
+  globalState->setFeedMode(GlobalFeedMode::FEED);
+}
+
+TEST(ThreadStartsTest, TestValidStartCounts) {
+  GlobalState* globalState = GlobalState::getInstance();
+
+  globalState->setThreadStarts(1);
+  vector<int> counts;
+  do {
+    counts.push_back(globalState->nextThreadStarts());
+  } while (globalState->getThreadStarts() != 1);
+
+  // only the counts that divide the encoder pulses per revolution
+  for (int starts : counts) {
+    ASSERT_EQ(ELS_SPINDLE_ENCODER_PPR % starts, 0);
+    ASSERT_LE(starts, ELS_THREAD_MAX_STARTS);
+  }
+  ASSERT_FALSE(GlobalState::isValidThreadStarts(3));
+  globalState->setThreadStarts(3);
+  ASSERT_EQ(globalState->getThreadStarts(), 1);
+
+  // the leadscrew keeps count of the start we're cutting
+  Spindle spindle;
+  LeadscrewIOMock io;
+  Leadscrew leadscrew(&spindle, &io, 0, 0, ELS_LEADSCREW_STEPPER_PPR,
+                      ELS_LEADSCREW_PITCH_MM);
+  leadscrew.setThreadStarts(3);
+  ASSERT_EQ(leadscrew.getThreadStarts(), 1);
+
+  leadscrew.setThreadStarts(4);
+  ASSERT_EQ(leadscrew.getThreadStart(), 0);
+  ASSERT_EQ(leadscrew.nextThreadStart(), 1);
+  ASSERT_EQ(leadscrew.nextThreadStart(), 2);
+  ASSERT_EQ(leadscrew.nextThreadStart(), 3);
+  ASSERT_EQ(leadscrew.nextThreadStart(), 0);
+  ASSERT_EQ(leadscrew.getThreadStartAngle(), 0);
+  leadscrew.nextThreadStart();
+  ASSERT_EQ(leadscrew.getThreadStartAngle(), ELS_SPINDLE_ENCODER_PPR / 4);
+
+  // picking the starts again goes back to the first
+  leadscrew.setThreadStarts(4);
+  ASSERT_EQ(leadscrew.getThreadStart(), 0);
+
+  globalState->setThreadStarts(1);
+}
+
+TEST(ThreadStartsTest, TestMetricStartsAreEvenlySpaced) {
+  MicrosSingleton::getInstance().setMicros(0);
+  checkStartSpacing(GlobalUnitMode::METRIC, ARRAY_SIZE(threadPitchMetric));
+}
+
+TEST(ThreadStartsTest, TestImperialStartsAreEvenlySpaced) {
+  MicrosSingleton::getInstance().setMicros(0);
+  checkStartSpacing(GlobalUnitMode::IMPERIAL, ARRAY_SIZE(threadPitchImperial));
+}
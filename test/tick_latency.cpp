@@ -0,0 +1,52 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <cycle_profile.h>
+#include <gmock/gmock.h>
+
+// 20us at 600MHz
+#define TICK_LATENCY_TEST_PERIOD 12000
+
+TEST(TickLatencyProfileTest, TestOnTimeTicksAreNotLate) {
+  TickLatencyProfile profile;
+  uint32_t now = 1000;
+  for (int i = 0; i < 10; i++) {
+    profile.tick(now, TICK_LATENCY_TEST_PERIOD);
+    now += TICK_LATENCY_TEST_PERIOD;
+  }
+  // the first tick has nothing to go by
+  ASSERT_EQ(profile.getSamples(), 9);
+  ASSERT_EQ(profile.getWorstLateCycles(), 0);
+}
+
+TEST(TickLatencyProfileTest, TestLateTickIsMeasuredFromTheOneBefore) {
+  TickLatencyProfile profile;
+  uint32_t now = 0;
+  profile.tick(now, TICK_LATENCY_TEST_PERIOD);
+
+  // held up by 300 cycles, then back on the timer's own schedule
+  now += TICK_LATENCY_TEST_PERIOD + 300;
+  profile.tick(now, TICK_LATENCY_TEST_PERIOD);
+  ASSERT_EQ(profile.getLastLateCycles(), 300);
+  now += TICK_LATENCY_TEST_PERIOD - 300;
+  profile.tick(now, TICK_LATENCY_TEST_PERIOD);
+  ASSERT_EQ(profile.getLastLateCycles(), 0);
+  ASSERT_EQ(profile.getWorstLateCycles(), 300);
+
+  profile.reset();
+  ASSERT_EQ(profile.getWorstLateCycles(), 0);
+  ASSERT_EQ(profile.getSamples(), 0);
+}
+
+TEST(TickLatencyProfileTest, TestPeriodChangesDontCountAsLate) {
+  TickLatencyProfile profile;
+  // waking up from idle, the long tick is given as the long period
+  uint32_t now = 0xFFFFF000;
+  profile.tick(now, TICK_LATENCY_TEST_PERIOD * 50);
+  now += TICK_LATENCY_TEST_PERIOD * 50;
+  profile.tick(now, TICK_LATENCY_TEST_PERIOD);
+  now += TICK_LATENCY_TEST_PERIOD + 20;
+  profile.tick(now, TICK_LATENCY_TEST_PERIOD);
+  ASSERT_EQ(profile.getWorstLateCycles(), 20);
+}
@@ -0,0 +1,124 @@
+#ifndef PIO_UNIT_TESTING
+#define PIO_UNIT_TESTING
+#endif
+
+#include <Arduino.h>
+#include <config.h>
+#include <display.h>
+#include <globalstate.h>
+#include <gmock/gmock.h>
+#include <leadscrew.h>
+#include <native_hal.h>
+
+#include <cstdlib>
+#include <string>
+
+using ::testing::HasSubstr;
+using ::testing::StartsWith;
+
+// src/main.cpp
+void setup();
+void loop();
+extern Leadscrew leadscrew;
+extern Display display;
+
+#define MS 1000
+
+// the whole firmware on the native HAL, setup() only runs once so every test
+// puts the machine back the way it found it
+class FirmwareTest : public ::testing::Test {
+ protected:
+  static std::string s_bootSerial;
+
+  NativeHal* m_hal = NativeHal::getInstance();
+
+  static void SetUpTestSuite() {
+    NativeHal::getInstance()->reset();
+    setup();
+    s_bootSerial = NativeHal::getInstance()->takeSerial();
+  }
+
+  void run(uint64_t micros) { m_hal->runFor(micros, loop); }
+
+  // press and release, then wait until it can't be part of a double click
+  void click(uint8_t pin) {
+    m_hal->setPin(pin, LOW);
+    run(50 * MS);
+    m_hal->setPin(pin, HIGH);
+    run((ELS_BUTTON_DOUBLE_CLICK_MS + 50) * MS);
+  }
+};
+
+std::string FirmwareTest::s_bootSerial;
+
+TEST_F(FirmwareTest, TestBootsToTheMainScreen) {
+  ASSERT_THAT(s_bootSerial, HasSubstr("Initial pulse delay: "));
+  ASSERT_TRUE(display.isAvailable());
+
+  uint32_t frames = m_hal->getFrames();
+  run(ELS_DISPLAY_TASK_PERIOD_US * 3);
+  ASSERT_GT(m_hal->getFrames(), frames);
+
+  int lit = 0;
+  for (int16_t y = 0; y < SCREEN_HEIGHT; y++) {
+    for (int16_t x = 0; x < SCREEN_WIDTH; x++) {
+      lit += m_hal->getPanelPixel(x, y);
+    }
+  }
+  ASSERT_GT(lit, 0);
+  ASSERT_LT(lit, SCREEN_WIDTH * SCREEN_HEIGHT);
+
+  std::string pbm = m_hal->getPanelPbm();
+  ASSERT_THAT(pbm, StartsWith("P4\n128 64\n"));
+  ASSERT_EQ(pbm.size(), 10 + (SCREEN_WIDTH / 8) * SCREEN_HEIGHT);
+}
+
+TEST_F(FirmwareTest, TestTelemetryIsPrinted) {
+  m_hal->takeSerial();
+  run(ELS_TELEMETRY_TASK_PERIOD_US + 10 * MS);
+
+  std::string serial = m_hal->takeSerial();
+  ASSERT_THAT(serial, HasSubstr("Uptime us: "));
+  ASSERT_THAT(serial, HasSubstr("Spindle position: 0"));
+}
+
+TEST_F(FirmwareTest, TestButtonsAreIgnoredWhileLocked) {
+  GlobalState* globalState = GlobalState::getInstance();
+  ASSERT_EQ(globalState->getButtonLock(), GlobalButtonLock::LOCKED);
+
+  click(ELS_ENABLE_BUTTON);
+  ASSERT_EQ(globalState->getMotionMode(), GlobalMotionMode::DISABLED);
+}
+
+TEST_F(FirmwareTest, TestLeadscrewFollowsTheSpindle) {
+  GlobalState* globalState = GlobalState::getInstance();
+  uint32_t stepsBefore = m_hal->getRisingEdges(ELS_LEADSCREW_STEP);
+
+  click(ELS_LOCK_BUTTON);
+  ASSERT_EQ(globalState->getButtonLock(), GlobalButtonLock::UNLOCKED);
+  click(ELS_ENABLE_BUTTON);
+  ASSERT_EQ(globalState->getMotionMode(), GlobalMotionMode::ENABLED);
+
+  // a turn a second, then stop and let the leadscrew catch up
+  m_hal->setEncoderRate(ELS_SPINDLE_ENCODER_A, ELS_SPINDLE_ENCODER_PPR);
+  run(2000 * MS);
+  m_hal->setEncoderRate(ELS_SPINDLE_ENCODER_A, 0);
+  run(500 * MS);
+
+  int spindlePosition = m_hal->readEncoder(ELS_SPINDLE_ENCODER_A);
+  ASSERT_NEAR(spindlePosition, 2 * ELS_SPINDLE_ENCODER_PPR, 1);
+  int expected = spindlePosition * leadscrew.getRatio();
+  ASSERT_NEAR(leadscrew.getCurrentPosition(), expected, 1);
+
+  // every position unit takes at least one pulse on the step pin, and once
+  // caught up the leadscrew stays put
+  uint32_t steps = m_hal->getRisingEdges(ELS_LEADSCREW_STEP) - stepsBefore;
+  ASSERT_GE(steps, abs(expected));
+  run(100 * MS);
+  ASSERT_EQ(m_hal->getRisingEdges(ELS_LEADSCREW_STEP) - stepsBefore, steps);
+
+  click(ELS_ENABLE_BUTTON);
+  ASSERT_EQ(globalState->getMotionMode(), GlobalMotionMode::DISABLED);
+  click(ELS_LOCK_BUTTON);
+  ASSERT_EQ(globalState->getButtonLock(), GlobalButtonLock::LOCKED);
+}
@@ -0,0 +1,226 @@
+// times Display::update() against the sprintf version, see usage() below
+#include <config.h>
+#include <display.h>
+#include <display_text.h>
+#include <globalstate.h>
+#include <leadscrew.h>
+#include <native_hal.h>
+#include <spindle.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "sprintf_display.h"
+
+using std::vector;
+
+// a spindle that reports whatever speed the frame wants
+class BenchSpindle : public Spindle {
+ public:
+  uint32_t pulsesPerSecond = 0;
+  uint32_t getEstimatedVelocityInPulsesPerSecond() override {
+    return pulsesPerSecond;
+  }
+};
+
+class BenchLeadscrewIO : public LeadscrewIO {
+ public:
+  void writeStepPin(uint8_t val) override {}
+  uint8_t readStepPin() override { return 0; }
+  void writeDirPin(uint8_t val) override {}
+  uint8_t readDirPin() override { return 0; }
+};
+
+// everything one frame shows
+struct BenchFrame {
+  GlobalUnitMode unitMode;
+  GlobalFeedMode feedMode;
+  int feedSelect;
+  int threadStarts;
+  uint32_t pulsesPerSecond;
+};
+
+struct BenchTable {
+  GlobalUnitMode unitMode;
+  GlobalFeedMode feedMode;
+  int size;
+};
+
+static const BenchTable benchTables[] = {
+    {GlobalUnitMode::METRIC, GlobalFeedMode::FEED,
+     ARRAY_SIZE(feedPitchMetric)},
+    {GlobalUnitMode::METRIC, GlobalFeedMode::THREAD,
+     ARRAY_SIZE(threadPitchMetric)},
+    {GlobalUnitMode::IMPERIAL, GlobalFeedMode::FEED,
+     ARRAY_SIZE(feedPitchImperial)},
+    {GlobalUnitMode::IMPERIAL, GlobalFeedMode::THREAD,
+     ARRAY_SIZE(threadPitchImperial)},
+};
+
+static const uint32_t benchSpeeds[] = {0, 100, 1500, 9000, 20000};
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [-n frames] [-r repeats]\n"
+          "  -n  frames drawn per timing, default 20000\n"
+          "  -r  timings of each display, the fastest is kept, default 5\n"
+          "\n"
+          "Draws every entry of the pitch tables at a few spindle speeds with\n"
+          "Display::update() and with the old sprintf text, checks both draw\n"
+          "the same pixels and prints what a frame costs each of them. The\n"
+          "text alone is timed too, on the native HAL drawing the pixels\n"
+          "costs a lot more than it does on the Teensy\n",
+          name);
+}
+
+static void showFrame(const BenchFrame& frame, BenchSpindle* spindle,
+                      Leadscrew* leadscrew) {
+  GlobalState* state = GlobalState::getInstance();
+  state->setUnitMode(frame.unitMode);
+  state->setFeedMode(frame.feedMode);
+  state->setFeedSelect(frame.feedSelect);
+  state->setThreadStarts(frame.threadStarts);
+  leadscrew->setThreadStarts(state->getThreadStarts());
+  spindle->pulsesPerSecond = frame.pulsesPerSecond;
+}
+
+// keeps the text from being optimised away
+static volatile char benchSink;
+
+// nanoseconds per frame of the fastest of the repeats so far
+struct BenchTiming {
+  double best = 0;
+
+  template <typename F>
+  void time(const vector<BenchFrame>& frames, BenchSpindle* spindle,
+            Leadscrew* leadscrew, int count, F draw) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+      showFrame(frames[i % frames.size()], spindle, leadscrew);
+      draw();
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double perFrame = elapsed.count() / count;
+    if (best == 0 || perFrame < best) {
+      best = perFrame;
+    }
+  }
+};
+
+static void printTimings(const char* name, const BenchTiming& before,
+                         const BenchTiming& after) {
+  printf("%-8s sprintf %8.0f ns/frame, now %8.0f ns/frame, saved %.1f%%\n",
+         name, before.best, after.best,
+         100 * (before.best - after.best) / before.best);
+}
+
+int main(int argc, char** argv) {
+  int count = 20000;
+  int repeats = 5;
+
+  int option;
+  while ((option = getopt(argc, argv, "n:r:h")) != -1) {
+    switch (option) {
+      case 'n':
+        count = atoi(optarg);
+        break;
+      case 'r':
+        repeats = atoi(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+  if (count < 1 || repeats < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  NativeHal::getInstance()->reset();
+  BenchSpindle spindle;
+  BenchLeadscrewIO leadscrewIO;
+  Leadscrew leadscrew(&spindle, &leadscrewIO,
+                      LEADSCREW_INITIAL_PULSE_DELAY_US,
+                      LEADSCREW_PULSE_DELAY_STEP_US, ELS_LEADSCREW_STEPPER_PPR,
+                      ELS_LEADSCREW_PITCH_MM);
+  Display display(&spindle, &leadscrew);
+  SprintfDisplay sprintfDisplay(&spindle, &leadscrew);
+  if (!display.init() || !sprintfDisplay.init()) {
+    fprintf(stderr, "the display didn't start\n");
+    return 1;
+  }
+
+  vector<BenchFrame> frames;
+  for (const BenchTable& table : benchTables) {
+    for (int select = 0; select < table.size; select++) {
+      for (uint32_t speed : benchSpeeds) {
+        frames.push_back({table.unitMode, table.feedMode, select,
+                          1 + select % 3, speed});
+      }
+    }
+  }
+
+  // the same frame has to come out of both, pixel for pixel
+  size_t framebufferSize = SSD1306_FRAMEBUFFER_SIZE;
+  for (const BenchFrame& frame : frames) {
+    showFrame(frame, &spindle, &leadscrew);
+    display.update();
+    sprintfDisplay.update();
+    if (memcmp(display.m_panel.getBuffer(),
+               sprintfDisplay.m_panel.getBuffer(), framebufferSize) != 0) {
+      fprintf(stderr,
+              "the displays differ at unit %d mode %d select %d, "
+              "%u pulses/s\n",
+              frame.unitMode, frame.feedMode, frame.feedSelect,
+              frame.pulsesPerSecond);
+      return 1;
+    }
+  }
+
+  // the text each frame needs, made the old way and the new way
+  GlobalState* state = GlobalState::getInstance();
+  auto sprintfText = [&spindle, &leadscrew]() {
+    char pitch[10];
+    char rpm[10];
+    char start[10];
+    SprintfDisplay::sprintfPitch(pitch);
+    SprintfDisplay::sprintfSpindleRpm(rpm, spindle.getEstimatedVelocityInRPM());
+    SprintfDisplay::sprintfThreadStart(start, leadscrew.getThreadStart(),
+                                       leadscrew.getThreadStarts());
+    benchSink = pitch[0] + rpm[3] + start[1];
+  };
+  auto labelText = [&spindle, &leadscrew, state]() {
+    char rpm[DISPLAY_INTEGER_SIZE];
+    char start[DISPLAY_INTEGER_SIZE];
+    const char* pitch = getPitchLabel(
+        state->getUnitMode(), state->getFeedMode(), state->getFeedSelect());
+    formatInteger(rpm, spindle.getEstimatedVelocityInRPM(), 4);
+    formatInteger(start, leadscrew.getThreadStart() + 1);
+    benchSink = pitch[0] + rpm[3] + start[0];
+    formatInteger(start, leadscrew.getThreadStarts());
+    benchSink = start[0];
+  };
+
+  // taking turns evens out anything else going on in the machine
+  BenchTiming sprintfUpdate, update, sprintfTextOnly, textOnly;
+  for (int repeat = 0; repeat < repeats; repeat++) {
+    sprintfUpdate.time(frames, &spindle, &leadscrew, count,
+                       [&sprintfDisplay]() { sprintfDisplay.update(); });
+    update.time(frames, &spindle, &leadscrew, count,
+                [&display]() { display.update(); });
+    sprintfTextOnly.time(frames, &spindle, &leadscrew, count, sprintfText);
+    textOnly.time(frames, &spindle, &leadscrew, count, labelText);
+  }
+
+  printf("%zu different frames, %d drawn per timing, best of %d\n",
+         frames.size(), count, repeats);
+  printTimings("update()", sprintfUpdate, update);
+  printTimings("text", sprintfTextOnly, textOnly);
+  return 0;
+}
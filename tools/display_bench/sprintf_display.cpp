@@ -0,0 +1,86 @@
+#include "sprintf_display.h"
+
+#include <config.h>
+#include <globalstate.h>
+
+#include <cstdio>
+
+void SprintfDisplay::update() {
+  if (!isAvailable()) {
+    return;
+  }
+
+  m_panel.clearDisplay();
+
+  drawMode();
+  drawSprintfPitch();
+  drawLocked();
+  drawEnabled();
+  drawSprintfSpindleRpm();
+  drawStopStatus();
+  drawSprintfThreadStart();
+
+  m_panel.display();
+}
+
+void SprintfDisplay::sprintfSpindleRpm(char* rpmString, int rpm) {
+  sprintf(rpmString, "%4dRPM", rpm);
+}
+
+void SprintfDisplay::sprintfThreadStart(char* start, int threadStart,
+                                        int threadStarts) {
+  sprintf(start, "S%d/%d", threadStart + 1, threadStarts);
+}
+
+void SprintfDisplay::sprintfPitch(char* pitch) {
+  GlobalState* state = GlobalState::getInstance();
+  GlobalUnitMode unit = state->getUnitMode();
+  GlobalFeedMode mode = state->getFeedMode();
+  int feedSelect = state->getFeedSelect();
+  if (unit == GlobalUnitMode::METRIC) {
+    if (mode == GlobalFeedMode::THREAD) {
+      sprintf(pitch, "%.2fmm", threadPitchMetric[feedSelect]);
+    } else {
+      sprintf(pitch, "%.2fmm", feedPitchMetric[feedSelect]);
+    }
+  } else {
+    if (mode == GlobalFeedMode::THREAD) {
+      sprintf(pitch, "%dTPI", (int)threadPitchImperial[feedSelect]);
+    } else {
+      sprintf(pitch, "%dth", (int)(feedPitchImperial[feedSelect] * 1000));
+    }
+  }
+}
+
+void SprintfDisplay::drawSprintfSpindleRpm() {
+  char rpmString[10];
+  m_panel.setCursor(0, 0);
+  m_panel.setTextSize(1);
+  m_panel.setTextColor(WHITE);
+  sprintfSpindleRpm(rpmString, m_sprintfSpindle->getEstimatedVelocityInRPM());
+  m_panel.print(rpmString);
+}
+
+void SprintfDisplay::drawSprintfThreadStart() {
+  int starts = m_sprintfLeadscrew->getThreadStarts();
+  if (GlobalState::getInstance()->getFeedMode() != GlobalFeedMode::THREAD ||
+      starts == 1) {
+    return;
+  }
+
+  char start[10];
+  m_panel.setCursor(0, 16);
+  m_panel.setTextSize(1);
+  m_panel.setTextColor(WHITE);
+  sprintfThreadStart(start, m_sprintfLeadscrew->getThreadStart(), starts);
+  m_panel.print(start);
+}
+
+void SprintfDisplay::drawSprintfPitch() {
+  char pitch[10];
+  sprintfPitch(pitch);
+  m_panel.setCursor(55, 8);
+  m_panel.setTextSize(2);
+  m_panel.setTextColor(WHITE);
+  m_panel.print(pitch);
+}
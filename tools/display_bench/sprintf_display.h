@@ -0,0 +1,34 @@
+#include <display.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#pragma once
+
+/**
+ * The display drawn the way Display::update() used to, with the pitch, RPM
+ * and thread start formatted by sprintf every frame. Everything else is drawn
+ * by Display itself, so the two only differ in how they make their text
+ */
+class SprintfDisplay : public Display {
+ private:
+  Spindle* m_sprintfSpindle;
+  Leadscrew* m_sprintfLeadscrew;
+
+  void drawSprintfPitch();
+  void drawSprintfSpindleRpm();
+  void drawSprintfThreadStart();
+
+ public:
+  // the text each part of the frame used to be, buffers of 10 chars
+  static void sprintfPitch(char* pitch);
+  static void sprintfSpindleRpm(char* rpmString, int rpm);
+  static void sprintfThreadStart(char* start, int threadStart,
+                                 int threadStarts);
+
+  SprintfDisplay(Spindle* spindle, Leadscrew* leadscrew)
+      : Display(spindle, leadscrew),
+        m_sprintfSpindle(spindle),
+        m_sprintfLeadscrew(leadscrew) {}
+
+  void update();
+};
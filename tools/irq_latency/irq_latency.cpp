@@ -0,0 +1,195 @@
+// runs the interrupt priority plan against synthetic load, see usage() below
+#include <config.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "nvic_model.h"
+
+using std::vector;
+
+// what the Teensy core gives every interrupt nobody has set a level for
+#define IRQ_LATENCY_DEFAULT_PRIORITY 128
+// IRQ numbers on the IMXRT1062, they break ties between equal levels
+#define IRQ_LATENCY_DMA_CH0 0
+#define IRQ_LATENCY_LPI2C1 28
+#define IRQ_LATENCY_USB1 113
+#define IRQ_LATENCY_PIT 122
+#define IRQ_LATENCY_GPIO6789 157
+// exception entry on the Cortex-M7, the handler's own cycles come on top
+#define IRQ_LATENCY_ENTRY_CYCLES 12
+
+struct LoadSettings {
+  float cpuMhz;
+  float rpm;
+  float countsPerRev;
+  uint32_t encoderCycles;
+  uint32_t timerCycles;
+  uint32_t timerMaskedCycles;
+  float i2cBytesPerSecond;
+  uint32_t i2cCycles;
+  uint32_t usbCycles;
+  uint32_t dmaCycles;
+  float seconds;
+  uint32_t seed;
+};
+
+struct Priorities {
+  const char* name;
+  uint8_t encoder;
+  uint8_t timer;
+  uint8_t comms;
+};
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [-r rpm] [-p counts] [-e cycles] [-t cycles] "
+          "[-m cycles]\n"
+          "          [-b bytes/s] [-i cycles] [-u cycles] [-d cycles] "
+          "[-s seconds]\n"
+          "          [-c MHz] [-x seed]\n"
+          "  -r  spindle RPM, default 3000\n"
+          "  -p  encoder counts a revolution, default ELS_SPINDLE_ENCODER_PPR\n"
+          "  -e  cycles an encoder edge takes to count, default 150\n"
+          "  -t  cycles a motion timer tick takes, the worst case from the\n"
+          "      'Motion timer cycles' telemetry, default 1500\n"
+          "  -m  cycles of that with interrupts masked, default 60\n"
+          "  -b  I2C bytes a second, one interrupt each, default 44000\n"
+          "  -i  cycles an I2C interrupt takes, default 250\n"
+          "  -u  cycles a USB serial interrupt takes, one every 125us, "
+          "default 2000\n"
+          "  -d  cycles the display DMA interrupt takes, default 400\n"
+          "  -s  seconds to run for, default 2\n"
+          "  -c  CPU clock, default 600\n"
+          "  -x  seed for the request jitter, default 1\n"
+          "\n"
+          "Runs the encoder, motion timer, I2C, USB and display DMA at the\n"
+          "Teensy's default priorities and at the ones in config.h and prints\n"
+          "how long each waited at worst. The step latency is how late the\n"
+          "motion timer started\n",
+          name);
+}
+
+static uint64_t toCycles(const LoadSettings& settings, float micros) {
+  return (uint64_t)(micros * settings.cpuMhz);
+}
+
+static void runLoad(const LoadSettings& settings,
+                    const Priorities& priorities) {
+  NvicModel model(IRQ_LATENCY_ENTRY_CYCLES);
+
+  // a real spindle isn't perfectly even, the edges wander by a quarter
+  float edgeMicros =
+      US_PER_SECOND / (settings.rpm / 60 * settings.countsPerRev);
+  uint64_t edgeCycles = toCycles(settings, edgeMicros);
+  model.addSource({"encoder", IRQ_LATENCY_GPIO6789, priorities.encoder,
+                   edgeCycles, (uint32_t)(edgeCycles / 4), 1, 0,
+                   settings.encoderCycles, 0});
+  int timer = model.addSource(
+      {"motion timer", IRQ_LATENCY_PIT, priorities.timer,
+       toCycles(settings, LEADSCREW_TIMER_US), 0, 1, 0, settings.timerCycles,
+       settings.timerMaskedCycles});
+  // none of the buses run off the timer's clock, so they drift against it
+  uint64_t byteCycles =
+      toCycles(settings, US_PER_SECOND / settings.i2cBytesPerSecond);
+  model.addSource({"i2c", IRQ_LATENCY_LPI2C1, priorities.comms, byteCycles,
+                   (uint32_t)(byteCycles / 10), 1, 0, settings.i2cCycles, 0});
+  // a high speed USB microframe
+  uint64_t microframeCycles = toCycles(settings, 125);
+  model.addSource({"usb serial", IRQ_LATENCY_USB1, priorities.comms,
+                   microframeCycles, (uint32_t)(microframeCycles / 4), 1, 0,
+                   settings.usbCycles, 0});
+  // one changed rectangle of the SPI TFT at a time, a few a frame
+  uint64_t frameCycles = toCycles(settings, ELS_DISPLAY_TASK_PERIOD_US);
+  model.addSource({"display dma", IRQ_LATENCY_DMA_CH0, priorities.comms,
+                   frameCycles, (uint32_t)(frameCycles / 4), 8,
+                   (uint32_t)toCycles(settings, 1100), settings.dmaCycles, 0});
+
+  uint64_t cycles = toCycles(settings, settings.seconds * US_PER_SECOND);
+  vector<IrqResult> results = model.run(cycles, settings.seed);
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const IrqSource& source = model.getSource(i);
+    printf("%s,%s,%d,%llu,%.2f,%.2f,%llu\n", priorities.name, source.name,
+           source.priority, (unsigned long long)results[i].requests,
+           results[i].worstLatencyCycles / settings.cpuMhz,
+           results[i].worstResponseCycles / settings.cpuMhz,
+           (unsigned long long)results[i].merged);
+  }
+
+  fprintf(stderr, "%s: worst step latency %.2fus, %.0f%% of the %dus tick\n",
+          priorities.name, results[timer].worstLatencyCycles / settings.cpuMhz,
+          results[timer].worstLatencyCycles / settings.cpuMhz * 100 /
+              LEADSCREW_TIMER_US,
+          LEADSCREW_TIMER_US);
+}
+
+int main(int argc, char** argv) {
+  LoadSettings settings = {600, 3000, ELS_SPINDLE_ENCODER_PPR, 150, 1500, 60,
+                           44000, 250, 2000, 400, 2, 1};
+
+  int option;
+  while ((option = getopt(argc, argv, "r:p:e:t:m:b:i:u:d:s:c:x:h")) != -1) {
+    switch (option) {
+      case 'r':
+        settings.rpm = atof(optarg);
+        break;
+      case 'p':
+        settings.countsPerRev = atof(optarg);
+        break;
+      case 'e':
+        settings.encoderCycles = atoi(optarg);
+        break;
+      case 't':
+        settings.timerCycles = atoi(optarg);
+        break;
+      case 'm':
+        settings.timerMaskedCycles = atoi(optarg);
+        break;
+      case 'b':
+        settings.i2cBytesPerSecond = atof(optarg);
+        break;
+      case 'i':
+        settings.i2cCycles = atoi(optarg);
+        break;
+      case 'u':
+        settings.usbCycles = atoi(optarg);
+        break;
+      case 'd':
+        settings.dmaCycles = atoi(optarg);
+        break;
+      case 's':
+        settings.seconds = atof(optarg);
+        break;
+      case 'c':
+        settings.cpuMhz = atof(optarg);
+        break;
+      case 'x':
+        settings.seed = atoi(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+  if (settings.rpm <= 0 || settings.countsPerRev <= 0 ||
+      settings.i2cBytesPerSecond <= 0 || settings.seconds <= 0 ||
+      settings.cpuMhz <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const Priorities defaults = {"defaults", IRQ_LATENCY_DEFAULT_PRIORITY,
+                               IRQ_LATENCY_DEFAULT_PRIORITY,
+                               IRQ_LATENCY_DEFAULT_PRIORITY};
+  const Priorities plan = {"config", ELS_ENCODER_IRQ_PRIORITY,
+                           ELS_MOTION_TIMER_PRIORITY, ELS_COMMS_IRQ_PRIORITY};
+
+  printf("priorities,irq,level,requests,worst_latency_us,worst_response_us,"
+         "merged\n");
+  runLoad(settings, defaults);
+  runLoad(settings, plan);
+  return 0;
+}
@@ -0,0 +1,153 @@
+#include "nvic_model.h"
+
+#include <irq_priority.h>
+
+#include <algorithm>
+#include <random>
+
+using std::vector;
+
+struct SourceState {
+  uint64_t nextRequest;
+  uint64_t burstStart;
+  uint32_t burstRemaining;
+  bool pending;
+  uint64_t pendingSince;
+};
+
+// a handler that has started, the running one is at the back
+struct ActiveHandler {
+  int source;
+  uint64_t requestedAt;
+  uint64_t remaining;
+  uint64_t ran;
+};
+
+NvicModel::NvicModel(uint32_t entryCycles) : m_entryCycles(entryCycles) {}
+
+int NvicModel::addSource(const IrqSource& source) {
+  m_sources.push_back(source);
+  return m_sources.size() - 1;
+}
+
+vector<IrqResult> NvicModel::run(uint64_t cycles, uint32_t seed) {
+  std::mt19937 random(seed);
+  vector<IrqResult> results(m_sources.size(), IrqResult{0, 0, 0, 0});
+  vector<SourceState> states(m_sources.size());
+  vector<ActiveHandler> active;
+
+  auto jitter = [&](const IrqSource& source) -> int64_t {
+    if (source.jitterCycles == 0) {
+      return 0;
+    }
+    std::uniform_int_distribution<int64_t> distribution(
+        -(int64_t)source.jitterCycles, source.jitterCycles);
+    return distribution(random);
+  };
+
+  // everything starts at a random phase within its period
+  for (size_t i = 0; i < m_sources.size(); i++) {
+    std::uniform_int_distribution<uint64_t> phase(
+        0, m_sources[i].periodCycles - 1);
+    states[i] = {phase(random), 0, m_sources[i].burstSize, false, 0};
+    states[i].burstStart = states[i].nextRequest;
+  }
+
+  uint64_t now = 0;
+  while (true) {
+    uint64_t next = UINT64_MAX;
+    for (const SourceState& state : states) {
+      next = std::min(next, state.nextRequest);
+    }
+    if (!active.empty()) {
+      const ActiveHandler& running = active.back();
+      next = std::min(next, now + running.remaining);
+      uint32_t masked = m_sources[running.source].maskedCycles;
+      if (running.ran < masked) {
+        next = std::min(next, now + masked - running.ran);
+      }
+    }
+    if (next > cycles) {
+      break;
+    }
+
+    if (!active.empty()) {
+      ActiveHandler& running = active.back();
+      running.remaining -= next - now;
+      running.ran += next - now;
+    }
+    now = next;
+
+    if (!active.empty() && active.back().remaining == 0) {
+      IrqResult& result = results[active.back().source];
+      result.worstResponseCycles = std::max(result.worstResponseCycles,
+                                            now - active.back().requestedAt);
+      active.pop_back();
+    }
+
+    for (size_t i = 0; i < m_sources.size(); i++) {
+      SourceState& state = states[i];
+      if (state.nextRequest != now) {
+        continue;
+      }
+      const IrqSource& source = m_sources[i];
+      results[i].requests++;
+      if (state.pending) {
+        results[i].merged++;
+      } else {
+        state.pending = true;
+        state.pendingSince = now;
+      }
+
+      if (--state.burstRemaining > 0) {
+        state.nextRequest = now + source.burstGapCycles;
+      } else {
+        int64_t start =
+            (int64_t)(state.burstStart + source.periodCycles) + jitter(source);
+        state.burstStart = std::max<int64_t>(start, now + 1);
+        state.nextRequest = state.burstStart;
+        state.burstRemaining = source.burstSize;
+      }
+    }
+
+    // start whatever may preempt, most urgent first, lowest IRQ on a tie
+    while (true) {
+      int best = -1;
+      for (size_t i = 0; i < m_sources.size(); i++) {
+        if (!states[i].pending) {
+          continue;
+        }
+        if (best < 0) {
+          best = i;
+          continue;
+        }
+        uint8_t level = getIrqPriorityLevel(m_sources[i].priority);
+        uint8_t bestLevel = getIrqPriorityLevel(m_sources[best].priority);
+        if (level < bestLevel ||
+            (level == bestLevel && m_sources[i].irq < m_sources[best].irq)) {
+          best = i;
+        }
+      }
+      if (best < 0) {
+        break;
+      }
+      if (!active.empty()) {
+        const ActiveHandler& running = active.back();
+        if (running.ran < m_sources[running.source].maskedCycles ||
+            getIrqPriorityLevel(m_sources[best].priority) >=
+                getIrqPriorityLevel(m_sources[running.source].priority)) {
+          break;
+        }
+      }
+
+      SourceState& state = states[best];
+      IrqResult& result = results[best];
+      result.worstLatencyCycles =
+          std::max(result.worstLatencyCycles, now - state.pendingSince);
+      active.push_back({best, state.pendingSince,
+                        m_sources[best].serviceCycles + m_entryCycles, 0});
+      state.pending = false;
+    }
+  }
+  return results;
+}
@@ -0,0 +1,55 @@
+#include <cstdint>
+#include <vector>
+
+#pragma once
+
+/**
+ * One interrupt and the load it puts on the CPU. Requests come in bursts of
+ * burstSize, burstGapCycles apart, with periodCycles from the start of one
+ * burst to the next moved by up to jitterCycles either way
+ */
+struct IrqSource {
+  const char* name;
+  // the IMXRT1062 IRQ number, equal levels are taken lowest number first
+  int irq;
+  uint8_t priority;
+  uint64_t periodCycles;
+  uint32_t jitterCycles;
+  uint32_t burstSize;
+  uint32_t burstGapCycles;
+  // how long the handler runs, the first maskedCycles with interrupts masked
+  uint32_t serviceCycles;
+  uint32_t maskedCycles;
+};
+
+struct IrqResult {
+  uint64_t requests;
+  // from the request to the handler starting and to it finishing
+  uint64_t worstLatencyCycles;
+  uint64_t worstResponseCycles;
+  // requests that came while the last one was still waiting, the handler only
+  // runs once for both. For the motion timer that's a lost tick
+  uint64_t merged;
+};
+
+/**
+ * The Cortex-M7 NVIC as far as latency goes
+ *
+ * A pending interrupt preempts the running handler if its level is more
+ * urgent, otherwise it waits and the most urgent pending one runs next. Every
+ * handler costs the exception entry on top of its own cycles. Requests are
+ * drawn from a seeded generator so runs are repeatable
+ */
+class NvicModel {
+ private:
+  std::vector<IrqSource> m_sources;
+  uint32_t m_entryCycles;
+
+ public:
+  explicit NvicModel(uint32_t entryCycles);
+
+  // returns the index the source's results will be at
+  int addSource(const IrqSource& source);
+  const IrqSource& getSource(int index) { return m_sources[index]; }
+  std::vector<IrqResult> run(uint64_t cycles, uint32_t seed);
+};
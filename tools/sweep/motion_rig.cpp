@@ -0,0 +1,68 @@
+#include "motion_rig.h"
+
+#include <config.h>
+
+#include <cmath>
+#include <cstdlib>
+
+SimSpindleIO::SimSpindleIO(Clock* clock, float rpm)
+    : m_clock(clock),
+      m_countsPerMicro((double)rpm * ELS_SPINDLE_ENCODER_PPR / 60 / 1000000) {}
+
+int32_t SimSpindleIO::readEncoder() {
+  return (int32_t)floor(m_clock->nowMicros() * m_countsPerMicro);
+}
+
+MotionRig::MotionRig(const MotionParams& params, GlobalUnitMode unitMode,
+                     GlobalFeedMode feedMode, int feedSelect, float rpm)
+    : m_spindleIO(&m_clock, rpm),
+      m_spindle(&m_spindleIO, &m_globalState, &m_clock),
+      m_leadscrew(&m_spindle, &m_leadscrewIO,
+                  1000000 / (params.jerk * ELS_LEADSCREW_STEPS_PER_MM),
+                  params.accel / ELS_LEADSCREW_STEPS_PER_MM,
+                  ELS_LEADSCREW_STEPPER_PPR, ELS_LEADSCREW_PITCH_MM,
+                  &m_globalState, &m_clock),
+      m_timerMicros(params.timerMicros) {
+  // the feed mode resets the selection, so it has to go first
+  m_globalState.setUnitMode(unitMode);
+  m_globalState.setFeedMode(feedMode);
+  m_globalState.setFeedSelect(feedSelect);
+  m_globalState.setMotionMode(GlobalMotionMode::ENABLED);
+
+  m_leadscrew.setMinPulseDelay(params.timerMicros * 2);
+  m_leadscrew.setRatio(m_globalState.getCurrentFeedPitch());
+}
+
+RunResult MotionRig::run(uint64_t settleMicros, uint64_t holdMicros,
+                         float toleranceMm) {
+  RunResult result = {true, 0};
+
+  // a leadscrew position is worth more or less travel depending on the pitch,
+  // every position takes 1 + ratio / leadscrew pitch pulses
+  float mmPerPosition =
+      (1 + fabs(m_leadscrew.getRatio() / ELS_LEADSCREW_PITCH_MM)) /
+      ELS_LEADSCREW_STEPS_PER_MM;
+
+  for (uint64_t time = 0; time < settleMicros + holdMicros;
+       time += m_timerMicros) {
+    m_clock.advance(m_timerMicros);
+    m_spindle.update();
+    m_leadscrew.update();
+
+    if (time < settleMicros) {
+      continue;
+    }
+
+    float errorMm = abs(m_leadscrew.getPositionError()) * mmPerPosition;
+    if (errorMm > result.worstErrorMm) {
+      result.worstErrorMm = errorMm;
+    }
+    // once it's lost the rest of the run can't change the answer
+    if (errorMm > toleranceMm) {
+      result.locked = false;
+      break;
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,87 @@
+#include <clock.h>
+#include <globalstate.h>
+#include <leadscrew.h>
+#include <spindle.h>
+
+#include <cstdint>
+
+#pragma once
+
+// the motion settings a sweep varies, in the units of config.h
+struct MotionParams {
+  // mm/s^2
+  float accel;
+  // mm/s, the speed the leadscrew can start and stop at instantly
+  float jerk;
+  // the motion timer period
+  uint32_t timerMicros;
+};
+
+// how a single run at one speed went
+struct RunResult {
+  bool locked;
+  // the largest position error while holding speed, in mm of carriage travel
+  float worstErrorMm;
+};
+
+class SimClock : public Clock {
+ private:
+  uint64_t m_nowMicros;
+
+ public:
+  SimClock() : m_nowMicros(0) {}
+  uint64_t nowMicros() override { return m_nowMicros; }
+  void advance(uint64_t micros) { m_nowMicros += micros; }
+};
+
+// a spindle encoder turning at a constant speed from time 0
+class SimSpindleIO : public SpindleIO {
+ private:
+  Clock* m_clock;
+  double m_countsPerMicro;
+
+ public:
+  SimSpindleIO(Clock* clock, float rpm);
+  int32_t readEncoder() override;
+};
+
+// a stepper that never misses a step
+class SimLeadscrewIO : public LeadscrewIO {
+ private:
+  uint8_t m_stepPin;
+  uint8_t m_dirPin;
+
+ public:
+  SimLeadscrewIO() : m_stepPin(0), m_dirPin(0) {}
+  void writeStepPin(uint8_t val) override { m_stepPin = val; }
+  uint8_t readStepPin() override { return m_stepPin; }
+  void writeDirPin(uint8_t val) override { m_dirPin = val; }
+  uint8_t readDirPin() override { return m_dirPin; }
+};
+
+/**
+ * One machine on its own clock and GlobalState, the leadscrew is enabled with
+ * the spindle already turning and has to catch up with it. Nothing is shared
+ * with any other rig, so every thread of a sweep can run its own
+ */
+class MotionRig {
+ private:
+  SimClock m_clock;
+  GlobalState m_globalState;
+  SimSpindleIO m_spindleIO;
+  SimLeadscrewIO m_leadscrewIO;
+  Spindle m_spindle;
+  Leadscrew m_leadscrew;
+  uint32_t m_timerMicros;
+
+ public:
+  MotionRig(const MotionParams& params, GlobalUnitMode unitMode,
+            GlobalFeedMode feedMode, int feedSelect, float rpm);
+
+  /**
+   * Ticks the motion timer for `settleMicros` to catch up and then for
+   * `holdMicros` more. We're locked if the error never goes over `toleranceMm`
+   * while holding
+   */
+  RunResult run(uint64_t settleMicros, uint64_t holdMicros, float toleranceMm);
+};
@@ -0,0 +1,221 @@
+// sweeps the motion settings over every pitch and speed, see usage() below
+#include <config.h>
+#include <globalstate.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "motion_rig.h"
+#include "work_stealing_pool.h"
+
+using std::vector;
+
+struct PitchTable {
+  const char* name;
+  GlobalUnitMode unitMode;
+  GlobalFeedMode feedMode;
+  const float* pitches;
+  int size;
+};
+
+static const PitchTable pitchTables[] = {
+    {"metric_feed", GlobalUnitMode::METRIC, GlobalFeedMode::FEED,
+     feedPitchMetric, ARRAY_SIZE(feedPitchMetric)},
+    {"metric_thread", GlobalUnitMode::METRIC, GlobalFeedMode::THREAD,
+     threadPitchMetric, ARRAY_SIZE(threadPitchMetric)},
+    {"imperial_feed", GlobalUnitMode::IMPERIAL, GlobalFeedMode::FEED,
+     feedPitchImperial, ARRAY_SIZE(feedPitchImperial)},
+    {"imperial_thread", GlobalUnitMode::IMPERIAL, GlobalFeedMode::THREAD,
+     threadPitchImperial, ARRAY_SIZE(threadPitchImperial)},
+};
+
+// one line of the CSV, every motion setting against one pitch
+struct Combination {
+  const PitchTable* table;
+  int feedSelect;
+  MotionParams params;
+};
+
+struct CombinationResult {
+  // the fastest band that held lock, 0 if not even the slowest did
+  float maxSafeRpm;
+  // the worst error while holding speed over the bands that held lock, in mm
+  float worstErrorMm;
+};
+
+struct SweepSettings {
+  vector<float> rpms;
+  uint64_t settleMicros;
+  uint64_t holdMicros;
+  float toleranceMm;
+};
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [-a accels] [-j jerks] [-t timers] [-r rpms] [-n threads]\n"
+          "          [-s settle ms] [-l hold ms] [-e tolerance] [-o out.csv]\n"
+          "  -a  leadscrew accelerations in mm/s^2, default 50,100,200\n"
+          "  -j  leadscrew jerks in mm/s, default 0.5,1\n"
+          "  -t  motion timer periods in us, default 10,20,40\n"
+          "  -r  spindle RPM bands, ascending, default "
+          "60,120,250,500,750,1000,1500,2000,3000\n"
+          "  -n  threads, default every hardware thread\n"
+          "  -s  time to catch up with the spindle, default 2000\n"
+          "  -l  time it then has to hold lock for, default 500\n"
+          "  -e  the most following error in mm that still counts as "
+          "locked,\n"
+          "      default 0.5\n"
+          "  -o  write the CSV here instead of stdout\n"
+          "\n"
+          "Every accel, jerk and timer period is run against every entry of\n"
+          "the pitch tables, at each RPM band until it loses lock\n",
+          name);
+}
+
+// parses a comma separated list, returns false if anything isn't a number
+static bool parseList(const char* text, vector<float>* values) {
+  values->clear();
+  const char* start = text;
+  while (*start != '\0') {
+    char* end;
+    float value = strtof(start, &end);
+    if (end == start || (*end != ',' && *end != '\0')) {
+      return false;
+    }
+    values->push_back(value);
+    start = *end == ',' ? end + 1 : end;
+  }
+  return !values->empty();
+}
+
+static CombinationResult sweepCombination(const Combination& combination,
+                                          const SweepSettings& settings) {
+  CombinationResult result = {0, 0};
+
+  // the bands are ascending, once one loses lock the faster ones will too
+  for (float rpm : settings.rpms) {
+    MotionRig rig(combination.params, combination.table->unitMode,
+                  combination.table->feedMode, combination.feedSelect, rpm);
+    RunResult run = rig.run(settings.settleMicros, settings.holdMicros,
+                            settings.toleranceMm);
+    if (!run.locked) {
+      break;
+    }
+    result.maxSafeRpm = rpm;
+    if (run.worstErrorMm > result.worstErrorMm) {
+      result.worstErrorMm = run.worstErrorMm;
+    }
+  }
+
+  return result;
+}
+
+int main(int argc, char** argv) {
+  vector<float> accels = {50, 100, 200};
+  vector<float> jerks = {0.5, 1};
+  vector<float> timers = {10, 20, 40};
+  SweepSettings settings = {
+      {60, 120, 250, 500, 750, 1000, 1500, 2000, 3000}, 2000000, 500000, 0.5};
+  size_t threads = 0;
+  const char* outPath = nullptr;
+
+  int option;
+  bool ok = true;
+  while ((option = getopt(argc, argv, "a:j:t:r:n:s:l:e:o:h")) != -1) {
+    switch (option) {
+      case 'a':
+        ok = parseList(optarg, &accels);
+        break;
+      case 'j':
+        ok = parseList(optarg, &jerks);
+        break;
+      case 't':
+        ok = parseList(optarg, &timers);
+        break;
+      case 'r':
+        ok = parseList(optarg, &settings.rpms);
+        break;
+      case 'n':
+        threads = atoi(optarg);
+        break;
+      case 's':
+        settings.settleMicros = (uint64_t)(atof(optarg) * 1000);
+        break;
+      case 'l':
+        settings.holdMicros = (uint64_t)(atof(optarg) * 1000);
+        break;
+      case 'e':
+        settings.toleranceMm = atof(optarg);
+        break;
+      case 'o':
+        outPath = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+    if (!ok) {
+      fprintf(stderr, "-%c: expected a comma separated list of numbers\n",
+              option);
+      return 1;
+    }
+  }
+
+  for (float timer : timers) {
+    if (timer < 1) {
+      fprintf(stderr, "-t: timer periods have to be at least 1us\n");
+      return 1;
+    }
+  }
+
+  vector<Combination> combinations;
+  for (const PitchTable& table : pitchTables) {
+    for (int feedSelect = 0; feedSelect < table.size; feedSelect++) {
+      for (float accel : accels) {
+        for (float jerk : jerks) {
+          for (float timer : timers) {
+            combinations.push_back(
+                {&table, feedSelect, {accel, jerk, (uint32_t)timer}});
+          }
+        }
+      }
+    }
+  }
+
+  FILE* out = stdout;
+  if (outPath != nullptr && (out = fopen(outPath, "w")) == nullptr) {
+    perror(outPath);
+    return 1;
+  }
+
+  // every job writes its own slot, so the CSV comes out in the same order
+  // however the jobs were spread over the threads
+  vector<CombinationResult> results(combinations.size());
+  WorkStealingPool pool(threads);
+  fprintf(stderr, "%zu combinations on %zu threads\n", combinations.size(),
+          pool.getThreads());
+  pool.run(combinations.size(), [&](size_t index) {
+    results[index] = sweepCombination(combinations[index], settings);
+  });
+
+  fprintf(out,
+          "table,pitch_index,pitch,accel,jerk,timer_us,max_safe_rpm,"
+          "worst_error_mm\n");
+  for (size_t i = 0; i < combinations.size(); i++) {
+    const Combination& combination = combinations[i];
+    fprintf(out, "%s,%d,%g,%g,%g,%u,%g,%.4f\n", combination.table->name,
+            combination.feedSelect,
+            combination.table->pitches[combination.feedSelect],
+            combination.params.accel, combination.params.jerk,
+            combination.params.timerMicros, results[i].maxSafeRpm,
+            results[i].worstErrorMm);
+  }
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : m_workers(threads > 0
+                    ? threads
+                    : std::max(1u, std::thread::hardware_concurrency())) {}
+
+size_t WorkStealingPool::getThreads() { return m_workers.size(); }
+
+bool WorkStealingPool::popOwn(size_t worker, size_t* job) {
+  std::lock_guard<std::mutex> lock(m_workers[worker].mutex);
+  std::deque<size_t>& jobs = m_workers[worker].jobs;
+  if (jobs.empty()) {
+    return false;
+  }
+  *job = jobs.back();
+  jobs.pop_back();
+  return true;
+}
+
+bool WorkStealingPool::steal(size_t thief, size_t* job) {
+  // start with the next worker along so the thieves spread out
+  for (size_t i = 1; i < m_workers.size(); i++) {
+    Worker& victim = m_workers[(thief + i) % m_workers.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      *job = victim.jobs.front();
+      victim.jobs.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::work(size_t worker,
+                            const std::function<void(size_t)>& job) {
+  // nothing is added once the run has started, so when there's nothing left to
+  // steal either we're done
+  size_t index;
+  while (popOwn(worker, &index) || steal(worker, &index)) {
+    job(index);
+  }
+}
+
+void WorkStealingPool::run(size_t count,
+                           const std::function<void(size_t)>& job) {
+  size_t threads = m_workers.size();
+  for (size_t worker = 0; worker < threads; worker++) {
+    size_t begin = count * worker / threads;
+    size_t end = count * (worker + 1) / threads;
+    for (size_t index = begin; index < end; index++) {
+      m_workers[worker].jobs.push_back(index);
+    }
+  }
+
+  // the calling thread is a worker too
+  std::vector<std::thread> pool;
+  for (size_t worker = 1; worker < threads; worker++) {
+    pool.emplace_back(&WorkStealingPool::work, this, worker, std::cref(job));
+  }
+  work(0, job);
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+}
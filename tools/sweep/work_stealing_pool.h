@@ -0,0 +1,43 @@
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#pragma once
+
+/**
+ * Runs a fixed set of jobs on a pool of threads that steal from each other
+ *
+ * The jobs are dealt out in contiguous blocks, one deque per thread. Every
+ * thread works from the back of its own deque and when it runs dry steals from
+ * the front of someone else's, so a thread that was dealt the slow jobs (high
+ * RPM bands take the longest to settle) doesn't hold the whole sweep up. Jobs
+ * are only identified by their index, results go wherever the job puts them so
+ * the output doesn't depend on which thread ran what
+ */
+class WorkStealingPool {
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+  };
+
+  std::vector<Worker> m_workers;
+
+  bool popOwn(size_t worker, size_t* job);
+  bool steal(size_t thief, size_t* job);
+  void work(size_t worker, const std::function<void(size_t)>& job);
+
+ public:
+  // 0 threads uses every hardware thread
+  explicit WorkStealingPool(size_t threads);
+
+  size_t getThreads();
+
+  /**
+   * Calls job(index) once for every index below count, returns when they've
+   * all finished. The calls run concurrently, the job has to be thread safe
+   */
+  void run(size_t count, const std::function<void(size_t)>& job);
+};